@@ -0,0 +1,86 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <benchmark/benchmark.h>
+#include <memory>
+#include "../source/layer/details/attention.hpp"
+#include "../source/layer/details/matmul.hpp"
+#include "data/tensor.hpp"
+
+// 解码阶段每生成一个token的耗时: 参数依次为隐藏层维度, 头数, 已缓存的上下文长度和层数
+static void BM_AttentionDecode(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const uint32_t dim = state.range(0);
+  const uint32_t head_num = state.range(1);
+  const uint32_t context = state.range(2);
+  const uint32_t layer_num = state.range(3);
+  const uint32_t head_dim = dim / head_num;
+  const uint32_t block_size = 16;
+
+  auto kv_cache = std::make_shared<KVCache>(layer_num, head_num, head_dim, block_size,
+                                            context / block_size + 2);
+  const int32_t seq_id = kv_cache->AddSequence();
+  kv_cache->Extend(seq_id, context);
+
+  // 每层的query, key, value和输出投影
+  std::vector<std::vector<std::shared_ptr<LLamaMatmulLayer>>> projections(layer_num);
+  std::vector<std::shared_ptr<MultiHeadAttentionLayer>> attention_layers;
+  for (uint32_t layer = 0; layer < layer_num; ++layer) {
+    for (uint32_t i = 0; i < 4; ++i) {
+      sftensor weight = std::make_shared<ftensor>(1, dim, dim);
+      weight->RandN(0.f, 0.02f);
+      auto projection = std::make_shared<LLamaMatmulLayer>(dim, dim);
+      projection->set_weights({weight});
+      projections.at(layer).push_back(projection);
+    }
+    attention_layers.push_back(
+        std::make_shared<MultiHeadAttentionLayer>(head_num, head_num, head_dim, layer, kv_cache));
+    attention_layers.back()->set_sequences({seq_id});
+  }
+
+  sftensor hidden = std::make_shared<ftensor>(1, dim, 1);
+  hidden->RandN();
+  std::vector<sftensor> inputs = {hidden};
+  std::vector<sftensor> qkv = {std::make_shared<ftensor>(1, dim, 1),
+                               std::make_shared<ftensor>(1, dim, 1),
+                               std::make_shared<ftensor>(1, dim, 1)};
+  std::vector<sftensor> attention_outputs = {std::make_shared<ftensor>(1, dim, 1)};
+  for (auto _ : state) {
+    kv_cache->Extend(seq_id, 1);
+    for (uint32_t layer = 0; layer < layer_num; ++layer) {
+      for (uint32_t i = 0; i < 3; ++i) {
+        std::vector<sftensor> projection_outputs = {qkv.at(i)};
+        projections.at(layer).at(i)->Forward(inputs, projection_outputs);
+      }
+      attention_layers.at(layer)->Forward(qkv, attention_outputs);
+      std::vector<sftensor> outputs = {hidden};
+      projections.at(layer).at(3)->Forward(attention_outputs, outputs);
+    }
+    // 上下文长度保持不变
+    kv_cache->Truncate(seq_id, context);
+  }
+  state.counters["tokens_per_second"] =
+      benchmark::Counter(double(state.iterations()), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_AttentionDecode)->Args({1024, 16, 128, 4})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_AttentionDecode)->Args({1024, 16, 1024, 4})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_AttentionDecode)->Args({2048, 16, 2048, 2})->Unit(benchmark::kMillisecond);
@@ -77,6 +77,56 @@ BENCHMARK(BM_Convolution)->Args({256, 128, 40, 40, 1, 1})->Unit(benchmark::kMill
 
 BENCHMARK(BM_Convolution)->Args({512, 256, 20, 20, 1, 1})->Unit(benchmark::kMillisecond);
 
+static void BM_ConvolutionInt8(benchmark::State& state) {
+  using namespace kuiper_infer;
+
+  uint32_t kernel_count = state.range(0);
+  uint32_t channels = state.range(1);
+  uint32_t rows = state.range(2);
+  uint32_t cols = state.range(3);
+
+  uint32_t kernel_h = state.range(4);
+  uint32_t kernel_w = state.range(5);
+  sftensor input = std::make_shared<ftensor>(channels, rows, cols);
+  input->RandN();
+
+  std::vector<sftensor> weights(kernel_count);
+  for (uint32_t k = 0; k < kernel_count; ++k) {
+    sftensor weight = std::make_shared<ftensor>(channels, kernel_h, kernel_w);
+    weight->RandN();
+    weights.at(k) = weight;
+  }
+
+  std::vector<sftensor> outputs(1);
+  std::vector<sftensor> inputs;
+  inputs.push_back(input);
+  ConvolutionLayer conv_layer(kernel_count, channels, kernel_h, kernel_w, 0, 0, 1, 1, 1, false);
+  conv_layer.set_weights(weights);
+  if (!conv_layer.QuantizeInt8(0.f)) {
+    state.SkipWithError("The convolution can not be quantized");
+    return;
+  }
+  for (auto _ : state) {
+    conv_layer.Forward(inputs, outputs);
+  }
+}
+
+BENCHMARK(BM_ConvolutionInt8)->Args({64, 32, 160, 160, 3, 3})->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ConvolutionInt8)->Args({128, 64, 80, 80, 3, 3})->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ConvolutionInt8)->Args({256, 128, 40, 40, 3, 3})->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ConvolutionInt8)->Args({512, 256, 20, 20, 3, 3})->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ConvolutionInt8)->Args({64, 32, 160, 160, 1, 1})->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ConvolutionInt8)->Args({128, 64, 80, 80, 1, 1})->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ConvolutionInt8)->Args({256, 128, 40, 40, 1, 1})->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ConvolutionInt8)->Args({512, 256, 20, 20, 1, 1})->Unit(benchmark::kMillisecond);
+
 static void BM_DeConvolutionk2x2s2x2(benchmark::State& state) {
   using namespace kuiper_infer;
 
@@ -455,6 +455,29 @@ BENCHMARK(BM_Softmax)->Args({32})->Unit(benchmark::kMillisecond);
 BENCHMARK(BM_Softmax)->Args({512})->Unit(benchmark::kMillisecond);
 BENCHMARK(BM_Softmax)->Args({1024})->Unit(benchmark::kMillisecond);
 BENCHMARK(BM_Softmax)->Args({4096})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Softmax)->Args({32000})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Softmax)->Args({1 << 20})->Unit(benchmark::kMillisecond);
+
+// 沿通道方向的softmax, softmax轴在内存中不连续
+static void BM_SoftmaxDim0(benchmark::State& state) {
+  using namespace kuiper_infer;
+
+  uint32_t input_c = state.range(0);
+  uint32_t input_h = state.range(1);
+  uint32_t input_w = state.range(2);
+
+  std::shared_ptr<Tensor<float>> input = std::make_shared<Tensor<float>>(input_c, input_h, input_w);
+  input->RandN();
+  std::vector<sftensor> inputs = {input};
+  std::vector<std::shared_ptr<Tensor<float>>> outputs(1);
+  SoftmaxLayer softmax_layer(0);
+  for (auto _ : state) {
+    softmax_layer.Forward(inputs, outputs);
+  }
+}
+
+BENCHMARK(BM_SoftmaxDim0)->Args({21, 128, 128})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SoftmaxDim0)->Args({80, 80, 80})->Unit(benchmark::kMillisecond);
 
 BENCHMARK(BM_SoftmaxDim1Batch8)->Args({1, 224, 224})->Unit(benchmark::kMillisecond);
 BENCHMARK(BM_SoftmaxDim1Batch8)->Args({8, 128, 128})->Unit(benchmark::kMillisecond);
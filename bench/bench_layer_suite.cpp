@@ -0,0 +1,238 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Per layer benchmark suite.
+//
+// Every registered layer type is benchmarked over the real shapes of its
+// layers in the bundled models, for batch sizes 1/4/8 and thread counts from
+// 1 to the number of processors. Layers with identical type and shapes are
+// only run once. The models are built when the first layer benchmark runs,
+// layer types that do not occur in the available models are reported as
+// skipped.
+//
+// Run with --benchmark_filter=BM_LayerSuite --benchmark_out=layers.json
+// --benchmark_out_format=json to track the results.
+#include <benchmark/benchmark.h>
+#include <omp.h>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include "data/tensor_util.hpp"
+#include "layer/abstract/layer_factory.hpp"
+#include "runtime/runtime_ir.hpp"
+
+namespace {
+using namespace kuiper_infer;
+
+struct LayerBenchCase {
+  /// Keeps the layers and their weights alive
+  std::shared_ptr<RuntimeGraph> graph;
+
+  std::shared_ptr<RuntimeOperator> op;
+
+  /// Shapes of each input operand and of the output, without the batch dim
+  std::vector<std::vector<int32_t>> input_shapes;
+  std::vector<int32_t> output_shape;
+
+  /// Estimated cost of one sample
+  uint64_t flops = 0;
+  uint64_t bytes = 0;
+};
+
+sftensor CreateSampleTensor(const std::vector<int32_t>& shape) {
+  switch (shape.size()) {
+    case 3:
+      return TensorCreate<float>(shape.at(0), shape.at(1), shape.at(2));
+    case 2:
+      return TensorCreate<float>(shape.at(0), shape.at(1));
+    case 1:
+      return TensorCreate<float>(shape.at(0));
+    default:
+      LOG(FATAL) << "Unknown sample shape length: " << shape.size();
+      return nullptr;
+  }
+}
+
+std::vector<int32_t> SampleShape(const std::vector<int32_t>& shape) {
+  CHECK(!shape.empty());
+  return std::vector<int32_t>(shape.begin() + 1, shape.end());
+}
+
+std::string ShapeString(const std::vector<int32_t>& shape) {
+  std::stringstream ss;
+  for (size_t i = 0; i < shape.size(); ++i) {
+    ss << (i == 0 ? "" : "x") << shape.at(i);
+  }
+  return ss.str();
+}
+
+struct LayerSuiteCases {
+  /// Representative shapes of each layer type
+  std::map<std::string, std::vector<LayerBenchCase>> type_cases;
+
+  /// Bundled models whose files were not found
+  std::vector<std::string> missing_models;
+};
+
+/**
+ * Builds the bundled models on first use and extracts the representative
+ * layers, so that runs filtered to other benchmarks do not load any model.
+ */
+const LayerSuiteCases& GetLayerSuiteCases() {
+  static const LayerSuiteCases suite_cases = [] {
+    const std::vector<std::pair<std::string, std::string>> models = {
+        {"tmp/yolo/demo/yolov5n_small.pnnx.param", "tmp/yolo/demo/yolov5n_small.pnnx.bin"},
+        {"tmp/resnet/resnet18_batch8.pnnx.param", "tmp/resnet/resnet18_batch8.pnnx.bin"},
+        {"tmp/mobilenet/mobile_batch8.pnnx.param", "tmp/mobilenet/mobile_batch8.bin"},
+        {"tmp/unet/unet_demo.pnnx.param", "tmp/unet/unet_demo.pnnx.bin"},
+    };
+
+    LayerSuiteCases cases;
+    std::set<std::string> case_keys;
+    for (const auto& [param_path, bin_path] : models) {
+      if (!std::ifstream(param_path).good() || !std::ifstream(bin_path).good()) {
+        cases.missing_models.push_back(param_path);
+        continue;
+      }
+      auto graph = std::make_shared<RuntimeGraph>(param_path, bin_path);
+      graph->Build();
+
+      const auto& operators = graph->operators();
+      const auto& op_costs = graph->operator_costs();
+      for (size_t i = 0; i < operators.size(); ++i) {
+        const auto& op = operators.at(i);
+        if (op->layer == nullptr || op->output_operands == nullptr) {
+          continue;
+        }
+
+        LayerBenchCase bench_case;
+        bench_case.graph = graph;
+        bench_case.op = op;
+        std::string key = op->type;
+        for (const auto& input_operand : op->input_operands_seq) {
+          bench_case.input_shapes.push_back(SampleShape(input_operand->shapes));
+          key += "_" + ShapeString(bench_case.input_shapes.back());
+        }
+        bench_case.output_shape = SampleShape(op->output_operands->shapes);
+        key += "_" + ShapeString(bench_case.output_shape);
+
+        // 相同类型、相同输入输出形状且计算量相同的算子只测试一次
+        const uint64_t model_batch = op->output_operands->shapes.front();
+        bench_case.flops = op_costs.at(i).flops / model_batch;
+        bench_case.bytes = op_costs.at(i).bytes / model_batch;
+        key += "_" + std::to_string(bench_case.flops);
+        if (case_keys.insert(key).second) {
+          cases.type_cases[op->type].push_back(bench_case);
+        }
+      }
+    }
+    return cases;
+  }();
+  return suite_cases;
+}
+
+// 每次迭代依次执行该类型的全部代表性形状
+void BM_LayerSuite(benchmark::State& state, const std::string& layer_type) {
+  const LayerSuiteCases& suite_cases = GetLayerSuiteCases();
+  const auto& type_cases_iter = suite_cases.type_cases.find(layer_type);
+  if (type_cases_iter == suite_cases.type_cases.end()) {
+    std::string message = "No representative shape of this layer type in the bundled models";
+    for (const std::string& missing_model : suite_cases.missing_models) {
+      message += ", missing " + missing_model;
+    }
+    state.SkipWithError(message.c_str());
+    return;
+  }
+  const std::vector<LayerBenchCase>& bench_cases = type_cases_iter->second;
+
+  const uint32_t batch_size = state.range(0);
+  const int32_t thread_num = static_cast<int32_t>(state.range(1));
+  const int32_t prev_thread_num = omp_get_max_threads();
+  omp_set_num_threads(thread_num);
+
+  // 输入的排列方式与Layer::Forward()相同, 按操作数依次排列各自的batch
+  std::vector<std::vector<sftensor>> case_inputs;
+  std::vector<std::vector<sftensor>> case_outputs;
+  uint64_t flops = 0;
+  uint64_t bytes = 0;
+  for (const LayerBenchCase& bench_case : bench_cases) {
+    std::vector<sftensor> inputs;
+    for (const auto& input_shape : bench_case.input_shapes) {
+      for (uint32_t b = 0; b < batch_size; ++b) {
+        sftensor input = CreateSampleTensor(input_shape);
+        input->RandN();
+        inputs.push_back(input);
+      }
+    }
+    std::vector<sftensor> outputs;
+    for (uint32_t b = 0; b < batch_size; ++b) {
+      outputs.push_back(CreateSampleTensor(bench_case.output_shape));
+    }
+    if (bench_case.op->layer->Forward(inputs, outputs) != StatusCode::kSuccess) {
+      omp_set_num_threads(prev_thread_num);
+      const std::string& message = "The layer forward failed: " + bench_case.op->name;
+      state.SkipWithError(message.c_str());
+      return;
+    }
+    case_inputs.push_back(std::move(inputs));
+    case_outputs.push_back(std::move(outputs));
+    flops += bench_case.flops;
+    bytes += bench_case.bytes;
+  }
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < bench_cases.size(); ++i) {
+      bench_cases.at(i).op->layer->Forward(case_inputs.at(i), case_outputs.at(i));
+    }
+  }
+
+  state.SetLabel(std::to_string(bench_cases.size()) + " shapes");
+  state.SetItemsProcessed(int64_t(state.iterations()) * batch_size);
+  state.SetBytesProcessed(int64_t(state.iterations()) * bytes * batch_size);
+  state.counters["FLOPS"] =
+      benchmark::Counter(double(flops) * batch_size, benchmark::Counter::kIsIterationInvariantRate,
+                         benchmark::Counter::kIs1000);
+  omp_set_num_threads(prev_thread_num);
+}
+
+// 注册时不加载模型, 模型在第一个运行的层基准测试中才构建
+bool RegisterLayerSuite() {
+  std::vector<int64_t> thread_nums;
+  const int32_t max_thread_num = omp_get_num_procs();
+  for (int32_t thread_num = 1; thread_num < max_thread_num; thread_num *= 2) {
+    thread_nums.push_back(thread_num);
+  }
+  thread_nums.push_back(max_thread_num);
+
+  for (const std::string& layer_type : LayerRegisterer::layer_types()) {
+    const std::string& bench_name = "BM_LayerSuite/" + layer_type;
+    benchmark::RegisterBenchmark(bench_name.c_str(), BM_LayerSuite, layer_type)
+        ->ArgsProduct({{1, 4, 8}, thread_nums})
+        ->ArgNames({"batch", "threads"})
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+  }
+  return true;
+}
+
+const bool layer_suite_registered = RegisterLayerSuite();
+}  // namespace
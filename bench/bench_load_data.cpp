@@ -0,0 +1,70 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <fstream>
+#include "data/load_data.hpp"
+
+static std::string BenchFilePath(const std::string& file_name) {
+  return (std::filesystem::temp_directory_path() / file_name).string();
+}
+
+static void BM_LoadCSV(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const uint32_t rows = state.range(0);
+  const uint32_t cols = state.range(1);
+  const std::string file_path = BenchFilePath("kuiper_bench_load.csv");
+  {
+    std::ofstream out(file_path);
+    for (uint32_t i = 0; i < rows; ++i) {
+      for (uint32_t j = 0; j < cols; ++j) {
+        out << float(i * cols + j) * 0.37f << (j + 1 < cols ? ',' : '\n');
+      }
+    }
+  }
+  for (auto _ : state) {
+    arma::fmat data = CSVDataLoader::LoadData<float>(file_path);
+    benchmark::DoNotOptimize(data.memptr());
+  }
+  std::filesystem::remove(file_path);
+}
+
+BENCHMARK(BM_LoadCSV)->Args({1024, 1024})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadCSV)->Args({256, 256})->Unit(benchmark::kMillisecond);
+
+static void BM_LoadNpy(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const uint32_t rows = state.range(0);
+  const uint32_t cols = state.range(1);
+  const std::string file_path = BenchFilePath("kuiper_bench_load.npy");
+  std::shared_ptr<Tensor<float>> tensor = std::make_shared<Tensor<float>>(1, rows, cols);
+  tensor->RandN();
+  NpyDataLoader::SaveTensor(file_path, tensor);
+  for (auto _ : state) {
+    std::shared_ptr<Tensor<float>> loaded = NpyDataLoader::LoadTensor<float>(file_path);
+    benchmark::DoNotOptimize(loaded->raw_ptr());
+  }
+  std::filesystem::remove(file_path);
+}
+
+BENCHMARK(BM_LoadNpy)->Args({1024, 1024})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadNpy)->Args({256, 256})->Unit(benchmark::kMillisecond);
@@ -0,0 +1,90 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <benchmark/benchmark.h>
+#include <memory>
+#include "../source/layer/details/linear.hpp"
+#include "../source/layer/details/matmul.hpp"
+#include "data/tensor.hpp"
+
+// 解码阶段的矩阵向量乘: 参数依次为权重格式, 输出维度, 输入维度和分组大小
+static void BM_LLamaMatmulDecode(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const auto format = static_cast<math::WeightFormat>(state.range(0));
+  const uint32_t weight_dim0 = state.range(1);
+  const uint32_t weight_dim1 = state.range(2);
+  const uint32_t group_size = state.range(3);
+
+  sftensor weight = std::make_shared<ftensor>(1, weight_dim0, weight_dim1);
+  weight->RandN();
+  LLamaMatmulLayer matmul_layer(weight_dim0, weight_dim1);
+  matmul_layer.set_weights({weight});
+  weight.reset();
+  if (!matmul_layer.ConvertWeights(format, group_size)) {
+    state.SkipWithError("The weights of the matmul layer can not be converted");
+    return;
+  }
+
+  sftensor input = std::make_shared<ftensor>(weight_dim1, 1);
+  input->RandN();
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> outputs = {std::make_shared<ftensor>(1, weight_dim0, 1)};
+  for (auto _ : state) {
+    matmul_layer.Forward(inputs, outputs);
+  }
+  state.counters["MB_per_forward"] =
+      double(matmul_layer.EstimateBytes({{int32_t(weight_dim1), 1}})) / (1024. * 1024.);
+}
+
+// 0: float32, 1: float16, 3: int8分组量化, 4: int4分组量化
+BENCHMARK(BM_LLamaMatmulDecode)->Args({0, 4096, 4096, 0})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LLamaMatmulDecode)->Args({1, 4096, 4096, 0})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LLamaMatmulDecode)->Args({3, 4096, 4096, 64})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LLamaMatmulDecode)->Args({4, 4096, 4096, 32})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LLamaMatmulDecode)->Args({4, 4096, 4096, 64})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LLamaMatmulDecode)->Args({4, 4096, 4096, 128})->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_LLamaMatmulDecode)->Args({0, 11008, 4096, 0})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LLamaMatmulDecode)->Args({3, 11008, 4096, 64})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LLamaMatmulDecode)->Args({4, 11008, 4096, 64})->Unit(benchmark::kMillisecond);
+
+// 单行输入的全连接层, 走矩阵向量乘的路径: 参数依次为输入维度和输出维度
+static void BM_LinearDecode(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const uint32_t in_features = state.range(0);
+  const uint32_t out_features = state.range(1);
+
+  sftensor weight = std::make_shared<ftensor>(1, in_features, out_features);
+  weight->RandN();
+  LinearLayer linear_layer(in_features, out_features, false);
+  linear_layer.set_weights(std::vector<sftensor>{weight});
+
+  sftensor input = std::make_shared<ftensor>(1, 1, in_features);
+  input->RandN();
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> outputs = {std::make_shared<ftensor>(1, 1, out_features)};
+  for (auto _ : state) {
+    linear_layer.Forward(inputs, outputs);
+  }
+}
+
+BENCHMARK(BM_LinearDecode)->Args({4096, 4096})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LinearDecode)->Args({4096, 11008})->Unit(benchmark::kMillisecond);
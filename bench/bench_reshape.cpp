@@ -22,6 +22,7 @@
 // Created by fss on 2023/3/20.
 #include <benchmark/benchmark.h>
 #include "data/tensor.hpp"
+#include "data/tensor_row_major.hpp"
 #include "data/tensor_util.hpp"
 
 static void BM_ReshapeRowMajor(benchmark::State& state) {
@@ -54,6 +55,37 @@ static void BM_ReshapeColMajor(benchmark::State& state) {
   }
 }
 
+static void BM_FlattenView(benchmark::State& state) {
+  using namespace kuiper_infer;
+  std::vector<sftensor> tensors;
+  const uint32_t batch_size = 8;
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    tensors.push_back(TensorCreate<float>({2048, 1, 1}));
+  }
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < batch_size; ++i) {
+      sftensor output = TensorReshape(tensors.at(i), {2048});
+      benchmark::DoNotOptimize(output);
+    }
+  }
+}
+
+static void BM_FlattenCopy(benchmark::State& state) {
+  using namespace kuiper_infer;
+  std::vector<sftensor> tensors;
+  const uint32_t batch_size = 8;
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    tensors.push_back(TensorCreate<float>({2048, 1, 1}));
+  }
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < batch_size; ++i) {
+      sftensor output = TensorClone(tensors.at(i));
+      output->Reshape({2048}, true);
+      benchmark::DoNotOptimize(output);
+    }
+  }
+}
+
 static void BM_FillRowMajor(benchmark::State& state) {
   using namespace kuiper_infer;
   sftensor tensor = TensorCreate<float>({32, 320, 320});
@@ -63,6 +95,44 @@ static void BM_FillRowMajor(benchmark::State& state) {
   }
 }
 
+static void BM_FillRowMajorTensor(benchmark::State& state) {
+  using namespace kuiper_infer;
+  RowMajorTensor<float> tensor(32, 320, 320);
+  std::vector<float> values(32 * 320 * 320, 1.f);
+  for (auto _ : state) {
+    tensor.Fill(values);
+  }
+}
+
+static void BM_RowMajorToTensor(benchmark::State& state) {
+  using namespace kuiper_infer;
+  RowMajorTensor<float> tensor(32, 320, 320);
+  tensor.Fill(1.f);
+  for (auto _ : state) {
+    sftensor output = tensor.ToTensor();
+    benchmark::DoNotOptimize(output);
+  }
+}
+
+static void BM_RowMajorTensorReshape(benchmark::State& state) {
+  using namespace kuiper_infer;
+  std::vector<RowMajorTensor<float>> tensors;
+  const uint32_t batch_size = 8;
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    tensors.emplace_back(32, 320, 320);
+  }
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < batch_size; ++i) {
+      tensors.at(i).Reshape({320, 320, 32});
+    }
+  }
+}
+
 BENCHMARK(BM_FillRowMajor)->Unit(benchmark::kMillisecond);
 BENCHMARK(BM_ReshapeRowMajor)->Unit(benchmark::kMillisecond);
 BENCHMARK(BM_ReshapeColMajor)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FlattenView)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FlattenCopy)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FillRowMajorTensor)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RowMajorToTensor)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RowMajorTensorReshape)->Unit(benchmark::kMicrosecond);
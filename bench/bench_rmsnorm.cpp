@@ -1,4 +1,26 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
 #include <benchmark/benchmark.h>
+#include <cmath>
 #include <cstring>
 #include <ctime>
 #include <memory>
@@ -38,3 +60,70 @@ BENCHMARK(BM_RMSNorm)->Unit(benchmark::kMillisecond)->Arg(128)->Iterations(3);
 BENCHMARK(BM_RMSNorm)->Unit(benchmark::kMillisecond)->Arg(512)->Iterations(3);
 BENCHMARK(BM_RMSNorm)->Unit(benchmark::kMillisecond)->Arg(1024)->Iterations(3);
 BENCHMARK(BM_RMSNorm)->Unit(benchmark::kMillisecond)->Arg(4096)->Iterations(3);
+
+// 按token逐行归一化: 参数依次为隐藏层维度和token数
+static void BM_RMSNormRows(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const uint32_t hidden = state.range(0);
+  const uint32_t tokens = state.range(1);
+  sftensor weight = std::make_shared<ftensor>(hidden);
+  weight->RandN();
+  sftensor input = std::make_shared<ftensor>(1, hidden, tokens);
+  input->RandN();
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> outputs = {std::make_shared<ftensor>(1, hidden, tokens)};
+
+  RMSNormLayer rms;
+  rms.set_weights(std::vector<sftensor>{weight});
+  for (auto _ : state) {
+    rms.Forward(inputs, outputs);
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * input->size() * 2 * sizeof(float));
+}
+
+// 原先的实现: 平方, 求均值和缩放各遍历一次, 并为平方的结果分配临时向量
+static void BM_RMSNormRowsArma(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const uint32_t hidden = state.range(0);
+  const uint32_t tokens = state.range(1);
+  arma::fvec weight_vec(hidden, arma::fill::randn);
+  arma::fmat input_mat(hidden, tokens, arma::fill::randn);
+  arma::fmat output_mat(hidden, tokens);
+  for (auto _ : state) {
+    for (uint32_t t = 0; t < tokens; ++t) {
+      arma::fvec input_vec(input_mat.colptr(t), hidden, false, true);
+      const arma::fvec& input_pow_vec = arma::pow(input_vec, 2.f);
+      const float norm_value = 1.f / std::sqrt(arma::mean(input_pow_vec) + 1e-5f);
+      arma::fvec output_vec(output_mat.colptr(t), hidden, false, true);
+      output_vec = weight_vec % (norm_value * input_vec);
+    }
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * input_mat.n_elem * 2 * sizeof(float));
+}
+
+// 残差相加和归一化融合为一次调用
+static void BM_RMSNormResidual(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const uint32_t hidden = state.range(0);
+  const uint32_t tokens = state.range(1);
+  sftensor weight = std::make_shared<ftensor>(hidden);
+  weight->RandN();
+  sftensor input = std::make_shared<ftensor>(1, hidden, tokens);
+  input->RandN();
+  sftensor residual = std::make_shared<ftensor>(1, hidden, tokens);
+  residual->Fill(0.f);
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> residuals = {residual};
+  std::vector<sftensor> outputs = {std::make_shared<ftensor>(1, hidden, tokens)};
+
+  RMSNormLayer rms;
+  rms.set_weights(std::vector<sftensor>{weight});
+  for (auto _ : state) {
+    rms.ForwardResidual(inputs, residuals, outputs);
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * input->size() * 4 * sizeof(float));
+}
+
+BENCHMARK(BM_RMSNormRows)->Args({4096, 1})->Args({4096, 128})->Args({5120, 512});
+BENCHMARK(BM_RMSNormRowsArma)->Args({4096, 1})->Args({4096, 128})->Args({5120, 512});
+BENCHMARK(BM_RMSNormResidual)->Args({4096, 1})->Args({4096, 128})->Args({5120, 512});
@@ -5,6 +5,7 @@
 #include <benchmark/benchmark.h>
 #include <armadillo>
 #include "../source/layer/details/simd.hpp"
+#include "data/tensor_util.hpp"
 static void BM_SigmoidSimd(benchmark::State& state) {
   using namespace kuiper_infer;
   uint32_t input_c = state.range(0);
@@ -109,4 +110,44 @@ static void BM_SiluSimd(benchmark::State& state) {
 
 BENCHMARK(BM_SiluSimd)->Args({255, 80, 80})->Unit(benchmark::kMillisecond);
 BENCHMARK(BM_SiluSimd)->Args({255, 40, 40})->Unit(benchmark::kMillisecond);
-BENCHMARK(BM_SiluSimd)->Args({255, 20, 20})->Unit(benchmark::kMillisecond);
\ No newline at end of file
+BENCHMARK(BM_SiluSimd)->Args({255, 20, 20})->Unit(benchmark::kMillisecond);
+
+static void BM_ElementAddBroadcast(benchmark::State& state) {
+  using namespace kuiper_infer;
+  uint32_t input_c = state.range(0);
+  uint32_t input_h = state.range(1);
+  uint32_t input_w = state.range(2);
+  sftensor input = std::make_shared<ftensor>(input_c, input_h, input_w);
+  input->RandN();
+  sftensor bias = std::make_shared<ftensor>(input_c, 1, 1);
+  bias->RandN();
+  sftensor output = std::make_shared<ftensor>(input_c, input_h, input_w);
+  for (auto _ : state) {
+    TensorElementBinary(BinaryType::kAdd, input, bias, output);
+  }
+}
+
+BENCHMARK(BM_ElementAddBroadcast)->Args({255, 80, 80})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ElementAddBroadcast)->Args({255, 40, 40})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ElementAddBroadcast)->Args({255, 20, 20})->Unit(benchmark::kMillisecond);
+
+static void BM_ElementAddBroadcastArma(benchmark::State& state) {
+  using namespace kuiper_infer;
+  uint32_t input_c = state.range(0);
+  uint32_t input_h = state.range(1);
+  uint32_t input_w = state.range(2);
+  sftensor input = std::make_shared<ftensor>(input_c, input_h, input_w);
+  input->RandN();
+  sftensor bias = std::make_shared<ftensor>(input_c, 1, 1);
+  bias->RandN();
+  sftensor output = std::make_shared<ftensor>(input_c, input_h, input_w);
+  for (auto _ : state) {
+    // 先复制出广播后的张量再相加
+    const auto& [input1, input2] = TensorBroadcast(input, bias);
+    output->set_data(input1->data() + input2->data());
+  }
+}
+
+BENCHMARK(BM_ElementAddBroadcastArma)->Args({255, 80, 80})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ElementAddBroadcastArma)->Args({255, 40, 40})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ElementAddBroadcastArma)->Args({255, 20, 20})->Unit(benchmark::kMillisecond);
@@ -21,7 +21,10 @@
 
 // Created by fss on 23-2-2.
 #include <benchmark/benchmark.h>
+#include "../source/layer/details/image_pre_process.hpp"
+#include "data/tensor_util.hpp"
 #include "runtime/runtime_ir.hpp"
+#include "runtime/runtime_pipeline.hpp"
 const static int kIterationNum = 5;
 
 static void BM_Yolov5nano_Batch4_320x320(benchmark::State& state) {
@@ -85,6 +88,78 @@ static void BM_Yolov5s_Batch8_640x640(benchmark::State& state) {
   }
 }
 
+static void BM_ImagePreProcess_1280x720_640x640(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const uint32_t rows = 720;
+  const uint32_t cols = 1280;
+  std::vector<uint8_t> image(rows * cols * 3);
+  for (uint32_t i = 0; i < image.size(); ++i) {
+    image.at(i) = uint8_t(i % 251);
+  }
+  ImagePreProcess pre_process(640, 640);
+  std::vector<ImageBuffer> images = {ImageBuffer{image.data(), rows, cols, cols * 3}};
+  std::vector<sftensor> outputs(1);
+  for (auto _ : state) {
+    pre_process.Forward(images, outputs);
+  }
+}
+
+// 每个请求包含4张图像的预处理和一次前向
+static std::vector<kuiper_infer::sftensor> PreProcessBatch4_320x320(
+    const kuiper_infer::ImagePreProcess& pre_process, const std::vector<uint8_t>& image) {
+  using namespace kuiper_infer;
+  const ImageBuffer buffer{image.data(), 720, 1280, 1280 * 3};
+  std::vector<sftensor> inputs(4);
+  pre_process.Forward({buffer, buffer, buffer, buffer}, inputs);
+  return inputs;
+}
+
+static void BM_Yolov5nano_Serial_320x320(benchmark::State& state) {
+  using namespace kuiper_infer;
+  RuntimeGraph graph("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                     "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  graph.Build();
+  ImagePreProcess pre_process(320, 320);
+  std::vector<uint8_t> image(720 * 1280 * 3, 127);
+  const uint32_t request_num = 8;
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < request_num; ++i) {
+      graph.set_inputs("pnnx_input_0", PreProcessBatch4_320x320(pre_process, image));
+      graph.Forward(false);
+      // 与流水线一样拷贝输出, 两者只相差阶段之间的重叠
+      std::vector<sftensor> outputs;
+      for (const sftensor& output : graph.get_outputs("pnnx_output_0")) {
+        outputs.push_back(TensorClone(output));
+      }
+      benchmark::DoNotOptimize(outputs);
+    }
+  }
+}
+
+static void BM_Yolov5nano_Pipeline_320x320(benchmark::State& state) {
+  using namespace kuiper_infer;
+  auto graph = std::make_shared<RuntimeGraph>("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                                              "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  graph->Build();
+  ImagePreProcess pre_process(320, 320);
+  std::vector<uint8_t> image(720 * 1280 * 3, 127);
+  const uint32_t request_num = 8;
+  RuntimePipeline pipeline(graph, "pnnx_input_0", "pnnx_output_0");
+  for (auto _ : state) {
+    std::vector<std::future<std::vector<sftensor>>> results;
+    for (uint32_t i = 0; i < request_num; ++i) {
+      results.push_back(pipeline.Submit(
+          [&pre_process, &image]() { return PreProcessBatch4_320x320(pre_process, image); }));
+    }
+    for (auto& result : results) {
+      benchmark::DoNotOptimize(result.get());
+    }
+  }
+}
+
 BENCHMARK(BM_Yolov5nano_Batch4_320x320)->Unit(benchmark::kMillisecond)->Iterations(5);
 BENCHMARK(BM_Yolov5s_Batch4_640x640)->Unit(benchmark::kMillisecond)->Iterations(5);
-BENCHMARK(BM_Yolov5s_Batch8_640x640)->Unit(benchmark::kMillisecond)->Iterations(5);
\ No newline at end of file
+BENCHMARK(BM_Yolov5s_Batch8_640x640)->Unit(benchmark::kMillisecond)->Iterations(5);
+BENCHMARK(BM_ImagePreProcess_1280x720_640x640)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Yolov5nano_Serial_320x320)->Unit(benchmark::kMillisecond)->Iterations(5);
+BENCHMARK(BM_Yolov5nano_Pipeline_320x320)->Unit(benchmark::kMillisecond)->Iterations(5);
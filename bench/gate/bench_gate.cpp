@@ -0,0 +1,484 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Performance regression gate for the model level benchmarks.
+//
+// Runs bench_kuiper on the model benchmarks with a fixed repetition count,
+// then compares the median and p99 time of every benchmark with the baseline
+// file. Exits with 1 if any benchmark is slower than its tolerance allows or
+// is missing from the results, and with 2 on usage or IO errors.
+//
+//   bench_gate --bench=./bench_kuiper --baseline=../bench/gate/model_baseline.json
+//   bench_gate --result=result.json --baseline=...   compare an existing run
+//   bench_gate --bench=./bench_kuiper --baseline=... --update
+//
+// The baseline file looks like:
+//   {
+//     "default_tolerance": 0.1,
+//     "benchmarks": {
+//       "BM_Resnet18_Batch8_224x224": {"median_ms": 95.2, "p99_ms": 101.3, "tolerance": 0.15}
+//     }
+//   }
+// Without --filter only the benchmarks of the baseline file are run. Entries
+// without recorded times fail the gate until they are recorded with --update.
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+const int kExitRegression = 1;
+const int kExitError = 2;
+
+/**
+ * @brief Minimal JSON value, enough for benchmark and baseline files
+ */
+struct JsonValue {
+  enum class Type { kNull, kBool, kNumber, kString, kArray, kObject };
+  Type type = Type::kNull;
+  bool boolean = false;
+  double number = 0.;
+  std::string str;
+  std::vector<JsonValue> array;
+  std::map<std::string, JsonValue> object;
+
+  const JsonValue* find(const std::string& key) const {
+    if (type != Type::kObject) {
+      return nullptr;
+    }
+    const auto iter = object.find(key);
+    return iter == object.end() ? nullptr : &iter->second;
+  }
+};
+
+class JsonParser {
+ public:
+  explicit JsonParser(std::string text) : text_(std::move(text)) {}
+
+  bool Parse(JsonValue& value) {
+    if (!ParseValue(value)) {
+      return false;
+    }
+    SkipSpace();
+    return pos_ == text_.size();
+  }
+
+ private:
+  void SkipSpace() {
+    while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+      pos_ += 1;
+    }
+  }
+
+  bool Consume(char c) {
+    SkipSpace();
+    if (pos_ < text_.size() && text_[pos_] == c) {
+      pos_ += 1;
+      return true;
+    }
+    return false;
+  }
+
+  bool ParseLiteral(const std::string& literal) {
+    if (text_.compare(pos_, literal.size(), literal) != 0) {
+      return false;
+    }
+    pos_ += literal.size();
+    return true;
+  }
+
+  bool ParseString(std::string& str) {
+    if (!Consume('"')) {
+      return false;
+    }
+    while (pos_ < text_.size() && text_[pos_] != '"') {
+      char c = text_[pos_++];
+      if (c == '\\' && pos_ < text_.size()) {
+        const char escaped = text_[pos_++];
+        switch (escaped) {
+          case 'n':
+            c = '\n';
+            break;
+          case 't':
+            c = '\t';
+            break;
+          case 'u':
+            // 基准测试名称中不会出现非ASCII字符, 直接跳过
+            pos_ = std::min(pos_ + 4, text_.size());
+            c = '?';
+            break;
+          default:
+            c = escaped;
+        }
+      }
+      str.push_back(c);
+    }
+    return Consume('"');
+  }
+
+  bool ParseValue(JsonValue& value) {
+    SkipSpace();
+    if (pos_ >= text_.size()) {
+      return false;
+    }
+    const char c = text_[pos_];
+    if (c == '{') {
+      value.type = JsonValue::Type::kObject;
+      pos_ += 1;
+      if (Consume('}')) {
+        return true;
+      }
+      do {
+        std::string key;
+        JsonValue member;
+        if (!ParseString(key) || !Consume(':') || !ParseValue(member)) {
+          return false;
+        }
+        value.object[key] = std::move(member);
+      } while (Consume(','));
+      return Consume('}');
+    } else if (c == '[') {
+      value.type = JsonValue::Type::kArray;
+      pos_ += 1;
+      if (Consume(']')) {
+        return true;
+      }
+      do {
+        JsonValue element;
+        if (!ParseValue(element)) {
+          return false;
+        }
+        value.array.push_back(std::move(element));
+      } while (Consume(','));
+      return Consume(']');
+    } else if (c == '"') {
+      value.type = JsonValue::Type::kString;
+      return ParseString(value.str);
+    } else if (c == 't' || c == 'f') {
+      value.type = JsonValue::Type::kBool;
+      value.boolean = c == 't';
+      return ParseLiteral(value.boolean ? "true" : "false");
+    } else if (c == 'n') {
+      value.type = JsonValue::Type::kNull;
+      return ParseLiteral("null");
+    }
+    value.type = JsonValue::Type::kNumber;
+    const char* begin = text_.c_str() + pos_;
+    char* end = nullptr;
+    value.number = std::strtod(begin, &end);
+    if (end == begin) {
+      return false;
+    }
+    pos_ += end - begin;
+    return true;
+  }
+
+  std::string text_;
+  size_t pos_ = 0;
+};
+
+bool LoadJson(const std::string& path, JsonValue& value) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "Can not open the json file: " << path << std::endl;
+    return false;
+  }
+  std::stringstream ss;
+  ss << file.rdbuf();
+  if (!JsonParser(ss.str()).Parse(value)) {
+    std::cerr << "Can not parse the json file: " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+double ToMilliseconds(double time, const std::string& time_unit) {
+  if (time_unit == "ns") {
+    return time / 1e6;
+  } else if (time_unit == "us") {
+    return time / 1e3;
+  } else if (time_unit == "s") {
+    return time * 1e3;
+  }
+  return time;
+}
+
+struct BenchTimes {
+  double median_ms = 0.;
+  double p99_ms = 0.;
+  size_t repetitions = 0;
+};
+
+/// Collects the real time of every repetition and reduces it to median and p99
+std::map<std::string, BenchTimes> CollectTimes(const JsonValue& result) {
+  std::map<std::string, std::vector<double>> repetition_times;
+  const JsonValue* benchmarks = result.find("benchmarks");
+  if (benchmarks == nullptr) {
+    return {};
+  }
+  for (const JsonValue& benchmark : benchmarks->array) {
+    const JsonValue* run_type = benchmark.find("run_type");
+    if (run_type != nullptr && run_type->str != "iteration") {
+      continue;
+    }
+    const JsonValue* error = benchmark.find("error_occurred");
+    if (error != nullptr && error->boolean) {
+      continue;
+    }
+    const JsonValue* run_name = benchmark.find("run_name");
+    if (run_name == nullptr) {
+      run_name = benchmark.find("name");
+    }
+    const JsonValue* real_time = benchmark.find("real_time");
+    const JsonValue* time_unit = benchmark.find("time_unit");
+    if (run_name == nullptr || real_time == nullptr) {
+      continue;
+    }
+    repetition_times[run_name->str].push_back(
+        ToMilliseconds(real_time->number, time_unit ? time_unit->str : "ns"));
+  }
+
+  std::map<std::string, BenchTimes> times;
+  for (auto& [name, values] : repetition_times) {
+    std::sort(values.begin(), values.end());
+    const size_t size = values.size();
+    BenchTimes bench_times;
+    bench_times.repetitions = size;
+    bench_times.median_ms =
+        size % 2 == 1 ? values[size / 2] : (values[size / 2 - 1] + values[size / 2]) / 2.;
+    const size_t p99_index = static_cast<size_t>(std::ceil(0.99 * double(size)));
+    bench_times.p99_ms = values[p99_index == 0 ? 0 : p99_index - 1];
+    times[name] = bench_times;
+  }
+  return times;
+}
+
+bool WriteBaseline(const std::string& path, const JsonValue& baseline,
+                   const std::map<std::string, BenchTimes>& times) {
+  double default_tolerance = 0.1;
+  if (const JsonValue* tolerance = baseline.find("default_tolerance")) {
+    default_tolerance = tolerance->number;
+  }
+  std::map<std::string, double> tolerances;
+  if (const JsonValue* benchmarks = baseline.find("benchmarks")) {
+    for (const auto& [name, entry] : benchmarks->object) {
+      if (const JsonValue* tolerance = entry.find("tolerance")) {
+        tolerances[name] = tolerance->number;
+      }
+    }
+  }
+
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "Can not write the baseline file: " << path << std::endl;
+    return false;
+  }
+  file << std::fixed << std::setprecision(3);
+  file << "{\n  \"default_tolerance\": " << default_tolerance << ",\n  \"benchmarks\": {";
+  bool first = true;
+  for (const auto& [name, bench_times] : times) {
+    file << (first ? "\n" : ",\n") << "    \"" << name << "\": {\"median_ms\": "
+         << bench_times.median_ms << ", \"p99_ms\": " << bench_times.p99_ms;
+    const auto tolerance_iter = tolerances.find(name);
+    if (tolerance_iter != tolerances.end()) {
+      file << ", \"tolerance\": " << tolerance_iter->second;
+    }
+    file << "}";
+    first = false;
+  }
+  file << "\n  }\n}\n";
+  return file.good();
+}
+
+/// Anchored filter running exactly the benchmark families of the baseline
+std::string BaselineFilter(const JsonValue& baseline) {
+  std::string filter;
+  if (const JsonValue* benchmarks = baseline.find("benchmarks")) {
+    for (const auto& [name, _] : benchmarks->object) {
+      // 名称中/之后是iterations等参数, 只按基准测试函数名匹配
+      filter += (filter.empty() ? "" : "|") + name.substr(0, name.find('/'));
+    }
+  }
+  return "^(" + filter + ")(/|$)";
+}
+
+std::string FormatDiff(double current, double base) {
+  std::stringstream ss;
+  ss << std::showpos << std::fixed << std::setprecision(1) << (current / base - 1.) * 100. << "%";
+  return ss.str();
+}
+
+int Compare(const JsonValue& baseline, const std::map<std::string, BenchTimes>& times) {
+  double default_tolerance = 0.1;
+  if (const JsonValue* tolerance = baseline.find("default_tolerance")) {
+    default_tolerance = tolerance->number;
+  }
+  const JsonValue* baseline_benchmarks = baseline.find("benchmarks");
+  if (baseline_benchmarks == nullptr) {
+    std::cerr << "The baseline file has no benchmarks" << std::endl;
+    return kExitError;
+  }
+
+  std::cout << std::left << std::setw(44) << "benchmark" << std::right << std::setw(12)
+            << "base med" << std::setw(12) << "cur med" << std::setw(9) << "diff"
+            << std::setw(12) << "base p99" << std::setw(12) << "cur p99" << std::setw(9)
+            << "diff" << std::setw(7) << "tol" << "  status" << std::endl;
+
+  int exit_code = 0;
+  uint32_t no_baseline_num = 0;
+  std::cout << std::fixed << std::setprecision(2);
+  for (const auto& [name, entry] : baseline_benchmarks->object) {
+    double tolerance = default_tolerance;
+    if (const JsonValue* entry_tolerance = entry.find("tolerance")) {
+      tolerance = entry_tolerance->number;
+    }
+    const JsonValue* base_median = entry.find("median_ms");
+    const JsonValue* base_p99 = entry.find("p99_ms");
+
+    std::cout << std::left << std::setw(44) << name << std::right;
+    const auto times_iter = times.find(name);
+    if (times_iter == times.end()) {
+      std::cout << "  MISSING" << std::endl;
+      exit_code = kExitRegression;
+      continue;
+    }
+    const BenchTimes& current = times_iter->second;
+    if (base_median == nullptr || base_p99 == nullptr ||
+        base_median->type != JsonValue::Type::kNumber ||
+        base_p99->type != JsonValue::Type::kNumber) {
+      // 没有记录时间的基准测试无法比较, 不能当作通过
+      std::cout << std::setw(12) << "-" << std::setw(12) << current.median_ms << std::setw(9)
+                << "-" << std::setw(12) << "-" << std::setw(12) << current.p99_ms
+                << std::setw(9) << "-" << std::setw(7) << tolerance << "  NO BASELINE"
+                << std::endl;
+      no_baseline_num += 1;
+      exit_code = kExitRegression;
+      continue;
+    }
+
+    const bool median_regressed = current.median_ms > base_median->number * (1. + tolerance);
+    const bool p99_regressed = current.p99_ms > base_p99->number * (1. + tolerance);
+    std::cout << std::setw(12) << base_median->number << std::setw(12) << current.median_ms
+              << std::setw(9) << FormatDiff(current.median_ms, base_median->number)
+              << std::setw(12) << base_p99->number << std::setw(12) << current.p99_ms
+              << std::setw(9) << FormatDiff(current.p99_ms, base_p99->number) << std::setw(7)
+              << tolerance << "  " << (median_regressed || p99_regressed ? "REGRESSED" : "OK")
+              << std::endl;
+    if (median_regressed || p99_regressed) {
+      exit_code = kExitRegression;
+    }
+  }
+
+  for (const auto& [name, _] : times) {
+    if (baseline_benchmarks->find(name) == nullptr) {
+      std::cout << std::left << std::setw(44) << name << "  NOT IN BASELINE" << std::endl;
+    }
+  }
+  if (no_baseline_num > 0) {
+    std::cerr << no_baseline_num
+              << " benchmarks have no recorded baseline times, record them with --update on "
+                 "the reference machine"
+              << std::endl;
+  }
+  return exit_code;
+}
+
+bool ParseFlag(const std::string& arg, const std::string& flag, std::string& value) {
+  const std::string& prefix = "--" + flag + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  value = arg.substr(prefix.size());
+  return true;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string bench_path;
+  std::string baseline_path;
+  std::string result_path;
+  std::string filter;
+  std::string repetitions = "10";
+  bool update = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--update") {
+      update = true;
+    } else if (!ParseFlag(arg, "bench", bench_path) &&
+               !ParseFlag(arg, "baseline", baseline_path) &&
+               !ParseFlag(arg, "result", result_path) && !ParseFlag(arg, "filter", filter) &&
+               !ParseFlag(arg, "repetitions", repetitions)) {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      return kExitError;
+    }
+  }
+  if (baseline_path.empty() || (bench_path.empty() && result_path.empty())) {
+    std::cerr << "Usage: " << argv[0]
+              << " --baseline=<file> (--bench=<bench_kuiper> | --result=<file>)"
+                 " [--filter=<regex>] [--repetitions=<n>] [--update]"
+              << std::endl;
+    return kExitError;
+  }
+
+  JsonValue baseline;
+  if (!LoadJson(baseline_path, baseline)) {
+    return kExitError;
+  }
+  if (filter.empty()) {
+    filter = BaselineFilter(baseline);
+  }
+
+  if (result_path.empty()) {
+    result_path = "bench_gate_result.json";
+    const std::string& command = bench_path + " --benchmark_filter='" + filter +
+                                 "' --benchmark_repetitions=" + repetitions +
+                                 " --benchmark_out_format=json --benchmark_out=" + result_path;
+    std::cout << "Running: " << command << std::endl;
+    if (std::system(command.c_str()) != 0) {
+      std::cerr << "The benchmark run failed" << std::endl;
+      return kExitError;
+    }
+  }
+
+  JsonValue result;
+  if (!LoadJson(result_path, result)) {
+    return kExitError;
+  }
+  const auto& times = CollectTimes(result);
+  if (times.empty()) {
+    std::cerr << "No benchmark result in " << result_path << std::endl;
+    return kExitError;
+  }
+
+  if (update) {
+    return WriteBaseline(baseline_path, baseline, times) ? 0 : kExitError;
+  }
+  return Compare(baseline, times);
+}
@@ -24,46 +24,13 @@
 #include <glog/logging.h>
 #include <iostream>
 #include <opencv2/opencv.hpp>
+#include "../../source/layer/details/image_pre_process.hpp"
+#include "../../source/layer/details/yolo_post_process.hpp"
 #include "../image_util.hpp"
 #include "data/tensor.hpp"
 #include "runtime/runtime_ir.hpp"
 #include "tick.hpp"
 
-kuiper_infer::sftensor PreProcessImage(const cv::Mat& image, const int32_t input_h,
-                                       const int32_t input_w) {
-  assert(!image.empty());
-  using namespace kuiper_infer;
-  const int32_t input_c = 3;
-
-  int stride = 32;
-  cv::Mat out_image;
-  Letterbox(image, out_image, {input_h, input_w}, stride, {114, 114, 114}, true);
-
-  cv::Mat rgb_image;
-  cv::cvtColor(out_image, rgb_image, cv::COLOR_BGR2RGB);
-
-  cv::Mat normalize_image;
-  rgb_image.convertTo(normalize_image, CV_32FC3, 1. / 255.);
-
-  std::vector<cv::Mat> split_images;
-  cv::split(normalize_image, split_images);
-  assert(split_images.size() == input_c);
-
-  std::shared_ptr<Tensor<float>> input = std::make_shared<Tensor<float>>(input_c, input_h, input_w);
-  input->Fill(0.f);
-
-  int index = 0;
-  int offset = 0;
-  for (const auto& split_image : split_images) {
-    assert(split_image.total() == input_w * input_h);
-    const cv::Mat& split_image_t = split_image.t();
-    memcpy(input->slice(index).memptr(), split_image_t.data, sizeof(float) * split_image.total());
-    index += 1;
-    offset += split_image.total();
-  }
-  return input;
-}
-
 void YoloDemo(const std::vector<std::string>& image_paths, const std::string& param_path,
               const std::string& bin_path, const uint32_t batch_size,
               const float conf_thresh = 0.25f, const float iou_thresh = 0.25f) {
@@ -73,17 +40,26 @@ void YoloDemo(const std::vector<std::string>& image_paths, const std::string& pa
 
   RuntimeGraph graph(param_path, bin_path);
   graph.Build();
+  // 置信度过滤和非极大值抑制在推理引擎中完成
+  graph.AppendOutputLayer("pnnx_output_0",
+                          std::make_shared<YoloPostProcessLayer>(conf_thresh, iou_thresh));
 
   assert(batch_size == image_paths.size());
-  std::vector<sftensor> inputs;
+  std::vector<cv::Mat> images;
+  std::vector<ImageBuffer> image_buffers;
   for (uint32_t i = 0; i < batch_size; ++i) {
-    const auto& input_image = cv::imread(image_paths.at(i));
-    sftensor input = PreProcessImage(input_image, input_h, input_w);
-    assert(input->rows() == 640);
-    assert(input->cols() == 640);
-    inputs.push_back(input);
+    images.push_back(cv::imread(image_paths.at(i)));
+    const cv::Mat& image = images.back();
+    assert(image.type() == CV_8UC3);
+    image_buffers.push_back({image.data, uint32_t(image.rows), uint32_t(image.cols), image.step});
   }
 
+  // 缩放, 通道交换, 归一化和布局转换在一次遍历中完成
+  ImagePreProcess pre_process(input_h, input_w);
+  std::vector<sftensor> inputs(batch_size);
+  StatusCode status = pre_process.Forward(image_buffers, inputs);
+  assert(status == StatusCode::kSuccess);
+
   std::vector<std::shared_ptr<Tensor<float>>> outputs;
   graph.set_inputs("pnnx_input_0", inputs);
   for (int i = 0; i < 1; ++i) {
@@ -94,59 +70,25 @@ void YoloDemo(const std::vector<std::string>& image_paths, const std::string& pa
   assert(outputs.size() == batch_size);
 
   for (int i = 0; i < outputs.size(); ++i) {
-    const auto& image = cv::imread(image_paths.at(i));
+    cv::Mat& image = images.at(i);
     const int32_t origin_input_h = image.size().height;
     const int32_t origin_input_w = image.size().width;
 
+    // 每一行为一个检测框 (x1, y1, x2, y2, score, class id)
     const auto& output = outputs.at(i);
-    assert(!output->empty());
-    const auto& shapes = output->shapes();
-    assert(shapes.size() == 3);
-
-    const uint32_t elements = shapes.at(1);
-    const uint32_t num_info = shapes.at(2);
     std::vector<Detection> detections;
+    for (uint32_t d = 0; d < output->rows(); ++d) {
+      const int left = (int)(output->at(0, d, 0));
+      const int top = (int)(output->at(0, d, 1));
+      const int right = (int)(output->at(0, d, 2));
+      const int bottom = (int)(output->at(0, d, 3));
 
-    std::vector<cv::Rect> boxes;
-    std::vector<float> confs;
-    std::vector<int> class_ids;
-
-    const uint32_t b = 0;
-    for (uint32_t e = 0; e < elements; ++e) {
-      float cls_conf = output->at(b, e, 4);
-      if (cls_conf >= conf_thresh) {
-        int center_x = (int)(output->at(b, e, 0));
-        int center_y = (int)(output->at(b, e, 1));
-        int width = (int)(output->at(b, e, 2));
-        int height = (int)(output->at(b, e, 3));
-        int left = center_x - width / 2;
-        int top = center_y - height / 2;
-
-        int best_class_id = -1;
-        float best_conf = -1.f;
-        for (uint32_t j = 5; j < num_info; ++j) {
-          if (output->at(b, e, j) > best_conf) {
-            best_conf = output->at(b, e, j);
-            best_class_id = int(j - 5);
-          }
-        }
-
-        boxes.emplace_back(left, top, width, height);
-        confs.emplace_back(best_conf * cls_conf);
-        class_ids.emplace_back(best_class_id);
-      }
-    }
-
-    std::vector<int> indices;
-    cv::dnn::NMSBoxes(boxes, confs, conf_thresh, iou_thresh, indices);
-
-    for (int idx : indices) {
       Detection det;
-      det.box = cv::Rect(boxes[idx]);
+      det.box = cv::Rect(left, top, right - left, bottom - top);
       ScaleCoords(cv::Size{input_w, input_h}, det.box, cv::Size{origin_input_w, origin_input_h});
 
-      det.conf = confs[idx];
-      det.class_id = class_ids[idx];
+      det.conf = output->at(0, d, 4);
+      det.class_id = (int)(output->at(0, d, 5));
       detections.emplace_back(det);
     }
 
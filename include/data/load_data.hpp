@@ -23,15 +23,20 @@
 
 #ifndef KUIPER_INFER_INCLUDE_DATA_LOAD_DATA_HPP_
 #define KUIPER_INFER_INCLUDE_DATA_LOAD_DATA_HPP_
-#include <glog/logging.h>
 #include <armadillo>
+#include <memory>
 #include <string>
+#include "data/tensor.hpp"
 namespace kuiper_infer {
 
 /**
  * @brief CSV data loader
  *
  * Provides utility to load CSV data into Armadillo matrices.
+ *
+ * The file is memory mapped and split into line aligned chunks which are
+ * parsed in parallel. Rows end at the first empty line, missing or
+ * malformed values are loaded as 0.
  */
 class CSVDataLoader {
  public:
@@ -42,79 +47,79 @@ class CSVDataLoader {
    *
    * @param file_path Path to CSV file
    * @param split_char Delimiter character
-   * @return Matrix containing loaded data
+   * @return Matrix containing loaded data, empty if the file can not be read
    */
   template <typename T>
   static arma::Mat<T> LoadData(const std::string& file_path, char split_char = ',');
 
- private:
   /**
-   * @brief Gets matrix dimensions from CSV
+   * @brief Loads CSV file into an existing matrix
    *
-   * Gets number of rows and cols for matrix based on CSV file.
-
-   * @param file CSV file stream
+   * The values are parsed straight into data, a matrix of another shape is
+   * resized, so a tensor channel of the CSV shape can be the destination.
+   *
+   * @param file_path Path to CSV file
+   * @param data Destination matrix
    * @param split_char Delimiter character
-   * @return Pair of rows and cols
-  */
-  static std::pair<size_t, size_t> GetMatrixSize(std::ifstream& file, char split_char);
+   * @return True if the file is loaded
+   */
+  template <typename T>
+  static bool LoadData(const std::string& file_path, arma::Mat<T>& data, char split_char = ',');
 };
 
-template <typename T>
-arma::Mat<T> CSVDataLoader::LoadData(const std::string& file_path, const char split_char) {
-  arma::Mat<T> data;
-  if (file_path.empty()) {
-    LOG(ERROR) << "CSV file path is empty: " << file_path;
-    return data;
-  }
-
-  std::ifstream in(file_path);
-  if (!in.is_open() || !in.good()) {
-    LOG(ERROR) << "File open failed: " << file_path;
-    return data;
-  }
-
-  std::string line_str;
-  std::stringstream line_stream;
-
-  const auto& [rows, cols] = CSVDataLoader::GetMatrixSize(in, split_char);
-  data.zeros(rows, cols);
-
-  size_t row = 0;
-  while (in.good()) {
-    std::getline(in, line_str);
-    if (line_str.empty()) {
-      break;
-    }
+/**
+ * @brief NumPy .npy data loader
+ *
+ * Reads and writes little endian .npy files of the element type, without
+ * text parsing. Loading memory maps the file and copies it into the
+ * destination once.
+ */
+class NpyDataLoader {
+ public:
+  /**
+   * @brief Loads a .npy file into a tensor
+   *
+   * Arrays of 1 to 3 dims become tensors of the same raw shapes, leading
+   * dims of size 1 are dropped from larger arrays.
+   *
+   * @param file_path Path to .npy file
+   * @return Loaded tensor, nullptr if the file can not be read
+   */
+  template <typename T>
+  static std::shared_ptr<Tensor<T>> LoadTensor(const std::string& file_path);
 
-    std::string token;
-    line_stream.clear();
-    line_stream.str(line_str);
+  /**
+   * @brief Saves a tensor as a .npy file in C order
+   *
+   * @param file_path Path to .npy file
+   * @param tensor Tensor to save
+   * @return True if the file is written
+   */
+  template <typename T>
+  static bool SaveTensor(const std::string& file_path, const std::shared_ptr<Tensor<T>>& tensor);
 
-    size_t col = 0;
-    while (line_stream.good()) {
-      std::getline(line_stream, token, split_char);
-      try {
-        if (std::is_same_v<T, float>) {
-          data.at(row, col) = std::stof(token);
-        } else if (std::is_same_v<T, int8_t> || std::is_same_v<T, int32_t>) {
-          data.at(row, col) = std::stoi(token);
-        } else {
-          LOG(FATAL) << "Unsupported data type \n";
-        }
-      } catch (std::exception& e) {
-        DLOG(ERROR) << "Parse CSV File meet error: " << e.what() << " row:" << row
-                    << " col:" << col;
-      }
-      col += 1;
-      CHECK(col <= cols) << "There are excessive elements on the column";
-    }
+  /**
+   * @brief Loads a .npy file into a matrix
+   *
+   * A 1D array is loaded as one row, leading dims of larger arrays are
+   * merged into the rows.
+   *
+   * @param file_path Path to .npy file
+   * @return Loaded matrix, empty if the file can not be read
+   */
+  template <typename T>
+  static arma::Mat<T> LoadData(const std::string& file_path);
 
-    row += 1;
-    CHECK(row <= rows) << "There are excessive elements on the row";
-  }
-  return data;
-}
+  /**
+   * @brief Saves a matrix as a .npy file in Fortran order
+   *
+   * @param file_path Path to .npy file
+   * @param data Matrix to save
+   * @return True if the file is written
+   */
+  template <typename T>
+  static bool SaveData(const std::string& file_path, const arma::Mat<T>& data);
+};
 
 }  // namespace kuiper_infer
 
@@ -273,6 +273,30 @@ class Tensor {
    */
   void Flatten(bool row_major = false);
 
+  /**
+   * @brief Checks if a row-major reshape keeps the memory layout
+   *
+   * Each channel is stored column-major, so the row-major order only stays
+   * in place when the channels before and after the reshape are both
+   * vectors or both of the same size.
+   *
+   * @param shapes New shape
+   * @return True if the reshape can alias the data
+   */
+  bool IsViewable(const std::vector<uint32_t>& shapes) const;
+
+  /**
+   * @brief Creates a row-major reshaped view of the tensor
+   *
+   * The view aliases the data of this tensor, which has to outlive it.
+   * Reshapes changing the memory layout are not viewable, use Reshape with
+   * row_major on a copy for them instead.
+   *
+   * @param shapes New shape, must be viewable
+   * @return Tensor sharing the data with the new shape
+   */
+  std::shared_ptr<Tensor<T>> View(const std::vector<uint32_t>& shapes);
+
   /**
    * @brief Applies element-wise transform
    *
@@ -0,0 +1,85 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_DATA_TENSOR_ELEMENTWISE_HPP_
+#define KUIPER_INFER_DATA_TENSOR_ELEMENTWISE_HPP_
+#include <memory>
+#include <vector>
+#include "data/tensor.hpp"
+
+namespace kuiper_infer {
+/**
+ * @brief Element-wise binary operations of tensors
+ */
+enum class BinaryType {
+  kAdd = 0,
+  kSub = 1,
+  kMul = 2,
+  kDiv = 3,
+  kMax = 4,
+  kMin = 5,
+};
+
+/**
+ * @brief Gets the shape two tensors broadcast to
+ *
+ * Channels, rows and columns are compared separately, each pair must be equal
+ * or one of them must be 1.
+ *
+ * @param shapes1 Shape of tensor 1
+ * @param shapes2 Shape of tensor 2
+ * @return Broadcast shape (channels, rows, cols)
+ */
+std::vector<uint32_t> TensorBroadcastShapes(const std::vector<uint32_t>& shapes1,
+                                            const std::vector<uint32_t>& shapes2);
+
+/**
+ * @brief Element-wise binary operation with broadcasting
+ *
+ * Dimensions of size 1 are broadcast while computing, no broadcast copy of an
+ * operand is made, so a scalar, a per-channel value, a row or a column is
+ * applied to the whole tensor directly.
+ *
+ * @param type Operation
+ * @param tensor1 Left operand
+ * @param tensor2 Right operand
+ * @param output_tensor Output with the broadcast shape, may be one of the
+ * operands to compute in place
+ */
+template <typename T>
+void TensorElementBinary(BinaryType type, const std::shared_ptr<Tensor<T>>& tensor1,
+                         const std::shared_ptr<Tensor<T>>& tensor2,
+                         const std::shared_ptr<Tensor<T>>& output_tensor);
+
+/**
+ * @brief Element-wise binary operation with broadcasting
+ *
+ * @param type Operation
+ * @param tensor1 Left operand
+ * @param tensor2 Right operand
+ * @return New tensor with the broadcast shape
+ */
+template <typename T>
+std::shared_ptr<Tensor<T>> TensorElementBinary(BinaryType type,
+                                               const std::shared_ptr<Tensor<T>>& tensor1,
+                                               const std::shared_ptr<Tensor<T>>& tensor2);
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_DATA_TENSOR_ELEMENTWISE_HPP_
@@ -0,0 +1,232 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_DATA_TENSOR_ROW_MAJOR_HPP_
+#define KUIPER_INFER_DATA_TENSOR_ROW_MAJOR_HPP_
+#include <armadillo>
+#include <memory>
+#include <vector>
+#include "data/tensor.hpp"
+
+namespace kuiper_infer {
+/// Alignment in bytes of the row-major tensor storage
+constexpr size_t kTensorAlignment = 64;
+
+/**
+ * @brief Transposes a row-major plane into column-major order
+ *
+ * Copies in cache sized blocks, a column-major plane is transposed into
+ * row-major order by swapping rows and cols.
+ *
+ * @param src Plane of rows x cols elements in row-major order
+ * @param rows Number of rows
+ * @param cols Number of columns
+ * @param dst Output plane in column-major order, must not overlap src
+ */
+template <typename T>
+void TransposePlane(const T* src, uint32_t rows, uint32_t cols, T* dst);
+
+/**
+ * @brief Tensor stored natively in row-major (C-order) layout
+ *
+ * Holds the channels, rows and columns of one batch element in the order of
+ * PyTorch and pnnx, in memory aligned to kTensorAlignment. Data in that
+ * layout is copied in and out without transposing, and reshapes only change
+ * the shape.
+ *
+ * Layers working on Armadillo use cube(), a view whose slices are the
+ * transposed channels, or convert to a column-major Tensor with ToTensor.
+ */
+template <typename T>
+class RowMajorTensor {
+ public:
+  /**
+   * @brief Construct a new empty tensor
+   */
+  explicit RowMajorTensor() = default;
+
+  /**
+   * @brief Construct a 3D tensor
+   *
+   * @param channels Number of channels
+   * @param rows Number of rows
+   * @param cols Number of columns
+   */
+  explicit RowMajorTensor(uint32_t channels, uint32_t rows, uint32_t cols);
+
+  /**
+   * @brief Construct a tensor with shape
+   *
+   * @param shapes Tensor dimensions, at most three
+   */
+  explicit RowMajorTensor(const std::vector<uint32_t>& shapes);
+
+  /**
+   * @brief Construct a view of row-major memory
+   *
+   * The memory is not owned and has to outlive the tensor.
+   *
+   * @param raw_ptr Row-major data
+   * @param shapes Tensor dimensions, at most three
+   */
+  explicit RowMajorTensor(T* raw_ptr, const std::vector<uint32_t>& shapes);
+
+  /**
+   * @brief Construct from a column-major tensor
+   *
+   * @param tensor Tensor to convert
+   */
+  explicit RowMajorTensor(const Tensor<T>& tensor);
+
+  RowMajorTensor(const RowMajorTensor& tensor);
+
+  RowMajorTensor(RowMajorTensor&& tensor) noexcept = default;
+
+  RowMajorTensor& operator=(const RowMajorTensor& tensor);
+
+  RowMajorTensor& operator=(RowMajorTensor&& tensor) noexcept = default;
+
+  uint32_t rows() const;
+
+  uint32_t cols() const;
+
+  uint32_t channels() const;
+
+  size_t size() const;
+
+  size_t plane_size() const;
+
+  bool empty() const;
+
+  /**
+   * @brief Checks if the tensor views memory it does not own
+   */
+  bool is_view() const;
+
+  /**
+   * @brief Gets tensor shape
+   *
+   * @return Channels, rows and columns
+   */
+  std::vector<uint32_t> shapes() const;
+
+  /**
+   * @brief Gets raw tensor shape
+   *
+   * @return Raw tensor dimensions
+   */
+  const std::vector<uint32_t>& raw_shapes() const;
+
+  T& index(size_t offset);
+
+  const T index(size_t offset) const;
+
+  T& at(uint32_t channel, uint32_t row, uint32_t col);
+
+  const T at(uint32_t channel, uint32_t row, uint32_t col) const;
+
+  T* raw_ptr();
+
+  const T* raw_ptr() const;
+
+  T* raw_ptr(size_t offset);
+
+  const T* raw_ptr(size_t offset) const;
+
+  /**
+   * @brief Gets the row-major data of a channel
+   *
+   * @param index Channel index
+   * @return Raw pointer to the channel
+   */
+  T* matrix_raw_ptr(uint32_t index);
+
+  const T* matrix_raw_ptr(uint32_t index) const;
+
+  /**
+   * @brief Fills tensor with a value
+   *
+   * @param value Fill value
+   */
+  void Fill(T value);
+
+  /**
+   * @brief Fills tensor with row-major values
+   *
+   * @param values Values in row-major order, copied without conversion
+   */
+  void Fill(const std::vector<T>& values);
+
+  /**
+   * @brief Gets the values in row-major order
+   */
+  std::vector<T> values() const;
+
+  /**
+   * @brief Reshapes the tensor
+   *
+   * Only changes the shape, the row-major order of the data is kept.
+   *
+   * @param shapes New shape with the same number of elements
+   */
+  void Reshape(const std::vector<uint32_t>& shapes);
+
+  /**
+   * @brief Gets an Armadillo view of the data
+   *
+   * Slice i of the view is the transpose of channel i, a cols x rows
+   * matrix sharing the memory of the tensor.
+   *
+   * @return Cube of cols x rows x channels aliasing the data
+   */
+  arma::Cube<T> cube();
+
+  /**
+   * @brief Converts to a column-major tensor
+   *
+   * @return Tensor with the same shape and values
+   */
+  std::shared_ptr<Tensor<T>> ToTensor() const;
+
+ private:
+  void Allocate();
+
+  void SetShapes(const std::vector<uint32_t>& shapes);
+
+  /// Raw tensor dimensions
+  std::vector<uint32_t> raw_shapes_;
+
+  uint32_t channels_ = 0;
+  uint32_t rows_ = 0;
+  uint32_t cols_ = 0;
+
+  /// Owned aligned memory, empty for views
+  std::shared_ptr<T> storage_;
+
+  /// Row-major data, owned or viewed
+  T* data_ = nullptr;
+};
+
+using frtensor = RowMajorTensor<float>;
+using sfrtensor = std::shared_ptr<RowMajorTensor<float>>;
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_DATA_TENSOR_ROW_MAJOR_HPP_
@@ -24,6 +24,7 @@
 #ifndef KUIPER_INFER_TENSOR_UTIL_H
 #define KUIPER_INFER_TENSOR_UTIL_H
 #include "data/tensor.hpp"
+#include "data/tensor_elementwise.hpp"
 
 namespace kuiper_infer {
 
@@ -65,6 +66,8 @@ bool TensorIsSame(const std::shared_ptr<Tensor<T>>& a, const std::shared_ptr<Ten
 /**
  * @brief Element-wise tensor add
  *
+ * Operands are broadcast like TensorElementBinary.
+ *
  * @param tensor1 Tensor 1
  * @param tensor2 Tensor 2
  * @return Output tensor
@@ -76,6 +79,8 @@ std::shared_ptr<Tensor<T>> TensorElementAdd(const std::shared_ptr<Tensor<T>>& te
 /**
  * @brief In-place element-wise tensor add
  *
+ * Operands are broadcast like TensorElementBinary.
+ *
  * @param tensor1 Tensor 1
  * @param tensor2 Tensor 2
  * @param output_tensor Output
@@ -88,6 +93,8 @@ void TensorElementAdd(const std::shared_ptr<Tensor<T>>& tensor1,
 /**
  * @brief Element-wise tensor multiply
  *
+ * Operands are broadcast like TensorElementBinary.
+ *
  * @param tensor1 Tensor 1
  * @param tensor2 Tensor 2
  * @return Output tensor
@@ -99,6 +106,8 @@ std::shared_ptr<Tensor<T>> TensorElementMultiply(const std::shared_ptr<Tensor<T>
 /**
  * @brief In-place element-wise tensor multiply
  *
+ * Operands are broadcast like TensorElementBinary.
+ *
  * @param tensor1 Tensor 1
  * @param tensor2 Tensor 2
  * @param output_tensor Output
@@ -156,6 +165,20 @@ std::shared_ptr<Tensor<T>> TensorCreate(const std::vector<uint32_t>& shapes);
 template <typename T>
 std::shared_ptr<Tensor<T>> TensorClone(std::shared_ptr<Tensor<T>> tensor);
 
+/**
+ * @brief Row-major reshape of a tensor
+ *
+ * Aliases the data of the tensor when the memory layout is kept, otherwise
+ * the data is copied into the new layout.
+ *
+ * @param tensor Tensor to reshape, left unchanged
+ * @param shapes New shape
+ * @return View or reshaped copy of the tensor
+ */
+template <typename T>
+std::shared_ptr<Tensor<T>> TensorReshape(const std::shared_ptr<Tensor<T>>& tensor,
+                                         const std::vector<uint32_t>& shapes);
+
 template <typename T>
 bool TensorIsSame(const std::shared_ptr<Tensor<T>>& a, const std::shared_ptr<Tensor<T>>& b,
                   T threshold) {
@@ -172,72 +195,26 @@ template <typename T>
 void TensorElementAdd(const std::shared_ptr<Tensor<T>>& tensor1,
                       const std::shared_ptr<Tensor<T>>& tensor2,
                       const std::shared_ptr<Tensor<T>>& output_tensor) {
-  CHECK(tensor1 != nullptr && tensor2 != nullptr && output_tensor != nullptr);
-  if (tensor1->shapes() == tensor2->shapes()) {
-    CHECK(tensor1->shapes() == output_tensor->shapes());
-    output_tensor->set_data(tensor1->data() + tensor2->data());
-  } else {
-    CHECK(tensor1->channels() == tensor2->channels()) << "Tensors shape are not adapting";
-    const auto& [input_tensor1, input_tensor2] = TensorBroadcast(tensor1, tensor2);
-    CHECK(output_tensor->shapes() == input_tensor1->shapes() &&
-          output_tensor->shapes() == input_tensor2->shapes());
-    output_tensor->set_data(input_tensor1->data() + input_tensor2->data());
-  }
+  TensorElementBinary(BinaryType::kAdd, tensor1, tensor2, output_tensor);
 }
 
 template <typename T>
 void TensorElementMultiply(const std::shared_ptr<Tensor<T>>& tensor1,
                            const std::shared_ptr<Tensor<T>>& tensor2,
                            const std::shared_ptr<Tensor<T>>& output_tensor) {
-  CHECK(tensor1 != nullptr && tensor2 != nullptr && output_tensor != nullptr);
-  if (tensor1->shapes() == tensor2->shapes()) {
-    CHECK(tensor1->shapes() == output_tensor->shapes());
-    output_tensor->set_data(tensor1->data() % tensor2->data());
-  } else {
-    CHECK(tensor1->channels() == tensor2->channels()) << "Tensors shape are not adapting";
-    const auto& [input_tensor1, input_tensor2] = TensorBroadcast(tensor1, tensor2);
-    CHECK(output_tensor->shapes() == input_tensor1->shapes() &&
-          output_tensor->shapes() == input_tensor2->shapes());
-    output_tensor->set_data(input_tensor1->data() % input_tensor2->data());
-  }
+  TensorElementBinary(BinaryType::kMul, tensor1, tensor2, output_tensor);
 }
 
 template <typename T>
 std::shared_ptr<Tensor<T>> TensorElementAdd(const std::shared_ptr<Tensor<T>>& tensor1,
                                             const std::shared_ptr<Tensor<T>>& tensor2) {
-  CHECK(tensor1 != nullptr && tensor2 != nullptr);
-  if (tensor1->shapes() == tensor2->shapes()) {
-    std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(tensor1->shapes());
-    output_tensor->set_data(tensor1->data() + tensor2->data());
-    return output_tensor;
-  } else {
-    // broadcast
-    CHECK(tensor1->channels() == tensor2->channels()) << "Tensors shape are not adapting";
-    const auto& [input_tensor1, input_tensor2] = TensorBroadcast(tensor1, tensor2);
-    CHECK(input_tensor1->shapes() == input_tensor2->shapes());
-    std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(input_tensor1->shapes());
-    output_tensor->set_data(input_tensor1->data() + input_tensor2->data());
-    return output_tensor;
-  }
+  return TensorElementBinary(BinaryType::kAdd, tensor1, tensor2);
 }
 
 template <typename T>
 std::shared_ptr<Tensor<T>> TensorElementMultiply(const std::shared_ptr<Tensor<T>>& tensor1,
                                                  const std::shared_ptr<Tensor<T>>& tensor2) {
-  CHECK(tensor1 != nullptr && tensor2 != nullptr);
-  if (tensor1->shapes() == tensor2->shapes()) {
-    std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(tensor1->shapes());
-    output_tensor->set_data(tensor1->data() % tensor2->data());
-    return output_tensor;
-  } else {
-    // broadcast
-    CHECK(tensor1->channels() == tensor2->channels()) << "Tensors shape are not adapting";
-    const auto& [input_tensor1, input_tensor2] = TensorBroadcast(tensor1, tensor2);
-    CHECK(input_tensor1->shapes() == input_tensor2->shapes());
-    std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(input_tensor1->shapes());
-    output_tensor->set_data(input_tensor1->data() % input_tensor2->data());
-    return output_tensor;
-  }
+  return TensorElementBinary(BinaryType::kMul, tensor1, tensor2);
 }
 
 template <typename T>
@@ -359,5 +336,17 @@ template <typename T>
 std::shared_ptr<Tensor<T>> TensorClone(std::shared_ptr<Tensor<T>> tensor) {
   return std::make_shared<Tensor<T>>(*tensor);
 }
+
+template <typename T>
+std::shared_ptr<Tensor<T>> TensorReshape(const std::shared_ptr<Tensor<T>>& tensor,
+                                         const std::vector<uint32_t>& shapes) {
+  CHECK(tensor != nullptr && !tensor->empty());
+  if (tensor->IsViewable(shapes)) {
+    return tensor->View(shapes);
+  }
+  std::shared_ptr<Tensor<T>> output = TensorClone(tensor);
+  output->Reshape(shapes, true);
+  return output;
+}
 }  // namespace kuiper_infer
 #endif  // KUIPER_INFER_TENSOR_UTIL_H
@@ -152,6 +152,55 @@ class Layer<float> {
    */
   void set_runtime_operator(const std::shared_ptr<RuntimeOperator>& runtime_operator);
 
+  /**
+   * @brief Estimates floating point operations of a forward pass
+   *
+   * A multiply-add counts as two operations.
+   *
+   * @param input_shapes Shapes of the input operands, the first dim is the batch
+   * @return Estimated floating point operations, 0 if the layer does no arithmetic
+   */
+  virtual uint64_t EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const;
+
+  /**
+   * @brief Estimates bytes read and written by a forward pass
+   *
+   * The default counts every input and output element once.
+   *
+   * @param input_shapes Shapes of the input operands, the first dim is the batch
+   * @return Estimated bytes moved between the layer and memory
+   */
+  virtual uint64_t EstimateBytes(const std::vector<std::vector<int32_t>>& input_shapes) const;
+
+  /**
+   * @brief Switches the layer to int8 inference
+   *
+   * Quantizes the weights per output channel. Afterwards the inputs are
+   * quantized with input_scale, multiplied in int8 with int32 accumulation
+   * and dequantized back to float outputs.
+   *
+   * @param input_scale Quantization scale of the input activations, a
+   * non-positive value computes the scale from each input at forward time
+   * @return True if the layer supports int8 inference and was quantized
+   */
+  virtual bool QuantizeInt8(float input_scale);
+
+ protected:
+  /**
+   * @brief Number of elements of a shape
+   */
+  static uint64_t ShapeSize(const std::vector<int32_t>& shape);
+
+  /**
+   * @brief Number of output elements
+   *
+   * Uses the output operand of the runtime operator if there is one,
+   * otherwise assumes the output has the size of the first input.
+   *
+   * @param input_shapes Shapes of the input operands
+   */
+  virtual uint64_t OutputSize(const std::vector<std::vector<int32_t>>& input_shapes) const;
+
  protected:
   std::string layer_name_;
   std::weak_ptr<RuntimeOperator> runtime_operator_;
@@ -124,6 +124,16 @@ class ParamLayer : public Layer<float> {
 
   std::shared_ptr<Tensor<float>> weight(int32_t index) const;
 
+  /**
+   * @brief Estimates bytes moved by a forward pass
+   *
+   * Counts the weights and biases in addition to the inputs and outputs.
+   *
+   * @param input_shapes Shapes of the input operands, the first dim is the batch
+   * @return Estimated bytes moved between the layer and memory
+   */
+  uint64_t EstimateBytes(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
  protected:
   std::vector<std::shared_ptr<Tensor<float>>> weights_;
   std::vector<std::shared_ptr<Tensor<float>>> bias_;
@@ -155,7 +155,7 @@ class Attribute
 
   Attribute(const std::initializer_list<int>& shape, const std::vector<float>& t);
 
-  // 0=null 1=f32 2=f64 3=f16 4=i32 5=i64 6=i16 7=i8 8=u8 9=bool
+  // 0=null 1=f32 2=f64 3=f16 4=i32 5=i64 6=i16 7=i8 8=u8 9=bool 13=bf16
   int type;
   std::vector<int> shape;
 
@@ -176,7 +176,7 @@ class Operand
   Operator* producer;
   std::vector<Operator*> consumers;
 
-  // 0=null 1=f32 2=f64 3=f16 4=i32 5=i64 6=i16 7=i8 8=u8 9=bool 10=cp64 11=cp128 12=cp32
+  // 0=null 1=f32 2=f64 3=f16 4=i32 5=i64 6=i16 7=i8 8=u8 9=bool 10=cp64 11=cp128 12=cp32 13=bf16
   int type;
   std::vector<int> shape;
 
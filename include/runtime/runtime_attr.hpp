@@ -27,6 +27,7 @@
 #include <vector>
 #include "runtime_datatype.hpp"
 #include "status_code.hpp"
+#include "utils/math/half.hpp"
 
 namespace kuiper_infer {
 
@@ -60,7 +61,7 @@ struct RuntimeAttribute {
   /**
    * @brief Data type of the attribute
    *
-   * Such as float32, int8, etc.
+   * Such as float32, float16, bfloat16, etc.
    */
   RuntimeDataType type = RuntimeDataType::kTypeUnknown;
 
@@ -68,9 +69,11 @@ struct RuntimeAttribute {
    * @brief Gets the attribute data as a typed array
    *
    * Returns the weight data as a vector of the template type T.
+   * Float16 and bfloat16 data is converted when T is float, or returned
+   * as raw 16 bit values when T is uint16_t.
    * The attribute data is cleared after get by default.
    *
-   * @tparam T Data type to return (float, int, etc)
+   * @tparam T Data type to return (float or uint16_t)
    * @param need_clear_weight Whether to clear data after get
    * @return Vector containing the attribute data
    */
@@ -82,7 +85,9 @@ template <class T>
 std::vector<T> RuntimeAttribute::get(bool need_clear_weight) {
   CHECK(!weight_data.empty());
   CHECK(type != RuntimeDataType::kTypeUnknown);
-  const uint32_t elem_size = sizeof(T);
+  static_assert(std::is_same<T, float>::value || std::is_same<T, uint16_t>::value,
+                "The attribute can only be got as float or raw 16 bit float values");
+  const uint32_t elem_size = math::IsHalfType(type) ? sizeof(uint16_t) : sizeof(float);
   CHECK_EQ(weight_data.size() % elem_size, 0);
   const uint32_t weight_data_size = weight_data.size() / elem_size;
 
@@ -90,7 +95,7 @@ std::vector<T> RuntimeAttribute::get(bool need_clear_weight) {
   weights.reserve(weight_data_size);
   switch (type) {
     case RuntimeDataType::kTypeFloat32: {
-      static_assert(std::is_same<T, float>::value == true);
+      CHECK((std::is_same<T, float>::value)) << "The float32 attribute can only be got as float";
       float* weight_data_ptr = reinterpret_cast<float*>(weight_data.data());
       for (uint32_t i = 0; i < weight_data_size; ++i) {
         float weight = *(weight_data_ptr + i);
@@ -98,6 +103,19 @@ std::vector<T> RuntimeAttribute::get(bool need_clear_weight) {
       }
       break;
     }
+    case RuntimeDataType::kTypeFloat16:
+    case RuntimeDataType::kTypeBFloat16: {
+      // 以float获取时转换为单精度, 以uint16_t获取时保留原始的16位数据
+      const uint16_t* weight_data_ptr = reinterpret_cast<const uint16_t*>(weight_data.data());
+      for (uint32_t i = 0; i < weight_data_size; ++i) {
+        if constexpr (std::is_same<T, float>::value) {
+          weights.push_back(math::HalfToFloat(*(weight_data_ptr + i), type));
+        } else {
+          weights.push_back(*(weight_data_ptr + i));
+        }
+      }
+      break;
+    }
     default: {
       LOG(FATAL) << "Unknown weight data type: " << int32_t(type);
     }
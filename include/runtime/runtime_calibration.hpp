@@ -0,0 +1,174 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_CALIBRATION_HPP_
+#define KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_CALIBRATION_HPP_
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "data/tensor.hpp"
+
+namespace kuiper_infer {
+
+/**
+ * @brief How the int8 scale of an operand is derived from its statistics
+ */
+enum class CalibrationMethod {
+  kMinMax = 0,   // 以绝对值的最大值作为量化的阈值
+  kEntropy = 1,  // 选择使KL散度最小的阈值
+};
+
+/**
+ * @brief Streaming statistics of one operand
+ *
+ * Keeps the min, max and a fixed size histogram of the absolute values, so
+ * the memory does not grow with the number of samples. The histogram range
+ * starts at the first absolute maximum and is doubled by merging adjacent
+ * bins whenever a larger value arrives.
+ */
+class ActivationHistogram {
+ public:
+  explicit ActivationHistogram(uint32_t bin_num = 2048);
+
+  /**
+   * @brief Adds tensors to the statistics
+   *
+   * The elements are accumulated by all OpenMP threads.
+   *
+   * @param tensors Tensors of one operand
+   * @param tensor_num Only the first tensor_num tensors are added
+   */
+  void Collect(const std::vector<sftensor>& tensors, uint32_t tensor_num);
+
+  /**
+   * @brief Quantization scale of the operand
+   *
+   * @param method Threshold selection method
+   * @return Symmetric scale mapping the threshold to the largest int8 value
+   */
+  float Scale(CalibrationMethod method) const;
+
+  float min_value() const { return min_value_; }
+
+  float max_value() const { return max_value_; }
+
+  float abs_max() const { return std::max(-min_value_, max_value_); }
+
+  float bin_width() const { return bin_width_; }
+
+  uint64_t count() const { return count_; }
+
+  const std::vector<uint64_t>& bins() const { return bins_; }
+
+ private:
+  /**
+   * @brief Doubles the bin width until abs_max falls into the histogram
+   */
+  void GrowRange(float abs_max);
+
+  /**
+   * @brief Threshold with the smallest KL divergence to the original distribution
+   */
+  float EntropyThreshold() const;
+
+ private:
+  std::vector<uint64_t> bins_;
+  float bin_width_ = 0.f;
+  float min_value_ = 0.f;
+  float max_value_ = 0.f;
+  uint64_t count_ = 0;
+};
+
+/**
+ * @brief Collects operand statistics of a graph and produces int8 scales
+ *
+ * The scales are written to a calibration table file, one operand per line:
+ *   <operand name> <scale> <min> <max>
+ * Lines starting with '#' are comments. The operand name is the name of the
+ * operator producing it, RuntimeGraph::QuantizeInt8 reads the table back.
+ */
+class Int8Calibrator {
+ public:
+  explicit Int8Calibrator(uint32_t bin_num = 2048);
+
+  /**
+   * @brief Adds the tensors of an operand to its statistics
+   *
+   * @param operand_name Name of the operator producing the operand
+   * @param tensors Batch of tensors of the operand
+   */
+  void Collect(const std::string& operand_name, const std::vector<sftensor>& tensors);
+
+  /**
+   * @brief Limits the tensors used from each batch
+   *
+   * The last batch of a calibration set is padded, the padded samples are
+   * not added to the statistics.
+   *
+   * @param sample_num Valid samples in the current batch, 0 for all
+   */
+  void set_sample_num(uint32_t sample_num);
+
+  /**
+   * @brief Computes the scale of every collected operand
+   */
+  std::map<std::string, float> ComputeScales(CalibrationMethod method) const;
+
+  /**
+   * @brief Writes the calibration table
+   *
+   * @return True if the table was written
+   */
+  bool WriteTable(const std::string& table_path, CalibrationMethod method) const;
+
+  /**
+   * @brief Reads the scales of a calibration table
+   *
+   * @param table_path Path of the table
+   * @param scales Output scale of each operand
+   * @return True if the table was read
+   */
+  static bool ReadTable(const std::string& table_path, std::map<std::string, float>& scales);
+
+  /**
+   * @brief Loads one calibration sample
+   *
+   * Files ending with .csv are read with CSVDataLoader, .npy files with
+   * NpyDataLoader, other files as raw float32 data. The values are in row
+   * major channel, row, col order.
+   *
+   * @param sample_path Path of the sample
+   * @param shapes Shape of the sample without the batch dim
+   * @return The sample, nullptr if it can not be read or has the wrong size
+   */
+  static sftensor LoadSample(const std::string& sample_path, const std::vector<uint32_t>& shapes);
+
+  const std::map<std::string, ActivationHistogram>& histograms() const { return histograms_; }
+
+ private:
+  uint32_t bin_num_ = 2048;
+  uint32_t sample_num_ = 0;
+  std::map<std::string, ActivationHistogram> histograms_;
+};
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_CALIBRATION_HPP_
@@ -26,7 +26,7 @@
  * @brief Runtime data types for operator attributes
  *
  * Enumerates the data types supported for operator attributes like
- * weights and biases.
+ * weights and biases. The values mirror the type codes of pnnx.
  */
 enum class RuntimeDataType {
   kTypeUnknown = 0,
@@ -38,5 +38,6 @@ enum class RuntimeDataType {
   kTypeInt16 = 6,
   kTypeInt8 = 7,
   kTypeUInt8 = 8,
+  kTypeBFloat16 = 13,
 };
 #endif  // KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_DATATYPE_HPP_
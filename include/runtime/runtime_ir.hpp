@@ -25,14 +25,47 @@
 #include <memory>
 #include <queue>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "layer/abstract/layer.hpp"
 #include "runtime/pnnx/ir.h"
+#include "runtime/runtime_calibration.hpp"
 #include "runtime/runtime_operand.hpp"
 #include "runtime_op.hpp"
+#include "utils/time/profiler.hpp"
 
 namespace kuiper_infer {
 
+/**
+ * @brief Estimated cost of a runtime operator
+ *
+ * Filled from the layer's FLOP and byte estimation after the graph is built.
+ */
+struct RuntimeOperatorCost {
+  /// Name of the operator
+  std::string name;
+
+  /// Type of the operator
+  std::string type;
+
+  /// Floating point operations of one forward
+  uint64_t flops = 0;
+
+  /// Bytes moved by one forward
+  uint64_t bytes = 0;
+
+  /// Arithmetic intensity in flops per byte
+  double intensity() const { return bytes == 0 ? 0. : double(flops) / double(bytes); }
+};
+
+/**
+ * @brief Memory layout of a buffer bound to a graph input or output
+ */
+enum class BufferLayout {
+  kColMajor = 0,  ///< Channels stored column-major, the layout of Tensor
+  kRowMajor = 1,  ///< Channels stored row-major, the NCHW layout of PyTorch
+};
+
 /**
  * @brief Runtime representation of a neural network graph
  *
@@ -73,6 +106,56 @@ class RuntimeGraph {
    */
   std::vector<sftensor> get_outputs(const std::string& output_name) const;
 
+  /**
+   * @brief Appends a layer after a graph output
+   *
+   * Must be called after Build. Every following Forward runs the layer on
+   * the tensors of the output, and get_outputs returns the outputs of the
+   * layer instead. Used for post processing which is not part of the
+   * exported model, such as the non maximum suppression of detectors.
+   * An output bound by BindOutput can not have an appended layer.
+   *
+   * @param output_name Name of the graph output
+   * @param layer Layer taking the output tensors as inputs, nullptr removes
+   * the appended layer
+   */
+  void AppendOutputLayer(const std::string& output_name, std::shared_ptr<Layer<float>> layer);
+
+  /**
+   * @brief Binds caller memory to a graph input
+   *
+   * Must be called after Build. Column-major memory, or memory whose
+   * channels are vectors, is read by the first layers without copying.
+   * Row-major memory is transposed into graph tensors at the start of every
+   * Forward. The memory has to stay valid until the input is bound again or
+   * set by set_inputs.
+   *
+   * @param input_name Name of the graph input
+   * @param ptr Memory holding the whole batch
+   * @param shapes Input dimensions with the batch first, such as
+   * batch x channels x rows x cols
+   * @param layout Layout of the channels in the memory
+   */
+  void BindInput(const std::string& input_name, float* ptr, const std::vector<uint32_t>& shapes,
+                 BufferLayout layout);
+
+  /**
+   * @brief Binds caller memory to a graph output
+   *
+   * Must be called after Build. The layer producing the output writes into
+   * column-major memory directly, outputs of layers allocating their own
+   * tensors and row-major memory are copied at the end of every Forward.
+   * An output with a layer appended by AppendOutputLayer can not be bound,
+   * since the outputs of the appended layer may have other shapes.
+   *
+   * @param output_name Name of the graph output
+   * @param ptr Memory for the whole batch, nullptr removes the binding
+   * @param shapes Output dimensions with the batch first
+   * @param layout Layout of the channels in the memory
+   */
+  void BindOutput(const std::string& output_name, float* ptr, const std::vector<uint32_t>& shapes,
+                  BufferLayout layout = BufferLayout::kColMajor);
+
   /**
    * @brief Checks if an op is an input op
    *
@@ -139,6 +222,126 @@ class RuntimeGraph {
    */
   void Forward(bool debug = false);
 
+  /**
+   * @brief Enables the operator profiler
+   *
+   * Every following Forward records the execution time of each operator
+   * into the profiler until DisableProfiler is called.
+   *
+   * @param capacity Events kept per thread in the profiler's ring buffer
+   * @param hardware_counters Also collect cycles, instructions and cache misses
+   * of each operator, falls back to time only if counters are unavailable
+   */
+  void EnableProfiler(uint32_t capacity = 1 << 16, bool hardware_counters = false);
+
+  /**
+   * @brief Disables the operator profiler
+   */
+  void DisableProfiler();
+
+  /**
+   * @brief Gets the operator profiler
+   *
+   * @return The profiler, nullptr if profiling is disabled
+   */
+  std::shared_ptr<utils::Profiler> profiler() const;
+
+  /**
+   * @brief Gets the operators of the graph
+   *
+   * In execution order after Build.
+   *
+   * @return Runtime operators of the graph
+   */
+  const std::vector<std::shared_ptr<RuntimeOperator>>& operators() const;
+
+  /**
+   * @brief Gets the estimated cost of each operator
+   *
+   * Available after Build, in execution order.
+   *
+   * @return Estimated FLOPs and bytes of each operator
+   */
+  const std::vector<RuntimeOperatorCost>& operator_costs() const;
+
+  /**
+   * @brief Gets the estimated FLOPs of one forward of the model
+   */
+  uint64_t total_flops() const;
+
+  /**
+   * @brief Gets the estimated bytes moved by one forward of the model
+   */
+  uint64_t total_bytes() const;
+
+  /**
+   * @brief Prints the estimated cost of each operator and of the model
+   */
+  void CostSummaryLogging() const;
+
+  /**
+   * @brief Switches the convolution and linear layers to int8 inference
+   *
+   * Must be called after Build. Weights are quantized per output channel and
+   * the inputs of each quantized layer are quantized with the scale of their
+   * operand, the outputs stay in float.
+   *
+   * @param activation_scales Quantization scale of each operand, keyed by the
+   * name of the operator producing it. Operands without a scale are quantized
+   * with a scale computed at each forward.
+   * @return Number of operators running in int8
+   */
+  uint32_t QuantizeInt8(const std::map<std::string, float>& activation_scales = {});
+
+  /**
+   * @brief Switches to int8 inference with the scales of a calibration table
+   *
+   * @param table_path Table written by Calibrate or Int8Calibrator::WriteTable
+   * @return Number of operators running in int8
+   */
+  uint32_t QuantizeInt8(const std::string& table_path);
+
+  /**
+   * @brief Enables the calibration mode
+   *
+   * Every following Forward adds the output of each operator to the
+   * statistics of the calibrator until DisableCalibration is called.
+   *
+   * @param bin_num Histogram bins kept per operand
+   */
+  void EnableCalibration(uint32_t bin_num = 2048);
+
+  /**
+   * @brief Disables the calibration mode
+   */
+  void DisableCalibration();
+
+  /**
+   * @brief Gets the calibrator
+   *
+   * @return The calibrator, nullptr if the calibration mode is disabled
+   */
+  std::shared_ptr<Int8Calibrator> calibrator() const;
+
+  /**
+   * @brief Calibrates the graph over a directory of input samples
+   *
+   * Runs Forward over every file of the directory, one sample per file in
+   * the format of Int8Calibrator::LoadSample, in batches of the input
+   * operand's batch size, and writes the calibration table. The calibration
+   * mode is disabled again on return unless it was enabled before the call,
+   * in which case the statistics add to those of the existing calibrator.
+   *
+   * @param input_name Name of the graph input
+   * @param sample_dir Directory of the calibration samples
+   * @param table_path Path of the calibration table to write
+   * @param method Threshold selection method of the scales
+   * @return True if the table was written
+   */
+  bool Calibrate(const std::string& input_name, const std::string& sample_dir,
+                 const std::string& table_path,
+                 CalibrationMethod method = CalibrationMethod::kEntropy);
+
  private:
   /**
    * @brief Initializes the graph
@@ -175,6 +378,20 @@ class RuntimeGraph {
    */
   void CreateNodeRelation();
 
+  /**
+   * @brief Registers the sorted operators to the profiler
+   *
+   * The profiler id of an operator is its index in the execution order.
+   */
+  void RegisterProfilerOps();
+
+  /**
+   * @brief Estimates the FLOPs and bytes of each operator
+   *
+   * Asks the layer of each operator with the shapes of its input operands.
+   */
+  void EstimateOperatorCosts();
+
   /**
    * @brief Initializes operator inputs
    *
@@ -204,7 +421,8 @@ class RuntimeGraph {
   /**
    * @brief Initializes operator attributes
    *
-   * Initializes attributes of a graph operator.
+   * Initializes attributes of a graph operator. Float32, float16 and
+   * bfloat16 attributes are supported.
    *
    * @param attrs Operator attributes in PNNX graph
    * @param runtime_operator The runtime operator to initialize attributes for
@@ -237,6 +455,16 @@ class RuntimeGraph {
   template <typename T>
   static std::shared_ptr<Layer<T>> CreateLayer(const std::shared_ptr<RuntimeOperatorBase<T>>& op);
 
+  /**
+   * @brief Transposes row-major bound inputs into their graph tensors
+   */
+  void CopyBoundInputs();
+
+  /**
+   * @brief Copies graph outputs not written in place into bound memory
+   */
+  void CopyBoundOutputs();
+
   /**
    * Propagate output data from current operator to inputs of next operators.
    *
@@ -272,9 +500,27 @@ class RuntimeGraph {
   std::unique_ptr<pnnx::Graph> graph_;
 
   GraphState graph_state_ = GraphState::NeedInit;
-  std::vector<std::shared_ptr<RuntimeOperator>> input_ops_;
-  std::vector<std::shared_ptr<RuntimeOperator>> output_ops_;
+  std::unordered_map<std::string, std::shared_ptr<RuntimeOperator>> input_ops_;
+  std::unordered_map<std::string, std::shared_ptr<RuntimeOperator>> output_ops_;
   std::vector<std::shared_ptr<RuntimeOperator>> operators_;
+  std::unordered_map<std::string, std::shared_ptr<RuntimeOperator>> operators_maps_;
+  std::shared_ptr<utils::Profiler> profiler_;
+  std::vector<RuntimeOperatorCost> operator_costs_;
+  std::shared_ptr<Int8Calibrator> calibrator_;
+  std::unordered_map<std::string, std::shared_ptr<Layer<float>>> output_layers_;
+  std::unordered_map<std::string, std::vector<sftensor>> output_layer_datas_;
+
+  /// Caller memory bound to a graph input or output
+  struct BufferBinding {
+    float* ptr = nullptr;
+    BufferLayout layout = BufferLayout::kColMajor;
+    /// Channels, rows and columns of one batch element
+    std::vector<uint32_t> sample_shapes;
+    /// Tensors of the graph, views of ptr when no copy is needed
+    std::vector<sftensor> tensors;
+  };
+  std::unordered_map<std::string, BufferBinding> input_bindings_;
+  std::unordered_map<std::string, BufferBinding> output_bindings_;
 };
 
 }  // namespace kuiper_infer
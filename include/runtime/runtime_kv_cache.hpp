@@ -0,0 +1,173 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_KV_CACHE_HPP_
+#define KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_KV_CACHE_HPP_
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kuiper_infer {
+
+/**
+ * @brief Paged key/value cache for autoregressive decoding
+ *
+ * The whole cache is allocated once as a pool of fixed size blocks. A block
+ * holds the keys and values of block_size consecutive tokens for every layer
+ * and kv head, so the sequences take blocks from the shared pool as they grow
+ * and return them when they are freed, and no sequence reserves memory for
+ * its maximum length up front.
+ *
+ * Inside a block the keys of one layer and head are stored as a contiguous
+ * block_size x head_dim matrix followed by the values in the same layout.
+ *
+ * The cache is not thread safe: sequences are added, extended and freed by
+ * the caller between the forward passes, the attention layers only read and
+ * write the slots that were reserved before.
+ */
+class KVCache {
+ public:
+  /**
+   * @brief Allocates the block pool
+   *
+   * @param layer_num Number of attention layers
+   * @param head_num Number of key/value heads of each layer
+   * @param head_dim Dimension of each head
+   * @param block_size Tokens per block
+   * @param block_num Number of blocks in the pool
+   */
+  KVCache(uint32_t layer_num, uint32_t head_num, uint32_t head_dim, uint32_t block_size,
+          uint32_t block_num);
+
+  /**
+   * @brief Registers a new empty sequence
+   *
+   * @return Id of the sequence, ids of freed sequences are reused
+   */
+  int32_t AddSequence();
+
+  /**
+   * @brief Returns all blocks of a sequence to the pool and releases its id
+   */
+  void FreeSequence(int32_t seq_id);
+
+  /**
+   * @brief Reserves slots for new tokens at the end of a sequence
+   *
+   * Called once per forward pass before the attention layers run, the new
+   * tokens take the positions [length - tokens, length) afterwards.
+   *
+   * @param seq_id Id of the sequence
+   * @param tokens Number of new tokens
+   * @return False if the pool does not have enough free blocks, the sequence
+   * is unchanged then
+   */
+  bool Extend(int32_t seq_id, uint32_t tokens);
+
+  /**
+   * @brief Shrinks a sequence, the blocks no longer used go back to the pool
+   *
+   * @param seq_id Id of the sequence
+   * @param length New length, not larger than the current one
+   */
+  void Truncate(int32_t seq_id, uint32_t length);
+
+  /**
+   * @brief Key vector of one token
+   *
+   * @param seq_id Id of the sequence
+   * @param layer Index of the attention layer
+   * @param head Index of the kv head
+   * @param pos Position of the token in the sequence, smaller than its length
+   * @return Pointer to head_dim floats
+   */
+  float* key(int32_t seq_id, uint32_t layer, uint32_t head, uint32_t pos);
+
+  /**
+   * @brief Value vector of one token, see key()
+   */
+  float* value(int32_t seq_id, uint32_t layer, uint32_t head, uint32_t pos);
+
+  /**
+   * @brief Keys of the logical block of a sequence
+   *
+   * @param seq_id Id of the sequence
+   * @param layer Index of the attention layer
+   * @param head Index of the kv head
+   * @param block Index of the block in the sequence, the tokens
+   * [block * block_size, (block + 1) * block_size)
+   * @return Pointer to a row major block_size x head_dim matrix
+   */
+  const float* key_block(int32_t seq_id, uint32_t layer, uint32_t head, uint32_t block) const;
+
+  /**
+   * @brief Values of the logical block of a sequence, see key_block()
+   */
+  const float* value_block(int32_t seq_id, uint32_t layer, uint32_t head, uint32_t block) const;
+
+  uint32_t length(int32_t seq_id) const;
+
+  uint32_t layer_num() const { return layer_num_; }
+
+  uint32_t head_num() const { return head_num_; }
+
+  uint32_t head_dim() const { return head_dim_; }
+
+  uint32_t block_size() const { return block_size_; }
+
+  uint32_t block_num() const { return block_num_; }
+
+  uint32_t free_block_num() const { return free_blocks_.size(); }
+
+  /**
+   * @brief Bytes of the block pool
+   */
+  uint64_t bytes() const { return pool_.size() * sizeof(float); }
+
+ private:
+  struct Sequence {
+    bool active = false;
+    uint32_t length = 0;
+    /// Physical block of each logical block of the sequence
+    std::vector<uint32_t> blocks;
+  };
+
+  void CheckSequence(int32_t seq_id) const;
+
+  /// Offset of the keys of a layer and head inside the physical block
+  size_t BlockOffset(uint32_t block, uint32_t layer, uint32_t head) const;
+
+  size_t TokenOffset(int32_t seq_id, uint32_t layer, uint32_t head, uint32_t pos) const;
+
+ private:
+  uint32_t layer_num_ = 0;
+  uint32_t head_num_ = 0;
+  uint32_t head_dim_ = 0;
+  uint32_t block_size_ = 0;
+  uint32_t block_num_ = 0;
+
+  std::vector<float> pool_;
+  std::vector<uint32_t> free_blocks_;
+  std::vector<Sequence> sequences_;
+};
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_KV_CACHE_HPP_
@@ -59,6 +59,12 @@ struct RuntimeOperatorBase {
   /// Whether this operator has run in current execution
   bool has_forward = false;
 
+  /// Whether this operator is an input of the graph, resolved at build time
+  bool is_graph_input = false;
+
+  /// Whether this operator is an output of the graph, resolved at build time
+  bool is_graph_output = false;
+
   /// Name of the operator
   std::string name;
 
@@ -83,6 +89,9 @@ struct RuntimeOperatorBase {
   /// Output operators mapped by output name
   std::map<std::string, std::shared_ptr<RuntimeOperatorBase<T>>> output_operators;
 
+  /// Input operands of the output operators fed by this operator, resolved at build time
+  std::vector<std::shared_ptr<RuntimeOperandBase<T>>> output_operands_seq;
+
   /// Operator parameters
   std::map<std::string, std::shared_ptr<RuntimeParameter>> params;
 
@@ -154,6 +163,31 @@ class RuntimeOperatorUtils<float> {
    */
   static void InitOperatorOutput(const std::vector<pnnx::Operator*>& pnnx_operators,
                                  const std::vector<std::shared_ptr<RuntimeOperator>>& operators);
+
+  /**
+   * @brief Extends the lifetime of the inputs of view operators
+   *
+   * Must be called before InitOperatorOutput. View and flatten operators
+   * may alias the data of their input, so the input's buffer has to stay
+   * alive until the last consumer of the view is executed.
+   *
+   * @param operators Vector of runtime operators in execution order
+   */
+  static void ExtendViewLifetimes(const std::vector<std::shared_ptr<RuntimeOperator>>& operators);
+
+  /**
+   * @brief Plans the outputs of channel concatenations in place
+   *
+   * Must be called after InitOperatorOutput. The output of each producer
+   * feeding only a channel concatenation becomes a view of its channel slice
+   * in the concatenation's output, so the concatenation copies nothing at
+   * runtime. Producers with other consumers keep their own outputs and are
+   * copied.
+   *
+   * @param operators Vector of runtime operators in execution order
+   * @return Number of producer outputs planned into a concatenation
+   */
+  static uint32_t PlanConcatOutputs(const std::vector<std::shared_ptr<RuntimeOperator>>& operators);
 };
 
 }  // namespace kuiper_infer
@@ -0,0 +1,193 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_PIPELINE_HPP_
+#define KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_PIPELINE_HPP_
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "runtime/runtime_ir.hpp"
+
+namespace kuiper_infer {
+
+/**
+ * @brief Blocking FIFO queue with a fixed capacity
+ *
+ * Push waits while the queue is full, which is the back-pressure between
+ * the stages of a pipeline, and Pop waits while it is empty. After Close
+ * the remaining items can still be popped.
+ */
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) : capacity_(capacity) { CHECK_GT(capacity, 0); }
+
+  /**
+   * @brief Appends an item, waits while the queue is full
+   *
+   * @return False if the queue was closed, the item is left to the caller
+   */
+  bool Push(T&& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Takes the first item, waits while the queue is empty
+   *
+   * @return False if the queue is closed and empty
+   */
+  bool Pop(T& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      return false;
+    }
+    item = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Rejects further items and wakes all waiting threads
+   */
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return items_.size();
+  }
+
+  size_t capacity() const { return capacity_; }
+
+ private:
+  size_t capacity_ = 0;
+  bool closed_ = false;
+  std::deque<T> items_;
+  mutable std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+};
+
+/**
+ * @brief Pipelined inference on a runtime graph
+ *
+ * Each request passes through three stages, each with its own thread:
+ * preprocessing, which creates the input tensors; the graph forward; and
+ * postprocessing of copies of the outputs. While the graph computes one
+ * request, the next request is preprocessed and the previous one is
+ * postprocessed. Requests finish in submission order.
+ *
+ * Bounded queues sit between the stages, so at most queue_capacity
+ * requests wait before each stage, and Submit blocks when the first
+ * queue is full. The graph must be built and must not be used elsewhere
+ * while the pipeline runs.
+ */
+class RuntimePipeline {
+ public:
+  /// Creates the input tensors of one request, runs on the preprocess thread
+  using PreProcess = std::function<std::vector<sftensor>()>;
+
+  /// Turns the graph outputs of one request into its result, runs on the
+  /// postprocess thread
+  using PostProcess = std::function<std::vector<sftensor>(std::vector<sftensor>& outputs)>;
+
+  /**
+   * @brief Starts the stage threads
+   *
+   * @param graph Built graph, used only by the compute thread
+   * @param input_name Name of the graph input set from the preprocessed tensors
+   * @param output_name Name of the graph output passed to the postprocessing
+   * @param queue_capacity Requests waiting before each stage at most
+   */
+  RuntimePipeline(std::shared_ptr<RuntimeGraph> graph, std::string input_name,
+                  std::string output_name, size_t queue_capacity = 4);
+
+  /**
+   * @brief Finishes the submitted requests and stops the threads
+   */
+  ~RuntimePipeline();
+
+  RuntimePipeline(const RuntimePipeline&) = delete;
+
+  RuntimePipeline& operator=(const RuntimePipeline&) = delete;
+
+  /**
+   * @brief Submits a request, waits while the pipeline is full
+   *
+   * @param pre_process Creates the input tensors
+   * @param post_process Callback on copies of the graph outputs, the outputs
+   * themselves are the result when it is empty
+   * @return Future of the result, holding the exception if a stage threw or
+   * the pipeline has been stopped
+   */
+  std::future<std::vector<sftensor>> Submit(PreProcess pre_process,
+                                            PostProcess post_process = nullptr);
+
+ private:
+  /// A request moving through the stages
+  struct Task {
+    PreProcess pre_process;
+    PostProcess post_process;
+    /// Inputs after preprocessing, outputs after the forward
+    std::vector<sftensor> tensors;
+    std::promise<std::vector<sftensor>> promise;
+  };
+
+  void PreProcessLoop();
+
+  void ComputeLoop();
+
+  void PostProcessLoop();
+
+  std::shared_ptr<RuntimeGraph> graph_;
+  std::string input_name_;
+  std::string output_name_;
+
+  BoundedQueue<std::unique_ptr<Task>> pre_process_queue_;
+  BoundedQueue<std::unique_ptr<Task>> compute_queue_;
+  BoundedQueue<std::unique_ptr<Task>> post_process_queue_;
+
+  std::thread pre_process_thread_;
+  std::thread compute_thread_;
+  std::thread post_process_thread_;
+};
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_PIPELINE_HPP_
@@ -0,0 +1,139 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_STREAM_HPP_
+#define KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_STREAM_HPP_
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "runtime/runtime_ir.hpp"
+#include "utils/time/latency_histogram.hpp"
+
+namespace kuiper_infer {
+
+/**
+ * @brief Frame by frame inference on a stream of inputs with fixed shapes
+ *
+ * The input tensors are allocated once, as two buffers. While the graph
+ * runs a frame from one buffer, the caller writes the next frame into the
+ * other. Frames run on a dedicated worker thread, and the graph keeps its
+ * output tensors across frames, so the loop does not allocate tensors
+ * after the first frame.
+ *
+ * A typical loop fills input(), calls Submit, fills input() with the next
+ * frame, and then calls Wait for the outputs of the submitted one.
+ */
+class RuntimeStreamSession {
+ public:
+  /**
+   * @brief Allocates the input buffers and starts the worker
+   *
+   * @param graph Built graph, used only by the worker while frames run
+   * @param input_name Name of the graph input
+   * @param output_name Name of the graph output
+   * @param shapes Input dimensions with the batch first, such as
+   * batch x channels x rows x cols, must match the input operand of the
+   * graph
+   */
+  RuntimeStreamSession(std::shared_ptr<RuntimeGraph> graph, std::string input_name,
+                       std::string output_name, const std::vector<uint32_t>& shapes);
+
+  /**
+   * @brief Waits for the running frame and stops the worker
+   */
+  ~RuntimeStreamSession();
+
+  RuntimeStreamSession(const RuntimeStreamSession&) = delete;
+
+  RuntimeStreamSession& operator=(const RuntimeStreamSession&) = delete;
+
+  /**
+   * @brief Gets the buffer of the next frame
+   *
+   * Not used by the running frame, so it can be written while the graph
+   * runs.
+   *
+   * @return Input tensors, one per batch element
+   */
+  const std::vector<sftensor>& input() const;
+
+  /**
+   * @brief Runs the frame written into input()
+   *
+   * Waits until the previous frame finished, starts the new frame on the
+   * worker and returns. The outputs of the previous frame are overwritten
+   * by the new one.
+   */
+  void Submit();
+
+  /**
+   * @brief Waits for the submitted frame
+   *
+   * Rethrows the exception of a frame that failed on the worker.
+   *
+   * @return Output tensors of the frame, valid until the next Submit
+   */
+  const std::vector<sftensor>& Wait();
+
+  /**
+   * @brief Number of finished frames
+   */
+  uint64_t frame_count() const;
+
+  /**
+   * @brief Latency of each frame, from Submit until its outputs are ready
+   */
+  const utils::LatencyHistogram& latency() const;
+
+ private:
+  void WorkerLoop();
+
+  std::shared_ptr<RuntimeGraph> graph_;
+  std::string input_name_;
+  std::string output_name_;
+
+  /// Two input buffers, the caller writes one while the other runs
+  std::vector<sftensor> input_buffers_[2];
+  /// Index of the buffer returned by input()
+  uint32_t write_index_ = 0;
+  /// Outputs of the last finished frame
+  std::vector<sftensor> outputs_;
+  /// Exception of a failed frame, rethrown by Wait
+  std::exception_ptr error_;
+
+  utils::LatencyHistogram latency_;
+  uint64_t frame_count_ = 0;
+  int64_t submit_ns_ = 0;
+
+  bool running_ = false;
+  bool stopped_ = false;
+  mutable std::mutex mutex_;
+  std::condition_variable frame_submitted_;
+  std::condition_variable frame_finished_;
+  std::thread worker_;
+};
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_STREAM_HPP_
@@ -0,0 +1,49 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_UTILS_MATH_GEMV_HPP_
+#define KUIPER_INFER_INCLUDE_UTILS_MATH_GEMV_HPP_
+#include <cstdint>
+
+namespace kuiper_infer {
+namespace math {
+
+/**
+ * @brief Float matrix vector product for single token inference
+ *
+ * Computes output[n] = sum_k weight[n][k] * input[k] + bias[n]. The output
+ * rows are split into contiguous ranges across the OpenMP threads, each
+ * thread streams its weight rows with software prefetching and AVX2 FMAs.
+ * Inside an active parallel region the product runs on the calling thread.
+ *
+ * @param weight Row major rows x depth weights
+ * @param rows Number of output rows
+ * @param depth Length of the input vector
+ * @param input Input vector
+ * @param bias Bias of each output row, nullptr for none
+ * @param output Output vector of rows values
+ */
+void Gemv(const float* weight, uint32_t rows, uint32_t depth, const float* input,
+          const float* bias, float* output);
+
+}  // namespace math
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_UTILS_MATH_GEMV_HPP_
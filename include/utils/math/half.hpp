@@ -0,0 +1,141 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_UTILS_MATH_HALF_HPP_
+#define KUIPER_INFER_INCLUDE_UTILS_MATH_HALF_HPP_
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "runtime/runtime_datatype.hpp"
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+namespace kuiper_infer {
+namespace math {
+
+/**
+ * @brief Whether the data type is a 16 bit float stored as uint16_t
+ */
+inline bool IsHalfType(RuntimeDataType type) {
+  return type == RuntimeDataType::kTypeFloat16 || type == RuntimeDataType::kTypeBFloat16;
+}
+
+/**
+ * @brief Converts an IEEE half precision value to float
+ */
+inline float Float16ToFloat(uint16_t value) {
+#ifdef __F16C__
+  return _cvtsh_ss(value);
+#else
+  const uint32_t sign = uint32_t(value & 0x8000) << 16;
+  uint32_t exponent = (value >> 10) & 0x1f;
+  uint32_t mantissa = value & 0x3ff;
+  uint32_t bits = 0;
+  if (exponent == 0x1f) {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  } else if (mantissa != 0) {
+    // 非规格化数, 移位到隐含的最高位并相应减小指数
+    exponent = 113;
+    while (!(mantissa & 0x400)) {
+      mantissa <<= 1;
+      exponent -= 1;
+    }
+    bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+  } else {
+    bits = sign;
+  }
+  float result = 0.f;
+  std::memcpy(&result, &bits, sizeof(float));
+  return result;
+#endif
+}
+
+/**
+ * @brief Converts a float to IEEE half precision, rounding to nearest even
+ */
+inline uint16_t FloatToFloat16(float value) {
+#ifdef __F16C__
+  return _cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT);
+#else
+  uint32_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(float));
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  const uint32_t abs_bits = bits & 0x7fffffff;
+  if (abs_bits >= 0x7f800000) {
+    return sign | 0x7c00 | (abs_bits > 0x7f800000 ? 0x200 : 0);
+  }
+  if (abs_bits >= 0x477ff000) {
+    // 大于等于65520的值舍入后溢出为无穷大
+    return sign | 0x7c00;
+  }
+  if (abs_bits < 0x38800000) {
+    // 半精度的非规格化数, 以2^-24为单位舍入
+    float abs_value = 0.f;
+    std::memcpy(&abs_value, &abs_bits, sizeof(float));
+    return sign | uint16_t(std::nearbyint(abs_value * 16777216.f));
+  }
+  const uint32_t rounded = abs_bits + 0xfff + ((abs_bits >> 13) & 1);
+  return sign | uint16_t((rounded - 0x38000000) >> 13);
+#endif
+}
+
+/**
+ * @brief Converts a bfloat16 value to float
+ */
+inline float BFloat16ToFloat(uint16_t value) {
+  const uint32_t bits = uint32_t(value) << 16;
+  float result = 0.f;
+  std::memcpy(&result, &bits, sizeof(float));
+  return result;
+}
+
+/**
+ * @brief Converts a float to bfloat16, rounding to nearest even
+ */
+inline uint16_t FloatToBFloat16(float value) {
+  uint32_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(float));
+  if ((bits & 0x7fffffff) > 0x7f800000) {
+    return uint16_t(bits >> 16) | 0x40;
+  }
+  bits += 0x7fff + ((bits >> 16) & 1);
+  return uint16_t(bits >> 16);
+}
+
+/**
+ * @brief Converts a 16 bit float of the given type to float
+ */
+inline float HalfToFloat(uint16_t value, RuntimeDataType type) {
+  return type == RuntimeDataType::kTypeBFloat16 ? BFloat16ToFloat(value) : Float16ToFloat(value);
+}
+
+/**
+ * @brief Converts a float to a 16 bit float of the given type
+ */
+inline uint16_t FloatToHalf(float value, RuntimeDataType type) {
+  return type == RuntimeDataType::kTypeBFloat16 ? FloatToBFloat16(value) : FloatToFloat16(value);
+}
+}  // namespace math
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_UTILS_MATH_HALF_HPP_
@@ -0,0 +1,93 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_UTILS_MATH_HALF_GEMM_HPP_
+#define KUIPER_INFER_INCLUDE_UTILS_MATH_HALF_GEMM_HPP_
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "runtime/runtime_datatype.hpp"
+#include "utils/math/half.hpp"
+
+namespace kuiper_infer {
+namespace math {
+
+/**
+ * @brief Weights of a GEMM stored as 16 bit floats
+ *
+ * Row n holds the reduction vector of output channel n. The values are
+ * converted to float in registers by the GEMM kernel, so the weights take
+ * half of the memory and bandwidth of float weights.
+ */
+struct HalfWeight {
+  /// kTypeFloat16 or kTypeBFloat16
+  RuntimeDataType type = RuntimeDataType::kTypeFloat16;
+
+  /// Number of output channels
+  uint32_t rows = 0;
+
+  /// Reduction length
+  uint32_t depth = 0;
+
+  /// rows x depth raw 16 bit values
+  std::vector<uint16_t> data;
+
+  bool empty() const { return rows == 0; }
+
+  /// Bytes held by the weights
+  size_t bytes() const { return data.size() * sizeof(uint16_t); }
+};
+
+/**
+ * @brief Converts float weights to 16 bit floats
+ *
+ * @param weight Row major rows x depth float weights
+ * @param rows Number of output channels
+ * @param depth Reduction length of each output channel
+ * @param type kTypeFloat16 or kTypeBFloat16
+ * @param converted Output weights
+ */
+void ConvertWeightToHalf(const float* weight, uint32_t rows, uint32_t depth, RuntimeDataType type,
+                         HalfWeight& converted);
+
+/**
+ * @brief GEMM with 16 bit float weights and float accumulation
+ *
+ * Computes output[(n - weight_begin) * rows + m] =
+ *   sum_k input[m][k] * weight[n][k] + bias[n]
+ * for n in [weight_begin, weight_end). The weights are widened with F16C
+ * (float16) or a 16 bit shift (bfloat16) right before the multiply-add. The
+ * output layout matches Int8GemmDequantize.
+ *
+ * @param input Row major rows x weight.depth activations
+ * @param rows Number of input rows
+ * @param weight 16 bit float weights
+ * @param weight_begin First output channel to compute
+ * @param weight_end One past the last output channel to compute
+ * @param bias Bias of each output channel indexed by n, nullptr for none
+ * @param output Float output
+ */
+void HalfGemm(const float* input, uint32_t rows, const HalfWeight& weight, uint32_t weight_begin,
+              uint32_t weight_end, const float* bias, float* output);
+
+}  // namespace math
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_UTILS_MATH_HALF_GEMM_HPP_
@@ -0,0 +1,142 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_UTILS_MATH_INT8_GEMM_HPP_
+#define KUIPER_INFER_INCLUDE_UTILS_MATH_INT8_GEMM_HPP_
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kuiper_infer {
+namespace math {
+
+/// The reduction dim of packed int8 matrices is padded with zeros to this multiple
+constexpr uint32_t kInt8DepthAlign = 32;
+
+/// Largest magnitude of a symmetric int8 value, -128 is never produced
+constexpr int32_t kInt8Max = 127;
+
+/**
+ * @brief Rounds the reduction length up to the packed length
+ */
+inline uint32_t Int8PackedDepth(uint32_t depth) {
+  return (depth + kInt8DepthAlign - 1) / kInt8DepthAlign * kInt8DepthAlign;
+}
+
+/**
+ * @brief Symmetric per output channel int8 weights
+ *
+ * Row n holds the reduction vector of output channel n, quantized with
+ * scales[n] and padded with zeros to packed_depth.
+ */
+struct Int8Weight {
+  /// Number of output channels
+  uint32_t rows = 0;
+
+  /// Reduction length before padding
+  uint32_t depth = 0;
+
+  /// Reduction length after padding
+  uint32_t packed_depth = 0;
+
+  /// rows x packed_depth quantized values
+  std::vector<int8_t> data;
+
+  /// Dequantization scale of each row
+  std::vector<float> scales;
+
+  /// Sum of the quantized values of each row, compensates the unsigned inputs of VNNI
+  std::vector<int32_t> row_sums;
+
+  bool empty() const { return rows == 0; }
+
+  /// Bytes held by the quantized weights
+  size_t bytes() const {
+    return data.size() * sizeof(int8_t) + scales.size() * sizeof(float) +
+           row_sums.size() * sizeof(int32_t);
+  }
+};
+
+/**
+ * @brief Quantizes weights per output channel
+ *
+ * @param weight Row major rows x depth float weights
+ * @param rows Number of output channels
+ * @param depth Reduction length of each output channel
+ * @param quantized Output quantized weights
+ */
+void QuantizeWeightPerChannel(const float* weight, uint32_t rows, uint32_t depth,
+                              Int8Weight& quantized);
+
+/**
+ * @brief Largest absolute value of an array
+ */
+float AbsMax(const float* data, size_t size);
+
+/**
+ * @brief Symmetric scale that maps the absolute maximum to kInt8Max
+ */
+inline float Int8Scale(float abs_max) { return abs_max > 0.f ? abs_max / kInt8Max : 1.f; }
+
+/**
+ * @brief Quantizes an activation matrix into packed int8 rows
+ *
+ * Element (m, k) is read from src[m * row_stride + k * depth_stride], so
+ * column major and transposed inputs are packed without an extra copy.
+ *
+ * @param src Float activations
+ * @param rows Number of rows of the packed matrix
+ * @param depth Reduction length of each row
+ * @param row_stride Distance between two rows in src
+ * @param depth_stride Distance between two elements of a row in src
+ * @param scale Quantization scale of the activations
+ * @param dst Output rows x Int8PackedDepth(depth) values
+ */
+void QuantizeActivation(const float* src, uint32_t rows, uint32_t depth, size_t row_stride,
+                        size_t depth_stride, float scale, int8_t* dst);
+
+/**
+ * @brief Int8 GEMM with a dequantizing epilogue
+ *
+ * Computes output[(n - weight_begin) * rows + m] =
+ *   (sum_k input[m][k] * weight[n][k]) * input_scale * weight.scales[n] + bias[n]
+ * for n in [weight_begin, weight_end), accumulating in int32. The output
+ * layout is the layout of a column major matrix with one column per output
+ * channel, which is the layout of both the convolution and linear outputs.
+ *
+ * Uses VNNI dot products when available, otherwise AVX2 16 bit multiply-adds.
+ *
+ * @param input Packed rows x weight.packed_depth quantized activations
+ * @param rows Number of input rows
+ * @param input_scale Quantization scale of the activations
+ * @param weight Quantized weights
+ * @param weight_begin First output channel to compute
+ * @param weight_end One past the last output channel to compute
+ * @param bias Bias of each output channel indexed by n, nullptr for none
+ * @param output Float output
+ */
+void Int8GemmDequantize(const int8_t* input, uint32_t rows, float input_scale,
+                        const Int8Weight& weight, uint32_t weight_begin, uint32_t weight_end,
+                        const float* bias, float* output);
+
+}  // namespace math
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_UTILS_MATH_INT8_GEMM_HPP_
@@ -0,0 +1,135 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_UTILS_MATH_WEIGHT_QUANT_GEMM_HPP_
+#define KUIPER_INFER_INCLUDE_UTILS_MATH_WEIGHT_QUANT_GEMM_HPP_
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kuiper_infer {
+namespace math {
+
+/**
+ * @brief Storage format of the weights of a matmul
+ */
+enum class WeightFormat {
+  kFloat32 = 0,
+  kFloat16 = 1,
+  kBFloat16 = 2,
+  kInt8Grouped = 3,  // 按组量化的8位权重
+  kInt4Grouped = 4,  // 按组量化的4位权重, 每个字节存放两个权重
+};
+
+/// The group size of grouped quantization must be a multiple of this block
+constexpr uint32_t kQuantGroupBlock = 32;
+
+/**
+ * @brief Weight only quantized weights with a scale and zero point per group
+ *
+ * Row n holds the reduction vector of output channel n, split into groups of
+ * group_size consecutive weights. Weight k of group g is dequantized as
+ * (q - zeros[g]) * scales[g] with unsigned codes q.
+ *
+ * 4 bit codes are packed per block of 32 weights: byte i of a block holds
+ * weight i in the low nibble and weight i + 16 in the high nibble, so one
+ * 16 byte load unpacks to two runs of 16 consecutive weights.
+ */
+struct GroupQuantWeight {
+  /// kInt8Grouped or kInt4Grouped
+  WeightFormat format = WeightFormat::kInt4Grouped;
+
+  /// Number of output channels
+  uint32_t rows = 0;
+
+  /// Reduction length, a multiple of group_size
+  uint32_t depth = 0;
+
+  /// Weights sharing one scale and zero point
+  uint32_t group_size = 0;
+
+  /// Packed unsigned codes, rows x depth bytes for int8, half of it for int4
+  std::vector<uint8_t> data;
+
+  /// Scale of each group, rows x (depth / group_size)
+  std::vector<float> scales;
+
+  /// Zero point of each group, rows x (depth / group_size)
+  std::vector<uint8_t> zeros;
+
+  bool empty() const { return rows == 0; }
+
+  uint32_t groups() const { return group_size == 0 ? 0 : depth / group_size; }
+
+  /// Bytes of one packed row
+  size_t row_bytes() const {
+    return format == WeightFormat::kInt4Grouped ? depth / 2 : depth;
+  }
+
+  /// Bytes held by the quantized weights
+  size_t bytes() const {
+    return data.size() + scales.size() * sizeof(float) + zeros.size() * sizeof(uint8_t);
+  }
+};
+
+/**
+ * @brief Quantizes weights per group with asymmetric scales and zero points
+ *
+ * The range of each group is extended to contain zero, so zero weights stay
+ * exact.
+ *
+ * @param weight Row major rows x depth float weights
+ * @param rows Number of output channels
+ * @param depth Reduction length, a multiple of group_size
+ * @param group_size Weights per group, a multiple of kQuantGroupBlock such as 32, 64 or 128
+ * @param format kInt8Grouped or kInt4Grouped
+ * @param quantized Output quantized weights
+ */
+void QuantizeWeightGrouped(const float* weight, uint32_t rows, uint32_t depth,
+                           uint32_t group_size, WeightFormat format, GroupQuantWeight& quantized);
+
+/**
+ * @brief Dequantizes one weight
+ */
+float DequantizeGroupedValue(const GroupQuantWeight& weight, uint32_t row, uint32_t k);
+
+/**
+ * @brief GEMM with weight only quantized weights
+ *
+ * Computes output[(n - weight_begin) * rows + m] = sum_k input[m][k] * weight[n][k]
+ * for n in [weight_begin, weight_end). The codes are widened to float in
+ * registers and accumulated per group, the scale is applied once per group
+ * and the zero points are folded into the group sums of the input. Meant for
+ * the few rows of LLM decoding, where the weights dominate the memory traffic.
+ *
+ * @param input Row major rows x weight.depth activations
+ * @param rows Number of input rows
+ * @param weight Quantized weights
+ * @param weight_begin First output channel to compute
+ * @param weight_end One past the last output channel to compute
+ * @param output Float output
+ */
+void GroupQuantGemm(const float* input, uint32_t rows, const GroupQuantWeight& weight,
+                    uint32_t weight_begin, uint32_t weight_end, float* output);
+
+}  // namespace math
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_UTILS_MATH_WEIGHT_QUANT_GEMM_HPP_
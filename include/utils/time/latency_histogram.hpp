@@ -0,0 +1,101 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_UTILS_TIME_LATENCY_HISTOGRAM_HPP_
+#define KUIPER_INFER_INCLUDE_UTILS_TIME_LATENCY_HISTOGRAM_HPP_
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace kuiper_infer {
+namespace utils {
+/**
+ * @brief Histogram of latencies with fixed width buckets
+ *
+ * Memory is allocated once, so recording never allocates. Percentiles are
+ * resolved to the upper edge of a bucket. Latencies beyond the last bucket
+ * are counted in it, and the exact maximum is kept separately.
+ */
+class LatencyHistogram {
+ public:
+  /**
+   * @param bucket_us Width of a bucket in microseconds
+   * @param bucket_num Number of buckets
+   */
+  explicit LatencyHistogram(double bucket_us = 250., uint32_t bucket_num = 400);
+
+  /**
+   * @brief Records a latency, thread safe
+   *
+   * @param duration_ns Latency in nanoseconds
+   */
+  void Record(int64_t duration_ns);
+
+  /**
+   * @brief Removes all recorded latencies
+   */
+  void Reset();
+
+  uint64_t count() const;
+
+  double mean_us() const;
+
+  double min_us() const;
+
+  double max_us() const;
+
+  /**
+   * @brief Gets a percentile of the recorded latencies
+   *
+   * @param percent Percentile in (0, 100]
+   * @return Upper edge of the bucket holding the percentile in microseconds,
+   * 0 if nothing is recorded
+   */
+  double Percentile(double percent) const;
+
+  /**
+   * @brief Gets the number of latencies of each bucket
+   */
+  std::vector<uint64_t> buckets() const;
+
+  double bucket_us() const;
+
+  /**
+   * @brief Logs count, mean, percentiles and extremes
+   *
+   * @param name Name printed before the statistics
+   */
+  void PrintSummary(const std::string& name) const;
+
+ private:
+  double bucket_us_ = 250.;
+  std::vector<uint64_t> buckets_;
+  uint64_t count_ = 0;
+  int64_t total_ns_ = 0;
+  int64_t min_ns_ = std::numeric_limits<int64_t>::max();
+  int64_t max_ns_ = 0;
+  mutable std::mutex mutex_;
+};
+}  // namespace utils
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_UTILS_TIME_LATENCY_HISTOGRAM_HPP_
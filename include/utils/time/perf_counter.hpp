@@ -0,0 +1,112 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_UTILS_TIME_PERF_COUNTER_HPP_
+#define KUIPER_INFER_INCLUDE_UTILS_TIME_PERF_COUNTER_HPP_
+#include <cstdint>
+
+namespace kuiper_infer {
+namespace utils {
+
+/**
+ * @brief Hardware counters collected around an operator
+ */
+enum class PerfCounterType {
+  kCycles = 0,
+  kInstructions = 1,
+  kLLCMisses = 2,
+  kL1DMisses = 3,
+  kBranchMisses = 4,
+};
+
+constexpr uint32_t kPerfCounterNum = 5;
+
+/**
+ * @brief Counter deltas of one measured region
+ */
+struct PerfCounterValues {
+  /// Counter values indexed by PerfCounterType
+  uint64_t values[kPerfCounterNum] = {0};
+
+  /// Bit i is set if the counter of PerfCounterType i was measured
+  uint32_t valid_mask = 0;
+
+  bool is_valid(PerfCounterType type) const {
+    return (valid_mask >> static_cast<uint32_t>(type)) & 1u;
+  }
+
+  uint64_t value(PerfCounterType type) const { return values[static_cast<uint32_t>(type)]; }
+};
+
+/**
+ * @brief Hardware performance counters of the calling thread
+ *
+ * Opens a perf_event_open counter group for the thread that constructs it.
+ * Counters which can not be opened, for example inside containers or with
+ * a restrictive perf_event_paranoid, are skipped. If none can be opened the
+ * object is unavailable and Stop only reports an empty valid mask, so
+ * callers can always fall back to time-only measurement.
+ *
+ * Only events of the constructing thread are counted, threads started by
+ * OpenMP inside a layer are not included.
+ */
+class PerfCounters {
+ public:
+  PerfCounters();
+
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  /**
+   * @brief Whether at least one counter could be opened
+   */
+  bool available() const;
+
+  /**
+   * @brief Resets and starts the counters
+   */
+  void Start();
+
+  /**
+   * @brief Stops the counters and reads the values since Start
+   *
+   * @param values Output counter values
+   */
+  void Stop(PerfCounterValues& values);
+
+  /**
+   * @brief Printable name of a counter
+   */
+  static const char* CounterName(PerfCounterType type);
+
+ private:
+  int32_t leader_fd_ = -1;
+  int32_t fds_[kPerfCounterNum] = {-1, -1, -1, -1, -1};
+  /// Position of each opened counter in the group read, -1 if not opened
+  int32_t group_index_[kPerfCounterNum] = {-1, -1, -1, -1, -1};
+  uint32_t opened_num_ = 0;
+};
+
+}  // namespace utils
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_UTILS_TIME_PERF_COUNTER_HPP_
@@ -0,0 +1,288 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_UTILS_TIME_PROFILER_HPP_
+#define KUIPER_INFER_INCLUDE_UTILS_TIME_PROFILER_HPP_
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utils/time/perf_counter.hpp"
+
+namespace kuiper_infer {
+namespace utils {
+
+/**
+ * @brief A single timed execution of an operator
+ *
+ * Stored by value in the per-thread ring buffer, so it is kept small and
+ * refers to the operator by its profiler id rather than by name.
+ */
+struct ProfileEvent {
+  /// Id of the operator, as returned by Profiler::RegisterOp
+  uint32_t op_id = 0;
+
+  /// Start timestamp in nanoseconds
+  int64_t start_ns = 0;
+
+  /// End timestamp in nanoseconds
+  int64_t end_ns = 0;
+};
+
+/**
+ * @brief Fixed capacity event ring buffer owned by one thread
+ *
+ * Only the owning thread writes to the buffer. Once full, the oldest
+ * events are overwritten. Writes and reads of the events take the lock of
+ * the buffer, which is only contended while the events are aggregated.
+ */
+struct ProfileRingBuffer {
+  ProfileRingBuffer(uint32_t capacity, uint32_t thread_index);
+
+  /// Preallocated event slots, capacity is a power of two
+  std::vector<ProfileEvent> events;
+
+  /// Total number of events written since the last reset
+  uint64_t head = 0;
+
+  /// Index of the owning thread in the trace
+  uint32_t thread_index = 0;
+
+  /// Guards events, head and counter_values
+  std::mutex mutex;
+
+  /// Id of the owning thread
+  std::thread::id thread_id;
+
+  /// Hardware counters of the owning thread, empty if counters are disabled
+  std::unique_ptr<PerfCounters> perf_counters;
+
+  /// Counter values of each event slot, empty if counters are disabled
+  std::vector<PerfCounterValues> counter_values;
+};
+
+/**
+ * @brief Aggregated statistics of an operator or an operator type
+ */
+struct ProfileStats {
+  /// Operator name, or the operator type when aggregated by type
+  std::string name;
+
+  /// Operator type
+  std::string type;
+
+  /// Number of recorded executions
+  uint64_t count = 0;
+
+  /// Total execution time in microseconds
+  double total_us = 0.;
+
+  /// Mean execution time in microseconds
+  double mean_us = 0.;
+
+  /// Median execution time in microseconds
+  double p50_us = 0.;
+
+  /// 99th percentile execution time in microseconds
+  double p99_us = 0.;
+
+  /// Mean floating point operations per execution
+  uint64_t flops = 0;
+
+  /// Mean bytes read and written per execution
+  uint64_t bytes = 0;
+
+  /// Achieved GFLOP/s over all recorded executions
+  double gflops = 0.;
+
+  /// Mean hardware counter values per execution, valid if measured in every execution
+  PerfCounterValues counters;
+
+  /// Instructions per cycle, 0 if the counters are unavailable
+  double ipc = 0.;
+};
+
+/**
+ * @brief Low overhead operator profiler
+ *
+ * Records nanosecond timestamps of operator executions into preallocated
+ * per-thread ring buffers. Recording does no allocation and only takes the
+ * uncontended lock of the thread's own buffer, so Summary, ExportChromeTrace
+ * and Reset may run while another thread records. Operators must be
+ * registered before recording starts.
+ */
+class Profiler {
+ public:
+  /**
+   * @brief Construct a profiler
+   *
+   * @param capacity Events kept per thread, rounded up to a power of two
+   * @param hardware_counters Also collect hardware performance counters
+   */
+  explicit Profiler(uint32_t capacity = 1 << 16, bool hardware_counters = false);
+
+  /**
+   * @brief Registers an operator to be profiled
+   *
+   * @param name Name of the operator
+   * @param type Type of the operator
+   * @param flops Floating point operations per execution, 0 if unknown
+   * @param bytes Bytes moved per execution, 0 if unknown
+   * @return Id of the operator used in Record
+   */
+  uint32_t RegisterOp(const std::string& name, const std::string& type, uint64_t flops = 0,
+                      uint64_t bytes = 0);
+
+  /**
+   * @brief Removes all registered operators and recorded events
+   */
+  void Clear();
+
+  /**
+   * @brief Removes the recorded events, keeps the registered operators
+   */
+  void Reset();
+
+  /**
+   * @brief Records an execution of an operator on the calling thread
+   *
+   * @param op_id Id of the operator
+   * @param start_ns Start timestamp from NowNs
+   * @param end_ns End timestamp from NowNs
+   * @param counter_values Hardware counter values of the execution, nullable
+   */
+  void Record(uint32_t op_id, int64_t start_ns, int64_t end_ns,
+              const PerfCounterValues* counter_values = nullptr);
+
+  /**
+   * @brief Hardware counters of the calling thread
+   *
+   * @return The counters, nullptr if counters are disabled or unavailable
+   */
+  PerfCounters* LocalPerfCounters();
+
+  /**
+   * @brief Whether hardware counters were requested
+   */
+  bool hardware_counters() const;
+
+  /**
+   * @brief Number of events currently held in all buffers
+   */
+  uint64_t event_count() const;
+
+  /**
+   * @brief Number of registered operators
+   */
+  uint32_t op_count() const;
+
+  /**
+   * @brief Aggregates recorded events
+   *
+   * @param by_type Aggregate per operator type instead of per operator
+   * @return Statistics sorted by total time, descending
+   */
+  std::vector<ProfileStats> Summary(bool by_type = false) const;
+
+  /**
+   * @brief Prints per operator and per type statistics
+   */
+  void SummaryLogging() const;
+
+  /**
+   * @brief Exports recorded events as Chrome trace event JSON
+   *
+   * The output can be loaded by chrome://tracing or Perfetto.
+   *
+   * @param path Output file path
+   * @return True if the file was written
+   */
+  bool ExportChromeTrace(const std::string& path) const;
+
+  /**
+   * @brief Current steady clock time in nanoseconds
+   */
+  static int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+ private:
+  struct OpInfo {
+    std::string name;
+    std::string type;
+    uint64_t flops = 0;
+    uint64_t bytes = 0;
+  };
+
+  ProfileRingBuffer* LocalBuffer();
+
+  std::vector<ProfileEvent> CollectEvents(std::vector<uint32_t>* thread_indexes,
+                                          std::vector<PerfCounterValues>* counter_values) const;
+
+  const uint64_t profiler_id_;
+  uint32_t capacity_;
+  bool hardware_counters_ = false;
+  std::vector<OpInfo> ops_;
+  mutable std::mutex buffers_mutex_;
+  std::vector<std::unique_ptr<ProfileRingBuffer>> buffers_;
+};
+
+/**
+ * @brief Records the lifetime of the scope as an operator execution
+ */
+class ProfileScope {
+ public:
+  ProfileScope(Profiler* profiler, uint32_t op_id)
+      : profiler_(profiler), op_id_(op_id), start_ns_(profiler ? Profiler::NowNs() : 0) {
+    perf_counters_ = profiler_ ? profiler_->LocalPerfCounters() : nullptr;
+    if (perf_counters_) {
+      perf_counters_->Start();
+    }
+  }
+
+  ~ProfileScope() {
+    if (perf_counters_) {
+      PerfCounterValues counter_values;
+      perf_counters_->Stop(counter_values);
+      profiler_->Record(op_id_, start_ns_, Profiler::NowNs(), &counter_values);
+    } else if (profiler_) {
+      profiler_->Record(op_id_, start_ns_, Profiler::NowNs());
+    }
+  }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+ private:
+  Profiler* profiler_ = nullptr;
+  PerfCounters* perf_counters_ = nullptr;
+  uint32_t op_id_ = 0;
+  int64_t start_ns_ = 0;
+};
+
+}  // namespace utils
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_UTILS_TIME_PROFILER_HPP_
@@ -57,7 +57,7 @@ struct LayerTimeState {
         layer_name_(std::move(layer_name)),
         layer_type_(std::move(layer_type)) {}
 
-  /// Duration in ms
+  /// Duration in us
   long duration_time_;
 
   /**
@@ -22,47 +22,540 @@
 // Created by fss on 22-11-21.
 #include "data/load_data.hpp"
 #include <glog/logging.h>
+#include <algorithm>
 #include <armadillo>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
+#include "data/tensor_row_major.hpp"
+#include "data/tensor_util.hpp"
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace kuiper_infer {
+/// Bytes of a CSV chunk parsed by one thread
+constexpr size_t kCSVChunkSize = 1 << 20;
 
-std::pair<size_t, size_t> CSVDataLoader::GetMatrixSize(std::ifstream& file, char split_char) {
-  bool load_ok = file.good();
-  file.clear();
-  size_t fn_rows = 0;
-  size_t fn_cols = 0;
-  const std::ifstream::pos_type start_pos = file.tellg();
+/// Magic string at the start of a .npy file
+constexpr char kNpyMagic[] = "\x93NUMPY";
+constexpr size_t kNpyMagicSize = sizeof(kNpyMagic) - 1;
 
-  std::string token;
-  std::string line_str;
-  std::stringstream line_stream;
+/// The .npy header including the magic string is padded to a multiple of this size
+constexpr size_t kNpyHeaderAlignment = 64;
 
-  while (file.good() && load_ok) {
-    std::getline(file, line_str);
-    if (line_str.empty()) {
+/// Elements of a loaded .npy array above which its channels are transposed in parallel
+constexpr size_t kNpyParallelSize = 1 << 16;
+
+namespace {
+/// Read only view of a whole file, memory mapped where the platform supports it
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& file_path) {
+#ifdef _WIN32
+    std::ifstream in(file_path, std::ios::binary);
+    if (!in.is_open()) {
+      return;
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    is_open_ = true;
+#else
+    const int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) == 0) {
+      size_ = size_t(file_stat.st_size);
+      if (size_ == 0) {
+        is_open_ = true;
+      } else {
+        void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+          madvise(mapped, size_, MADV_SEQUENTIAL);
+          data_ = static_cast<const char*>(mapped);
+          is_open_ = true;
+        }
+      }
+    }
+    close(fd);
+#endif
+  }
+
+  ~MappedFile() {
+#ifndef _WIN32
+    if (data_ != nullptr) {
+      munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool is_open() const { return is_open_; }
+
+  const char* data() const { return data_; }
+
+  size_t size() const { return size_; }
+
+ private:
+  bool is_open_ = false;
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  std::vector<char> buffer_;
+#endif
+};
+
+/// Lines of a CSV chunk before its first empty line
+struct CSVChunk {
+  size_t begin = 0;
+  size_t end = 0;
+  size_t rows = 0;
+  size_t cols = 0;
+  bool has_empty_line = false;
+};
+
+/// Shape and data of a .npy file
+struct NpyArray {
+  std::vector<size_t> shapes;
+  bool fortran_order = false;
+  const char* data = nullptr;
+};
+}  // namespace
+
+// 行尾可能是\r\n
+static const char* LineEnd(const char* line, const char* end, const char** next_line) {
+  const char* line_end = static_cast<const char*>(std::memchr(line, '\n', end - line));
+  if (line_end == nullptr) {
+    *next_line = end;
+    line_end = end;
+  } else {
+    *next_line = line_end + 1;
+  }
+  if (line_end > line && *(line_end - 1) == '\r') {
+    line_end -= 1;
+  }
+  return line_end;
+}
+
+template <typename T>
+static bool ParseNumber(const char* begin, const char* end, T& value) {
+  while (begin < end && (*begin == ' ' || *begin == '\t')) {
+    begin += 1;
+  }
+  if (begin < end && *begin == '+') {
+    begin += 1;
+  }
+  if constexpr (std::is_floating_point_v<T>) {
+#if defined(__cpp_lib_to_chars)
+    return std::from_chars(begin, end, value).ec == std::errc();
+#else
+    // 标准库不支持浮点数的from_chars, 复制到以0结尾的缓冲区再解析
+    char buffer[64];
+    const size_t length = std::min(size_t(end - begin), sizeof(buffer) - 1);
+    std::memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+    char* parse_end = nullptr;
+    value = T(std::strtod(buffer, &parse_end));
+    return parse_end != buffer;
+#endif
+  } else {
+    return std::from_chars(begin, end, value).ec == std::errc();
+  }
+}
+
+template <typename T>
+bool CSVDataLoader::LoadData(const std::string& file_path, arma::Mat<T>& data, char split_char) {
+  static_assert(std::is_arithmetic_v<T>, "Unsupported data type of the CSV data loader");
+  if (file_path.empty()) {
+    LOG(ERROR) << "CSV file path is empty: " << file_path;
+    return false;
+  }
+
+  MappedFile file(file_path);
+  if (!file.is_open()) {
+    LOG(ERROR) << "File open failed: " << file_path;
+    return false;
+  }
+
+  const char* file_data = file.data();
+  const size_t file_size = file.size();
+  const size_t chunk_num = std::max(size_t(1), (file_size + kCSVChunkSize - 1) / kCSVChunkSize);
+  std::vector<CSVChunk> chunks(chunk_num);
+  // 每个块从它范围内的第一个行首开始, 到下一个块的起点结束
+  for (size_t i = 0; i < chunk_num; ++i) {
+    size_t begin = std::min(i * kCSVChunkSize, file_size);
+    if (i > 0) {
+      const void* line_end = std::memchr(file_data + begin - 1, '\n', file_size - begin + 1);
+      begin = line_end == nullptr ? file_size : static_cast<const char*>(line_end) - file_data + 1;
+    }
+    chunks.at(i).begin = begin;
+    if (i > 0) {
+      chunks.at(i - 1).end = begin;
+    }
+  }
+  chunks.back().end = file_size;
+
+  // 统计每个块中空行之前的行数和最大列数
+#pragma omp parallel for if (chunk_num > 1)
+  for (size_t i = 0; i < chunk_num; ++i) {
+    CSVChunk& chunk = chunks.at(i);
+    const char* line = file_data + chunk.begin;
+    const char* chunk_end = file_data + chunk.end;
+    while (line < chunk_end) {
+      const char* next_line = nullptr;
+      const char* line_end = LineEnd(line, chunk_end, &next_line);
+      if (line_end == line) {
+        chunk.has_empty_line = true;
+        break;
+      }
+      const size_t cols = std::count(line, line_end, split_char) + 1;
+      chunk.cols = std::max(chunk.cols, cols);
+      chunk.rows += 1;
+      line = next_line;
+    }
+  }
+
+  // 第一个空行之后的块不再读取
+  size_t rows = 0;
+  size_t cols = 0;
+  size_t valid_chunk_num = 0;
+  std::vector<size_t> row_offsets(chunk_num);
+  for (size_t i = 0; i < chunk_num; ++i) {
+    row_offsets.at(i) = rows;
+    rows += chunks.at(i).rows;
+    cols = std::max(cols, chunks.at(i).cols);
+    valid_chunk_num += 1;
+    if (chunks.at(i).has_empty_line) {
       break;
     }
+  }
+
+  data.zeros(rows, cols);
+#pragma omp parallel for if (valid_chunk_num > 1)
+  for (size_t i = 0; i < valid_chunk_num; ++i) {
+    const CSVChunk& chunk = chunks.at(i);
+    const char* line = file_data + chunk.begin;
+    const char* chunk_end = file_data + chunk.end;
+    for (size_t row = row_offsets.at(i); row < row_offsets.at(i) + chunk.rows; ++row) {
+      const char* next_line = nullptr;
+      const char* line_end = LineEnd(line, chunk_end, &next_line);
+      const char* token = line;
+      for (size_t col = 0; token <= line_end; ++col) {
+        const char* token_end = std::find(token, line_end, split_char);
+        T value{};
+        if (ParseNumber(token, token_end, value)) {
+          data.at(row, col) = value;
+        } else {
+          DLOG(ERROR) << "Parse CSV File meet error, row:" << row << " col:" << col;
+        }
+        token = token_end + 1;
+      }
+      line = next_line;
+    }
+  }
+  return true;
+}
+
+template <typename T>
+arma::Mat<T> CSVDataLoader::LoadData(const std::string& file_path, const char split_char) {
+  arma::Mat<T> data;
+  CSVDataLoader::LoadData(file_path, data, split_char);
+  return data;
+}
+
+template <typename T>
+static const char* NpyDescr() {
+  if constexpr (std::is_same_v<T, float>) {
+    return "<f4";
+  } else if constexpr (std::is_same_v<T, int32_t>) {
+    return "<i4";
+  } else if constexpr (std::is_same_v<T, uint8_t>) {
+    return "|u1";
+  } else {
+    static_assert(std::is_same_v<T, float>, "Unsupported data type of the npy data loader");
+    return nullptr;
+  }
+}
+
+// 解析header中键对应的值
+// header形如{'descr': '<f4', 'fortran_order': False, 'shape': (3, 4), }
+static std::string NpyHeaderValue(const std::string& header, const std::string& key) {
+  const size_t key_pos = header.find("'" + key + "'");
+  if (key_pos == std::string::npos) {
+    return "";
+  }
+  const size_t value_begin = header.find(':', key_pos);
+  if (value_begin == std::string::npos) {
+    return "";
+  }
+  size_t value_end = value_begin + 1;
+  if (header.find('(', value_begin) == header.find_first_not_of(' ', value_begin + 1)) {
+    value_end = header.find(')', value_begin) + 1;
+  } else {
+    value_end = header.find_first_of(",}", value_begin);
+  }
+  if (value_end == std::string::npos || value_end == 0) {
+    return "";
+  }
+  std::string value = header.substr(value_begin + 1, value_end - value_begin - 1);
+  const size_t first = value.find_first_not_of(" '");
+  const size_t last = value.find_last_not_of(" '");
+  return first == std::string::npos ? "" : value.substr(first, last - first + 1);
+}
+
+template <typename T>
+static bool ReadNpyArray(const MappedFile& file, const std::string& file_path, NpyArray& array) {
+  if (!file.is_open()) {
+    LOG(ERROR) << "File open failed: " << file_path;
+    return false;
+  }
+
+  const char* file_data = file.data();
+  const size_t file_size = file.size();
+  if (file_size < kNpyMagicSize + 4 || std::memcmp(file_data, kNpyMagic, kNpyMagicSize) != 0) {
+    LOG(ERROR) << "The file is not a npy file: " << file_path;
+    return false;
+  }
+
+  // 1.0版本的header长度是2字节, 2.0和3.0版本是4字节, 都是小端
+  const uint8_t major_version = uint8_t(file_data[kNpyMagicSize]);
+  const auto* length_ptr = reinterpret_cast<const uint8_t*>(file_data + kNpyMagicSize + 2);
+  size_t header_begin = kNpyMagicSize + 4;
+  size_t header_length = size_t(length_ptr[0]) | size_t(length_ptr[1]) << 8;
+  if (major_version >= 2) {
+    header_begin = kNpyMagicSize + 6;
+    if (file_size < header_begin) {
+      LOG(ERROR) << "The npy file is truncated: " << file_path;
+      return false;
+    }
+    header_length |= size_t(length_ptr[2]) << 16 | size_t(length_ptr[3]) << 24;
+  }
+  if (header_begin + header_length > file_size) {
+    LOG(ERROR) << "The npy file is truncated: " << file_path;
+    return false;
+  }
 
-    line_stream.clear();
-    line_stream.str(line_str);
-    size_t line_cols = 0;
+  const std::string header(file_data + header_begin, header_length);
+  const std::string descr = NpyHeaderValue(header, "descr");
+  const std::string expected_descr = NpyDescr<T>();
+  // 单字节类型不区分字节序'|', 本机字节序'='按小端处理
+  const bool same_type = descr.size() == expected_descr.size() &&
+                         (descr.at(0) == '<' || descr.at(0) == '|' || descr.at(0) == '=') &&
+                         descr.substr(1) == expected_descr.substr(1);
+  if (!same_type) {
+    LOG(ERROR) << "The npy file has dtype " << descr << ", but " << expected_descr
+               << " is needed: " << file_path;
+    return false;
+  }
+  array.fortran_order = NpyHeaderValue(header, "fortran_order") == "True";
 
-    std::string row_token;
-    while (line_stream.good()) {
-      std::getline(line_stream, row_token, split_char);
-      ++line_cols;
+  const std::string shape_str = NpyHeaderValue(header, "shape");
+  array.shapes.clear();
+  size_t size = 1;
+  for (const char* ptr = shape_str.data(); ptr < shape_str.data() + shape_str.size();) {
+    size_t dim = 0;
+    const auto [end_ptr, error] = std::from_chars(ptr, shape_str.data() + shape_str.size(), dim);
+    if (error == std::errc()) {
+      array.shapes.push_back(dim);
+      size *= dim;
+      ptr = end_ptr;
+    } else {
+      ptr += 1;
     }
-    if (line_cols > fn_cols) {
-      fn_cols = line_cols;
+  }
+
+  const size_t data_begin = header_begin + header_length;
+  if ((file_size - data_begin) / sizeof(T) < size) {
+    LOG(ERROR) << "The npy file has less data than its shape: " << file_path;
+    return false;
+  }
+  array.data = file_data + data_begin;
+  return true;
+}
+
+template <typename T>
+static bool WriteNpyArray(const std::string& file_path, const std::vector<size_t>& shapes,
+                          bool fortran_order, const T* data, size_t size) {
+  std::string header = std::string("{'descr': '") + NpyDescr<T>() +
+                       "', 'fortran_order': " + (fortran_order ? "True" : "False") +
+                       ", 'shape': (";
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    if (i > 0) {
+      header += ", ";
     }
+    header += std::to_string(shapes.at(i));
+  }
+  // 只有一个元素的元组需要逗号
+  if (shapes.size() == 1) {
+    header += ",";
+  }
+  header += "), }";
+  // header以换行结尾, 用空格补齐使数据对齐
+  const size_t prefix_size = kNpyMagicSize + 4;
+  const size_t total_size =
+      (prefix_size + header.size() + 1 + kNpyHeaderAlignment - 1) / kNpyHeaderAlignment *
+      kNpyHeaderAlignment;
+  header.append(total_size - prefix_size - header.size() - 1, ' ');
+  header += '\n';
 
-    ++fn_rows;
+  std::ofstream out(file_path, std::ios::binary);
+  if (!out.is_open()) {
+    LOG(ERROR) << "File open failed: " << file_path;
+    return false;
   }
-  file.clear();
-  file.seekg(start_pos);
-  return {fn_rows, fn_cols};
+  const char version[2] = {1, 0};
+  const char header_length[2] = {char(header.size() & 0xff), char(header.size() >> 8 & 0xff)};
+  out.write(kNpyMagic, kNpyMagicSize);
+  out.write(version, 2);
+  out.write(header_length, 2);
+  out.write(header.data(), std::streamsize(header.size()));
+  out.write(reinterpret_cast<const char*>(data), std::streamsize(size * sizeof(T)));
+  if (!out.good()) {
+    LOG(ERROR) << "Write npy file failed: " << file_path;
+    return false;
+  }
+  return true;
 }
-}  // namespace kuiper_infer
\ No newline at end of file
+
+template <typename T>
+std::shared_ptr<Tensor<T>> NpyDataLoader::LoadTensor(const std::string& file_path) {
+  MappedFile file(file_path);
+  NpyArray array;
+  if (!ReadNpyArray<T>(file, file_path, array)) {
+    return nullptr;
+  }
+
+  std::vector<uint32_t> shapes;
+  for (size_t dim : array.shapes) {
+    // 去掉多余的大小为1的前导维度
+    if (shapes.empty() && dim == 1 && array.shapes.size() > 3) {
+      continue;
+    }
+    shapes.push_back(uint32_t(dim));
+  }
+  if (shapes.empty()) {
+    shapes.push_back(1);
+  }
+  if (shapes.size() > 3) {
+    LOG(ERROR) << "The npy array has more than 3 dims: " << file_path;
+    return nullptr;
+  }
+  if (array.fortran_order && shapes.size() > 2) {
+    LOG(ERROR) << "The npy array in fortran order should have at most 2 dims: " << file_path;
+    return nullptr;
+  }
+
+  std::shared_ptr<Tensor<T>> tensor = TensorCreate<T>(shapes);
+  if (tensor->empty()) {
+    return tensor;
+  }
+  const T* array_data = reinterpret_cast<const T*>(array.data);
+  if (array.fortran_order) {
+    // fortran顺序的矩阵就是张量的列主序
+    std::memcpy(tensor->raw_ptr(), array_data, tensor->size() * sizeof(T));
+    return tensor;
+  }
+
+  const uint32_t channels = tensor->channels();
+  const uint32_t rows = tensor->rows();
+  const uint32_t cols = tensor->cols();
+  const size_t plane_size = tensor->plane_size();
+#pragma omp parallel for if (channels > 1 && tensor->size() >= kNpyParallelSize)
+  for (uint32_t c = 0; c < channels; ++c) {
+    TransposePlane(array_data + c * plane_size, rows, cols, tensor->matrix_raw_ptr(c));
+  }
+  return tensor;
+}
+
+template <typename T>
+bool NpyDataLoader::SaveTensor(const std::string& file_path,
+                               const std::shared_ptr<Tensor<T>>& tensor) {
+  CHECK(tensor != nullptr && !tensor->empty()) << "The tensor to save is empty";
+  const std::vector<T>& values = tensor->values(true);
+  const std::vector<uint32_t>& raw_shapes = tensor->raw_shapes();
+  const std::vector<size_t> shapes(raw_shapes.begin(), raw_shapes.end());
+  return WriteNpyArray(file_path, shapes, false, values.data(), values.size());
+}
+
+template <typename T>
+arma::Mat<T> NpyDataLoader::LoadData(const std::string& file_path) {
+  arma::Mat<T> data;
+  MappedFile file(file_path);
+  NpyArray array;
+  if (!ReadNpyArray<T>(file, file_path, array)) {
+    return data;
+  }
+
+  // 前面的维度都合并到行
+  size_t rows = 1;
+  size_t cols = array.shapes.empty() ? 1 : array.shapes.back();
+  for (size_t i = 0; i + 1 < array.shapes.size(); ++i) {
+    rows *= array.shapes.at(i);
+  }
+  if (array.fortran_order && array.shapes.size() > 2) {
+    LOG(ERROR) << "The npy array in fortran order should have at most 2 dims: " << file_path;
+    return data;
+  }
+
+  data.set_size(rows, cols);
+  if (data.empty()) {
+    return data;
+  }
+  const T* array_data = reinterpret_cast<const T*>(array.data);
+  if (array.fortran_order) {
+    std::memcpy(data.memptr(), array_data, data.n_elem * sizeof(T));
+  } else {
+    TransposePlane(array_data, uint32_t(rows), uint32_t(cols), data.memptr());
+  }
+  return data;
+}
+
+template <typename T>
+bool NpyDataLoader::SaveData(const std::string& file_path, const arma::Mat<T>& data) {
+  return WriteNpyArray(file_path, {size_t(data.n_rows), size_t(data.n_cols)}, true, data.memptr(),
+                       data.n_elem);
+}
+
+template bool CSVDataLoader::LoadData(const std::string& file_path, arma::Mat<float>& data,
+                                      char split_char);
+template bool CSVDataLoader::LoadData(const std::string& file_path, arma::Mat<int32_t>& data,
+                                      char split_char);
+template bool CSVDataLoader::LoadData(const std::string& file_path, arma::Mat<int8_t>& data,
+                                      char split_char);
+template arma::Mat<float> CSVDataLoader::LoadData(const std::string& file_path, char split_char);
+template arma::Mat<int32_t> CSVDataLoader::LoadData(const std::string& file_path, char split_char);
+template arma::Mat<int8_t> CSVDataLoader::LoadData(const std::string& file_path, char split_char);
+
+template std::shared_ptr<Tensor<float>> NpyDataLoader::LoadTensor(const std::string& file_path);
+template std::shared_ptr<Tensor<int32_t>> NpyDataLoader::LoadTensor(const std::string& file_path);
+template std::shared_ptr<Tensor<uint8_t>> NpyDataLoader::LoadTensor(const std::string& file_path);
+template bool NpyDataLoader::SaveTensor(const std::string& file_path,
+                                        const std::shared_ptr<Tensor<float>>& tensor);
+template bool NpyDataLoader::SaveTensor(const std::string& file_path,
+                                        const std::shared_ptr<Tensor<int32_t>>& tensor);
+template bool NpyDataLoader::SaveTensor(const std::string& file_path,
+                                        const std::shared_ptr<Tensor<uint8_t>>& tensor);
+template arma::Mat<float> NpyDataLoader::LoadData(const std::string& file_path);
+template arma::Mat<int32_t> NpyDataLoader::LoadData(const std::string& file_path);
+template arma::Mat<uint8_t> NpyDataLoader::LoadData(const std::string& file_path);
+template bool NpyDataLoader::SaveData(const std::string& file_path, const arma::Mat<float>& data);
+template bool NpyDataLoader::SaveData(const std::string& file_path,
+                                      const arma::Mat<int32_t>& data);
+template bool NpyDataLoader::SaveData(const std::string& file_path,
+                                      const arma::Mat<uint8_t>& data);
+}  // namespace kuiper_infer
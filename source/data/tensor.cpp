@@ -22,6 +22,7 @@
 // Created by fss on 22-11-12.
 
 #include "data/tensor.hpp"
+#include "data/tensor_row_major.hpp"
 namespace kuiper_infer {
 
 template <typename T>
@@ -258,10 +259,10 @@ void Tensor<T>::Fill(const std::vector<T>& values, bool row_major) {
     const uint32_t planes = rows * cols;
     const uint32_t channels = this->channels();
 
+    // 分块转置, 不生成临时矩阵
+#pragma omp parallel for if (channels > 1)
     for (uint32_t i = 0; i < channels; ++i) {
-      arma::Mat<T> channel_data_t(const_cast<T*>(values.data()) + i * planes, this->cols(),
-                                  this->rows(), false, true);
-      this->data_.slice(i) = channel_data_t.t();
+      TransposePlane(values.data() + size_t(i) * planes, rows, cols, this->data_.slice_memptr(i));
     }
   } else {
     std::copy(values.begin(), values.end(), this->data_.memptr());
@@ -368,7 +369,8 @@ void Tensor<T>::Reshape(const std::vector<uint32_t>& shapes, bool row_major) {
       std::accumulate(shapes.begin(), shapes.end(), size_t(1), std::multiplies<size_t>());
   CHECK(shapes.size() <= 3);
   CHECK(current_size == origin_size);
-  if (!row_major) {
+  // 内存布局不变时, 按行优先的变形与按列优先的变形相同
+  if (!row_major || this->IsViewable(shapes)) {
     if (shapes.size() == 3) {
       this->data_.reshape(shapes.at(1), shapes.at(2), shapes.at(0));
       this->raw_shapes_ = {shapes.at(0), shapes.at(1), shapes.at(2)};
@@ -393,6 +395,34 @@ void Tensor<T>::Reshape(const std::vector<uint32_t>& shapes, bool row_major) {
   }
 }
 
+template <typename T>
+bool Tensor<T>::IsViewable(const std::vector<uint32_t>& shapes) const {
+  CHECK(!shapes.empty() && shapes.size() <= 3);
+  const size_t new_size =
+      std::accumulate(shapes.begin(), shapes.end(), size_t(1), std::multiplies<size_t>());
+  if (new_size != this->size()) {
+    return false;
+  }
+  const uint32_t new_cols = shapes.back();
+  const uint32_t new_rows = shapes.size() >= 2 ? shapes.at(shapes.size() - 2) : 1;
+  // 通道为向量时, 列优先和行优先的存储顺序相同
+  const bool is_vector = this->rows() == 1 || this->cols() == 1;
+  const bool new_is_vector = new_rows == 1 || new_cols == 1;
+  return (is_vector && new_is_vector) || (new_rows == this->rows() && new_cols == this->cols());
+}
+
+template <typename T>
+std::shared_ptr<Tensor<T>> Tensor<T>::View(const std::vector<uint32_t>& shapes) {
+  CHECK(this->IsViewable(shapes)) << "The reshape changes the memory layout of the tensor";
+  const uint32_t channels = shapes.size() == 3 ? shapes.front() : 1;
+  const uint32_t rows = shapes.size() >= 2 ? shapes.at(shapes.size() - 2) : 1;
+  const uint32_t cols = shapes.back();
+  std::shared_ptr<Tensor<T>> view =
+      std::make_shared<Tensor<T>>(this->raw_ptr(), channels, rows, cols);
+  view->raw_shapes_ = shapes;
+  return view;
+}
+
 template <typename T>
 T* Tensor<T>::raw_ptr() {
   CHECK(!this->data_.empty()) << "The data area of the tensor is empty.";
@@ -429,13 +459,15 @@ std::vector<T> Tensor<T>::values(bool row_major) {
   if (!row_major) {
     std::copy(this->data_.mem, this->data_.mem + this->data_.size(), values.begin());
   } else {
-    uint32_t index = 0;
-    for (uint32_t c = 0; c < this->data_.n_slices; ++c) {
-      const arma::Mat<T>& channel = this->data_.slice(c).t();
-      std::copy(channel.begin(), channel.end(), values.begin() + index);
-      index += channel.size();
+    // 列优先的通道看作cols x rows的行优先矩阵, 转置后即为行优先
+    const uint32_t rows = this->rows();
+    const uint32_t cols = this->cols();
+    const size_t planes = this->plane_size();
+    const uint32_t channels = this->channels();
+#pragma omp parallel for if (channels > 1)
+    for (uint32_t c = 0; c < channels; ++c) {
+      TransposePlane(this->data_.slice_memptr(c), cols, rows, values.data() + c * planes);
     }
-    CHECK_EQ(index, values.size());
   }
   return values;
 }
@@ -0,0 +1,231 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "data/tensor_elementwise.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <type_traits>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace kuiper_infer {
+/// Output elements of one task, larger tensors are split into tasks for the threads
+constexpr size_t kBinaryBlockSize = 16384;
+
+std::vector<uint32_t> TensorBroadcastShapes(const std::vector<uint32_t>& shapes1,
+                                            const std::vector<uint32_t>& shapes2) {
+  CHECK(shapes1.size() == 3 && shapes2.size() == 3)
+      << "The broadcast shapes should be channels, rows and cols";
+  std::vector<uint32_t> shapes(3);
+  for (uint32_t i = 0; i < 3; ++i) {
+    const uint32_t dim1 = shapes1.at(i);
+    const uint32_t dim2 = shapes2.at(i);
+    CHECK(dim1 == dim2 || dim1 == 1 || dim2 == 1)
+        << "Broadcast shape is not adapting, dim " << i << ": " << dim1 << " and " << dim2;
+    shapes.at(i) = std::max(dim1, dim2);
+  }
+  return shapes;
+}
+
+template <BinaryType type, typename T>
+static inline T BinaryValue(T a, T b) {
+  if constexpr (type == BinaryType::kAdd) {
+    return a + b;
+  } else if constexpr (type == BinaryType::kSub) {
+    return a - b;
+  } else if constexpr (type == BinaryType::kMul) {
+    return a * b;
+  } else if constexpr (type == BinaryType::kDiv) {
+    return a / b;
+  } else if constexpr (type == BinaryType::kMax) {
+    return std::max(a, b);
+  } else {
+    return std::min(a, b);
+  }
+}
+
+#ifdef __AVX2__
+template <BinaryType type>
+static inline __m256 BinaryValue(__m256 a, __m256 b) {
+  if constexpr (type == BinaryType::kAdd) {
+    return _mm256_add_ps(a, b);
+  } else if constexpr (type == BinaryType::kSub) {
+    return _mm256_sub_ps(a, b);
+  } else if constexpr (type == BinaryType::kMul) {
+    return _mm256_mul_ps(a, b);
+  } else if constexpr (type == BinaryType::kDiv) {
+    return _mm256_div_ps(a, b);
+  } else if constexpr (type == BinaryType::kMax) {
+    return _mm256_max_ps(a, b);
+  } else {
+    return _mm256_min_ps(a, b);
+  }
+}
+#endif
+
+// 计算一段连续的输出, 每个操作数是一段连续的数据或者被广播的单个值
+template <BinaryType type, typename T>
+static void BinarySpan(const T* ptr1, bool scalar1, const T* ptr2, bool scalar2, size_t size,
+                       T* output_ptr) {
+  size_t i = 0;
+#ifdef __AVX2__
+  if constexpr (std::is_same_v<T, float>) {
+    if (!scalar1 && !scalar2) {
+      for (; i + 8 <= size; i += 8) {
+        _mm256_storeu_ps(output_ptr + i, BinaryValue<type>(_mm256_loadu_ps(ptr1 + i),
+                                                           _mm256_loadu_ps(ptr2 + i)));
+      }
+    } else if (scalar1 && !scalar2) {
+      const __m256 value1 = _mm256_set1_ps(*ptr1);
+      for (; i + 8 <= size; i += 8) {
+        _mm256_storeu_ps(output_ptr + i, BinaryValue<type>(value1, _mm256_loadu_ps(ptr2 + i)));
+      }
+    } else if (!scalar1 && scalar2) {
+      const __m256 value2 = _mm256_set1_ps(*ptr2);
+      for (; i + 8 <= size; i += 8) {
+        _mm256_storeu_ps(output_ptr + i, BinaryValue<type>(_mm256_loadu_ps(ptr1 + i), value2));
+      }
+    }
+  }
+#endif
+  for (; i < size; ++i) {
+    output_ptr[i] = BinaryValue<type>(scalar1 ? *ptr1 : ptr1[i], scalar2 ? *ptr2 : ptr2[i]);
+  }
+}
+
+template <BinaryType type, typename T>
+static void BinaryForward(const Tensor<T>& tensor1, const Tensor<T>& tensor2,
+                          Tensor<T>& output_tensor) {
+  const uint32_t channels = output_tensor.channels();
+  const uint32_t rows = output_tensor.rows();
+  const uint32_t cols = output_tensor.cols();
+  const size_t plane_size = size_t(rows) * cols;
+  const bool parallel = output_tensor.size() > kBinaryBlockSize;
+
+  const T* ptr1 = tensor1.raw_ptr();
+  const T* ptr2 = tensor2.raw_ptr();
+  T* output_ptr = output_tensor.raw_ptr();
+  // 被广播的维度上步长为0
+  const size_t channel_step1 = tensor1.channels() == 1 ? 0 : tensor1.plane_size();
+  const size_t channel_step2 = tensor2.channels() == 1 ? 0 : tensor2.plane_size();
+  const bool full_plane1 = tensor1.rows() == rows && tensor1.cols() == cols;
+  const bool full_plane2 = tensor2.rows() == rows && tensor2.cols() == cols;
+  const bool point1 = tensor1.rows() == 1 && tensor1.cols() == 1;
+  const bool point2 = tensor2.rows() == 1 && tensor2.cols() == 1;
+
+  if ((full_plane1 || point1) && (full_plane2 || point2)) {
+    // 每个通道中的操作数是连续的数据或者单个值, 按块划分通道
+    const size_t block_num = (plane_size + kBinaryBlockSize - 1) / kBinaryBlockSize;
+    const size_t task_num = channels * block_num;
+#pragma omp parallel for if (parallel)
+    for (size_t task = 0; task < task_num; ++task) {
+      const size_t channel = task / block_num;
+      const size_t offset = task % block_num * kBinaryBlockSize;
+      const size_t size = std::min(kBinaryBlockSize, plane_size - offset);
+      const T* channel_ptr1 = ptr1 + channel * channel_step1 + (full_plane1 ? offset : 0);
+      const T* channel_ptr2 = ptr2 + channel * channel_step2 + (full_plane2 ? offset : 0);
+      BinarySpan<type>(channel_ptr1, !full_plane1, channel_ptr2, !full_plane2, size,
+                       output_ptr + channel * plane_size + offset);
+    }
+    return;
+  }
+
+  // 行或者列被广播, 按列计算, 一列在内存中是连续的
+  const size_t col_step1 = tensor1.cols() == 1 ? 0 : tensor1.rows();
+  const size_t col_step2 = tensor2.cols() == 1 ? 0 : tensor2.rows();
+  const bool row_scalar1 = tensor1.rows() != rows;
+  const bool row_scalar2 = tensor2.rows() != rows;
+  const size_t task_num = size_t(channels) * cols;
+#pragma omp parallel for if (parallel)
+  for (size_t task = 0; task < task_num; ++task) {
+    const size_t channel = task / cols;
+    const size_t col = task % cols;
+    BinarySpan<type>(ptr1 + channel * channel_step1 + col * col_step1, row_scalar1,
+                     ptr2 + channel * channel_step2 + col * col_step2, row_scalar2, rows,
+                     output_ptr + channel * plane_size + col * rows);
+  }
+}
+
+template <typename T>
+void TensorElementBinary(BinaryType type, const std::shared_ptr<Tensor<T>>& tensor1,
+                         const std::shared_ptr<Tensor<T>>& tensor2,
+                         const std::shared_ptr<Tensor<T>>& output_tensor) {
+  CHECK(tensor1 != nullptr && tensor2 != nullptr && output_tensor != nullptr);
+  CHECK(!tensor1->empty() && !tensor2->empty()) << "The operand tensor is empty";
+  CHECK(output_tensor->shapes() == TensorBroadcastShapes(tensor1->shapes(), tensor2->shapes()))
+      << "The output tensor shape does not match the broadcast shape";
+  switch (type) {
+    case BinaryType::kAdd:
+      BinaryForward<BinaryType::kAdd>(*tensor1, *tensor2, *output_tensor);
+      break;
+    case BinaryType::kSub:
+      BinaryForward<BinaryType::kSub>(*tensor1, *tensor2, *output_tensor);
+      break;
+    case BinaryType::kMul:
+      BinaryForward<BinaryType::kMul>(*tensor1, *tensor2, *output_tensor);
+      break;
+    case BinaryType::kDiv:
+      BinaryForward<BinaryType::kDiv>(*tensor1, *tensor2, *output_tensor);
+      break;
+    case BinaryType::kMax:
+      BinaryForward<BinaryType::kMax>(*tensor1, *tensor2, *output_tensor);
+      break;
+    case BinaryType::kMin:
+      BinaryForward<BinaryType::kMin>(*tensor1, *tensor2, *output_tensor);
+      break;
+    default:
+      LOG(FATAL) << "Unknown binary operation type: " << int32_t(type);
+  }
+}
+
+template <typename T>
+std::shared_ptr<Tensor<T>> TensorElementBinary(BinaryType type,
+                                               const std::shared_ptr<Tensor<T>>& tensor1,
+                                               const std::shared_ptr<Tensor<T>>& tensor2) {
+  CHECK(tensor1 != nullptr && tensor2 != nullptr);
+  const std::vector<uint32_t> shapes = TensorBroadcastShapes(tensor1->shapes(), tensor2->shapes());
+  std::shared_ptr<Tensor<T>> output_tensor =
+      std::make_shared<Tensor<T>>(shapes.at(0), shapes.at(1), shapes.at(2));
+  TensorElementBinary(type, tensor1, tensor2, output_tensor);
+  return output_tensor;
+}
+
+template void TensorElementBinary(BinaryType type, const std::shared_ptr<Tensor<float>>& tensor1,
+                                  const std::shared_ptr<Tensor<float>>& tensor2,
+                                  const std::shared_ptr<Tensor<float>>& output_tensor);
+template void TensorElementBinary(BinaryType type, const std::shared_ptr<Tensor<int32_t>>& tensor1,
+                                  const std::shared_ptr<Tensor<int32_t>>& tensor2,
+                                  const std::shared_ptr<Tensor<int32_t>>& output_tensor);
+template void TensorElementBinary(BinaryType type, const std::shared_ptr<Tensor<uint8_t>>& tensor1,
+                                  const std::shared_ptr<Tensor<uint8_t>>& tensor2,
+                                  const std::shared_ptr<Tensor<uint8_t>>& output_tensor);
+
+template std::shared_ptr<Tensor<float>> TensorElementBinary(
+    BinaryType type, const std::shared_ptr<Tensor<float>>& tensor1,
+    const std::shared_ptr<Tensor<float>>& tensor2);
+template std::shared_ptr<Tensor<int32_t>> TensorElementBinary(
+    BinaryType type, const std::shared_ptr<Tensor<int32_t>>& tensor1,
+    const std::shared_ptr<Tensor<int32_t>>& tensor2);
+template std::shared_ptr<Tensor<uint8_t>> TensorElementBinary(
+    BinaryType type, const std::shared_ptr<Tensor<uint8_t>>& tensor1,
+    const std::shared_ptr<Tensor<uint8_t>>& tensor2);
+}  // namespace kuiper_infer
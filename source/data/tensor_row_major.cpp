@@ -0,0 +1,299 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "data/tensor_row_major.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace kuiper_infer {
+/// Elements above which the conversions are split over the channels
+constexpr size_t kTransposeParallelSize = 1 << 16;
+
+template <typename T>
+void TransposePlane(const T* src, uint32_t rows, uint32_t cols, T* dst) {
+  CHECK(src != nullptr && dst != nullptr);
+  // 分块转置, 读写都停留在缓存中
+  constexpr uint32_t block_size = 16;
+  for (uint32_t r0 = 0; r0 < rows; r0 += block_size) {
+    const uint32_t r1 = std::min(rows, r0 + block_size);
+    for (uint32_t c0 = 0; c0 < cols; c0 += block_size) {
+      const uint32_t c1 = std::min(cols, c0 + block_size);
+      for (uint32_t c = c0; c < c1; ++c) {
+        T* dst_col = dst + size_t(c) * rows;
+        for (uint32_t r = r0; r < r1; ++r) {
+          dst_col[r] = src[size_t(r) * cols + c];
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+RowMajorTensor<T>::RowMajorTensor(uint32_t channels, uint32_t rows, uint32_t cols) {
+  this->SetShapes({channels, rows, cols});
+  this->Allocate();
+}
+
+template <typename T>
+RowMajorTensor<T>::RowMajorTensor(const std::vector<uint32_t>& shapes) {
+  this->SetShapes(shapes);
+  this->Allocate();
+}
+
+template <typename T>
+RowMajorTensor<T>::RowMajorTensor(T* raw_ptr, const std::vector<uint32_t>& shapes) {
+  CHECK_NE(raw_ptr, nullptr);
+  this->SetShapes(shapes);
+  this->data_ = raw_ptr;
+}
+
+template <typename T>
+RowMajorTensor<T>::RowMajorTensor(const Tensor<T>& tensor) {
+  CHECK(!tensor.empty()) << "The data area of the tensor is empty.";
+  this->SetShapes({tensor.channels(), tensor.rows(), tensor.cols()});
+  this->raw_shapes_ = tensor.raw_shapes();
+  this->Allocate();
+  // 列优先的通道可以看作cols x rows的行优先矩阵
+#pragma omp parallel for if (channels_ > 1 && this->size() >= kTransposeParallelSize)
+  for (uint32_t c = 0; c < channels_; ++c) {
+    TransposePlane(tensor.matrix_raw_ptr(c), cols_, rows_, this->matrix_raw_ptr(c));
+  }
+}
+
+template <typename T>
+RowMajorTensor<T>::RowMajorTensor(const RowMajorTensor& tensor) {
+  *this = tensor;
+}
+
+template <typename T>
+RowMajorTensor<T>& RowMajorTensor<T>::operator=(const RowMajorTensor& tensor) {
+  if (this == &tensor) {
+    return *this;
+  }
+  // 拷贝总是得到拥有内存的张量
+  this->raw_shapes_ = tensor.raw_shapes_;
+  this->channels_ = tensor.channels_;
+  this->rows_ = tensor.rows_;
+  this->cols_ = tensor.cols_;
+  this->storage_.reset();
+  this->data_ = nullptr;
+  if (tensor.data_ != nullptr) {
+    this->Allocate();
+    std::memcpy(this->data_, tensor.data_, sizeof(T) * this->size());
+  }
+  return *this;
+}
+
+template <typename T>
+void RowMajorTensor<T>::Allocate() {
+  const std::align_val_t alignment{kTensorAlignment};
+  T* ptr = static_cast<T*>(::operator new[](sizeof(T) * this->size(), alignment));
+  this->storage_.reset(ptr, [alignment](T* p) { ::operator delete[](p, alignment); });
+  this->data_ = ptr;
+}
+
+template <typename T>
+void RowMajorTensor<T>::SetShapes(const std::vector<uint32_t>& shapes) {
+  CHECK(!shapes.empty() && shapes.size() <= 3);
+  std::vector<uint32_t> padded_shapes(3, 1);
+  std::copy(shapes.begin(), shapes.end(), padded_shapes.begin() + (3 - shapes.size()));
+  this->channels_ = padded_shapes.at(0);
+  this->rows_ = padded_shapes.at(1);
+  this->cols_ = padded_shapes.at(2);
+  if (channels_ == 1 && rows_ == 1) {
+    this->raw_shapes_ = std::vector<uint32_t>{cols_};
+  } else if (channels_ == 1) {
+    this->raw_shapes_ = std::vector<uint32_t>{rows_, cols_};
+  } else {
+    this->raw_shapes_ = std::vector<uint32_t>{channels_, rows_, cols_};
+  }
+}
+
+template <typename T>
+uint32_t RowMajorTensor<T>::rows() const {
+  return this->rows_;
+}
+
+template <typename T>
+uint32_t RowMajorTensor<T>::cols() const {
+  return this->cols_;
+}
+
+template <typename T>
+uint32_t RowMajorTensor<T>::channels() const {
+  return this->channels_;
+}
+
+template <typename T>
+size_t RowMajorTensor<T>::size() const {
+  return size_t(channels_) * rows_ * cols_;
+}
+
+template <typename T>
+size_t RowMajorTensor<T>::plane_size() const {
+  return size_t(rows_) * cols_;
+}
+
+template <typename T>
+bool RowMajorTensor<T>::empty() const {
+  return this->data_ == nullptr || this->size() == 0;
+}
+
+template <typename T>
+bool RowMajorTensor<T>::is_view() const {
+  return this->data_ != nullptr && this->storage_ == nullptr;
+}
+
+template <typename T>
+std::vector<uint32_t> RowMajorTensor<T>::shapes() const {
+  CHECK(!this->empty()) << "The data area of the tensor is empty.";
+  return {channels_, rows_, cols_};
+}
+
+template <typename T>
+const std::vector<uint32_t>& RowMajorTensor<T>::raw_shapes() const {
+  CHECK(!this->raw_shapes_.empty());
+  return this->raw_shapes_;
+}
+
+template <typename T>
+T& RowMajorTensor<T>::index(size_t offset) {
+  CHECK_LT(offset, this->size()) << "Tensor index out of bound!";
+  return this->data_[offset];
+}
+
+template <typename T>
+const T RowMajorTensor<T>::index(size_t offset) const {
+  CHECK_LT(offset, this->size()) << "Tensor index out of bound!";
+  return this->data_[offset];
+}
+
+template <typename T>
+T& RowMajorTensor<T>::at(uint32_t channel, uint32_t row, uint32_t col) {
+  CHECK_LT(row, rows_);
+  CHECK_LT(col, cols_);
+  CHECK_LT(channel, channels_);
+  return this->data_[(size_t(channel) * rows_ + row) * cols_ + col];
+}
+
+template <typename T>
+const T RowMajorTensor<T>::at(uint32_t channel, uint32_t row, uint32_t col) const {
+  CHECK_LT(row, rows_);
+  CHECK_LT(col, cols_);
+  CHECK_LT(channel, channels_);
+  return this->data_[(size_t(channel) * rows_ + row) * cols_ + col];
+}
+
+template <typename T>
+T* RowMajorTensor<T>::raw_ptr() {
+  CHECK(!this->empty()) << "The data area of the tensor is empty.";
+  return this->data_;
+}
+
+template <typename T>
+const T* RowMajorTensor<T>::raw_ptr() const {
+  CHECK(!this->empty()) << "The data area of the tensor is empty.";
+  return this->data_;
+}
+
+template <typename T>
+T* RowMajorTensor<T>::raw_ptr(size_t offset) {
+  CHECK_LT(offset, this->size());
+  return this->data_ + offset;
+}
+
+template <typename T>
+const T* RowMajorTensor<T>::raw_ptr(size_t offset) const {
+  CHECK_LT(offset, this->size());
+  return this->data_ + offset;
+}
+
+template <typename T>
+T* RowMajorTensor<T>::matrix_raw_ptr(uint32_t index) {
+  CHECK_LT(index, channels_);
+  return this->raw_ptr(index * this->plane_size());
+}
+
+template <typename T>
+const T* RowMajorTensor<T>::matrix_raw_ptr(uint32_t index) const {
+  CHECK_LT(index, channels_);
+  return this->raw_ptr(index * this->plane_size());
+}
+
+template <typename T>
+void RowMajorTensor<T>::Fill(T value) {
+  CHECK(!this->empty()) << "The data area of the tensor is empty.";
+  std::fill(this->data_, this->data_ + this->size(), value);
+}
+
+template <typename T>
+void RowMajorTensor<T>::Fill(const std::vector<T>& values) {
+  CHECK(!this->empty()) << "The data area of the tensor is empty.";
+  CHECK_EQ(values.size(), this->size());
+  std::copy(values.begin(), values.end(), this->data_);
+}
+
+template <typename T>
+std::vector<T> RowMajorTensor<T>::values() const {
+  CHECK(!this->empty()) << "The data area of the tensor is empty.";
+  return std::vector<T>(this->data_, this->data_ + this->size());
+}
+
+template <typename T>
+void RowMajorTensor<T>::Reshape(const std::vector<uint32_t>& shapes) {
+  CHECK(!this->empty()) << "The data area of the tensor is empty.";
+  CHECK(!shapes.empty() && shapes.size() <= 3);
+  const size_t origin_size = this->size();
+  this->SetShapes(shapes);
+  CHECK_EQ(this->size(), origin_size);
+  this->raw_shapes_ = shapes;
+}
+
+template <typename T>
+arma::Cube<T> RowMajorTensor<T>::cube() {
+  CHECK(!this->empty()) << "The data area of the tensor is empty.";
+  return arma::Cube<T>(this->data_, cols_, rows_, channels_, false, true);
+}
+
+template <typename T>
+std::shared_ptr<Tensor<T>> RowMajorTensor<T>::ToTensor() const {
+  CHECK(!this->empty()) << "The data area of the tensor is empty.";
+  auto tensor = std::make_shared<Tensor<T>>(channels_, rows_, cols_);
+  if (this->raw_shapes_ != tensor->raw_shapes()) {
+    tensor->Reshape(this->raw_shapes_);
+  }
+#pragma omp parallel for if (channels_ > 1 && this->size() >= kTransposeParallelSize)
+  for (uint32_t c = 0; c < channels_; ++c) {
+    TransposePlane(this->matrix_raw_ptr(c), rows_, cols_, tensor->matrix_raw_ptr(c));
+  }
+  return tensor;
+}
+
+template void TransposePlane(const float* src, uint32_t rows, uint32_t cols, float* dst);
+template void TransposePlane(const int32_t* src, uint32_t rows, uint32_t cols, int32_t* dst);
+template void TransposePlane(const uint8_t* src, uint32_t rows, uint32_t cols, uint8_t* dst);
+
+template class RowMajorTensor<float>;
+template class RowMajorTensor<int32_t>;
+template class RowMajorTensor<uint8_t>;
+}  // namespace kuiper_infer
@@ -96,6 +96,43 @@ StatusCode Layer<float>::Check(const std::vector<sftensor>& inputs,
   return StatusCode::kFunctionNotImplement;
 }
 
+uint64_t Layer<float>::EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const {
+  return 0;
+}
+
+uint64_t Layer<float>::EstimateBytes(const std::vector<std::vector<int32_t>>& input_shapes) const {
+  uint64_t elements = OutputSize(input_shapes);
+  for (const auto& input_shape : input_shapes) {
+    elements += ShapeSize(input_shape);
+  }
+  return elements * sizeof(float);
+}
+
+bool Layer<float>::QuantizeInt8(float input_scale) { return false; }
+
+uint64_t Layer<float>::ShapeSize(const std::vector<int32_t>& shape) {
+  if (shape.empty()) {
+    return 0;
+  }
+  uint64_t size = 1;
+  for (int32_t dim : shape) {
+    CHECK_GT(dim, 0) << "Dynamic shape is not supported in the estimation";
+    size *= dim;
+  }
+  return size;
+}
+
+uint64_t Layer<float>::OutputSize(const std::vector<std::vector<int32_t>>& input_shapes) const {
+  const auto& runtime_operator = this->runtime_operator_.lock();
+  if (runtime_operator != nullptr && runtime_operator->output_operands != nullptr) {
+    return ShapeSize(runtime_operator->output_operands->shapes);
+  }
+  if (input_shapes.empty()) {
+    return 0;
+  }
+  return ShapeSize(input_shapes.front());
+}
+
 void Layer<float>::set_runtime_operator(const std::shared_ptr<RuntimeOperator>& runtime_operator) {
   CHECK(runtime_operator != nullptr);
   this->runtime_operator_ = runtime_operator;
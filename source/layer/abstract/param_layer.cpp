@@ -99,6 +99,21 @@ std::shared_ptr<Tensor<float>> ParamLayer::weight(int32_t index) const {
   return this->weights_.at(index);
 }
 
+uint64_t ParamLayer::EstimateBytes(const std::vector<std::vector<int32_t>>& input_shapes) const {
+  uint64_t param_size = 0;
+  for (const auto& weight : this->weights_) {
+    if (weight != nullptr) {
+      param_size += weight->size();
+    }
+  }
+  for (const auto& bias : this->bias_) {
+    if (bias != nullptr) {
+      param_size += bias->size();
+    }
+  }
+  return Layer<float>::EstimateBytes(input_shapes) + param_size * sizeof(float);
+}
+
 void ParamLayer::set_bias(const std::vector<float>& bias) {
   size_t bias_size = 0;
   const size_t elem_size = bias.size();
@@ -93,5 +93,33 @@ StatusCode ActivationLayer::Forward(const std::vector<std::shared_ptr<Tensor<flo
 
 ActivationLayer::ActivationLayer(activation::ActivationType type, std::string layer_name)
     : NonParamLayer(std::move(layer_name)), act_type_(type) {}
+uint64_t ActivationLayer::EstimateFlops(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty()) {
+    return 0;
+  }
+  // 每个元素的运算次数, 指数运算按一次计算
+  uint64_t element_flops = 0;
+  switch (act_type_) {
+    case ActivationType::kActivationRelu:
+      element_flops = 1;
+      break;
+    case ActivationType::kActivationRelu6:
+    case ActivationType::kActivationHardSigmoid:
+      element_flops = 3;
+      break;
+    case ActivationType::kActivationSigmoid:
+      element_flops = 4;
+      break;
+    case ActivationType::kActivationSilu:
+    case ActivationType::kActivationHardSwish:
+      element_flops = 5;
+      break;
+    default:
+      element_flops = 0;
+  }
+  return element_flops * ShapeSize(input_shapes.front());
+}
+
 }  // namespace activation
 }  // namespace kuiper_infer
\ No newline at end of file
@@ -33,6 +33,8 @@ class ActivationLayer : public NonParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  uint64_t EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
  private:
   ActivationType act_type_ = ActivationType::kActivatetionUnknown;
 };
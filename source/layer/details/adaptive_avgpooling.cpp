@@ -165,4 +165,23 @@ StatusCode AdaptiveAveragePoolingLayer::Check(const std::vector<sftensor>& input
 LayerRegistererWrapper kAdaptiveAvgPoolingCreateInstance(
     AdaptiveAveragePoolingLayer::CreateInstance, "nn.AdaptiveAvgPool2d", "F.adaptive_avg_pool2d");
 
+uint64_t AdaptiveAveragePoolingLayer::EstimateFlops(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty()) {
+    return 0;
+  }
+  // 每个输入元素做一次累加, 每个输出元素做一次除法
+  return ShapeSize(input_shapes.front()) + OutputSize(input_shapes);
+}
+
+uint64_t AdaptiveAveragePoolingLayer::OutputSize(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty()) {
+    return 0;
+  }
+  const std::vector<int32_t>& input_shape = input_shapes.front();
+  CHECK_EQ(input_shape.size(), 4) << "The input shape of the avg pooling layer should be NCHW";
+  return uint64_t(input_shape.at(0)) * input_shape.at(1) * output_h_ * output_w_;
+}
+
 }  // namespace kuiper_infer
\ No newline at end of file
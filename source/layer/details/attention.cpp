@@ -0,0 +1,274 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "attention.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "utils/math/fmath.hpp"
+#include "utils/math/simd_reduce.hpp"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#define KUIPER_ATTENTION_SIMD
+#endif
+
+namespace kuiper_infer {
+static inline float Dot(const float* x, const float* y, uint32_t size) {
+  uint32_t i = 0;
+  float sum = 0.f;
+#ifdef KUIPER_ATTENTION_SIMD
+  __m256 acc = _mm256_setzero_ps();
+  for (; i + 8 <= size; i += 8) {
+    acc = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), acc);
+  }
+  sum = math::HorizontalSum(acc);
+#endif
+  for (; i < size; ++i) {
+    sum += x[i] * y[i];
+  }
+  return sum;
+}
+
+// y += alpha * x
+static inline void Axpy(float alpha, const float* x, float* y, uint32_t size) {
+  uint32_t i = 0;
+#ifdef KUIPER_ATTENTION_SIMD
+  const __m256 alpha256 = _mm256_set1_ps(alpha);
+  for (; i + 8 <= size; i += 8) {
+    _mm256_storeu_ps(y + i,
+                     _mm256_fmadd_ps(alpha256, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+  }
+#endif
+  for (; i < size; ++i) {
+    y[i] += alpha * x[i];
+  }
+}
+
+// 原地计算softmax, 返回指数的和
+static inline float ExpSum(float* scores, uint32_t size) {
+  const float max_value = *std::max_element(scores, scores + size);
+  uint32_t i = 0;
+  float sum = 0.f;
+#ifdef KUIPER_ATTENTION_SIMD
+  const __m256 max_value256 = _mm256_set1_ps(max_value);
+  __m256 sum256 = _mm256_setzero_ps();
+  for (; i + 8 <= size; i += 8) {
+    const __m256 exp_value =
+        fmath::exp_ps256(_mm256_sub_ps(_mm256_loadu_ps(scores + i), max_value256));
+    _mm256_storeu_ps(scores + i, exp_value);
+    sum256 = _mm256_add_ps(sum256, exp_value);
+  }
+  sum = math::HorizontalSum(sum256);
+#endif
+  for (; i < size; ++i) {
+    scores[i] = fmath::exp(scores[i] - max_value);
+    sum += scores[i];
+  }
+  return sum;
+}
+
+MultiHeadAttentionLayer::MultiHeadAttentionLayer(uint32_t head_num, uint32_t kv_head_num,
+                                                 uint32_t head_dim, uint32_t layer_index,
+                                                 std::shared_ptr<KVCache> kv_cache,
+                                                 float rope_theta)
+    : NonParamLayer("MultiHeadAttention"),
+      head_num_(head_num),
+      kv_head_num_(kv_head_num),
+      head_dim_(head_dim),
+      layer_index_(layer_index),
+      rope_theta_(rope_theta),
+      kv_cache_(std::move(kv_cache)) {
+  CHECK(kv_cache_ != nullptr) << "The attention layer needs a kv cache";
+  CHECK(head_num > 0 && kv_head_num > 0 && head_num % kv_head_num == 0)
+      << "The query heads of the attention layer can not be grouped by the kv heads";
+  CHECK(head_dim > 0 && head_dim % 2 == 0) << "The head dimension has to be an even number";
+  CHECK(kv_cache_->head_num() == kv_head_num && kv_cache_->head_dim() == head_dim)
+      << "The kv cache does not match the heads of the attention layer";
+  CHECK_LT(layer_index, kv_cache_->layer_num());
+  if (rope_theta_ > 0.f) {
+    inv_freq_.resize(head_dim / 2);
+    for (uint32_t p = 0; p < head_dim / 2; ++p) {
+      inv_freq_.at(p) = std::pow(rope_theta_, -float(2 * p) / float(head_dim));
+    }
+  }
+}
+
+void MultiHeadAttentionLayer::set_sequences(std::vector<int32_t> seq_ids) {
+  seq_ids_ = std::move(seq_ids);
+}
+
+void MultiHeadAttentionLayer::ApplyRoPE(float* data, uint32_t head_num, const float* rope) const {
+  for (uint32_t h = 0; h < head_num; ++h) {
+    float* head = data + size_t(h) * head_dim_;
+    for (uint32_t p = 0; p < head_dim_ / 2; ++p) {
+      const float x0 = head[2 * p];
+      const float x1 = head[2 * p + 1];
+      const float cos_value = rope[2 * p];
+      const float sin_value = rope[2 * p + 1];
+      head[2 * p] = x0 * cos_value - x1 * sin_value;
+      head[2 * p + 1] = x0 * sin_value + x1 * cos_value;
+    }
+  }
+}
+
+StatusCode MultiHeadAttentionLayer::Forward(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  if (inputs.empty()) {
+    LOG(ERROR) << "The input tensor array in the attention layer is empty";
+    return StatusCode::kInferInputsEmpty;
+  }
+
+  if (outputs.empty()) {
+    LOG(ERROR) << "The output tensor array in the attention layer is empty";
+    return StatusCode::kInferOutputsEmpty;
+  }
+
+  if (inputs.size() != 3 * outputs.size()) {
+    LOG(ERROR) << "The attention layer needs a query, key and value for each output";
+    return StatusCode::kInferDimMismatch;
+  }
+
+  if (seq_ids_.size() != outputs.size()) {
+    LOG(ERROR) << "The kv cache sequences of the attention layer do not match the outputs";
+    return StatusCode::kInferParamError;
+  }
+
+  const uint32_t query_dim = head_num_ * head_dim_;
+  const uint32_t kv_dim = kv_head_num_ * head_dim_;
+  const uint32_t group = head_num_ / kv_head_num_;
+  const uint32_t block_size = kv_cache_->block_size();
+  const float scale = 1.f / std::sqrt(float(head_dim_));
+  const bool use_rope = !inv_freq_.empty();
+  for (uint32_t i = 0; i < outputs.size(); ++i) {
+    const auto& query = inputs.at(3 * i);
+    const auto& key = inputs.at(3 * i + 1);
+    const auto& value = inputs.at(3 * i + 2);
+    CHECK(query != nullptr && !query->empty() && key != nullptr && !key->empty() &&
+          value != nullptr && !value->empty())
+        << "The input tensor array in the attention layer has an empty tensor " << i << " th";
+
+    const uint32_t tokens = query->size() / query_dim;
+    CHECK(tokens > 0 && query->size() == tokens * query_dim)
+        << "The query size is not a multiple of the heads in the attention layer";
+    CHECK(key->size() == tokens * kv_dim && value->size() == tokens * kv_dim)
+        << "The key and value sizes do not match the query in the attention layer";
+
+    std::shared_ptr<Tensor<float>> output = outputs.at(i);
+    if (output == nullptr || output->empty()) {
+      output = std::make_shared<Tensor<float>>(query->shapes());
+      outputs.at(i) = output;
+    }
+    CHECK(output->size() == query->size())
+        << "The input and output tensor sizes of the attention layer do not match " << i << " th";
+
+    const int32_t seq_id = seq_ids_.at(i);
+    const uint32_t length = kv_cache_->length(seq_id);
+    CHECK_GE(length, tokens) << "The slots of the new tokens are not reserved in the kv cache";
+    const uint32_t start = length - tokens;
+
+    // 每个新token位置上的旋转角度, 所有的头共用
+    std::vector<float> rope;
+    if (use_rope) {
+      rope.resize(size_t(tokens) * head_dim_);
+      for (uint32_t t = 0; t < tokens; ++t) {
+        for (uint32_t p = 0; p < head_dim_ / 2; ++p) {
+          const double angle = double(start + t) * inv_freq_.at(p);
+          rope.at(size_t(t) * head_dim_ + 2 * p) = float(std::cos(angle));
+          rope.at(size_t(t) * head_dim_ + 2 * p + 1) = float(std::sin(angle));
+        }
+      }
+    }
+
+    // 新token的key和value追加到kv cache中
+    for (uint32_t t = 0; t < tokens; ++t) {
+      for (uint32_t h = 0; h < kv_head_num_; ++h) {
+        const size_t offset = size_t(t) * kv_dim + h * head_dim_;
+        float* key_cache = kv_cache_->key(seq_id, layer_index_, h, start + t);
+        float* value_cache = kv_cache_->value(seq_id, layer_index_, h, start + t);
+        std::memcpy(key_cache, key->raw_ptr() + offset, head_dim_ * sizeof(float));
+        std::memcpy(value_cache, value->raw_ptr() + offset, head_dim_ * sizeof(float));
+        if (use_rope) {
+          ApplyRoPE(key_cache, 1, rope.data() + size_t(t) * head_dim_);
+        }
+      }
+    }
+
+    // 每个新token的每个头只和它之前的token计算注意力
+    const uint32_t task_num = tokens * head_num_;
+#pragma omp parallel for schedule(dynamic) if (task_num > 1)
+    for (uint32_t task = 0; task < task_num; ++task) {
+      const uint32_t t = task / head_num_;
+      const uint32_t h = task % head_num_;
+      const uint32_t kv_head = h / group;
+      const uint32_t context = start + t + 1;
+
+      const float* query_ptr = query->raw_ptr() + size_t(t) * query_dim + h * head_dim_;
+      std::vector<float> query_head(query_ptr, query_ptr + head_dim_);
+      if (use_rope) {
+        ApplyRoPE(query_head.data(), 1, rope.data() + size_t(t) * head_dim_);
+      }
+
+      std::vector<float> scores(context);
+      for (uint32_t b = 0; b * block_size < context; ++b) {
+        const float* key_block = kv_cache_->key_block(seq_id, layer_index_, kv_head, b);
+        const uint32_t block_tokens = std::min(block_size, context - b * block_size);
+        for (uint32_t j = 0; j < block_tokens; ++j) {
+          scores[b * block_size + j] =
+              Dot(query_head.data(), key_block + size_t(j) * head_dim_, head_dim_) * scale;
+        }
+      }
+      const float inv_sum = 1.f / ExpSum(scores.data(), context);
+
+      float* output_ptr = output->raw_ptr() + size_t(t) * query_dim + h * head_dim_;
+      std::fill(output_ptr, output_ptr + head_dim_, 0.f);
+      for (uint32_t b = 0; b * block_size < context; ++b) {
+        const float* value_block = kv_cache_->value_block(seq_id, layer_index_, kv_head, b);
+        const uint32_t block_tokens = std::min(block_size, context - b * block_size);
+        for (uint32_t j = 0; j < block_tokens; ++j) {
+          Axpy(scores[b * block_size + j] * inv_sum, value_block + size_t(j) * head_dim_,
+               output_ptr, head_dim_);
+        }
+      }
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+uint64_t MultiHeadAttentionLayer::EstimateFlops(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  uint64_t flops = 0;
+  const uint64_t query_dim = uint64_t(head_num_) * head_dim_;
+  for (uint32_t i = 0; i * 3 < input_shapes.size(); ++i) {
+    const uint64_t tokens = ShapeSize(input_shapes.at(3 * i)) / query_dim;
+    uint64_t length = tokens;
+    if (i < seq_ids_.size()) {
+      length = std::max(uint64_t(kv_cache_->length(seq_ids_.at(i))), tokens);
+    }
+    // 每个新token的上下文长度为它之前的token数, 分数和加权求和各一次乘加
+    const uint64_t contexts = tokens * (length - tokens) + tokens * (tokens + 1) / 2;
+    flops += 4 * contexts * query_dim;
+  }
+  return flops;
+}
+
+}  // namespace kuiper_infer
@@ -0,0 +1,100 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_SOURCE_LAYER_DETAILS_ATTENTION_HPP
+#define KUIPER_INFER_SOURCE_LAYER_DETAILS_ATTENTION_HPP
+#include "layer/abstract/non_param_layer.hpp"
+#include "runtime/runtime_kv_cache.hpp"
+namespace kuiper_infer {
+/**
+ * @brief Causal multi-head attention over a paged kv cache
+ *
+ * The inputs are the query, key and value projections of the new tokens of
+ * each sequence. The layer rotates the query and key with RoPE, appends the
+ * key and value to the kv cache and attends the new queries to every cached
+ * token of the sequence, so a decode step costs one pass over the cache
+ * instead of recomputing the attention of the whole prefix.
+ *
+ * The heads are grouped when kv_head_num is smaller than head_num, every
+ * head_num / kv_head_num query heads share one kv head.
+ */
+class MultiHeadAttentionLayer : public NonParamLayer {
+ public:
+  /**
+   * @param head_num Number of query heads
+   * @param kv_head_num Number of key/value heads, divides head_num
+   * @param head_dim Dimension of each head, an even number
+   * @param layer_index Index of the layer in the kv cache
+   * @param kv_cache Cache shared by all attention layers of the model
+   * @param rope_theta Base of the rotary embedding frequencies, RoPE is not
+   * applied if it is not positive
+   */
+  MultiHeadAttentionLayer(uint32_t head_num, uint32_t kv_head_num, uint32_t head_dim,
+                          uint32_t layer_index, std::shared_ptr<KVCache> kv_cache,
+                          float rope_theta = 10000.f);
+
+  /**
+   * @brief Runs the attention of the new tokens
+   *
+   * The inputs hold the query, key and value of each sequence in turn, the
+   * i-th output belongs to the sequence set by set_sequences(). A query has
+   * the shape 1 x (head_num * head_dim) x tokens and stores the tokens one
+   * after another like the output of LLamaMatmulLayer, the key and value have
+   * kv_head_num * head_dim rows. The slots of the new tokens have to be
+   * reserved with KVCache::Extend() before, they are the last tokens of the
+   * sequence.
+   */
+  StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  uint64_t EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
+  /**
+   * @brief Sets the kv cache sequence of each input of the next forward
+   */
+  void set_sequences(std::vector<int32_t> seq_ids);
+
+  const std::vector<int32_t>& sequences() const { return seq_ids_; }
+
+ private:
+  /**
+   * @brief Rotates the heads of one token in place
+   *
+   * @param data head_num consecutive vectors of head_dim floats
+   * @param head_num Number of heads in data
+   * @param rope cos and sin of each rotated pair at the token position
+   */
+  void ApplyRoPE(float* data, uint32_t head_num, const float* rope) const;
+
+ private:
+  uint32_t head_num_ = 0;
+  uint32_t kv_head_num_ = 0;
+  uint32_t head_dim_ = 0;
+  uint32_t layer_index_ = 0;
+  float rope_theta_ = 10000.f;
+
+  /// Rotation frequency of each pair of dimensions
+  std::vector<float> inv_freq_;
+  std::vector<int32_t> seq_ids_;
+  std::shared_ptr<KVCache> kv_cache_;
+};
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_SOURCE_LAYER_DETAILS_ATTENTION_HPP
@@ -23,6 +23,7 @@
 // Created by fss on 23-10-11.
 //
 #include "base_convolution.hpp"
+#include <algorithm>
 #include "convolution.hpp"
 #include "deconvolution.hpp"
 #include "layer/abstract/layer.hpp"
@@ -71,6 +72,10 @@ BaseConvolutionLayer::BaseConvolutionLayer(ConvType conv_type, uint32_t output_c
 
   CHECK_GT(kernel_h, 0);
   CHECK_GT(kernel_w, 0);
+  kernel_count_ = output_channel;
+  kernel_channel_ = in_channel;
+  kernel_h_ = kernel_h;
+  kernel_w_ = kernel_w;
   this->InitWeightParam(output_channel, in_channel, kernel_h, kernel_w);
   if (use_bias_) {
     this->InitBiasParam(output_channel, 1, 1, 1);
@@ -79,6 +84,13 @@ BaseConvolutionLayer::BaseConvolutionLayer(ConvType conv_type, uint32_t output_c
 
 void BaseConvolutionLayer::InitIm2ColWeight() {}
 
+void BaseConvolutionLayer::ReleaseFloatKernels() {
+  for (auto& kernel : this->weights_) {
+    kernel = std::make_shared<Tensor<float>>();
+  }
+  kernel_matrix_arr_.clear();
+}
+
 void BaseConvolutionLayer::AddBias(arma::fmat& output, uint32_t bias_index) const {
   if (!this->bias_.empty() && this->use_bias_) {
     std::shared_ptr<Tensor<float>> bias;
@@ -99,10 +111,10 @@ StatusCode BaseConvolutionLayer::Forward(const std::vector<std::shared_ptr<Tenso
     return check_code;
   }
 
-  const uint32_t kernel_count = this->weights_.size();
-  const uint32_t kernel_h = this->weights_.at(0)->rows();
-  const uint32_t kernel_w = this->weights_.at(0)->cols();
-  const uint32_t kernel_channel = this->weights_.at(0)->channels();
+  const uint32_t kernel_count = kernel_count_;
+  const uint32_t kernel_h = kernel_h_;
+  const uint32_t kernel_w = kernel_w_;
+  const uint32_t kernel_channel = kernel_channel_;
 
   if (kernel_matrix_arr_.size() != kernel_count) {
     InitIm2ColWeight();
@@ -363,8 +375,36 @@ StatusCode BaseConvolutionLayer::CreateInstance(const std::shared_ptr<RuntimeOpe
     return StatusCode::kParseWeightError;
   }
 
-  const std::vector<float>& weight_values = weight->get<float>();
-  conv_layer->set_weights(weight_values);
+  const bool half_weight = math::IsHalfType(weight->type) && conv_type == ConvType::kOpConv;
+  if (half_weight) {
+    // 16位的卷积核直接以16位存放, 不再转换出float卷积核
+    auto conv = std::dynamic_pointer_cast<ConvolutionLayer>(conv_layer);
+    CHECK(conv != nullptr);
+    math::HalfWeight half_weights;
+    half_weights.type = weight->type;
+    half_weights.rows = out_channel->value;
+    half_weights.data = weight->get<uint16_t>();
+    half_weights.depth = half_weights.data.size() / out_channel->value;
+    // pnnx的卷积核平面按行优先存放, 与float卷积核的Fill一样转为列优先
+    const uint32_t kernel_h = kernels.at(0);
+    const uint32_t kernel_w = kernels.at(1);
+    const uint32_t plane_size = kernel_h * kernel_w;
+    CHECK_EQ(half_weights.data.size() % plane_size, 0);
+    std::vector<uint16_t> plane(plane_size);
+    for (size_t offset = 0; offset < half_weights.data.size(); offset += plane_size) {
+      uint16_t* plane_data = half_weights.data.data() + offset;
+      std::copy(plane_data, plane_data + plane_size, plane.begin());
+      for (uint32_t r = 0; r < kernel_h; ++r) {
+        for (uint32_t c = 0; c < kernel_w; ++c) {
+          plane_data[c * kernel_h + r] = plane.at(r * kernel_w + c);
+        }
+      }
+    }
+    conv->set_half_weights(std::move(half_weights));
+  } else {
+    const std::vector<float>& weight_values = weight->get<float>();
+    conv_layer->set_weights(weight_values);
+  }
 
   auto conv_layer_derived = std::dynamic_pointer_cast<BaseConvolutionLayer>(conv_layer);
   CHECK(conv_layer_derived != nullptr);
@@ -436,15 +476,15 @@ StatusCode BaseConvolutionLayer::Check(const std::vector<sftensor>& inputs,
   }
 
   const uint32_t kernel_count = this->weights_.size();
-  if (!kernel_count) {
+  if (!kernel_count || kernel_count != kernel_count_) {
     LOG(ERROR) << "The size of kernel matrix in the convolution layer should be greater "
                   "than zero";
     return StatusCode::kInferParamError;
   }
 
-  const uint32_t kernel_h = this->weights_.at(0)->rows();
-  const uint32_t kernel_w = this->weights_.at(0)->cols();
-  const uint32_t kernel_channel = this->weights_.at(0)->channels();
+  const uint32_t kernel_h = kernel_h_;
+  const uint32_t kernel_w = kernel_w_;
+  const uint32_t kernel_channel = kernel_channel_;
 
   if (!kernel_h || !kernel_w || !kernel_channel) {
     LOG(ERROR) << "The size of kernel matrix in the convolution layer should be greater "
@@ -454,6 +494,10 @@ StatusCode BaseConvolutionLayer::Check(const std::vector<sftensor>& inputs,
 
   for (uint32_t k = 0; k < kernel_count; ++k) {
     const std::shared_ptr<Tensor<float>>& kernel = this->weights_.at(k);
+    // 以int8或16位卷积核计算时float卷积核已经释放
+    if (kernel->empty()) {
+      continue;
+    }
     if (kernel->rows() != kernel_h) {
       return StatusCode::kInferParamError;
     }
@@ -467,4 +511,45 @@ StatusCode BaseConvolutionLayer::Check(const std::vector<sftensor>& inputs,
   return StatusCode::kSuccess;
 }
 
+uint64_t BaseConvolutionLayer::EstimateFlops(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty() || this->weights_.empty()) {
+    return 0;
+  }
+  const std::vector<int32_t>& input_shape = input_shapes.front();
+  CHECK_EQ(input_shape.size(), 4) << "The input shape of the convolution layer should be NCHW";
+  const uint64_t batch = input_shape.at(0);
+  const uint32_t input_h = input_shape.at(2);
+  const uint32_t input_w = input_shape.at(3);
+
+  const uint64_t kernel_count = kernel_count_;
+  const uint32_t kernel_h = kernel_h_;
+  const uint32_t kernel_w = kernel_w_;
+  const uint64_t kernel_channel = kernel_channel_;
+  const auto& [output_h, output_w] = ComputeOutputSize(input_h, input_w, kernel_h, kernel_w);
+
+  // 卷积的每个输出位置, 转置卷积的每个输入位置都要与整个卷积核做乘加
+  uint64_t positions = 0;
+  if (conv_type_ == ConvType::kOpConv) {
+    positions = uint64_t(output_h) * output_w;
+  } else {
+    positions = uint64_t(input_h) * input_w;
+  }
+  const uint64_t macs = batch * positions * kernel_count * kernel_channel * kernel_h * kernel_w;
+  const uint64_t bias_flops = use_bias_ ? batch * kernel_count * output_h * output_w : 0;
+  return 2 * macs + bias_flops;
+}
+
+uint64_t BaseConvolutionLayer::OutputSize(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty() || this->weights_.empty()) {
+    return Layer<float>::OutputSize(input_shapes);
+  }
+  const std::vector<int32_t>& input_shape = input_shapes.front();
+  CHECK_EQ(input_shape.size(), 4) << "The input shape of the convolution layer should be NCHW";
+  const auto& [output_h, output_w] =
+      ComputeOutputSize(input_shape.at(2), input_shape.at(3), kernel_h_, kernel_w_);
+  return uint64_t(input_shape.at(0)) * kernel_count_ * output_h * output_w;
+}
+
 }  // namespace kuiper_infer
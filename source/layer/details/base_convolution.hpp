@@ -61,12 +61,25 @@ class BaseConvolutionLayer : public ParamLayer {
  public:
   StatusCode Check(const std::vector<sftensor>& inputs, const std::vector<sftensor>& outputs);
 
+  uint64_t EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
+ protected:
+  uint64_t OutputSize(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
  private:
   virtual void InitIm2ColWeight();
 
  protected:
   void AddBias(arma::fmat& output, uint32_t bias_index) const;
 
+  /**
+   * @brief Releases the float kernels of a layer computing with other kernels
+   *
+   * The kernel tensors become empty, the kernel shape is kept in kernel_count_,
+   * kernel_channel_, kernel_h_ and kernel_w_.
+   */
+  void ReleaseFloatKernels();
+
  protected:
   uint32_t groups_ = 1;
   bool use_bias_ = false;
@@ -84,6 +97,12 @@ class BaseConvolutionLayer : public ParamLayer {
 
   ConvType conv_type_ = ConvType::kOpConvUnknown;
   std::vector<arma::fmat> kernel_matrix_arr_;
+
+  /// Shape of the kernels, valid after the float kernels are released
+  uint32_t kernel_count_ = 0;
+  uint32_t kernel_channel_ = 0;
+  uint32_t kernel_h_ = 0;
+  uint32_t kernel_w_ = 0;
 };
 }  // namespace kuiper_infer
 #endif  // KUIPER_INFER_SOURCE_LAYER_DETAILS_BASE_CONVOLUTION_H
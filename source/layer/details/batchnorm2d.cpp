@@ -191,4 +191,13 @@ BatchNorm2dLayer::BatchNorm2dLayer(uint32_t num_features, float eps,
 LayerRegistererWrapper kBatchNorm2dCreateInstance(BatchNorm2dLayer::CreateInstance,
                                                   "nn.BatchNorm2d");
 
+uint64_t BatchNorm2dLayer::EstimateFlops(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty()) {
+    return 0;
+  }
+  // 减均值、除标准差、乘仿射权重和加仿射偏置
+  return 4 * ShapeSize(input_shapes.front());
+}
+
 }  // namespace kuiper_infer
\ No newline at end of file
@@ -37,6 +37,8 @@ class BatchNorm2dLayer : public ParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  uint64_t EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
   static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                    std::shared_ptr<Layer<float>>& batch_layer);
 
@@ -55,8 +55,11 @@ StatusCode CatLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>&
           << i << " th";
 
       const uint32_t plane_size = in_rows * in_cols;
-      memcpy(output->raw_ptr(copy_channel_offset * plane_size), input->raw_ptr(),
-             sizeof(float) * plane_size * in_channels);
+      float* output_ptr = output->raw_ptr(copy_channel_offset * plane_size);
+      // 输入已经直接写在输出的对应通道中时无需拷贝
+      if (input->raw_ptr() != output_ptr) {
+        memcpy(output_ptr, input->raw_ptr(), sizeof(float) * plane_size * in_channels);
+      }
       copy_channel_offset += input->channels();
     }
   }
@@ -39,6 +39,10 @@ bool ConvolutionLayer::Is1x1KernelNoPadding(uint32_t kernel_h, uint32_t kernel_w
 }
 
 void ConvolutionLayer::InitIm2ColWeight() {
+  if (!int8_weight_.empty() || !half_weight_.empty()) {
+    // int8或16位权重推理时不再需要im2col形式的浮点卷积核
+    return;
+  }
   const uint32_t kernel_count = this->weights_.size();
   CHECK(kernel_count > 0) << "kernel count must greater than zero";
   const uint32_t kernel_h = this->weights_.at(0)->rows();
@@ -85,6 +89,16 @@ void ConvolutionLayer::ComputeOutput(sftensor input, sftensor output_tensor, uin
                                      uint32_t input_h, uint32_t input_w,
                                      uint32_t channels_per_group, uint32_t output_h,
                                      uint32_t output_w, uint32_t group) const {
+  if (!int8_weight_.empty()) {
+    ComputeOutputInt8(input, output_tensor, kernel_h, kernel_w, kernel_count_group, input_h,
+                      input_w, channels_per_group, output_h, output_w, group);
+    return;
+  }
+  if (!half_weight_.empty()) {
+    ComputeOutputHalf(input, output_tensor, kernel_h, kernel_w, kernel_count_group, input_h,
+                      input_w, channels_per_group, output_h, output_w, group);
+    return;
+  }
   bool is_1x1conv = Is1x1KernelNoPadding(kernel_h, kernel_w);
   const arma::fmat& input_matrix =
       ConvIm2Col(input, kernel_h, kernel_w, input_h, input_w, channels_per_group, output_h,
@@ -158,6 +172,144 @@ void ConvolutionLayer::ConvGEMMBias(const arma::fmat& input_matrix, sftensor out
   return AddBias(output, kernel_index);
 }
 
+bool ConvolutionLayer::QuantizeInt8(float input_scale) {
+  if (this->weights_.empty()) {
+    return false;
+  }
+  if (!int8_weight_.empty()) {
+    // float卷积核已经释放, 只更新输入的scale
+    int8_input_scale_ = input_scale;
+    return true;
+  }
+  const uint32_t kernel_count = kernel_count_;
+  const uint32_t depth = kernel_channel_ * kernel_h_ * kernel_w_;
+  if (depth < math::kInt8DepthAlign / 2) {
+    // 深度可分离卷积等规约长度过短的卷积, 补零对齐后int8并不会更快
+    return false;
+  }
+
+  std::vector<float> weight_values(size_t(kernel_count) * depth);
+  if (!half_weight_.empty()) {
+    // 16位卷积核的float卷积核已经释放, 由16位卷积核转换后量化
+    for (size_t i = 0; i < weight_values.size(); ++i) {
+      weight_values.at(i) = math::HalfToFloat(half_weight_.data.at(i), half_weight_.type);
+    }
+  } else {
+    for (uint32_t k = 0; k < kernel_count; ++k) {
+      const std::shared_ptr<Tensor<float>>& kernel = this->weights_.at(k);
+      CHECK(kernel != nullptr && kernel->size() == depth)
+          << "The kernels of the convolution layer have different sizes";
+      memcpy(weight_values.data() + size_t(k) * depth, kernel->raw_ptr(), depth * sizeof(float));
+    }
+  }
+  math::QuantizeWeightPerChannel(weight_values.data(), kernel_count, depth, int8_weight_);
+  half_weight_ = math::HalfWeight();
+  InitGemmBias();
+  int8_input_scale_ = input_scale;
+  // 只保留int8的卷积核
+  ReleaseFloatKernels();
+  return true;
+}
+
+uint64_t ConvolutionLayer::EstimateBytes(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  return BaseConvolutionLayer::EstimateBytes(input_shapes) + int8_weight_.bytes() +
+         half_weight_.bytes();
+}
+
+void ConvolutionLayer::InitGemmBias() {
+  gemm_bias_.clear();
+  if (use_bias_ && !this->bias_.empty()) {
+    CHECK_EQ(this->bias_.size(), this->weights_.size());
+    for (const auto& bias : this->bias_) {
+      CHECK(bias != nullptr && !bias->empty()) << "Bias tensor is empty or nullptr";
+      gemm_bias_.push_back(bias->index(0));
+    }
+  }
+}
+
+void ConvolutionLayer::set_half_weights(math::HalfWeight weights) {
+  CHECK(math::IsHalfType(weights.type)) << "Unsupported 16 bit weight type";
+  CHECK(weights.rows == kernel_count_ &&
+        weights.depth == kernel_channel_ * kernel_h_ * kernel_w_)
+      << "The 16 bit kernels do not match the kernels of the convolution layer";
+  CHECK_EQ(weights.data.size(), size_t(weights.rows) * weights.depth);
+  half_weight_ = std::move(weights);
+  int8_weight_ = math::Int8Weight();
+  InitGemmBias();
+  // 只保留16位的卷积核
+  ReleaseFloatKernels();
+}
+
+void ConvolutionLayer::ComputeOutputInt8(sftensor input, sftensor output_tensor,
+                                         uint32_t kernel_h, uint32_t kernel_w,
+                                         uint32_t kernel_count_group, uint32_t input_h,
+                                         uint32_t input_w, uint32_t channels_per_group,
+                                         uint32_t output_h, uint32_t output_w,
+                                         uint32_t group) const {
+  const uint32_t row_len = kernel_h * kernel_w;
+  const uint32_t col_len = output_h * output_w;
+  const uint32_t depth = channels_per_group * row_len;
+  CHECK_EQ(depth, int8_weight_.depth) << "The int8 kernel does not match the input channels";
+
+  const float* group_input = input->matrix_raw_ptr(group * channels_per_group);
+  float input_scale = int8_input_scale_;
+  if (input_scale <= 0.f) {
+    input_scale =
+        math::Int8Scale(math::AbsMax(group_input, size_t(channels_per_group) * input_h * input_w));
+  }
+
+  // 将每个输出位置的规约向量量化为连续存放的int8行
+  std::vector<int8_t> packed_input(size_t(col_len) * int8_weight_.packed_depth);
+  if (Is1x1KernelNoPadding(kernel_h, kernel_w)) {
+    // 1x1卷积的输入本身就是col_len x channels的列主序矩阵
+    math::QuantizeActivation(group_input, col_len, depth, 1, col_len, input_scale,
+                             packed_input.data());
+  } else {
+    const arma::fmat& input_matrix =
+        ConvIm2Col(input, kernel_h, kernel_w, input_h, input_w, channels_per_group, output_h,
+                   output_w, group, row_len, col_len);
+    math::QuantizeActivation(input_matrix.memptr(), col_len, depth, depth, 1, input_scale,
+                             packed_input.data());
+  }
+
+  const uint32_t kernel_begin = group * kernel_count_group;
+  math::Int8GemmDequantize(packed_input.data(), col_len, input_scale, int8_weight_, kernel_begin,
+                           kernel_begin + kernel_count_group,
+                           gemm_bias_.empty() ? nullptr : gemm_bias_.data(),
+                           output_tensor->matrix_raw_ptr(kernel_begin));
+}
+
+void ConvolutionLayer::ComputeOutputHalf(sftensor input, sftensor output_tensor,
+                                         uint32_t kernel_h, uint32_t kernel_w,
+                                         uint32_t kernel_count_group, uint32_t input_h,
+                                         uint32_t input_w, uint32_t channels_per_group,
+                                         uint32_t output_h, uint32_t output_w,
+                                         uint32_t group) const {
+  const uint32_t row_len = kernel_h * kernel_w;
+  const uint32_t col_len = output_h * output_w;
+  const uint32_t depth = channels_per_group * row_len;
+  CHECK_EQ(depth, half_weight_.depth) << "The 16 bit kernel does not match the input channels";
+
+  // im2col矩阵的每一列是一个输出位置的规约向量, 正好是半精度核需要的行
+  arma::fmat input_matrix;
+  if (Is1x1KernelNoPadding(kernel_h, kernel_w)) {
+    // 1x1卷积的输入是col_len x channels的列主序矩阵, 需要转置
+    const arma::fmat group_input(input->matrix_raw_ptr(group * channels_per_group), col_len,
+                                 depth, false, true);
+    input_matrix = group_input.t();
+  } else {
+    input_matrix = ConvIm2Col(input, kernel_h, kernel_w, input_h, input_w, channels_per_group,
+                              output_h, output_w, group, row_len, col_len);
+  }
+
+  const uint32_t kernel_begin = group * kernel_count_group;
+  math::HalfGemm(input_matrix.memptr(), col_len, half_weight_, kernel_begin,
+                 kernel_begin + kernel_count_group,
+                 gemm_bias_.empty() ? nullptr : gemm_bias_.data(),
+                 output_tensor->matrix_raw_ptr(kernel_begin));
+}
+
 std::pair<uint32_t, uint32_t> ConvolutionLayer::ComputeOutputSize(const uint32_t input_h,
                                                                   const uint32_t input_w,
                                                                   const uint32_t kernel_h,
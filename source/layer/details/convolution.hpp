@@ -25,6 +25,8 @@
 #define KUIPER_INFER_SOURCE_LAYER_CONVOLUTION_HPP_
 #include "base_convolution.hpp"
 #include "layer/abstract/param_layer.hpp"
+#include "utils/math/half_gemm.hpp"
+#include "utils/math/int8_gemm.hpp"
 
 namespace kuiper_infer {
 
@@ -40,6 +42,24 @@ class ConvolutionLayer : public BaseConvolutionLayer {
                              padding_h, padding_w, stride_h, stride_w, groups, use_bias,
                              output_padding_h, output_padding_w, dilation_h, dilation_w) {}
 
+  /**
+   * @brief Quantizes the kernels to int8 and releases the float kernels
+   */
+  bool QuantizeInt8(float input_scale) override;
+
+  uint64_t EstimateBytes(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
+  /**
+   * @brief Keeps the kernels as 16 bit floats
+   *
+   * The float kernels are released and the forward widens the kernels
+   * inside the GEMM kernel.
+   *
+   * @param weights output_channel x (in_channel / groups * kernel_h * kernel_w)
+   * float16 or bfloat16 kernels
+   */
+  void set_half_weights(math::HalfWeight weights);
+
  private:
   bool Is1x1KernelNoPadding(uint32_t kernel_h, uint32_t kernel_w) const;
 
@@ -63,6 +83,33 @@ class ConvolutionLayer : public BaseConvolutionLayer {
                                       uint32_t channels_per_group, uint32_t output_h,
                                       uint32_t output_w, uint32_t group, uint32_t row_len,
                                       uint32_t col_len) const;
+
+  void ComputeOutputInt8(sftensor input, sftensor output_tensor, uint32_t kernel_h,
+                         uint32_t kernel_w, uint32_t kernel_count_group, uint32_t input_h,
+                         uint32_t input_w, uint32_t channels_per_group, uint32_t output_h,
+                         uint32_t output_w, uint32_t group) const;
+
+  void ComputeOutputHalf(sftensor input, sftensor output_tensor, uint32_t kernel_h,
+                         uint32_t kernel_w, uint32_t kernel_count_group, uint32_t input_h,
+                         uint32_t input_w, uint32_t channels_per_group, uint32_t output_h,
+                         uint32_t output_w, uint32_t group) const;
+
+  /**
+   * @brief Gathers the bias of each output channel for the int8 and half kernels
+   */
+  void InitGemmBias();
+
+ private:
+  /// Per output channel int8 kernels, empty if the layer runs in float
+  math::Int8Weight int8_weight_;
+  /// Calibrated scale of the input, non-positive for a scale per forward
+  float int8_input_scale_ = 0.f;
+
+  /// Per output channel 16 bit float kernels, empty if the kernels are float
+  math::HalfWeight half_weight_;
+
+  /// Contiguous bias of the output channels used by the int8 and half kernels
+  std::vector<float> gemm_bias_;
 };
 
 }  // namespace kuiper_infer
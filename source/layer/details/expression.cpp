@@ -77,8 +77,6 @@ StatusCode ExpressionLayer::Forward(const std::vector<std::shared_ptr<Tensor<flo
     } else if (TokenIsOperator(current_token)) {
       // process operation
       CHECK(op_stack.size() >= 2) << "The number of operand is less than two";
-      std::shared_ptr<Tensor<float>> (*function)(const std::shared_ptr<Tensor<float>>& tensor1,
-                                                 const std::shared_ptr<Tensor<float>>& tensor2);
       std::vector<std::shared_ptr<Tensor<float>>> input_node1(std::move(op_stack.top()));
       CHECK(input_node1.size() == batch_size)
           << "The first operand doesn't have appropriate number of tensors, "
@@ -93,17 +91,29 @@ StatusCode ExpressionLayer::Forward(const std::vector<std::shared_ptr<Tensor<flo
       op_stack.pop();
 
       std::vector<std::shared_ptr<Tensor<float>>> output_token_nodes(batch_size);
+      BinaryType binary_type = BinaryType::kAdd;
       if (current_token.token_type == TokenType::TokenAdd) {
-        function = TensorElementAdd;
+        binary_type = BinaryType::kAdd;
       } else if (current_token.token_type == TokenType::TokenMul) {
-        function = TensorElementMultiply;
+        binary_type = BinaryType::kMul;
       } else {
         LOG(FATAL) << "Unsupported operator type in the expression layer: "
                    << int(current_token.token_type);
       }
+      // 最后一个运算直接写入已经分配好的输出
+      const bool is_last_operator = std::next(iter) == tokens.rend();
 #pragma omp parallel for num_threads(batch_size)
       for (uint32_t i = 0; i < batch_size; ++i) {
-        output_token_nodes.at(i) = function(input_node1.at(i), input_node2.at(i));
+        const sftensor& input1 = input_node1.at(i);
+        const sftensor& input2 = input_node2.at(i);
+        const sftensor& output = outputs.at(i);
+        if (is_last_operator && output != nullptr && !output->empty() &&
+            output->shapes() == TensorBroadcastShapes(input1->shapes(), input2->shapes())) {
+          TensorElementBinary(binary_type, input1, input2, output);
+          output_token_nodes.at(i) = output;
+        } else {
+          output_token_nodes.at(i) = TensorElementBinary(binary_type, input1, input2);
+        }
       }
       op_stack.push(output_token_nodes);
     }
@@ -152,4 +162,18 @@ StatusCode ExpressionLayer::CreateInstance(const std::shared_ptr<RuntimeOperator
 
 LayerRegistererWrapper kExpressionCreateInstance(ExpressionLayer::CreateInstance,
                                                  "pnnx.Expression");
+
+uint64_t ExpressionLayer::EstimateFlops(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  // 表达式中的每个add和mul对输出的每个元素各计算一次
+  uint64_t operator_count = 0;
+  for (const std::string& op_name : {std::string("add"), std::string("mul")}) {
+    for (size_t pos = statement_.find(op_name); pos != std::string::npos;
+         pos = statement_.find(op_name, pos + op_name.size())) {
+      operator_count += 1;
+    }
+  }
+  return operator_count * OutputSize(input_shapes);
+}
+
 }  // namespace kuiper_infer
\ No newline at end of file
@@ -34,6 +34,8 @@ class ExpressionLayer : public NonParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  uint64_t EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
   bool TokenIsOperator(Token token) const;
 
   static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
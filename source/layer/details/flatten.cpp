@@ -83,25 +83,24 @@ StatusCode FlattenLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>
     uint32_t elements_size = std::accumulate(shapes.begin() + start_dim,
                                              shapes.begin() + end_dim + 1, 1, std::multiplies());
 
-    std::shared_ptr<Tensor<float>> output = outputs.at(i);
-    output = TensorClone(input);
-    CHECK(input->size() == output->size()) << "The output and input shapes of the flatten layer do "
-                                              "not match "
-                                           << i << " th";
-    outputs.at(i) = output;
-
+    std::vector<uint32_t> output_shapes;
     if (start_dim == 1 && end_dim == 3) {
-      output->Reshape({elements_size}, true);
+      output_shapes = {elements_size};
     } else if (start_dim == 2 && end_dim == 3) {
-      uint32_t channels = input->channels();
-      output->Reshape({channels, elements_size}, true);
+      output_shapes = {input->channels(), elements_size};
     } else if (start_dim == 1 && end_dim == 2) {
-      uint32_t cols = input->cols();
-      output->Reshape({elements_size, cols}, true);
+      output_shapes = {elements_size, input->cols()};
     } else {
       LOG(FATAL) << "Wrong flatten dim: "
                  << "start dim: " << start_dim << " end dim: " << end_dim;
     }
+
+    // 内存布局不变时输出直接引用输入的数据, 不发生拷贝
+    std::shared_ptr<Tensor<float>> output = TensorReshape(input, output_shapes);
+    CHECK(input->size() == output->size()) << "The output and input shapes of the flatten layer do "
+                                              "not match "
+                                           << i << " th";
+    outputs.at(i) = output;
   }
   return StatusCode::kSuccess;
 }
@@ -0,0 +1,243 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "image_pre_process.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace kuiper_infer {
+/// Channels of an interleaved input image
+constexpr uint32_t kImageChannels = 3;
+
+namespace {
+/// Neighbours of the resized rows or columns in the source image
+struct ResizeAxis {
+  /// Byte offsets of the first and second neighbour
+  std::vector<int32_t> offset0;
+  std::vector<int32_t> offset1;
+  /// Weight of the second neighbour
+  std::vector<float> weight;
+};
+}  // namespace
+
+// 与cv::resize的INTER_LINEAR相同, 像素中心对齐
+static void ComputeResizeAxis(uint32_t src_size, uint32_t dst_size, int32_t stride,
+                              ResizeAxis& axis) {
+  const float ratio = float(src_size) / float(dst_size);
+  const int32_t last = int32_t(src_size) - 1;
+  axis.offset0.resize(dst_size);
+  axis.offset1.resize(dst_size);
+  axis.weight.resize(dst_size);
+  for (uint32_t d = 0; d < dst_size; ++d) {
+    const float position = (float(d) + 0.5f) * ratio - 0.5f;
+    int32_t i0 = int32_t(std::floor(position));
+    float weight = position - float(i0);
+    if (i0 < 0) {
+      i0 = 0;
+      weight = 0.f;
+    }
+    if (i0 >= last) {
+      i0 = last;
+      weight = 0.f;
+    }
+    axis.offset0.at(d) = i0 * stride;
+    axis.offset1.at(d) = std::min(i0 + 1, last) * stride;
+    axis.weight.at(d) = weight;
+  }
+}
+
+// 计算输出的一列, 每个通道在列上是连续的
+static void ResizeColumn(const uint8_t* data, int32_t x0, int32_t x1, float wx,
+                         const ResizeAxis& y_axis, bool vectorize, const uint32_t* src_channels,
+                         const float* alpha, const float* beta, float* const* dst) {
+  const uint32_t rows = y_axis.weight.size();
+  uint32_t y = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+  if (vectorize) {
+    // 一次gather读入像素所在的4个字节, 非首个像素从前一个字节开始读, 不越过图像末尾
+    const int32_t shift0 = x0 > 0 ? 1 : 0;
+    const int32_t shift1 = x1 > 0 ? 1 : 0;
+    const int* base0 = reinterpret_cast<const int*>(data + x0 - shift0);
+    const int* base1 = reinterpret_cast<const int*>(data + x1 - shift1);
+    const __m256i byte_mask = _mm256_set1_epi32(0xff);
+    const __m256 wx256 = _mm256_set1_ps(wx);
+    for (; y + 8 <= rows; y += 8) {
+      const __m256i row0 =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y_axis.offset0.data() + y));
+      const __m256i row1 =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y_axis.offset1.data() + y));
+      const __m256i p00 = _mm256_i32gather_epi32(base0, row0, 1);
+      const __m256i p01 = _mm256_i32gather_epi32(base1, row0, 1);
+      const __m256i p10 = _mm256_i32gather_epi32(base0, row1, 1);
+      const __m256i p11 = _mm256_i32gather_epi32(base1, row1, 1);
+      const __m256 wy = _mm256_loadu_ps(y_axis.weight.data() + y);
+      for (uint32_t c = 0; c < kImageChannels; ++c) {
+        const __m128i bits0 = _mm_cvtsi32_si128(int32_t(8 * (src_channels[c] + shift0)));
+        const __m128i bits1 = _mm_cvtsi32_si128(int32_t(8 * (src_channels[c] + shift1)));
+        const __m256 v00 =
+            _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(p00, bits0), byte_mask));
+        const __m256 v01 =
+            _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(p01, bits1), byte_mask));
+        const __m256 v10 =
+            _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(p10, bits0), byte_mask));
+        const __m256 v11 =
+            _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(p11, bits1), byte_mask));
+        const __m256 top = _mm256_fmadd_ps(_mm256_sub_ps(v01, v00), wx256, v00);
+        const __m256 bottom = _mm256_fmadd_ps(_mm256_sub_ps(v11, v10), wx256, v10);
+        const __m256 value = _mm256_fmadd_ps(_mm256_sub_ps(bottom, top), wy, top);
+        _mm256_storeu_ps(dst[c] + y, _mm256_fmadd_ps(value, _mm256_set1_ps(alpha[c]),
+                                                     _mm256_set1_ps(beta[c])));
+      }
+    }
+  }
+#endif
+  for (; y < rows; ++y) {
+    const uint8_t* row0 = data + y_axis.offset0.at(y);
+    const uint8_t* row1 = data + y_axis.offset1.at(y);
+    const float wy = y_axis.weight.at(y);
+    for (uint32_t c = 0; c < kImageChannels; ++c) {
+      const uint32_t k = src_channels[c];
+      const float v00 = row0[x0 + k];
+      const float v01 = row0[x1 + k];
+      const float v10 = row1[x0 + k];
+      const float v11 = row1[x1 + k];
+      const float top = (v01 - v00) * wx + v00;
+      const float bottom = (v11 - v10) * wx + v10;
+      dst[c][y] = ((bottom - top) * wy + top) * alpha[c] + beta[c];
+    }
+  }
+}
+
+ImagePreProcess::ImagePreProcess(uint32_t output_rows, uint32_t output_cols, bool swap_rb,
+                                 float scale, std::vector<float> mean, std::vector<float> std,
+                                 uint8_t pad_value, bool scale_up)
+    : output_rows_(output_rows),
+      output_cols_(output_cols),
+      swap_rb_(swap_rb),
+      scale_up_(scale_up),
+      pad_value_(pad_value) {
+  CHECK(output_rows > 0 && output_cols > 0) << "The output of the image pre process is empty";
+  CHECK(mean.size() == kImageChannels && std.size() == kImageChannels)
+      << "The image pre process needs a mean and std for each of the three channels";
+  for (uint32_t c = 0; c < kImageChannels; ++c) {
+    CHECK_NE(std.at(c), 0.f) << "The std of channel " << c << " is zero";
+    alpha_.push_back(scale / std.at(c));
+    beta_.push_back(-mean.at(c) / std.at(c));
+  }
+}
+
+void ImagePreProcess::Forward(const ImageBuffer& image, Tensor<float>& output) const {
+  CHECK(image.data != nullptr && image.rows > 0 && image.cols > 0)
+      << "The input image of the image pre process is empty";
+  CHECK_GE(image.step, size_t(image.cols) * kImageChannels);
+  CHECK_LE(image.step * image.rows, size_t(std::numeric_limits<int32_t>::max()));
+  CHECK(output.channels() == kImageChannels && output.rows() == output_rows_ &&
+        output.cols() == output_cols_)
+      << "The output of the image pre process should be 3 x " << output_rows_ << " x "
+      << output_cols_;
+
+  // 与Letterbox相同, 保持宽高比缩放, 填充平均分布在两侧
+  float ratio = std::min(float(output_rows_) / float(image.rows),
+                         float(output_cols_) / float(image.cols));
+  if (!scale_up_) {
+    ratio = std::min(ratio, 1.f);
+  }
+  const uint32_t resized_rows =
+      std::clamp(uint32_t(std::round(float(image.rows) * ratio)), 1u, output_rows_);
+  const uint32_t resized_cols =
+      std::clamp(uint32_t(std::round(float(image.cols) * ratio)), 1u, output_cols_);
+  const uint32_t top = uint32_t(std::round(float(output_rows_ - resized_rows) / 2.f - 0.1f));
+  const uint32_t left = uint32_t(std::round(float(output_cols_ - resized_cols) / 2.f - 0.1f));
+
+  ResizeAxis x_axis;
+  ResizeAxis y_axis;
+  ComputeResizeAxis(image.cols, resized_cols, kImageChannels, x_axis);
+  ComputeResizeAxis(image.rows, resized_rows, int32_t(image.step), y_axis);
+
+  uint32_t src_channels[kImageChannels];
+  float pad[kImageChannels];
+  float* channels[kImageChannels];
+  for (uint32_t c = 0; c < kImageChannels; ++c) {
+    src_channels[c] = swap_rb_ ? kImageChannels - 1 - c : c;
+    pad[c] = float(pad_value_) * alpha_.at(c) + beta_.at(c);
+    channels[c] = output.matrix_raw_ptr(c);
+  }
+  // 只有一列的图像读4个字节会越过图像末尾
+  const bool vectorize = image.cols >= 2;
+
+#pragma omp parallel for
+  for (uint32_t x = 0; x < output_cols_; ++x) {
+    float* dst[kImageChannels];
+    for (uint32_t c = 0; c < kImageChannels; ++c) {
+      dst[c] = channels[c] + size_t(x) * output_rows_;
+    }
+    if (x < left || x >= left + resized_cols) {
+      for (uint32_t c = 0; c < kImageChannels; ++c) {
+        std::fill(dst[c], dst[c] + output_rows_, pad[c]);
+      }
+      continue;
+    }
+    for (uint32_t c = 0; c < kImageChannels; ++c) {
+      std::fill(dst[c], dst[c] + top, pad[c]);
+      std::fill(dst[c] + top + resized_rows, dst[c] + output_rows_, pad[c]);
+      dst[c] += top;
+    }
+    const uint32_t rx = x - left;
+    ResizeColumn(image.data, x_axis.offset0.at(rx), x_axis.offset1.at(rx), x_axis.weight.at(rx),
+                 y_axis, vectorize, src_channels, alpha_.data(), beta_.data(), dst);
+  }
+}
+
+StatusCode ImagePreProcess::Forward(const std::vector<ImageBuffer>& images,
+                                    std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
+  if (images.empty()) {
+    LOG(ERROR) << "The input image array in the image pre process is empty";
+    return StatusCode::kInferInputsEmpty;
+  }
+
+  if (images.size() != outputs.size()) {
+    LOG(ERROR) << "The input image and output tensor array size of the image pre process "
+                  "do not match";
+    return StatusCode::kInferDimMismatch;
+  }
+
+  for (uint32_t i = 0; i < images.size(); ++i) {
+    std::shared_ptr<Tensor<float>>& output = outputs.at(i);
+    if (output == nullptr || output->empty()) {
+      output = std::make_shared<Tensor<float>>(kImageChannels, output_rows_, output_cols_);
+    }
+    if (output->channels() != kImageChannels || output->rows() != output_rows_ ||
+        output->cols() != output_cols_) {
+      LOG(ERROR) << "The output tensor array in the image pre process has an incorrectly sized "
+                    "tensor "
+                 << i << "th";
+      return StatusCode::kInferDimMismatch;
+    }
+    this->Forward(images.at(i), *output);
+  }
+  return StatusCode::kSuccess;
+}
+}  // namespace kuiper_infer
@@ -0,0 +1,101 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_SOURCE_LAYER_DETAILS_IMAGE_PRE_PROCESS_HPP_
+#define KUIPER_INFER_SOURCE_LAYER_DETAILS_IMAGE_PRE_PROCESS_HPP_
+#include <memory>
+#include <vector>
+#include "data/tensor.hpp"
+#include "status_code.hpp"
+
+namespace kuiper_infer {
+/**
+ * @brief An interleaved 8-bit image with three channels
+ *
+ * Such as the data of a CV_8UC3 cv::Mat, the memory is not owned.
+ */
+struct ImageBuffer {
+  const uint8_t* data = nullptr;
+  uint32_t rows = 0;
+  uint32_t cols = 0;
+  /// Bytes between the starts of two rows, at least cols * 3
+  size_t step = 0;
+};
+
+/**
+ * @brief Letterbox resize and normalization of 8-bit images
+ *
+ * Turns interleaved 8-bit images into the 3 x rows x cols float input of a
+ * network in one pass: bilinear resize keeping the aspect ratio, constant
+ * padding around the resized image, channel swap, and
+ * (value * scale - mean) / std per channel.
+ *
+ * Each output column is contiguous in a Tensor, so the columns are split
+ * over the threads and the rows of a column are computed eight at a time.
+ */
+class ImagePreProcess {
+ public:
+  /**
+   * @param output_rows Rows of the network input
+   * @param output_cols Columns of the network input
+   * @param swap_rb Swap the first and third channel, BGR to RGB
+   * @param scale Factor applied to the 8-bit values
+   * @param mean Per channel mean subtracted after scaling, in output order
+   * @param std Per channel deviation dividing the result, in output order
+   * @param pad_value 8-bit value of the padding
+   * @param scale_up Enlarge images smaller than the output
+   */
+  explicit ImagePreProcess(uint32_t output_rows, uint32_t output_cols, bool swap_rb = true,
+                           float scale = 1.f / 255.f, std::vector<float> mean = {0.f, 0.f, 0.f},
+                           std::vector<float> std = {1.f, 1.f, 1.f}, uint8_t pad_value = 114,
+                           bool scale_up = false);
+
+  /**
+   * @brief Preprocesses a batch of images
+   *
+   * @param images Interleaved 8-bit images
+   * @param outputs Tensors of 3 x output_rows x output_cols, created when
+   * empty, otherwise written in place such as tensors bound to the graph
+   * @return Status code
+   */
+  StatusCode Forward(const std::vector<ImageBuffer>& images,
+                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) const;
+
+  /**
+   * @brief Preprocesses one image
+   *
+   * @param image Interleaved 8-bit image
+   * @param output Output of 3 x output_rows x output_cols
+   */
+  void Forward(const ImageBuffer& image, Tensor<float>& output) const;
+
+ private:
+  uint32_t output_rows_ = 0;
+  uint32_t output_cols_ = 0;
+  bool swap_rb_ = true;
+  bool scale_up_ = false;
+  uint8_t pad_value_ = 114;
+  /// (value * scale - mean) / std as value * alpha + beta, per output channel
+  std::vector<float> alpha_;
+  std::vector<float> beta_;
+};
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_SOURCE_LAYER_DETAILS_IMAGE_PRE_PROCESS_HPP_
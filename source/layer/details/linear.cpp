@@ -24,6 +24,7 @@
 #include "linear.hpp"
 #include <glog/logging.h>
 #include "layer/abstract/layer_factory.hpp"
+#include "utils/math/gemv.hpp"
 
 namespace kuiper_infer {
 
@@ -69,9 +70,13 @@ StatusCode LinearLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>
 
   uint32_t batch = inputs.size();
   const std::shared_ptr<Tensor<float>>& weight = weights_.front();
-  arma::fmat weight_data_t(weight->raw_ptr(), in_features_, out_features_, false, true);
+  arma::fmat weight_data_t;
+  const bool float_weight = half_weight_.empty() && int8_weight_.empty();
+  if (float_weight) {
+    weight_data_t = arma::fmat(weight->raw_ptr(), in_features_, out_features_, false, true);
+  }
 
-#pragma omp parallel for num_threads(batch)
+#pragma omp parallel for if (batch > 1) num_threads(batch)
   for (uint32_t i = 0; i < batch; ++i) {
     const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
     CHECK(input != nullptr && !input->empty())
@@ -80,10 +85,14 @@ StatusCode LinearLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>
 
     const uint32_t feature_dims = input_shapes.at(1);
     const uint32_t in_features = input_shapes.at(2);
-    CHECK(weight_data_t.n_cols == out_features_)
-        << "The row of weight tensor should be same to output features.";
-    CHECK(weight_data_t.n_rows == in_features && in_features == in_features_)
-        << "The col of weight tensor should be same to input features.";
+    if (float_weight) {
+      CHECK(weight_data_t.n_cols == out_features_)
+          << "The row of weight tensor should be same to output features.";
+      CHECK(weight_data_t.n_rows == in_features)
+          << "The col of weight tensor should be same to input features.";
+    }
+    CHECK(in_features == in_features_)
+        << "The col of input tensor should be same to input features.";
 
     arma::fmat input_vec(input->raw_ptr(), feature_dims, in_features_, false, true);
     std::shared_ptr<Tensor<float>> output = outputs.at(i);
@@ -105,6 +114,64 @@ StatusCode LinearLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>
     }
 
     arma::fmat& result = output->slice(0);
+    if (!int8_weight_.empty()) {
+      CHECK(result.n_rows == feature_dims && result.n_cols == out_features_)
+          << "The output tensor of the int8 linear layer has a wrong size";
+      float input_scale = int8_input_scale_;
+      if (input_scale <= 0.f) {
+        input_scale = math::Int8Scale(math::AbsMax(input->raw_ptr(), input->size()));
+      }
+      // 输入为feature_dims x in_features的列主序矩阵, 量化时转为按行连续存放
+      std::vector<int8_t> packed_input(size_t(feature_dims) * int8_weight_.packed_depth);
+      math::QuantizeActivation(input->raw_ptr(), feature_dims, in_features_, 1, feature_dims,
+                               input_scale, packed_input.data());
+      const float* bias_ptr = nullptr;
+      if (use_bias_) {
+        CHECK(!this->bias_.empty() && this->bias_.front()->size() == out_features_)
+            << "The col of bias tensor is not same to output features";
+        bias_ptr = this->bias_.front()->raw_ptr();
+      }
+      math::Int8GemmDequantize(packed_input.data(), feature_dims, input_scale, int8_weight_, 0,
+                               out_features_, bias_ptr, result.memptr());
+      continue;
+    }
+
+    if (!half_weight_.empty()) {
+      CHECK(result.n_rows == feature_dims && result.n_cols == out_features_)
+          << "The output tensor of the linear layer has a wrong size";
+      // 半精度核要求每个输入行连续存放, 只有一行时无需转置
+      arma::fmat input_rows;
+      const float* input_ptr = input->raw_ptr();
+      if (feature_dims > 1) {
+        input_rows = input_vec.t();
+        input_ptr = input_rows.memptr();
+      }
+      const float* bias_ptr = nullptr;
+      if (use_bias_) {
+        CHECK(!this->bias_.empty() && this->bias_.front()->size() == out_features_)
+            << "The col of bias tensor is not same to output features";
+        bias_ptr = this->bias_.front()->raw_ptr();
+      }
+      math::HalfGemm(input_ptr, feature_dims, half_weight_, 0, out_features_, bias_ptr,
+                     result.memptr());
+      continue;
+    }
+
+    if (feature_dims == 1) {
+      // 只有一行输入时使用多线程的矩阵向量乘, 权重的每个输出特征连续存放
+      CHECK(result.n_elem == out_features_)
+          << "The output tensor of the linear layer has a wrong size";
+      const float* bias_ptr = nullptr;
+      if (use_bias_) {
+        CHECK(!this->bias_.empty() && this->bias_.front()->size() == out_features_)
+            << "The col of bias tensor is not same to output features";
+        bias_ptr = this->bias_.front()->raw_ptr();
+      }
+      math::Gemv(weight->raw_ptr(), out_features_, in_features_, input->raw_ptr(), bias_ptr,
+                 result.memptr());
+      continue;
+    }
+
     result = input_vec * weight_data_t;
     if (use_bias_) {
       CHECK(!this->bias_.empty() && this->bias_.size() == 1)
@@ -119,6 +186,41 @@ StatusCode LinearLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>
   return StatusCode::kSuccess;
 }
 
+bool LinearLayer::QuantizeInt8(float input_scale) {
+  if (this->weights_.empty() || !half_weight_.empty()) {
+    return false;
+  }
+  if (!int8_weight_.empty()) {
+    // float权重已经释放, 只更新输入的scale
+    int8_input_scale_ = input_scale;
+    return true;
+  }
+  // 权重为in_features x out_features的列主序矩阵, 每个输出特征的权重连续存放
+  const std::shared_ptr<Tensor<float>>& weight = this->weights_.front();
+  CHECK(weight != nullptr && weight->size() == size_t(in_features_) * out_features_);
+  math::QuantizeWeightPerChannel(weight->raw_ptr(), out_features_, in_features_, int8_weight_);
+  int8_input_scale_ = input_scale;
+  // 释放float权重, 只保留int8的权重
+  this->weights_.front() = std::make_shared<Tensor<float>>();
+  return true;
+}
+
+void LinearLayer::set_half_weights(math::HalfWeight weights) {
+  CHECK(math::IsHalfType(weights.type)) << "Unsupported 16 bit weight type";
+  CHECK(weights.rows == out_features_ && weights.depth == in_features_)
+      << "The 16 bit weights do not match the features of the linear layer";
+  CHECK_EQ(weights.data.size(), size_t(out_features_) * in_features_);
+  half_weight_ = std::move(weights);
+  // 释放float权重, 只保留16位的权重
+  CHECK(!this->weights_.empty());
+  this->weights_.front() = std::make_shared<Tensor<float>>();
+  int8_weight_ = math::Int8Weight();
+}
+
+uint64_t LinearLayer::EstimateBytes(const std::vector<std::vector<int32_t>>& input_shapes) const {
+  return ParamLayer::EstimateBytes(input_shapes) + half_weight_.bytes() + int8_weight_.bytes();
+}
+
 StatusCode LinearLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                        std::shared_ptr<Layer<float>>& linear_layer) {
   if (!op) {
@@ -172,13 +274,24 @@ StatusCode LinearLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& o
   int32_t in_features = shapes.at(1);
   const bool use_bias = use_bias_param->value;
 
-  linear_layer = std::make_shared<LinearLayer>(in_features, out_features, use_bias);
+  auto layer = std::make_shared<LinearLayer>(in_features, out_features, use_bias);
   if (use_bias) {
-    linear_layer->set_bias(bias->get<float>());
+    layer->set_bias(bias->get<float>());
   }
 
   // load weights
-  linear_layer->set_weights(weight->get<float>());
+  if (math::IsHalfType(weight->type)) {
+    // float16和bfloat16的权重直接以16位存放
+    math::HalfWeight half_weight;
+    half_weight.type = weight->type;
+    half_weight.rows = out_features;
+    half_weight.depth = in_features;
+    half_weight.data = weight->get<uint16_t>();
+    layer->set_half_weights(std::move(half_weight));
+  } else {
+    layer->set_weights(weight->get<float>());
+  }
+  linear_layer = layer;
   return StatusCode::kSuccess;
 }
 
@@ -224,4 +337,20 @@ StatusCode LinearLayer::Check(const std::vector<sftensor>& inputs,
 
 LayerRegistererWrapper kLinearCreateInstance(LinearLayer::CreateInstance, "nn.Linear");
 
+uint64_t LinearLayer::EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty()) {
+    return 0;
+  }
+  const uint64_t rows = ShapeSize(input_shapes.front()) / in_features_;
+  const uint64_t bias_flops = use_bias_ ? rows * out_features_ : 0;
+  return 2 * rows * in_features_ * out_features_ + bias_flops;
+}
+
+uint64_t LinearLayer::OutputSize(const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty()) {
+    return 0;
+  }
+  return ShapeSize(input_shapes.front()) / in_features_ * out_features_;
+}
+
 }  // namespace kuiper_infer
\ No newline at end of file
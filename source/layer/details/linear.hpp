@@ -25,6 +25,8 @@
 #define KUIPER_INFER_SOURCE_LAYER_LINEAR_HPP_
 #include "layer/abstract/layer.hpp"
 #include "layer/abstract/param_layer.hpp"
+#include "utils/math/half_gemm.hpp"
+#include "utils/math/int8_gemm.hpp"
 
 namespace kuiper_infer {
 class LinearLayer : public ParamLayer {
@@ -39,6 +41,8 @@ class LinearLayer : public ParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  uint64_t EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
   static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                    std::shared_ptr<Layer<float>>& linear_layer);
 
@@ -46,10 +50,35 @@ class LinearLayer : public ParamLayer {
 
   void set_weights(const std::vector<std::shared_ptr<Tensor<float>>>& weights) override;
 
+  bool QuantizeInt8(float input_scale) override;
+
+  /**
+   * @brief Keeps the weights as 16 bit floats
+   *
+   * The float weight tensor is released and the forward widens the weights
+   * inside the GEMM kernel.
+   *
+   * @param weights out_features x in_features float16 or bfloat16 weights
+   */
+  void set_half_weights(math::HalfWeight weights);
+
+  uint64_t EstimateBytes(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
+ protected:
+  uint64_t OutputSize(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
  private:
   int32_t in_features_ = 0;
   int32_t out_features_ = 0;
   bool use_bias_ = false;
+
+  /// Per output feature int8 weights, empty if the layer runs in float
+  math::Int8Weight int8_weight_;
+  /// Calibrated scale of the input, non-positive for a scale per forward
+  float int8_input_scale_ = 0.f;
+
+  /// Per output feature 16 bit float weights, empty if the weights are float
+  math::HalfWeight half_weight_;
 };
 }  // namespace kuiper_infer
 
@@ -23,6 +23,7 @@
 // Created by fss on 24-2-9.
 //
 #include "matmul.hpp"
+#include "utils/math/gemv.hpp"
 namespace kuiper_infer {
 LLamaMatmulLayer::LLamaMatmulLayer(int32_t weight_dim0, int32_t weight_dim1)
     : ParamLayer("matmul"), weight_dim0_(weight_dim0), weight_dim1_(weight_dim1) {
@@ -36,6 +37,86 @@ void LLamaMatmulLayer::set_weights(const std::vector<float>& weights) {
 void LLamaMatmulLayer::set_weights(const std::vector<std::shared_ptr<Tensor<float>>>& weights) {
   CHECK(weights.size() == weights_.size());
   this->weights_ = weights;
+  half_weight_ = math::HalfWeight();
+  quant_weight_ = math::GroupQuantWeight();
+  weight_format_ = math::WeightFormat::kFloat32;
+}
+
+void LLamaMatmulLayer::set_half_weights(math::HalfWeight weights) {
+  CHECK(math::IsHalfType(weights.type)) << "Unsupported 16 bit weight type";
+  CHECK(weights.rows == weight_dim0_ && weights.depth == weight_dim1_)
+      << "The 16 bit weights do not match the shape of the matmul layer";
+  CHECK_EQ(weights.data.size(), size_t(weight_dim0_) * weight_dim1_);
+  weight_format_ = weights.type == RuntimeDataType::kTypeBFloat16 ? math::WeightFormat::kBFloat16
+                                                                  : math::WeightFormat::kFloat16;
+  half_weight_ = std::move(weights);
+  quant_weight_ = math::GroupQuantWeight();
+  this->weights_.front() = nullptr;
+}
+
+void LLamaMatmulLayer::set_quant_weights(math::GroupQuantWeight weights) {
+  CHECK(weights.format == math::WeightFormat::kInt8Grouped ||
+        weights.format == math::WeightFormat::kInt4Grouped)
+      << "Unsupported quantized weight format";
+  CHECK(weights.rows == weight_dim0_ && weights.depth == weight_dim1_)
+      << "The quantized weights do not match the shape of the matmul layer";
+  CHECK(weights.group_size > 0 && weight_dim1_ % weights.group_size == 0 &&
+        weights.data.size() == weights.rows * weights.row_bytes() &&
+        weights.scales.size() == size_t(weights.rows) * weights.groups() &&
+        weights.zeros.size() == weights.scales.size())
+      << "The quantized weights of the matmul layer are incomplete";
+  weight_format_ = weights.format;
+  quant_weight_ = std::move(weights);
+  half_weight_ = math::HalfWeight();
+  this->weights_.front() = nullptr;
+}
+
+bool LLamaMatmulLayer::ConvertWeights(math::WeightFormat format, uint32_t group_size) {
+  const std::shared_ptr<Tensor<float>>& weight = this->weights_.front();
+  if (weight_format_ != math::WeightFormat::kFloat32 || weight == nullptr) {
+    LOG(ERROR) << "Only the float weights of the matmul layer can be converted";
+    return false;
+  }
+  CHECK_EQ(weight->size(), size_t(weight_dim0_) * weight_dim1_);
+  switch (format) {
+    case math::WeightFormat::kFloat32: {
+      return true;
+    }
+    case math::WeightFormat::kFloat16:
+    case math::WeightFormat::kBFloat16: {
+      math::HalfWeight half_weight;
+      math::ConvertWeightToHalf(weight->raw_ptr(), weight_dim0_, weight_dim1_,
+                                format == math::WeightFormat::kFloat16
+                                    ? RuntimeDataType::kTypeFloat16
+                                    : RuntimeDataType::kTypeBFloat16,
+                                half_weight);
+      set_half_weights(std::move(half_weight));
+      return true;
+    }
+    case math::WeightFormat::kInt8Grouped:
+    case math::WeightFormat::kInt4Grouped: {
+      if (group_size == 0 || group_size % math::kQuantGroupBlock != 0 ||
+          weight_dim1_ % group_size != 0) {
+        LOG(ERROR) << "The group size " << group_size << " does not divide the weight dim "
+                   << weight_dim1_;
+        return false;
+      }
+      math::GroupQuantWeight quant_weight;
+      math::QuantizeWeightGrouped(weight->raw_ptr(), weight_dim0_, weight_dim1_, group_size, format,
+                                  quant_weight);
+      set_quant_weights(std::move(quant_weight));
+      return true;
+    }
+    default: {
+      LOG(ERROR) << "Unknown weight format: " << int32_t(format);
+      return false;
+    }
+  }
+}
+
+uint64_t LLamaMatmulLayer::EstimateBytes(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  return ParamLayer::EstimateBytes(input_shapes) + half_weight_.bytes() + quant_weight_.bytes();
 }
 
 StatusCode LLamaMatmulLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
@@ -66,6 +147,11 @@ StatusCode LLamaMatmulLayer::Forward(const std::vector<std::shared_ptr<Tensor<fl
     return StatusCode::kInferParamError;
   }
 
+  if (weight_format_ == math::WeightFormat::kFloat32 && weights_.front() == nullptr) {
+    LOG(ERROR) << "The weight tensor in the matmul layer is not set";
+    return StatusCode::kInferParamError;
+  }
+
   // w @ x
   uint32_t batch = inputs.size();
 #pragma omp parallel for if (batch > 1) num_threads(batch)
@@ -103,14 +189,34 @@ StatusCode LLamaMatmulLayer::Forward(const std::vector<std::shared_ptr<Tensor<fl
     } else {
       LOG(FATAL) << "The shape of output tensor need be equal to one or two";
     }
-    if (input_dim1 == 1) {
+    if (weight_format_ != math::WeightFormat::kFloat32) {
+      // 16位和量化权重的核要求输入按行连续存放, 输出的每个通道连续存放, 与该层的布局互为转置
+      arma::fmat input_rows;
+      arma::fmat output_t;
+      const float* input_ptr = input->raw_ptr();
       float* output_ptr = output->raw_ptr();
-      float* weight_ptr = weight->raw_ptr();
-#pragma omp parallel for
-      for (int32_t j = 0; j < weight_dim0_; ++j) {
-        arma::fmat sub_weight(weight_ptr + j * weight_dim1_, weight_dim1_, 1, false, true);
-        *(output_ptr + j) = arma::as_scalar(input_vec * sub_weight);
+      if (input_dim1 > 1) {
+        input_rows = input_vec.t();
+        input_ptr = input_rows.memptr();
+        output_t.set_size(input_dim1, weight_dim0_);
+        output_ptr = output_t.memptr();
+      }
+      if (weight_format_ == math::WeightFormat::kInt8Grouped ||
+          weight_format_ == math::WeightFormat::kInt4Grouped) {
+        math::GroupQuantGemm(input_ptr, input_dim1, quant_weight_, 0, weight_dim0_, output_ptr);
+      } else {
+        math::HalfGemm(input_ptr, input_dim1, half_weight_, 0, weight_dim0_, nullptr, output_ptr);
+      }
+      if (input_dim1 > 1) {
+        arma::fmat output_mat(output->raw_ptr(), weight_dim0_, input_dim1, false, true);
+        output_mat = output_t.t();
       }
+      continue;
+    }
+    if (input_dim1 == 1) {
+      // 单个token时为矩阵向量乘, 按输出行拆分到多个线程
+      math::Gemv(weight->raw_ptr(), weight_dim0_, weight_dim1_, input->raw_ptr(), nullptr,
+                 output->raw_ptr());
     } else {
       arma::fmat weight_data(weight->raw_ptr(), weight_dim1_, weight_dim0_, false, true);  // wt
       if (weight_dim0_ == 1) {
@@ -124,4 +230,22 @@ StatusCode LLamaMatmulLayer::Forward(const std::vector<std::shared_ptr<Tensor<fl
   }
   return StatusCode::kSuccess;
 }
+
+uint64_t LLamaMatmulLayer::EstimateFlops(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty()) {
+    return 0;
+  }
+  // 输入的每一列都与weight_dim0_行权重做点积
+  const uint64_t input_cols = ShapeSize(input_shapes.front()) / weight_dim1_;
+  return 2 * input_cols * weight_dim0_ * weight_dim1_;
+}
+
+uint64_t LLamaMatmulLayer::OutputSize(const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty()) {
+    return 0;
+  }
+  return ShapeSize(input_shapes.front()) / weight_dim1_ * weight_dim0_;
+}
+
 }  // namespace kuiper_infer
\ No newline at end of file
@@ -26,6 +26,8 @@
 #ifndef KUIPER_INFER_SOURCE_LAYER_DETAILS_MATMUL_HPP
 #define KUIPER_INFER_SOURCE_LAYER_DETAILS_MATMUL_HPP
 #include "layer/abstract/param_layer.hpp"
+#include "utils/math/half_gemm.hpp"
+#include "utils/math/weight_quant_gemm.hpp"
 namespace kuiper_infer {
 class LLamaMatmulLayer : public ParamLayer {
  public:
@@ -34,13 +36,60 @@ class LLamaMatmulLayer : public ParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  uint64_t EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
   void set_weights(const std::vector<std::shared_ptr<Tensor<float>>>& weights) override;
 
   void set_weights(const std::vector<float>& weights) override;
 
+  /**
+   * @brief Keeps the weights as 16 bit floats
+   *
+   * The forward widens the weights inside the GEMM kernel, the float weight
+   * tensor is released.
+   *
+   * @param weights weight_dim0 x weight_dim1 float16 or bfloat16 weights
+   */
+  void set_half_weights(math::HalfWeight weights);
+
+  /**
+   * @brief Keeps the weights as weight only quantized codes
+   *
+   * @param weights weight_dim0 x weight_dim1 grouped int8 or int4 weights
+   */
+  void set_quant_weights(math::GroupQuantWeight weights);
+
+  /**
+   * @brief Converts the float weights to another storage format
+   *
+   * The float weight tensor is released afterwards, the forward picks the
+   * GEMM kernel by the weight format.
+   *
+   * @param format Target weight format
+   * @param group_size Weights per group of the grouped formats, 32, 64 or 128
+   * @return True if the weights were converted
+   */
+  bool ConvertWeights(math::WeightFormat format, uint32_t group_size = 64);
+
+  math::WeightFormat weight_format() const { return weight_format_; }
+
+  uint64_t EstimateBytes(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
+ protected:
+  uint64_t OutputSize(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
  private:
   int32_t weight_dim0_ = 0;
   int32_t weight_dim1_ = 0;
+
+  /// Storage format of the weights, selects the GEMM kernel of the forward
+  math::WeightFormat weight_format_ = math::WeightFormat::kFloat32;
+
+  /// 16 bit float weights of the kFloat16 and kBFloat16 formats
+  math::HalfWeight half_weight_;
+
+  /// Quantized weights of the kInt8Grouped and kInt4Grouped formats
+  math::GroupQuantWeight quant_weight_;
 };
 }  // namespace kuiper_infer
 #endif  // KUIPER_INFER_SOURCE_LAYER_DETAILS_MATMUL_HPP
@@ -223,4 +223,24 @@ StatusCode MaxPoolingLayer::Check(const std::vector<sftensor>& inputs,
 
 LayerRegistererWrapper kMaxPoolingCreateInstance(MaxPoolingLayer::CreateInstance, "nn.MaxPool2d");
 
+uint64_t MaxPoolingLayer::EstimateFlops(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  // 每个输出元素需要在池化窗口内做比较
+  const uint64_t window_size = uint64_t(pooling_size_h_) * pooling_size_w_;
+  return OutputSize(input_shapes) * window_size;
+}
+
+uint64_t MaxPoolingLayer::OutputSize(const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty()) {
+    return 0;
+  }
+  const std::vector<int32_t>& input_shape = input_shapes.front();
+  CHECK_EQ(input_shape.size(), 4) << "The input shape of the max pooling layer should be NCHW";
+  const int32_t input_padded_h = input_shape.at(2) + 2 * int32_t(padding_h_);
+  const int32_t input_padded_w = input_shape.at(3) + 2 * int32_t(padding_w_);
+  const uint64_t output_h = (input_padded_h - int32_t(pooling_size_h_)) / stride_h_ + 1;
+  const uint64_t output_w = (input_padded_w - int32_t(pooling_size_w_)) / stride_w_ + 1;
+  return uint64_t(input_shape.at(0)) * input_shape.at(1) * output_h * output_w;
+}
+
 }  // namespace kuiper_infer
\ No newline at end of file
@@ -33,12 +33,17 @@ class MaxPoolingLayer : public NonParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  uint64_t EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
   StatusCode Check(const std::vector<sftensor>& inputs,
                    const std::vector<sftensor>& outputs) override;
 
   static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                    std::shared_ptr<Layer<float>>& max_layer);
 
+ protected:
+  uint64_t OutputSize(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
  private:
   uint32_t padding_h_ = 0;
   uint32_t padding_w_ = 0;
@@ -24,7 +24,75 @@
 //
 
 #include "rms_norm.hpp"
+#include <algorithm>
+#include <cmath>
+#include "utils/math/simd_reduce.hpp"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+#define KUIPER_RMSNORM_SIMD
+#endif
+
 namespace kuiper_infer {
+/// Elements below which the rows are normalized on the calling thread
+constexpr size_t kRMSNormParallelSize = 1 << 14;
+
+// 计算一行的平方和; residual不为空时先把input累加到residual上, 再对累加的结果求平方和
+static inline float SquareSum(const float* input, float* residual, uint32_t size) {
+  uint32_t i = 0;
+  float sum = 0.f;
+#ifdef KUIPER_RMSNORM_SIMD
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  if (residual != nullptr) {
+    for (; i + 16 <= size; i += 16) {
+      const __m256 x0 = _mm256_add_ps(_mm256_loadu_ps(input + i), _mm256_loadu_ps(residual + i));
+      const __m256 x1 =
+          _mm256_add_ps(_mm256_loadu_ps(input + i + 8), _mm256_loadu_ps(residual + i + 8));
+      _mm256_storeu_ps(residual + i, x0);
+      _mm256_storeu_ps(residual + i + 8, x1);
+      acc0 = _mm256_fmadd_ps(x0, x0, acc0);
+      acc1 = _mm256_fmadd_ps(x1, x1, acc1);
+    }
+  } else {
+    for (; i + 16 <= size; i += 16) {
+      const __m256 x0 = _mm256_loadu_ps(input + i);
+      const __m256 x1 = _mm256_loadu_ps(input + i + 8);
+      acc0 = _mm256_fmadd_ps(x0, x0, acc0);
+      acc1 = _mm256_fmadd_ps(x1, x1, acc1);
+    }
+  }
+  sum = math::HorizontalSum(_mm256_add_ps(acc0, acc1));
+#endif
+  for (; i < size; ++i) {
+    float value = input[i];
+    if (residual != nullptr) {
+      value += residual[i];
+      residual[i] = value;
+    }
+    sum += value * value;
+  }
+  return sum;
+}
+
+// output = input * scale * weight
+static inline void ScaleRow(const float* input, const float* weight, float scale, uint32_t size,
+                            float* output) {
+  uint32_t i = 0;
+#ifdef KUIPER_RMSNORM_SIMD
+  const __m256 scale256 = _mm256_set1_ps(scale);
+  for (; i + 8 <= size; i += 8) {
+    const __m256 value = _mm256_mul_ps(_mm256_loadu_ps(input + i), scale256);
+    _mm256_storeu_ps(output + i, _mm256_mul_ps(value, _mm256_loadu_ps(weight + i)));
+  }
+#endif
+  for (; i < size; ++i) {
+    output[i] = input[i] * scale * weight[i];
+  }
+}
+
 RMSNormLayer::RMSNormLayer() : ParamLayer("rms_norm") { this->weights_.resize(1); }
 
 void RMSNormLayer::set_weights(const std::vector<float>& weights) {
@@ -38,6 +106,22 @@ void RMSNormLayer::set_weights(const std::vector<std::shared_ptr<Tensor<float>>>
 
 StatusCode RMSNormLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                                  std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  return ForwardRows(inputs, nullptr, outputs);
+}
+
+StatusCode RMSNormLayer::ForwardResidual(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                         std::vector<std::shared_ptr<Tensor<float>>>& residuals,
+                                         std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  if (residuals.size() != inputs.size()) {
+    LOG(ERROR) << "The input and residual tensor array size of the rmsnorm layer do not match";
+    return StatusCode::kInferDimMismatch;
+  }
+  return ForwardRows(inputs, &residuals, outputs);
+}
+
+StatusCode RMSNormLayer::ForwardRows(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                     std::vector<std::shared_ptr<Tensor<float>>>* residuals,
+                                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
   if (inputs.empty()) {
     LOG(ERROR) << "The input tensor array in the rmsnorm layer is empty";
     return StatusCode::kInferInputsEmpty;
@@ -54,21 +138,26 @@ StatusCode RMSNormLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>
     return StatusCode::kInferDimMismatch;
   }
 
-  if (weights_.empty() || weights_.front()->empty()) {
+  if (weights_.empty() || weights_.front() == nullptr || weights_.front()->empty()) {
     LOG(ERROR) << "The weight for the rmsnorm layer is missing.";
     return StatusCode::kInferParamError;
   }
 
   std::shared_ptr<Tensor<float>> weight = this->weight(0);
-  arma::fvec weight_vec(weight->raw_ptr(), weight->size(), false, true);
+  const float* weight_ptr = weight->raw_ptr();
+  const uint32_t hidden = weight->size();
   const uint32_t batch_size = inputs.size();
-#pragma omp parallel for if (batch_size > 1) num_threads(batch_size)
+  // 所有输入的行依次编号, 第i个输入的行位于[row_offsets[i], row_offsets[i + 1])
+  std::vector<size_t> row_offsets(batch_size + 1, 0);
   for (uint32_t i = 0; i < batch_size; ++i) {
     const auto& input = inputs.at(i);
     CHECK(input != nullptr && !input->empty())
         << "The input tensor array in the rmsnorm layer has an "
            "empty tensor "
         << i << " th";
+    CHECK_EQ(input->size() % hidden, 0)
+        << "The input size of the rmsnorm layer is not a multiple of the weight size " << i
+        << " th";
 
     std::shared_ptr<Tensor<float>> output = outputs.at(i);
     if (output == nullptr || output->empty()) {
@@ -79,16 +168,40 @@ StatusCode RMSNormLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>
         << "The input and output tensor shapes of the rmsnorm "
            "layer do not match "
         << i << " th";
+    if (residuals != nullptr) {
+      const auto& residual = residuals->at(i);
+      CHECK(residual != nullptr && residual->shapes() == input->shapes())
+          << "The input and residual tensor shapes of the rmsnorm layer do not match " << i
+          << " th";
+    }
+    row_offsets.at(i + 1) = row_offsets.at(i) + input->size() / hidden;
+  }
 
-    const size_t size = input->size();
-    arma::fvec input_vec(input->raw_ptr(), size, false, true);
+  const size_t row_num = row_offsets.back();
+#pragma omp parallel for if (row_num > 1 && row_num * hidden > kRMSNormParallelSize)
+  for (size_t row = 0; row < row_num; ++row) {
+    const uint32_t i =
+        std::upper_bound(row_offsets.begin(), row_offsets.end(), row) - row_offsets.begin() - 1;
+    const size_t offset = (row - row_offsets[i]) * hidden;
+    const float* input_ptr = inputs[i]->raw_ptr() + offset;
+    float* residual_ptr = residuals != nullptr ? (*residuals)[i]->raw_ptr() + offset : nullptr;
+    float* output_ptr = outputs[i]->raw_ptr() + offset;
 
-    const arma::fvec& input_pow_vec = arma::pow(input_vec, 2.f);
-    const float mean_value = arma::mean(input_pow_vec);
-    const float norm_value = 1.f / std::sqrt(mean_value + eps_);
-    arma::fvec output_vec(output->raw_ptr(), size, false, true);
-    output_vec = weight_vec % (norm_value * input_vec);
+    // 一次遍历求平方和, 第二次遍历写出归一化的结果
+    const float square_sum = SquareSum(input_ptr, residual_ptr, hidden);
+    const float norm_value = 1.f / std::sqrt(square_sum / float(hidden) + eps_);
+    ScaleRow(residual_ptr != nullptr ? residual_ptr : input_ptr, weight_ptr, norm_value, hidden,
+             output_ptr);
   }
   return StatusCode::kSuccess;
 }
+
+uint64_t RMSNormLayer::EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty()) {
+    return 0;
+  }
+  // 平方累加以及乘以归一化系数和权重, 每个元素各两次
+  return 4 * ShapeSize(input_shapes.front());
+}
+
 }  // namespace kuiper_infer
\ No newline at end of file
@@ -28,6 +28,13 @@
 #include "layer/abstract/param_layer.hpp"
 #include "runtime/runtime_op.hpp"
 namespace kuiper_infer {
+/**
+ * @brief Root mean square normalization over the hidden dimension
+ *
+ * The size of the weight is the hidden dimension. Every input is split into
+ * consecutive rows of that size, one row per token, and each row is
+ * normalized on its own. The rows of all inputs are processed in parallel.
+ */
 class RMSNormLayer : public ParamLayer {
  public:
   explicit RMSNormLayer();
@@ -35,10 +42,32 @@ class RMSNormLayer : public ParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  /**
+   * @brief Adds the inputs to the residuals and normalizes the sums
+   *
+   * Computes residual = residual + input and output = rmsnorm(residual) in
+   * one pass, the updated residuals are written back in place.
+   *
+   * @param inputs Outputs of the previous block
+   * @param residuals Residual stream, has the shapes of the inputs
+   * @param outputs Normalized residuals
+   * @return Status code
+   */
+  StatusCode ForwardResidual(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                             std::vector<std::shared_ptr<Tensor<float>>>& residuals,
+                             std::vector<std::shared_ptr<Tensor<float>>>& outputs);
+
+  uint64_t EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
   void set_weights(const std::vector<std::shared_ptr<Tensor<float>>>& weights) override;
 
   void set_weights(const std::vector<float>& weights) override;
+
  private:
+  StatusCode ForwardRows(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                         std::vector<std::shared_ptr<Tensor<float>>>* residuals,
+                         std::vector<std::shared_ptr<Tensor<float>>>& outputs);
+
   float eps_ = 1e-5f;
 };
 }  // namespace kuiper_infer
@@ -23,11 +23,147 @@
 
 #include "softmax.hpp"
 #include <glog/logging.h>
-#include <numeric>
+#include <algorithm>
+#include <limits>
 #include "data/tensor_util.hpp"
 #include "layer/abstract/layer_factory.hpp"
 #include "utils/math/fmath.hpp"
+#include "utils/math/simd_reduce.hpp"
 namespace kuiper_infer {
+/// Elements below which a tensor is normalized on the calling thread
+constexpr size_t kSoftmaxParallelSize = 1 << 14;
+/// Positions of the inner dimension normalized together on a strided axis
+constexpr uint32_t kSoftmaxInnerTile = 256;
+
+/**
+ * 连续轴上的online softmax
+ *
+ * 第一遍同时维护最大值和以当前最大值为基准的指数和, 最大值变大时把已有的和按比例缩小;
+ * 第二遍写出exp(x - max) / sum. 相比先求最大值再求指数和的做法少读写一遍数据.
+ */
+static void SoftmaxContiguous(const float* input, uint32_t size, float* output) {
+  uint32_t i = 0;
+  float max_value = std::numeric_limits<float>::lowest();
+  float sum_value = 0.f;
+#ifdef __AVX2__
+  if (size >= 8) {
+    // 每个lane各自维护最大值和指数和, 每32个数只对已有的和缩放一次
+    __m256 max256 = _mm256_set1_ps(max_value);
+    __m256 sum256 = _mm256_setzero_ps();
+    for (; i + 32 <= size; i += 32) {
+      const __m256 x0 = _mm256_loadu_ps(input + i);
+      const __m256 x1 = _mm256_loadu_ps(input + i + 8);
+      const __m256 x2 = _mm256_loadu_ps(input + i + 16);
+      const __m256 x3 = _mm256_loadu_ps(input + i + 24);
+      const __m256 block_max = _mm256_max_ps(_mm256_max_ps(x0, x1), _mm256_max_ps(x2, x3));
+      const __m256 new_max = _mm256_max_ps(max256, block_max);
+      sum256 = _mm256_mul_ps(sum256, fmath::exp_ps256(_mm256_sub_ps(max256, new_max)));
+      sum256 = _mm256_add_ps(sum256, fmath::exp_ps256(_mm256_sub_ps(x0, new_max)));
+      sum256 = _mm256_add_ps(sum256, fmath::exp_ps256(_mm256_sub_ps(x1, new_max)));
+      sum256 = _mm256_add_ps(sum256, fmath::exp_ps256(_mm256_sub_ps(x2, new_max)));
+      sum256 = _mm256_add_ps(sum256, fmath::exp_ps256(_mm256_sub_ps(x3, new_max)));
+      max256 = new_max;
+    }
+    for (; i + 8 <= size; i += 8) {
+      const __m256 x = _mm256_loadu_ps(input + i);
+      const __m256 new_max = _mm256_max_ps(max256, x);
+      sum256 = _mm256_mul_ps(sum256, fmath::exp_ps256(_mm256_sub_ps(max256, new_max)));
+      sum256 = _mm256_add_ps(sum256, fmath::exp_ps256(_mm256_sub_ps(x, new_max)));
+      max256 = new_max;
+    }
+    max_value = math::HorizontalMax(max256);
+    sum256 = _mm256_mul_ps(
+        sum256, fmath::exp_ps256(_mm256_sub_ps(max256, _mm256_set1_ps(max_value))));
+    sum_value = math::HorizontalSum(sum256);
+  }
+#endif
+  for (; i < size; ++i) {
+    const float cur_value = input[i];
+    if (cur_value > max_value) {
+      sum_value *= fmath::exp(max_value - cur_value);
+      max_value = cur_value;
+    }
+    sum_value += fmath::exp(cur_value - max_value);
+  }
+
+  const float inv_sum = 1.f / sum_value;
+  i = 0;
+#ifdef __AVX2__
+  const __m256 max256 = _mm256_set1_ps(max_value);
+  const __m256 inv_sum256 = _mm256_set1_ps(inv_sum);
+  for (; i + 8 <= size; i += 8) {
+    const __m256 exp_value = fmath::exp_ps256(_mm256_sub_ps(_mm256_loadu_ps(input + i), max256));
+    _mm256_storeu_ps(output + i, _mm256_mul_ps(exp_value, inv_sum256));
+  }
+#endif
+  for (; i < size; ++i) {
+    output[i] = fmath::exp(input[i] - max_value) * inv_sum;
+  }
+}
+
+/**
+ * 非连续轴上的softmax
+ *
+ * 同时处理inner方向上连续的width个位置, 向量化的方向是inner而不是softmax轴,
+ * 沿轴的每一步读写的都是连续的width个数. 三遍分别求最大值, 写出指数并求和, 归一化.
+ */
+static void SoftmaxStrided(const float* input, uint32_t axis_size, uint32_t stride,
+                           uint32_t width, float* output) {
+  float max_values[kSoftmaxInnerTile];
+  float sum_values[kSoftmaxInnerTile];
+  std::fill(max_values, max_values + width, std::numeric_limits<float>::lowest());
+  std::fill(sum_values, sum_values + width, 0.f);
+
+  for (uint32_t a = 0; a < axis_size; ++a) {
+    const float* input_row = input + size_t(a) * stride;
+    uint32_t j = 0;
+#ifdef __AVX2__
+    for (; j + 8 <= width; j += 8) {
+      _mm256_storeu_ps(max_values + j, _mm256_max_ps(_mm256_loadu_ps(max_values + j),
+                                                     _mm256_loadu_ps(input_row + j)));
+    }
+#endif
+    for (; j < width; ++j) {
+      max_values[j] = std::max(max_values[j], input_row[j]);
+    }
+  }
+
+  for (uint32_t a = 0; a < axis_size; ++a) {
+    const float* input_row = input + size_t(a) * stride;
+    float* output_row = output + size_t(a) * stride;
+    uint32_t j = 0;
+#ifdef __AVX2__
+    for (; j + 8 <= width; j += 8) {
+      const __m256 exp_value = fmath::exp_ps256(
+          _mm256_sub_ps(_mm256_loadu_ps(input_row + j), _mm256_loadu_ps(max_values + j)));
+      _mm256_storeu_ps(output_row + j, exp_value);
+      _mm256_storeu_ps(sum_values + j, _mm256_add_ps(_mm256_loadu_ps(sum_values + j), exp_value));
+    }
+#endif
+    for (; j < width; ++j) {
+      const float exp_value = fmath::exp(input_row[j] - max_values[j]);
+      output_row[j] = exp_value;
+      sum_values[j] += exp_value;
+    }
+  }
+
+  for (uint32_t j = 0; j < width; ++j) {
+    sum_values[j] = 1.f / sum_values[j];
+  }
+  for (uint32_t a = 0; a < axis_size; ++a) {
+    float* output_row = output + size_t(a) * stride;
+    uint32_t j = 0;
+#ifdef __AVX2__
+    for (; j + 8 <= width; j += 8) {
+      _mm256_storeu_ps(output_row + j, _mm256_mul_ps(_mm256_loadu_ps(output_row + j),
+                                                     _mm256_loadu_ps(sum_values + j)));
+    }
+#endif
+    for (; j < width; ++j) {
+      output_row[j] *= sum_values[j];
+    }
+  }
+}
 
 SoftmaxLayer::SoftmaxLayer(int32_t dim) : NonParamLayer("Softmax"), softmax_dim_(dim) {}
 
@@ -50,7 +186,7 @@ StatusCode SoftmaxLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>
   }
 
   const uint32_t batch_size = inputs.size();
-#pragma omp parallel for num_threads(batch_size)
+#pragma omp parallel for if (batch_size > 1) num_threads(batch_size)
   for (uint32_t i = 0; i < batch_size; ++i) {
     const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
     CHECK(input != nullptr && !input->empty())
@@ -66,7 +202,7 @@ StatusCode SoftmaxLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>
            "match "
         << i << " th";
     int32_t dim = this->softmax_dim_;
-    std::vector<uint32_t> raw_shapes = input->raw_shapes();
+    const std::vector<uint32_t>& raw_shapes = input->raw_shapes();
 
     if (dim < 0) {
       dim += int32_t(raw_shapes.size());
@@ -78,150 +214,57 @@ StatusCode SoftmaxLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>
                  << dim;
     }
 
-    if (raw_shapes.size() == 1 && dim == 0) {
-      float* input_ptr = input->raw_ptr();
-      float* output_ptr = output->raw_ptr();
-      int32_t size = static_cast<int32_t>(raw_shapes.front());
-      float max_value = *std::max_element(input_ptr, input_ptr + size);
-
-      int32_t index = 0;
-      float sum_value = 0.f;
-#ifdef __AVX2__
-      int32_t packet_size = 8;
-      input_ptr = input->raw_ptr();
-      __m256 sum_vec = _mm256_setzero_ps();
-      __m256 max_value256 = _mm256_set1_ps(max_value);
-      for (; index <= size - packet_size; index += packet_size) {
-        __m256 p = _mm256_loadu_ps(input_ptr);
-        __m256 exp_sub_value = fmath::exp_ps256(_mm256_sub_ps(p, max_value256));
-        _mm256_storeu_ps(output_ptr, exp_sub_value);
-        sum_vec = _mm256_add_ps(sum_vec, exp_sub_value);
-        input_ptr += packet_size;
-        output_ptr += packet_size;
-      }
-      sum_vec = _mm256_hadd_ps(sum_vec, sum_vec);
-      sum_vec = _mm256_hadd_ps(sum_vec, sum_vec);
-      sum_value = ((float*)&sum_vec)[0] + ((float*)&sum_vec)[4];
-#endif
-      if (index < size) {
-        input_ptr = input->raw_ptr(index);
-        output_ptr = output->raw_ptr(index);
-        for (; index < size; ++index) {
-          float cur_value = *input_ptr;
-          float exp_sub_value = fmath::exp(cur_value - max_value);
-          *output_ptr = exp_sub_value;
-          sum_value += exp_sub_value;
-
-          input_ptr += 1;
-          output_ptr += 1;
-        }
+    /**
+     * 张量按通道存放, 每个通道内按列存放, 内存中从慢到快依次为channels, cols, rows.
+     * 将softmax轴两侧的数据量分别记为outer和inner, inner部分在内存中是连续的.
+     * raw_shapes对应(channels, rows, cols)的最后几维, 超出raw_shapes的dim轴长度为1
+     */
+    const uint32_t channels = input->channels();
+    const uint32_t rows = input->rows();
+    const uint32_t cols = input->cols();
+    uint32_t outer_sizes = input->size();
+    uint32_t axis_sizes = 1;
+    uint32_t inner_sizes = 1;
+    if (dim < raw_shapes.size()) {
+      const uint32_t axis = dim + 3 - raw_shapes.size();
+      if (axis == 0) {
+        outer_sizes = 1;
+        axis_sizes = channels;
+        inner_sizes = rows * cols;
+      } else if (axis == 1) {
+        outer_sizes = channels * cols;
+        axis_sizes = rows;
+        inner_sizes = 1;
+      } else {
+        outer_sizes = channels;
+        axis_sizes = cols;
+        inner_sizes = rows;
       }
+    }
+    CHECK_EQ(size_t(axis_sizes) * outer_sizes * inner_sizes, input->size());
 
-      index = 0;
-#ifdef __AVX2__
-      output_ptr = output->raw_ptr();
-      sum_vec = _mm256_set1_ps(sum_value);
-      for (; index <= size - packet_size; index += packet_size) {
-        __m256 p = _mm256_loadu_ps(output_ptr);
-        __m256 div_value = _mm256_div_ps(p, sum_vec);
-        _mm256_storeu_ps(output_ptr, div_value);
-        output_ptr += packet_size;
-      }
-#endif
-      if (index < size) {
-        output_ptr = output->raw_ptr(index);
-        for (; index < size; ++index) {
-          *output_ptr = *output_ptr / sum_value;
-          output_ptr += 1;
-        }
+    const float* input_ptr = input->raw_ptr();
+    float* output_ptr = output->raw_ptr();
+    const bool parallel = input->size() > kSoftmaxParallelSize;
+    if (inner_sizes == 1) {
+#pragma omp parallel for if (parallel && outer_sizes > 1)
+      for (uint32_t outer_size = 0; outer_size < outer_sizes; ++outer_size) {
+        const size_t offset = size_t(outer_size) * axis_sizes;
+        SoftmaxContiguous(input_ptr + offset, axis_sizes, output_ptr + offset);
       }
     } else {
-      const uint32_t padding_size_num = 3 - raw_shapes.size();
-      for (uint32_t j = 0; j < padding_size_num; ++j) {
-        raw_shapes.push_back(1);
-      }
-
-      /**
-       * [...(inner size) dim ...(outer_size)
-       * 将输入的数据按dim维度拆分为两部分，分别为inner和outer
-       * 开始位置到dim轴位置的数据量是inner_size,
-       * dim轴位置到结束位置的数据量是outer_sizes
-       */
-      const uint32_t inner_sizes =
-          std::accumulate(raw_shapes.begin() + dim + 1, raw_shapes.end(), 1, std::multiplies());
-      const uint32_t outer_sizes =
-          std::accumulate(raw_shapes.begin(), raw_shapes.begin() + dim, 1, std::multiplies());
-
-      // dim轴数据的数量
-      int32_t axis_sizes = static_cast<int32_t>(raw_shapes.at(dim));
-      CHECK_EQ(axis_sizes * outer_sizes * inner_sizes, input->size());
-
-      std::vector<float> output_values = input->values(true);
-#pragma omp parallel for collapse(2)
+      // 每个任务处理inner方向上连续的一段, 沿softmax轴的每一步都是连续的读写
+      const uint32_t tiles = (inner_sizes + kSoftmaxInnerTile - 1) / kSoftmaxInnerTile;
+#pragma omp parallel for collapse(2) if (parallel && outer_sizes * tiles > 1)
       for (uint32_t outer_size = 0; outer_size < outer_sizes; ++outer_size) {
-        for (uint32_t inner_size = 0; inner_size < inner_sizes; ++inner_size) {
-          // 迭代当前dim中的数据，并找到其中的最大值
-          float max_value = std::numeric_limits<float>::lowest();
-          uint32_t base_index = outer_size * axis_sizes * inner_sizes + inner_size;
-
-          std::vector<float> tmp_storage(axis_sizes);
-          for (uint32_t axis_size = 0; axis_size < axis_sizes; ++axis_size) {
-            uint32_t index = base_index + axis_size * inner_sizes;
-            float cur_value = output_values.at(index);
-            if (cur_value > max_value) {
-              max_value = cur_value;
-            }
-            tmp_storage.at(axis_size) = cur_value;
-          }
-
-          float sum_value = 0.f;
-          int32_t axis_size = 0;
-#ifdef __AVX2__
-          int32_t packet_size = 8;
-          float* tmp_storage_ptr = tmp_storage.data();
-          __m256 sum_vec = _mm256_setzero_ps();
-          __m256 max_value256 = _mm256_set1_ps(max_value);
-          for (; axis_size <= axis_sizes - packet_size; axis_size += packet_size) {
-            __m256 p = _mm256_loadu_ps(tmp_storage_ptr);
-            __m256 exp_sub_value = fmath::exp_ps256(_mm256_sub_ps(p, max_value256));
-            _mm256_storeu_ps(tmp_storage_ptr, exp_sub_value);
-            sum_vec = _mm256_add_ps(sum_vec, exp_sub_value);
-            tmp_storage_ptr += packet_size;
-          }
-          sum_vec = _mm256_hadd_ps(sum_vec, sum_vec);
-          sum_vec = _mm256_hadd_ps(sum_vec, sum_vec);
-          sum_value = ((float*)&sum_vec)[0] + ((float*)&sum_vec)[4];
-#endif
-          for (; axis_size < axis_sizes; ++axis_size) {
-            float cur_value = tmp_storage.at(axis_size);
-            float exp_sub_value = fmath::exp(cur_value - max_value);
-            sum_value += exp_sub_value;
-            tmp_storage.at(axis_size) = exp_sub_value;
-          }
-
-#ifdef __AVX2__
-          tmp_storage_ptr = tmp_storage.data();
-          sum_vec = _mm256_set1_ps(sum_value);
-          for (axis_size = 0; axis_size <= axis_sizes - packet_size; axis_size += packet_size) {
-            __m256 p = _mm256_loadu_ps(tmp_storage_ptr);
-            __m256 div_value = _mm256_div_ps(p, sum_vec);
-            _mm256_storeu_ps(tmp_storage_ptr, div_value);
-            tmp_storage_ptr += packet_size;
-          }
-#endif
-          for (; axis_size < axis_sizes; ++axis_size) {
-            tmp_storage.at(axis_size) = tmp_storage.at(axis_size) / sum_value;
-          }
-
-          // 迭代当前dim中的数据，求exp(cur_value - max_value) / sum_value
-          for (axis_size = 0; axis_size < axis_sizes; ++axis_size) {
-            uint32_t index = base_index + axis_size * inner_sizes;
-            float div_value = tmp_storage.at(axis_size);
-            output_values.at(index) = div_value;
-          }
+        for (uint32_t tile = 0; tile < tiles; ++tile) {
+          const uint32_t inner_begin = tile * kSoftmaxInnerTile;
+          const uint32_t inner_end = std::min(inner_begin + kSoftmaxInnerTile, inner_sizes);
+          const size_t offset = size_t(outer_size) * axis_sizes * inner_sizes + inner_begin;
+          SoftmaxStrided(input_ptr + offset, axis_sizes, inner_sizes, inner_end - inner_begin,
+                         output_ptr + offset);
         }
       }
-      output->Fill(output_values, true);
     }
   }
   return StatusCode::kSuccess;
@@ -257,4 +300,13 @@ StatusCode SoftmaxLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>&
 }
 LayerRegistererWrapper kSoftMaxCreateInstanceNN(SoftmaxLayer::CreateInstance, "F.softmax",
                                                 "nn.Softmax");
+
+uint64_t SoftmaxLayer::EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty()) {
+    return 0;
+  }
+  // 求最大值、减最大值、求指数、求和与除法, 每个元素各一次
+  return 5 * ShapeSize(input_shapes.front());
+}
+
 }  // namespace kuiper_infer
\ No newline at end of file
@@ -265,4 +265,24 @@ StatusCode UpSampleLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>&
 
 LayerRegistererWrapper kUpSamplerCreateInstance(UpSampleLayer::CreateInstance, "nn.Upsample",
                                                 "F.upsample");
+
+uint64_t UpSampleLayer::EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (mode_ == UpSampleMode::kModeNearest) {
+    return 0;
+  }
+  // 双线性插值的每个输出元素需要4次乘法和3次加法
+  return 7 * OutputSize(input_shapes);
+}
+
+uint64_t UpSampleLayer::OutputSize(const std::vector<std::vector<int32_t>>& input_shapes) const {
+  if (input_shapes.empty()) {
+    return 0;
+  }
+  const std::vector<int32_t>& input_shape = input_shapes.front();
+  CHECK_EQ(input_shape.size(), 4) << "The input shape of the upsample layer should be NCHW";
+  const uint64_t output_h = uint64_t(std::floor(float(input_shape.at(2)) * scale_h_));
+  const uint64_t output_w = uint64_t(std::floor(float(input_shape.at(3)) * scale_w_));
+  return uint64_t(input_shape.at(0)) * input_shape.at(1) * output_h * output_w;
+}
+
 }  // namespace kuiper_infer
@@ -69,10 +69,8 @@ StatusCode ViewLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>&
       }
     }
 
-    std::shared_ptr<Tensor<float>> output_data = outputs.at(i);
-    output_data = TensorClone(input_data);
-    outputs.at(i) = output_data;
-    output_data->Reshape(shapes, true);
+    // 内存布局不变时输出直接引用输入的数据, 不发生拷贝
+    outputs.at(i) = TensorReshape(input_data, shapes);
   }
   return StatusCode::kSuccess;
 }
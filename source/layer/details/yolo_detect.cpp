@@ -23,9 +23,46 @@
 #include "yolo_detect.hpp"
 #include "data/tensor_util.hpp"
 #include "layer/abstract/layer_factory.hpp"
-#include "simd.hpp"
+#include "utils/math/fmath.hpp"
 
 namespace kuiper_infer {
+/**
+ * 对一行输出做sigmoid, 并按属性做坐标变换
+ *
+ * attr为0和1时是中心点坐标: (2 * sigmoid(x) + grid) * stride;
+ * attr为2和3时是宽高: (2 * sigmoid(x))^2 * anchor_grid; 其余属性只做sigmoid.
+ */
+static void DecodeYoloRow(float* data, uint32_t size, uint32_t attr, const float* table,
+                          float stride) {
+  uint32_t i = 0;
+#ifdef __AVX2__
+  const __m256 one = _mm256_set1_ps(1.f);
+  const __m256 two = _mm256_set1_ps(2.f);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 stride256 = _mm256_set1_ps(stride);
+  for (; i + 8 <= size; i += 8) {
+    __m256 p = _mm256_loadu_ps(data + i);
+    p = _mm256_div_ps(one, _mm256_add_ps(one, fmath::exp_ps256(_mm256_sub_ps(zero, p))));
+    if (attr < 2) {
+      p = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(p, two), _mm256_loadu_ps(table + i)),
+                        stride256);
+    } else if (attr < 4) {
+      p = _mm256_mul_ps(p, two);
+      p = _mm256_mul_ps(_mm256_mul_ps(p, p), _mm256_loadu_ps(table + i));
+    }
+    _mm256_storeu_ps(data + i, p);
+  }
+#endif
+  for (; i < size; ++i) {
+    float p = 1.f / (1.f + fmath::exp(-data[i]));
+    if (attr < 2) {
+      p = (p * 2.f + table[i]) * stride;
+    } else if (attr < 4) {
+      p = (p * 2.f) * (p * 2.f) * table[i];
+    }
+    data[i] = p;
+  }
+}
 
 YoloDetectLayer::YoloDetectLayer(int32_t stages, int32_t num_classes, int32_t num_anchors,
                                  std::vector<float> strides, std::vector<arma::fmat> anchor_grids,
@@ -102,62 +139,69 @@ StatusCode YoloDetectLayer::Forward(const std::vector<std::shared_ptr<Tensor<flo
     stage_outputs.at(stage) = stage_output;
   }
 
-  std::vector<sftensor> stage_tensors;
-  uint32_t concat_rows = 0;
+  // 每个stage输出的行数, 所有stage依次拼接在最终的输出中
+  std::vector<uint32_t> stage_offsets(stages + 1, 0);
   for (uint32_t stage = 0; stage < stages; ++stage) {
-    const std::vector<sftensor> stage_output = stage_outputs.at(stage);
+    const std::vector<sftensor>& stage_output = stage_outputs.at(stage);
     const uint32_t nx = stage_output.front()->rows();
     const uint32_t ny = stage_output.front()->cols();
     for (uint32_t i = 0; i < stage_output.size(); ++i) {
+      CHECK(stage_output.at(i) != nullptr && !stage_output.at(i)->empty());
       CHECK(stage_output.at(i)->rows() == nx && stage_output.at(i)->cols() == ny);
+      CHECK_EQ(stage_output.at(i)->channels(), num_anchors_ * classes_info);
     }
-
-    std::shared_ptr<Tensor<float>> stages_tensor =
-        TensorCreate<float>(batch_size, stages * nx * ny, uint32_t(num_classes_ + 5));
-    stage_tensors.push_back(stages_tensor);
-
-#pragma omp parallel for num_threads(batch_size)
-    for (uint32_t b = 0; b < batch_size; ++b) {
-      const std::shared_ptr<Tensor<float>>& input = stage_output.at(b);
-      CHECK(input != nullptr && !input->empty());
-      CHECK_EQ(input->rows(), nx);
-      CHECK_EQ(input->cols(), ny);
-      input->Reshape({stages, uint32_t(classes_info), ny * nx}, true);
-
-      CHECK_EQ(stages_tensor->channels(), batch_size);
-      CHECK_EQ(stages_tensor->rows(), stages_ * nx * ny);
-      CHECK_EQ(stages_tensor->cols(), classes_info);
-
-      using namespace kuiper_infer::activation;
-      ApplySSEActivation(ActivationType::kActivationSigmoid)(input, input);
-      const arma::fcube& input_data = input->data();
-
-      arma::fmat& x_stages = stages_tensor->slice(b);
-      for (uint32_t na = 0; na < num_anchors_; ++na) {
-        x_stages.submat(ny * nx * na, 0, ny * nx * (na + 1) - 1, classes_info - 1) =
-            input_data.slice(na).t();
-      }
-
-      auto xy = x_stages.submat(0, 0, x_stages.n_rows - 1, 1);
-      auto wh = x_stages.submat(0, 2, x_stages.n_rows - 1, 3);
-      xy = (xy * 2 + grids_[stage]) * strides_[stage];
-      wh = arma::pow((wh * 2), 2) % anchor_grids_[stage];
-    }
-    concat_rows += stages_tensor->rows();
+    const uint32_t stage_rows = num_anchors_ * nx * ny;
+    CHECK(grids_.at(stage).n_rows == stage_rows && grids_.at(stage).n_cols == 2)
+        << "The grid of the yolo detect layer does not match the stage output " << stage;
+    CHECK(anchor_grids_.at(stage).n_rows == stage_rows && anchor_grids_.at(stage).n_cols == 2)
+        << "The anchor grid of the yolo detect layer does not match the stage output " << stage;
+    stage_offsets.at(stage + 1) = stage_offsets.at(stage) + stage_rows;
   }
 
+  const uint32_t concat_rows = stage_offsets.back();
   for (uint32_t i = 0; i < batch_size; ++i) {
     std::shared_ptr<Tensor<float>> output = outputs.at(i);
     if (output == nullptr || output->empty()) {
       output = std::make_shared<Tensor<float>>(1, concat_rows, classes_info);
       outputs.at(i) = output;
     }
-    uint32_t current_rows = 0;
-    for (std::shared_ptr<ftensor> stages_tensor : stage_tensors) {
-      arma::fcube& output_data = output->data();
-      output_data.subcube(current_rows, 0, 0, current_rows + stages_tensor->rows() - 1,
-                          classes_info - 1, 0) = stages_tensor->slice(i);
-      current_rows += stages_tensor->rows();
+    CHECK(output->channels() == 1 && output->rows() == concat_rows &&
+          output->cols() == classes_info)
+        << "The output tensor shape of the yolo detect layer is wrong " << i << " th";
+  }
+
+  // 每个任务对应一个batch, stage, anchor和一个属性, 从卷积输出读出并解码后写到输出的一列中
+  const uint32_t stage_tasks = num_anchors_ * classes_info;
+  const uint32_t task_num = batch_size * stages * stage_tasks;
+#pragma omp parallel for schedule(dynamic)
+  for (uint32_t task = 0; task < task_num; ++task) {
+    const uint32_t b = task / (stages * stage_tasks);
+    const uint32_t stage = task / stage_tasks % stages;
+    const uint32_t anchor = task % stage_tasks / classes_info;
+    const uint32_t attr = task % classes_info;
+
+    const sftensor& stage_output = stage_outputs.at(stage).at(b);
+    const uint32_t nx = stage_output->rows();
+    const uint32_t ny = stage_output->cols();
+    const uint32_t area = nx * ny;
+    const float* input_ptr = stage_output->raw_ptr() + size_t(anchor * classes_info + attr) * area;
+    float* output_ptr = outputs.at(b)->raw_ptr() + size_t(attr) * concat_rows +
+                        stage_offsets.at(stage) + anchor * area;
+
+    const float* table = nullptr;
+    if (attr < 2) {
+      table = grids_.at(stage).colptr(attr) + anchor * area;
+    } else if (attr < 4) {
+      table = anchor_grids_.at(stage).colptr(attr - 2) + anchor * area;
+    }
+    // 卷积输出的通道按列存放, 输出中的位置按行展开, 逐行转置后立即解码
+    for (uint32_t r = 0; r < nx; ++r) {
+      float* output_row = output_ptr + r * ny;
+      for (uint32_t c = 0; c < ny; ++c) {
+        output_row[c] = input_ptr[c * nx + r];
+      }
+      DecodeYoloRow(output_row, ny, attr, table == nullptr ? nullptr : table + r * ny,
+                    strides_.at(stage));
     }
   }
   return StatusCode::kSuccess;
@@ -0,0 +1,271 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "yolo_post_process.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace kuiper_infer {
+/// Number of values of an output detection: x1, y1, x2, y2, score, class id
+constexpr uint32_t kDetectionInfo = 6;
+
+namespace {
+struct Candidate {
+  float score = 0.f;
+  uint32_t row = 0;
+  uint32_t class_id = 0;
+};
+
+/// Boxes kept by the suppression, stored per coordinate for the vectorized IoU
+struct KeptBoxes {
+  std::vector<float> x1;
+  std::vector<float> y1;
+  std::vector<float> x2;
+  std::vector<float> y2;
+  std::vector<float> area;
+
+  void Push(float bx1, float by1, float bx2, float by2) {
+    x1.push_back(bx1);
+    y1.push_back(by1);
+    x2.push_back(bx2);
+    y2.push_back(by2);
+    area.push_back((bx2 - bx1) * (by2 - by1));
+  }
+
+  uint32_t size() const { return x1.size(); }
+};
+}  // namespace
+
+// 目标置信度不低于阈值的行, objectness列在内存中是连续的
+static void FilterObjectness(const float* objectness, uint32_t rows, float conf_thresh,
+                             std::vector<uint32_t>& selected) {
+  uint32_t r = 0;
+#ifdef __AVX2__
+  const __m256 thresh = _mm256_set1_ps(conf_thresh);
+  for (; r + 8 <= rows; r += 8) {
+    const int mask =
+        _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(objectness + r), thresh, _CMP_GE_OQ));
+    if (mask == 0) {
+      continue;
+    }
+    for (uint32_t bit = 0; bit < 8; ++bit) {
+      if (mask >> bit & 1) {
+        selected.push_back(r + bit);
+      }
+    }
+  }
+#endif
+  for (; r < rows; ++r) {
+    if (objectness[r] >= conf_thresh) {
+      selected.push_back(r);
+    }
+  }
+}
+
+// 判断框和已保留的框的IoU是否超过阈值, 遇到第一个超过阈值的框即返回
+static bool Suppressed(const KeptBoxes& kept, float x1, float y1, float x2, float y2,
+                       float iou_thresh) {
+  const float area = (x2 - x1) * (y2 - y1);
+  const uint32_t size = kept.size();
+  uint32_t j = 0;
+#ifdef __AVX2__
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 x1_256 = _mm256_set1_ps(x1);
+  const __m256 y1_256 = _mm256_set1_ps(y1);
+  const __m256 x2_256 = _mm256_set1_ps(x2);
+  const __m256 y2_256 = _mm256_set1_ps(y2);
+  const __m256 area256 = _mm256_set1_ps(area);
+  const __m256 thresh = _mm256_set1_ps(iou_thresh);
+  for (; j + 8 <= size; j += 8) {
+    const __m256 w = _mm256_max_ps(
+        zero, _mm256_sub_ps(_mm256_min_ps(x2_256, _mm256_loadu_ps(kept.x2.data() + j)),
+                            _mm256_max_ps(x1_256, _mm256_loadu_ps(kept.x1.data() + j))));
+    const __m256 h = _mm256_max_ps(
+        zero, _mm256_sub_ps(_mm256_min_ps(y2_256, _mm256_loadu_ps(kept.y2.data() + j)),
+                            _mm256_max_ps(y1_256, _mm256_loadu_ps(kept.y1.data() + j))));
+    const __m256 inter = _mm256_mul_ps(w, h);
+    // inter / union > thresh 等价于 inter > thresh * union, 避免除法
+    const __m256 union_area =
+        _mm256_sub_ps(_mm256_add_ps(area256, _mm256_loadu_ps(kept.area.data() + j)), inter);
+    const __m256 over = _mm256_cmp_ps(inter, _mm256_mul_ps(thresh, union_area), _CMP_GT_OQ);
+    if (_mm256_movemask_ps(over) != 0) {
+      return true;
+    }
+  }
+#endif
+  for (; j < size; ++j) {
+    const float w = std::max(0.f, std::min(x2, kept.x2[j]) - std::max(x1, kept.x1[j]));
+    const float h = std::max(0.f, std::min(y2, kept.y2[j]) - std::max(y1, kept.y1[j]));
+    const float inter = w * h;
+    if (inter > iou_thresh * (area + kept.area[j] - inter)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+YoloPostProcessLayer::YoloPostProcessLayer(float conf_thresh, float iou_thresh, uint32_t top_k,
+                                           uint32_t max_detections, bool class_agnostic)
+    : NonParamLayer("YoloPostProcess"),
+      conf_thresh_(conf_thresh),
+      iou_thresh_(iou_thresh),
+      top_k_(top_k),
+      max_detections_(max_detections),
+      class_agnostic_(class_agnostic) {
+  CHECK(top_k > 0 && max_detections > 0)
+      << "The yolo post process layer needs at least one candidate and detection";
+}
+
+StatusCode YoloPostProcessLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                         std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  if (inputs.empty()) {
+    LOG(ERROR) << "The input tensor array in the yolo post process layer is empty";
+    return StatusCode::kInferInputsEmpty;
+  }
+
+  if (inputs.size() != outputs.size()) {
+    LOG(ERROR) << "The input and output tensor array size of the yolo post process "
+                  "layer do not match";
+    return StatusCode::kInferDimMismatch;
+  }
+
+  const uint32_t batch_size = inputs.size();
+#pragma omp parallel for if (batch_size > 1) num_threads(batch_size)
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
+    CHECK(input != nullptr && !input->empty())
+        << "The input tensor array in the yolo post process layer has an empty tensor " << i
+        << " th";
+    CHECK(input->channels() == 1 && input->cols() > 5)
+        << "The input of the yolo post process layer should be rows x (5 + classes)";
+    const uint32_t rows = input->rows();
+    const uint32_t num_classes = input->cols() - 5;
+    // 每一列的数据在内存中是连续的
+    const float* input_ptr = input->raw_ptr();
+    auto value = [input_ptr, rows](uint32_t row, uint32_t col) {
+      return input_ptr[size_t(col) * rows + row];
+    };
+
+    std::vector<uint32_t> selected;
+    FilterObjectness(input_ptr + size_t(4) * rows, rows, conf_thresh_, selected);
+
+    std::vector<Candidate> candidates;
+    candidates.reserve(selected.size());
+    for (uint32_t row : selected) {
+      uint32_t best_class = 0;
+      float best_score = value(row, 5);
+      for (uint32_t c = 1; c < num_classes; ++c) {
+        const float class_score = value(row, 5 + c);
+        if (class_score > best_score) {
+          best_score = class_score;
+          best_class = c;
+        }
+      }
+      const float score = best_score * value(row, 4);
+      if (score >= conf_thresh_) {
+        candidates.push_back({score, row, best_class});
+      }
+    }
+
+    // 按分数从高到低保留前top_k个候选框
+    auto better = [](const Candidate& a, const Candidate& b) {
+      return a.score > b.score || (a.score == b.score && a.row < b.row);
+    };
+    if (candidates.size() > top_k_) {
+      std::nth_element(candidates.begin(), candidates.begin() + top_k_, candidates.end(), better);
+      candidates.resize(top_k_);
+    }
+    std::sort(candidates.begin(), candidates.end(), better);
+
+    // 不同类别的框平移到互不相交的区域, 一次扫描即完成按类别的抑制
+    float max_coordinate = 0.f;
+    for (const Candidate& candidate : candidates) {
+      const float cx = std::abs(value(candidate.row, 0));
+      const float cy = std::abs(value(candidate.row, 1));
+      const float half_w = std::abs(value(candidate.row, 2)) / 2.f;
+      const float half_h = std::abs(value(candidate.row, 3)) / 2.f;
+      max_coordinate = std::max(max_coordinate, std::max(cx + half_w, cy + half_h));
+    }
+    const float class_offset = class_agnostic_ ? 0.f : 2.f * max_coordinate + 1.f;
+
+    KeptBoxes kept;
+    std::vector<const Candidate*> detections;
+    for (const Candidate& candidate : candidates) {
+      if (detections.size() >= max_detections_) {
+        break;
+      }
+      const float cx = value(candidate.row, 0);
+      const float cy = value(candidate.row, 1);
+      const float half_w = value(candidate.row, 2) / 2.f;
+      const float half_h = value(candidate.row, 3) / 2.f;
+      const float offset = class_offset * float(candidate.class_id);
+      const float x1 = cx - half_w + offset;
+      const float y1 = cy - half_h + offset;
+      const float x2 = cx + half_w + offset;
+      const float y2 = cy + half_h + offset;
+      if (!Suppressed(kept, x1, y1, x2, y2, iou_thresh_)) {
+        kept.Push(x1, y1, x2, y2);
+        detections.push_back(&candidate);
+      }
+    }
+
+    const uint32_t detection_num = detections.size();
+    std::shared_ptr<Tensor<float>> output =
+        std::make_shared<Tensor<float>>(1, detection_num, kDetectionInfo);
+    for (uint32_t d = 0; d < detection_num; ++d) {
+      const Candidate& candidate = *detections.at(d);
+      const float cx = value(candidate.row, 0);
+      const float cy = value(candidate.row, 1);
+      const float half_w = value(candidate.row, 2) / 2.f;
+      const float half_h = value(candidate.row, 3) / 2.f;
+      output->at(0, d, 0) = cx - half_w;
+      output->at(0, d, 1) = cy - half_h;
+      output->at(0, d, 2) = cx + half_w;
+      output->at(0, d, 3) = cy + half_h;
+      output->at(0, d, 4) = candidate.score;
+      output->at(0, d, 5) = float(candidate.class_id);
+    }
+    outputs.at(i) = output;
+  }
+  return StatusCode::kSuccess;
+}
+
+uint64_t YoloPostProcessLayer::EstimateFlops(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  uint64_t flops = 0;
+  for (const auto& input_shape : input_shapes) {
+    // 每行比较一次目标置信度, 候选框的数量与数据有关, 按top_k次IoU估计
+    flops += ShapeSize(input_shape) / std::max(input_shape.back(), 1) +
+             uint64_t(top_k_) * max_detections_ * 8;
+  }
+  return flops;
+}
+
+uint64_t YoloPostProcessLayer::OutputSize(
+    const std::vector<std::vector<int32_t>>& input_shapes) const {
+  return uint64_t(input_shapes.size()) * max_detections_ * kDetectionInfo;
+}
+
+}  // namespace kuiper_infer
@@ -0,0 +1,69 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_SOURCE_LAYER_DETAILS_YOLO_POST_PROCESS_HPP_
+#define KUIPER_INFER_SOURCE_LAYER_DETAILS_YOLO_POST_PROCESS_HPP_
+#include "layer/abstract/non_param_layer.hpp"
+
+namespace kuiper_infer {
+/**
+ * @brief Confidence filtering and non maximum suppression of yolo outputs
+ *
+ * Takes the 1 x rows x (5 + classes) output of YoloDetectLayer, each row is
+ * (cx, cy, w, h, objectness, class scores...). Rows whose objectness and
+ * score (objectness * best class score) pass the confidence threshold are
+ * kept, the top_k best are suppressed per class by IoU.
+ *
+ * Every output is a num_detections x 6 tensor with the rows
+ * (x1, y1, x2, y2, score, class id) sorted by score, an image without
+ * detections gets a tensor with zero rows.
+ */
+class YoloPostProcessLayer : public NonParamLayer {
+ public:
+  /**
+   * @param conf_thresh Minimum objectness and score of a detection
+   * @param iou_thresh Boxes of the same class overlapping a better box by
+   * more than this IoU are suppressed
+   * @param top_k Candidates entering the suppression, the best by score
+   * @param max_detections Maximum number of detections of an image
+   * @param class_agnostic Suppress overlapping boxes of different classes too
+   */
+  explicit YoloPostProcessLayer(float conf_thresh = 0.25f, float iou_thresh = 0.45f,
+                                uint32_t top_k = 1024, uint32_t max_detections = 300,
+                                bool class_agnostic = false);
+
+  StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  uint64_t EstimateFlops(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
+ protected:
+  uint64_t OutputSize(const std::vector<std::vector<int32_t>>& input_shapes) const override;
+
+ private:
+  float conf_thresh_ = 0.25f;
+  float iou_thresh_ = 0.45f;
+  uint32_t top_k_ = 1024;
+  uint32_t max_detections_ = 300;
+  bool class_agnostic_ = false;
+};
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_SOURCE_LAYER_DETAILS_YOLO_POST_PROCESS_HPP_
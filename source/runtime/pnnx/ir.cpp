@@ -43,6 +43,7 @@ static bool type_is_integer(int type) {
   if (type == 10) return false;
   if (type == 11) return false;
   if (type == 12) return false;
+  if (type == 13) return false;
   return false;
 }
 
@@ -59,6 +60,7 @@ static const char* type_to_string(int type) {
   if (type == 10) return "cp64";
   if (type == 11) return "cp128";
   if (type == 12) return "cp32";
+  if (type == 13) return "bf16";
   return "null";
 }
 
@@ -75,6 +77,7 @@ static const char* type_to_numpy_string(int type) {
   if (type == 10) return "csingle";
   if (type == 11) return "cdouble";
   if (type == 12) return "chalf";
+  if (type == 13) return "bfloat16";
   return "null";
 }
 
@@ -91,6 +94,7 @@ static const char* type_to_dtype_string(int type) {
   if (type == 10) return "torch.complex64";
   if (type == 11) return "torch.complex128";
   if (type == 12) return "torch.complex32";
+  if (type == 13) return "torch.bfloat16";
   return "null";
 }
 
@@ -107,6 +111,7 @@ static size_t type_to_elemsize(int type) {
   if (type == 10) return 8;
   if (type == 11) return 16;
   if (type == 12) return 4;
+  if (type == 13) return 2;
   return 0;  // null
 }
 
@@ -123,6 +128,7 @@ static int string_to_type(const char* s) {
   if (strcmp(s, "cp64") == 0) return 10;
   if (strcmp(s, "cp128") == 0) return 11;
   if (strcmp(s, "cp32") == 0) return 12;
+  if (strcmp(s, "bf16") == 0) return 13;
   return 0;  // null
 }
 
@@ -143,6 +149,7 @@ int get_at_tensor_type(const at::ScalarType& st) {
   if (st == c10::ScalarType::ComplexFloat) return 10;
   if (st == c10::ScalarType::ComplexDouble) return 11;
   if (st == c10::ScalarType::ComplexHalf) return 12;
+  if (st == c10::ScalarType::BFloat16) return 13;
   return 0;  // unknown type
 }
 
@@ -0,0 +1,340 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "runtime/runtime_calibration.hpp"
+#include <glog/logging.h>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include "data/load_data.hpp"
+#include "data/tensor_util.hpp"
+#include "utils/math/int8_gemm.hpp"
+
+namespace kuiper_infer {
+/// Elements accumulated by one OpenMP task
+constexpr size_t kCalibrationChunk = 1 << 14;
+/// Quantization levels of the positive half of int8
+constexpr uint32_t kCalibrationLevels = 128;
+
+ActivationHistogram::ActivationHistogram(uint32_t bin_num) : bins_(bin_num, 0) {
+  CHECK_GE(bin_num, kCalibrationLevels)
+      << "The histogram needs at least " << kCalibrationLevels << " bins";
+}
+
+void ActivationHistogram::GrowRange(float abs_max) {
+  const uint32_t bin_num = bins_.size();
+  if (bin_width_ <= 0.f) {
+    bin_width_ = abs_max / float(bin_num);
+    return;
+  }
+  while (abs_max > bin_width_ * float(bin_num)) {
+    // 合并相邻的两个bin, 范围扩大一倍
+    for (uint32_t i = 0; i < bin_num / 2; ++i) {
+      bins_.at(i) = bins_.at(2 * i) + bins_.at(2 * i + 1);
+    }
+    std::fill(bins_.begin() + bin_num / 2, bins_.end(), 0);
+    bin_width_ *= 2.f;
+  }
+}
+
+void ActivationHistogram::Collect(const std::vector<sftensor>& tensors, uint32_t tensor_num) {
+  tensor_num = std::min(tensor_num, static_cast<uint32_t>(tensors.size()));
+  // 将所有张量切分为固定大小的块, 由各个线程并行统计
+  std::vector<std::pair<const float*, size_t>> chunks;
+  for (uint32_t i = 0; i < tensor_num; ++i) {
+    const sftensor& tensor = tensors.at(i);
+    CHECK(tensor != nullptr && !tensor->empty()) << "The calibration tensor is empty";
+    const float* data = tensor->raw_ptr();
+    const size_t size = tensor->size();
+    for (size_t offset = 0; offset < size; offset += kCalibrationChunk) {
+      chunks.emplace_back(data + offset, std::min(kCalibrationChunk, size - offset));
+    }
+  }
+  if (chunks.empty()) {
+    return;
+  }
+
+  const int64_t chunk_num = static_cast<int64_t>(chunks.size());
+  float min_value = std::numeric_limits<float>::max();
+  float max_value = std::numeric_limits<float>::lowest();
+#pragma omp parallel for reduction(min : min_value) reduction(max : max_value)
+  for (int64_t c = 0; c < chunk_num; ++c) {
+    const auto& [data, size] = chunks.at(c);
+    for (size_t j = 0; j < size; ++j) {
+      min_value = std::min(min_value, data[j]);
+      max_value = std::max(max_value, data[j]);
+    }
+  }
+  if (count_ == 0) {
+    min_value_ = min_value;
+    max_value_ = max_value;
+  } else {
+    min_value_ = std::min(min_value_, min_value);
+    max_value_ = std::max(max_value_, max_value);
+  }
+
+  const float abs_max = std::max(-min_value, max_value);
+  if (abs_max > 0.f) {
+    GrowRange(abs_max);
+  }
+
+  size_t element_num = 0;
+  for (const auto& chunk : chunks) {
+    element_num += chunk.second;
+  }
+  count_ += element_num;
+
+  if (bin_width_ <= 0.f) {
+    // 到目前为止所有的值都为零, 直方图的范围尚未确定
+    bins_.front() += element_num;
+  } else {
+    const uint32_t bin_num = bins_.size();
+    const float inv_width = 1.f / bin_width_;
+#pragma omp parallel
+    {
+      std::vector<uint64_t> local_bins(bin_num, 0);
+#pragma omp for nowait
+      for (int64_t c = 0; c < chunk_num; ++c) {
+        const auto& [data, size] = chunks.at(c);
+        for (size_t j = 0; j < size; ++j) {
+          const uint32_t index = static_cast<uint32_t>(std::fabs(data[j]) * inv_width);
+          local_bins[std::min(index, bin_num - 1)] += 1;
+        }
+      }
+#pragma omp critical
+      for (uint32_t i = 0; i < bin_num; ++i) {
+        bins_[i] += local_bins[i];
+      }
+    }
+  }
+}
+
+float ActivationHistogram::EntropyThreshold() const {
+  const uint32_t bin_num = bins_.size();
+  // 超出阈值的部分合并到参考分布的最后一个bin中
+  std::vector<uint64_t> tail_sums(bin_num + 1, 0);
+  for (int64_t i = int64_t(bin_num) - 1; i >= 0; --i) {
+    tail_sums.at(i) = tail_sums.at(i + 1) + bins_.at(i);
+  }
+  if (tail_sums.front() == 0) {
+    return 0.f;
+  }
+
+  const int32_t candidate_num = int32_t(bin_num - kCalibrationLevels + 1);
+  std::vector<double> divergences(candidate_num, std::numeric_limits<double>::max());
+#pragma omp parallel for schedule(dynamic, 16)
+  for (int32_t c = 0; c < candidate_num; ++c) {
+    const uint32_t threshold_bin = kCalibrationLevels + c;
+    std::vector<double> reference(bins_.begin(), bins_.begin() + threshold_bin);
+    reference.back() += double(tail_sums.at(threshold_bin));
+
+    // 将前threshold_bin个bin量化为kCalibrationLevels级, 再展开到非零的bin上
+    std::vector<double> candidate(threshold_bin, 0.);
+    for (uint32_t level = 0; level < kCalibrationLevels; ++level) {
+      const uint32_t start = uint64_t(level) * threshold_bin / kCalibrationLevels;
+      const uint32_t end = uint64_t(level + 1) * threshold_bin / kCalibrationLevels;
+      double total = 0.;
+      uint32_t nonzero = 0;
+      for (uint32_t i = start; i < end; ++i) {
+        total += double(bins_.at(i));
+        nonzero += bins_.at(i) != 0;
+      }
+      if (nonzero == 0) {
+        continue;
+      }
+      for (uint32_t i = start; i < end; ++i) {
+        candidate.at(i) = bins_.at(i) != 0 ? total / nonzero : 0.;
+      }
+    }
+
+    double reference_sum = 0.;
+    double candidate_sum = 0.;
+    for (uint32_t i = 0; i < threshold_bin; ++i) {
+      reference_sum += reference.at(i);
+      candidate_sum += candidate.at(i);
+    }
+    if (reference_sum == 0. || candidate_sum == 0.) {
+      continue;
+    }
+
+    double divergence = 0.;
+    for (uint32_t i = 0; i < threshold_bin; ++i) {
+      const double p = reference.at(i) / reference_sum;
+      if (p == 0.) {
+        continue;
+      }
+      // 截断后最后一个bin可能在量化分布中为零, 用一个很小的概率代替
+      const double q = std::max(candidate.at(i) / candidate_sum, 1e-12);
+      divergence += p * std::log(p / q);
+    }
+    divergences.at(c) = divergence;
+  }
+
+  const auto min_iter = std::min_element(divergences.begin(), divergences.end());
+  const uint32_t best_bin = kCalibrationLevels + uint32_t(min_iter - divergences.begin());
+  return (float(best_bin) + 0.5f) * bin_width_;
+}
+
+float ActivationHistogram::Scale(CalibrationMethod method) const {
+  const float abs_max = this->abs_max();
+  if (count_ == 0 || abs_max <= 0.f) {
+    return math::Int8Scale(0.f);
+  }
+  if (method == CalibrationMethod::kEntropy) {
+    const float threshold = EntropyThreshold();
+    if (threshold > 0.f) {
+      return math::Int8Scale(std::min(threshold, abs_max));
+    }
+  }
+  return math::Int8Scale(abs_max);
+}
+
+Int8Calibrator::Int8Calibrator(uint32_t bin_num) : bin_num_(bin_num) {}
+
+void Int8Calibrator::set_sample_num(uint32_t sample_num) { this->sample_num_ = sample_num; }
+
+void Int8Calibrator::Collect(const std::string& operand_name,
+                             const std::vector<sftensor>& tensors) {
+  auto histogram_iter = histograms_.find(operand_name);
+  if (histogram_iter == histograms_.end()) {
+    histogram_iter = histograms_.emplace(operand_name, ActivationHistogram(bin_num_)).first;
+  }
+  const uint32_t tensor_num = sample_num_ == 0 ? tensors.size() : sample_num_;
+  histogram_iter->second.Collect(tensors, tensor_num);
+}
+
+std::map<std::string, float> Int8Calibrator::ComputeScales(CalibrationMethod method) const {
+  std::map<std::string, float> scales;
+  for (const auto& [operand_name, histogram] : histograms_) {
+    scales.insert({operand_name, histogram.Scale(method)});
+  }
+  return scales;
+}
+
+bool Int8Calibrator::WriteTable(const std::string& table_path, CalibrationMethod method) const {
+  std::ofstream table(table_path);
+  if (!table.is_open()) {
+    LOG(ERROR) << "Can not open the calibration table: " << table_path;
+    return false;
+  }
+  table << "# KuiperInfer int8 calibration table\n";
+  table << "# method: " << (method == CalibrationMethod::kEntropy ? "entropy" : "minmax") << "\n";
+  table << "# operand scale min max\n";
+  table.precision(std::numeric_limits<float>::max_digits10);
+  for (const auto& [operand_name, histogram] : histograms_) {
+    table << operand_name << " " << histogram.Scale(method) << " " << histogram.min_value() << " "
+          << histogram.max_value() << "\n";
+  }
+  return table.good();
+}
+
+bool Int8Calibrator::ReadTable(const std::string& table_path,
+                               std::map<std::string, float>& scales) {
+  std::ifstream table(table_path);
+  if (!table.is_open()) {
+    LOG(ERROR) << "Can not open the calibration table: " << table_path;
+    return false;
+  }
+  std::string line;
+  uint32_t line_index = 0;
+  while (std::getline(table, line)) {
+    line_index += 1;
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    std::stringstream line_stream(line);
+    std::string operand_name;
+    float scale = 0.f;
+    if (!(line_stream >> operand_name >> scale) || scale <= 0.f) {
+      LOG(ERROR) << "Wrong calibration table line " << line_index << ": " << line;
+      return false;
+    }
+    scales[operand_name] = scale;
+  }
+  return true;
+}
+
+sftensor Int8Calibrator::LoadSample(const std::string& sample_path,
+                                    const std::vector<uint32_t>& shapes) {
+  size_t size = 1;
+  for (uint32_t dim : shapes) {
+    size *= dim;
+  }
+
+  auto has_suffix = [&sample_path](const std::string& suffix) {
+    return sample_path.size() >= suffix.size() &&
+           sample_path.compare(sample_path.size() - suffix.size(), suffix.size(), suffix) == 0;
+  };
+
+  if (has_suffix(".npy")) {
+    // npy文件按C顺序保存, 形状不同时按行主序调整
+    sftensor sample = NpyDataLoader::LoadTensor<float>(sample_path);
+    if (sample == nullptr) {
+      return nullptr;
+    }
+    if (sample->size() != size) {
+      LOG(ERROR) << "The calibration sample " << sample_path << " has " << sample->size()
+                 << " values, but the input needs " << size;
+      return nullptr;
+    }
+    if (sample->raw_shapes() != shapes) {
+      sample->Reshape(shapes, true);
+    }
+    return sample;
+  }
+
+  std::vector<float> values;
+  if (has_suffix(".csv")) {
+    const arma::fmat& data = CSVDataLoader::LoadData<float>(sample_path);
+    values.reserve(data.size());
+    for (uint32_t r = 0; r < data.n_rows; ++r) {
+      for (uint32_t c = 0; c < data.n_cols; ++c) {
+        values.push_back(data.at(r, c));
+      }
+    }
+  } else {
+    std::ifstream file(sample_path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+      LOG(ERROR) << "Can not open the calibration sample: " << sample_path;
+      return nullptr;
+    }
+    const std::streamsize file_size = file.tellg();
+    if (file_size < 0 || size_t(file_size) % sizeof(float) != 0) {
+      LOG(ERROR) << "The calibration sample is not float32 data: " << sample_path;
+      return nullptr;
+    }
+    file.seekg(0);
+    values.resize(size_t(file_size) / sizeof(float));
+    file.read(reinterpret_cast<char*>(values.data()), file_size);
+  }
+
+  if (values.size() != size) {
+    LOG(ERROR) << "The calibration sample " << sample_path << " has " << values.size()
+               << " values, but the input needs " << size;
+    return nullptr;
+  }
+  sftensor sample = TensorCreate<float>(shapes);
+  sample->Fill(values, true);
+  return sample;
+}
+
+}  // namespace kuiper_infer
@@ -20,11 +20,16 @@
 // SOFTWARE.
 
 #include "runtime/runtime_ir.hpp"
+#include <algorithm>
 #include <deque>
+#include <filesystem>
 #include <iostream>
 #include <memory>
+#include <unordered_map>
 #include <utility>
 #include <vector>
+#include "data/tensor_row_major.hpp"
+#include "data/tensor_util.hpp"
 #include "layer/abstract/layer_factory.hpp"
 #include "runtime/runtime_ir.hpp"
 #include "utils/time/time_logging.hpp"
@@ -120,9 +125,19 @@ void RuntimeGraph::Build() {
 
   // 初始化节点的输入和输出空间
   RuntimeOperatorUtils<float>::InitOperatorInput(operators_);
+  // view的输出可能引用输入的数据, 输入的内存在view的输出使用完之前不能复用
+  RuntimeOperatorUtils<float>::ExtendViewLifetimes(operators_);
   RuntimeOperatorUtils<float>::InitOperatorOutput(graph_->ops, operators_);
+  // 拼接的输入直接写入拼接输出的对应通道
+  RuntimeOperatorUtils<float>::PlanConcatOutputs(operators_);
+
+  // 估计各个节点的计算量和访存量
+  EstimateOperatorCosts();
 
   graph_state_ = GraphState::Complete;
+  if (profiler_ != nullptr) {
+    RegisterProfilerOps();
+  }
   if (graph_ != nullptr) {
     graph_.reset();
     graph_ = nullptr;
@@ -131,10 +146,14 @@ void RuntimeGraph::Build() {
 
 template <typename T>
 StatusCode ExecuteLayer(const std::shared_ptr<Layer<T>>& layer, const std::string& op_name,
-                        const std::string& op_type, bool is_debug) {
+                        const std::string& op_type, bool is_debug,
+                        utils::Profiler* profiler, uint32_t op_id) {
   CHECK(layer != nullptr);
   StatusCode status;
-  if (is_debug) {
+  if (profiler != nullptr) {
+    utils::ProfileScope profile_scope(profiler, op_id);
+    status = layer->Forward();
+  } else if (is_debug) {
     utils::LayerTimeLogging layer_time_logging(op_name, op_type);
     status = layer->Forward();
   } else {
@@ -154,11 +173,12 @@ void RuntimeGraph::Forward(bool debug) {
     utils::LayerTimeStatesSingleton::LayerTimeStatesCollectorInit();
   }
 
+  CopyBoundInputs();
   for (const auto& current_op : operators_) {
     current_op->has_forward = false;
     CHECK_GT(current_op->start_time, 0);
 
-    if (is_input_op(current_op->name) || is_output_op(current_op->name)) {
+    if (current_op->is_graph_input || current_op->is_graph_output) {
       current_op->has_forward = true;
       continue;
     }
@@ -167,15 +187,46 @@ void RuntimeGraph::Forward(bool debug) {
         << "The layer corresponding to the op " << current_op->name
         << " is empty, indicating that it may not have been created.";
 
-    StatusCode status = ExecuteLayer(current_op->layer, current_op->name, current_op->type, debug);
+    // 算子在执行顺序中的位置即为其在profiler中的id
+    StatusCode status = ExecuteLayer(current_op->layer, current_op->name, current_op->type, debug,
+                                     profiler_.get(), current_op->start_time - 1);
     CHECK(status == StatusCode::kSuccess)
         << current_op->layer->layer_name()
         << " layer forward failed, error code: " << int32_t(status);
 
+    if (calibrator_ != nullptr) {
+      // 输出的内存可能被之后的算子复用, 所以在算子执行后立即统计
+      calibrator_->Collect(current_op->name, current_op->output_operands->datas);
+    }
+
     current_op->has_forward = true;
     PropagateLayerOutputs(current_op, current_op->output_operands->datas);
   }
 
+  CopyBoundOutputs();
+
+  // 追加在输出之后的层, 以输出算子的输入作为输入
+  for (const auto& [output_name, output_layer] : output_layers_) {
+    const std::shared_ptr<RuntimeOperator>& output_op = output_ops_.at(output_name);
+    std::vector<sftensor> layer_inputs;
+    for (const auto& input_operand : output_op->input_operands_seq) {
+      std::copy(input_operand->datas.begin(), input_operand->datas.end(),
+                std::back_inserter(layer_inputs));
+    }
+    std::vector<sftensor>& layer_outputs = output_layer_datas_[output_name];
+    layer_outputs.resize(layer_inputs.size());
+    StatusCode status;
+    if (debug) {
+      utils::LayerTimeLogging layer_time_logging(output_name, output_layer->layer_name());
+      status = output_layer->Forward(layer_inputs, layer_outputs);
+    } else {
+      status = output_layer->Forward(layer_inputs, layer_outputs);
+    }
+    CHECK(status == StatusCode::kSuccess)
+        << output_layer->layer_name()
+        << " layer appended to the output forward failed, error code: " << int32_t(status);
+  }
+
   if (debug) {
     utils::LayerTimeLogging::SummaryLogging();
   }
@@ -335,17 +386,28 @@ void RuntimeGraph::InitGraphAttrs(const std::map<std::string, pnnx::Attribute>&
   }
   CHECK(runtime_operator != nullptr) << "The runtime operator is null pointer";
   for (const auto& [name, attr] : attrs) {
+    RuntimeDataType data_type = RuntimeDataType::kTypeUnknown;
     switch (attr.type) {
       case 1: {
-        std::shared_ptr<RuntimeAttribute> runtime_attribute = std::make_shared<RuntimeAttribute>(
-            attr.shape, RuntimeDataType::kTypeFloat32, attr.data);
-        runtime_operator->attribute.insert({name, runtime_attribute});
+        data_type = RuntimeDataType::kTypeFloat32;
+        break;
+      }
+      case 3: {
+        data_type = RuntimeDataType::kTypeFloat16;
+        break;
+      }
+      case 13: {
+        data_type = RuntimeDataType::kTypeBFloat16;
         break;
       }
       default: {
         LOG(FATAL) << "Unknown attribute type: " << attr.type;
       }
     }
+    // 16位的权重保持原样, 由算子决定转为float还是直接以16位存放
+    std::shared_ptr<RuntimeAttribute> runtime_attribute =
+        std::make_shared<RuntimeAttribute>(attr.shape, data_type, attr.data);
+    runtime_operator->attribute.insert({name, runtime_attribute});
   }
 }
 
@@ -353,22 +415,17 @@ template <typename T>
 void RuntimeGraph::PropagateLayerOutputs(
     const std::shared_ptr<RuntimeOperatorBase<T>>& current_op,
     const std::vector<std::shared_ptr<Tensor<T>>>& layer_output_datas) {
-  // For each next operator of current operator
-  for (const auto& [_, output_op] : current_op->output_operators) {
-    // Get next op's input operands corresponding to current op's output
-    const auto& next_input_operands = output_op->input_operands;
-    const auto& next_input_op_iter = next_input_operands.find(current_op->name);
-    if (next_input_op_iter != next_input_operands.end()) {
-      // Get input data spaces for those operands
-      std::vector<stensor<T>>& next_input_datas = next_input_op_iter->second->datas;
-      // Copy current op output data to next op input data
-      for (uint32_t i = 0; i < next_input_datas.size(); ++i) {
-        const stensor<T>& layer_output_data = layer_output_datas.at(i);
-        if (next_input_datas.at(i) != nullptr) {
-          CHECK(next_input_datas.at(i)->shapes() == layer_output_data->shapes());
-        }
-        next_input_datas.at(i) = layer_output_data;
+  // For each input operand of next operators fed by current operator
+  for (const auto& next_input_operand : current_op->output_operands_seq) {
+    // Get input data spaces for those operands
+    std::vector<stensor<T>>& next_input_datas = next_input_operand->datas;
+    // Copy current op output data to next op input data
+    for (uint32_t i = 0; i < next_input_datas.size(); ++i) {
+      const stensor<T>& layer_output_data = layer_output_datas.at(i);
+      if (next_input_datas.at(i) != nullptr) {
+        CHECK(next_input_datas.at(i)->shapes() == layer_output_data->shapes());
       }
+      next_input_datas.at(i) = layer_output_data;
     }
   }
 }
@@ -420,10 +477,12 @@ void RuntimeGraph::ReverseTopoSortInternal(const std::shared_ptr<RuntimeOperator
     return;
   }
   if (root_op->input_operands.empty() && !root_op->has_forward) {
-    this->input_ops_.push_back(root_op);
+    root_op->is_graph_input = true;
+    this->input_ops_.insert({root_op->name, root_op});
   }
   if (root_op->output_names.empty() && !root_op->has_forward) {
-    this->output_ops_.push_back(root_op);
+    root_op->is_graph_output = true;
+    this->output_ops_.insert({root_op->name, root_op});
   }
 
   root_op->has_forward = true;
@@ -442,15 +501,30 @@ void RuntimeGraph::ReverseTopoSortInternal(const std::shared_ptr<RuntimeOperator
 }
 
 void RuntimeGraph::CreateNodeRelation() {
+  // 建立算子名称到算子的索引
+  operators_maps_.clear();
+  operators_maps_.reserve(this->operators_.size());
+  for (const auto& op : this->operators_) {
+    operators_maps_.insert({op->name, op});
+  }
+
   // 构建图关系
   for (const auto& current_op : this->operators_) {
-    // 获取当前节点的所有后继节点的names，遍历根据next_op_name从operators_maps_中插入所需要的节点
+    // 获取当前节点的所有后继节点的names，根据next_op_name从operators_maps_中插入所需要的节点
     const std::vector<std::string>& output_names = current_op->output_names;
     for (const auto& kOutputName : output_names) {
-      for (const auto& output_op : this->operators_) {
-        if (output_op != current_op && output_op->name == kOutputName) {
-          current_op->output_operators.insert({kOutputName, output_op});
-        }
+      const auto& output_op_iter = operators_maps_.find(kOutputName);
+      if (output_op_iter != operators_maps_.end() && output_op_iter->second != current_op) {
+        current_op->output_operators.insert({kOutputName, output_op_iter->second});
+      }
+    }
+
+    // 预先解析后继节点中由当前节点提供的输入operand，避免执行时按名称查找
+    current_op->output_operands_seq.clear();
+    for (const auto& [_, output_op] : current_op->output_operators) {
+      const auto& next_input_operand_iter = output_op->input_operands.find(current_op->name);
+      if (next_input_operand_iter != output_op->input_operands.end()) {
+        current_op->output_operands_seq.push_back(next_input_operand_iter->second);
       }
     }
     // 除了输入和输出节点，都创建layer
@@ -466,31 +540,212 @@ void RuntimeGraph::CreateNodeRelation() {
   }
 }
 
+void RuntimeGraph::EnableProfiler(uint32_t capacity, bool hardware_counters) {
+  profiler_ = std::make_shared<utils::Profiler>(capacity, hardware_counters);
+  if (graph_state_ == GraphState::Complete) {
+    RegisterProfilerOps();
+  }
+}
+
+void RuntimeGraph::DisableProfiler() { profiler_.reset(); }
+
+std::shared_ptr<utils::Profiler> RuntimeGraph::profiler() const { return this->profiler_; }
+
+void RuntimeGraph::RegisterProfilerOps() {
+  CHECK(profiler_ != nullptr);
+  profiler_->Clear();
+  CHECK_EQ(operator_costs_.size(), operators_.size());
+  for (const auto& op_cost : operator_costs_) {
+    profiler_->RegisterOp(op_cost.name, op_cost.type, op_cost.flops, op_cost.bytes);
+  }
+}
+
+void RuntimeGraph::EstimateOperatorCosts() {
+  operator_costs_.clear();
+  for (const auto& op : operators_) {
+    RuntimeOperatorCost op_cost;
+    op_cost.name = op->name;
+    op_cost.type = op->type;
+    if (op->layer != nullptr) {
+      std::vector<std::vector<int32_t>> input_shapes;
+      for (const auto& input_operand : op->input_operands_seq) {
+        input_shapes.push_back(input_operand->shapes);
+      }
+      op_cost.flops = op->layer->EstimateFlops(input_shapes);
+      op_cost.bytes = op->layer->EstimateBytes(input_shapes);
+    }
+    operator_costs_.push_back(op_cost);
+  }
+}
+
+const std::vector<std::shared_ptr<RuntimeOperator>>& RuntimeGraph::operators() const {
+  return this->operators_;
+}
+
+const std::vector<RuntimeOperatorCost>& RuntimeGraph::operator_costs() const {
+  return this->operator_costs_;
+}
+
+uint64_t RuntimeGraph::total_flops() const {
+  uint64_t flops = 0;
+  for (const auto& op_cost : operator_costs_) {
+    flops += op_cost.flops;
+  }
+  return flops;
+}
+
+uint64_t RuntimeGraph::total_bytes() const {
+  uint64_t bytes = 0;
+  for (const auto& op_cost : operator_costs_) {
+    bytes += op_cost.bytes;
+  }
+  return bytes;
+}
+
+void RuntimeGraph::CostSummaryLogging() const {
+  for (const auto& op_cost : operator_costs_) {
+    if (op_cost.flops == 0 && op_cost.bytes == 0) {
+      continue;
+    }
+    LOG(INFO) << "Layer name: " << op_cost.name << "\t"
+              << "layer type: " << op_cost.type << "\t"
+              << "MFLOPs: " << double(op_cost.flops) / 1e6 << "\t"
+              << "MBytes: " << double(op_cost.bytes) / 1e6 << "\t"
+              << "FLOPs/Byte: " << op_cost.intensity();
+  }
+  LOG(INFO) << "Total GFLOPs: " << double(total_flops()) / 1e9 << "\t"
+            << "Total MBytes: " << double(total_bytes()) / 1e6;
+}
+
+uint32_t RuntimeGraph::QuantizeInt8(const std::map<std::string, float>& activation_scales) {
+  CHECK(graph_state_ == GraphState::Complete) << "Graph need be build before the quantization";
+  uint32_t quantized_num = 0;
+  for (const auto& op : operators_) {
+    if (op->layer == nullptr || op->input_operands_seq.size() != 1) {
+      continue;
+    }
+    // 激活值的scale以产生该操作数的算子名称为键
+    float input_scale = 0.f;
+    const auto& scale_iter = activation_scales.find(op->input_operands_seq.front()->name);
+    if (scale_iter != activation_scales.end()) {
+      input_scale = scale_iter->second;
+    }
+    if (op->layer->QuantizeInt8(input_scale)) {
+      quantized_num += 1;
+      LOG_IF(WARNING, input_scale <= 0.f)
+          << "The operator " << op->name << " has no calibrated input scale, "
+          << "the scale will be computed at each forward";
+    }
+  }
+  LOG(INFO) << "Quantized " << quantized_num << " operators to int8";
+  return quantized_num;
+}
+
+uint32_t RuntimeGraph::QuantizeInt8(const std::string& table_path) {
+  std::map<std::string, float> activation_scales;
+  if (!Int8Calibrator::ReadTable(table_path, activation_scales)) {
+    LOG(ERROR) << "Can not read the calibration table, the graph stays in float";
+    return 0;
+  }
+  return QuantizeInt8(activation_scales);
+}
+
+void RuntimeGraph::EnableCalibration(uint32_t bin_num) {
+  calibrator_ = std::make_shared<Int8Calibrator>(bin_num);
+}
+
+void RuntimeGraph::DisableCalibration() { calibrator_.reset(); }
+
+std::shared_ptr<Int8Calibrator> RuntimeGraph::calibrator() const { return this->calibrator_; }
+
+bool RuntimeGraph::Calibrate(const std::string& input_name, const std::string& sample_dir,
+                             const std::string& table_path, CalibrationMethod method) {
+  CHECK(graph_state_ == GraphState::Complete) << "Graph need be build before the calibration";
+  const auto& input_op_iter = this->input_ops_.find(input_name);
+  if (input_op_iter == this->input_ops_.end()) {
+    LOG(ERROR) << "Can not find the input operator: " << input_name;
+    return false;
+  }
+  const auto& input_operand = input_op_iter->second->output_operands;
+  CHECK(input_operand != nullptr && input_operand->shapes.size() >= 2);
+  const uint32_t batch_size = input_operand->shapes.front();
+  const std::vector<uint32_t> sample_shapes(input_operand->shapes.begin() + 1,
+                                            input_operand->shapes.end());
+
+  std::vector<std::string> sample_paths;
+  std::error_code error_code;
+  for (const auto& entry : std::filesystem::directory_iterator(sample_dir, error_code)) {
+    if (entry.is_regular_file()) {
+      sample_paths.push_back(entry.path().string());
+    }
+  }
+  if (error_code || sample_paths.empty()) {
+    LOG(ERROR) << "Can not find calibration samples in the directory: " << sample_dir;
+    return false;
+  }
+  std::sort(sample_paths.begin(), sample_paths.end());
+
+  // 调用前没有开启标定时, 结束后关闭标定以免之后的Forward继续统计
+  const bool calibration_enabled = calibrator_ != nullptr;
+  if (!calibration_enabled) {
+    EnableCalibration();
+  }
+  const uint32_t sample_num = sample_paths.size();
+  for (uint32_t start = 0; start < sample_num; start += batch_size) {
+    // 最后一个batch不足时用本batch的第一个样本补齐, 补齐的样本不参与统计
+    const uint32_t valid_num = std::min(batch_size, sample_num - start);
+    std::vector<sftensor> inputs;
+    for (uint32_t b = 0; b < batch_size; ++b) {
+      const std::string& sample_path = sample_paths.at(start + (b < valid_num ? b : 0));
+      sftensor input = Int8Calibrator::LoadSample(sample_path, sample_shapes);
+      if (input == nullptr) {
+        calibrator_->set_sample_num(0);
+        if (!calibration_enabled) {
+          DisableCalibration();
+        }
+        return false;
+      }
+      inputs.push_back(input);
+    }
+
+    calibrator_->set_sample_num(valid_num);
+    calibrator_->Collect(input_name, inputs);
+    set_inputs(input_name, inputs);
+    Forward();
+  }
+  calibrator_->set_sample_num(0);
+  LOG(INFO) << "Calibrated " << calibrator_->histograms().size() << " operands over "
+            << sample_num << " samples";
+  const bool table_written = calibrator_->WriteTable(table_path, method);
+  if (!calibration_enabled) {
+    DisableCalibration();
+  }
+  return table_written;
+}
+
 RuntimeGraph::GraphState RuntimeGraph::graph_state() const { return this->graph_state_; }
 
 void RuntimeGraph::set_inputs(const std::string& input_name, const std::vector<sftensor>& inputs) {
   CHECK(this->graph_state_ == GraphState::Complete);
-  std::shared_ptr<RuntimeOperator> input_op;
-  for (auto op : this->input_ops_) {
-    if (op->name == input_name) {
-      input_op = op;
-      break;
-    }
-  }
-  CHECK(input_op != nullptr) << "Can not find the input operator: " << input_name;
-  PropagateLayerOutputs(input_op, inputs);
+  const auto& input_op_iter = this->input_ops_.find(input_name);
+  CHECK(input_op_iter != this->input_ops_.end())
+      << "Can not find the input operator: " << input_name;
+  input_bindings_.erase(input_name);
+  PropagateLayerOutputs(input_op_iter->second, inputs);
 }
 
 std::vector<sftensor> RuntimeGraph::get_outputs(const std::string& output_name) const {
   CHECK(this->graph_state_ == GraphState::Complete);
-  std::shared_ptr<RuntimeOperator> output_op;
-  for (auto op : this->output_ops_) {
-    if (op->name == output_name) {
-      output_op = op;
-    }
+  const auto& output_op_iter = this->output_ops_.find(output_name);
+  CHECK(output_op_iter != this->output_ops_.end())
+      << "Can not find the output operator: " << output_name;
+
+  const auto& output_layer_iter = this->output_layer_datas_.find(output_name);
+  if (output_layer_iter != this->output_layer_datas_.end()) {
+    return output_layer_iter->second;
   }
 
-  CHECK(output_op != nullptr) << "Can not find the output operator: " << output_name;
+  const std::shared_ptr<RuntimeOperator>& output_op = output_op_iter->second;
   std::vector<sftensor> outputs;
   for (const auto& input_operand : output_op->input_operands_seq) {
     std::copy(input_operand->datas.begin(), input_operand->datas.end(),
@@ -499,24 +754,194 @@ std::vector<sftensor> RuntimeGraph::get_outputs(const std::string& output_name)
   return outputs;
 }
 
-bool RuntimeGraph::is_input_op(const std::string& op_name) const {
-  for (auto op : this->input_ops_) {
-    CHECK(op != nullptr);
-    if (op->name == op_name) {
-      return true;
+void RuntimeGraph::AppendOutputLayer(const std::string& output_name,
+                                     std::shared_ptr<Layer<float>> layer) {
+  CHECK(this->graph_state_ == GraphState::Complete)
+      << "The graph need be build before appending an output layer";
+  CHECK(this->output_ops_.find(output_name) != this->output_ops_.end())
+      << "Can not find the output operator: " << output_name;
+  CHECK(layer == nullptr || output_bindings_.find(output_name) == output_bindings_.end())
+      << "Can not append a layer to the bound output: " << output_name;
+  // 输出在下一次Forward之前不再有效
+  output_layer_datas_.erase(output_name);
+  if (layer == nullptr) {
+    output_layers_.erase(output_name);
+  } else {
+    output_layers_[output_name] = std::move(layer);
+  }
+}
+
+// 去掉batch维后每个样本的形状, 补齐为channels, rows, cols
+static std::vector<uint32_t> BindingSampleShapes(const std::vector<uint32_t>& shapes,
+                                                 const std::vector<int32_t>& operand_shapes) {
+  CHECK(shapes.size() >= 2 && shapes.size() <= 4)
+      << "The bound shapes should be the batch followed by at most three dimensions";
+  CHECK_EQ(shapes.size(), operand_shapes.size()) << "The bound shapes do not match the graph";
+  for (uint32_t i = 0; i < shapes.size(); ++i) {
+    // 图中未知的维度为-1
+    CHECK(operand_shapes.at(i) <= 0 || shapes.at(i) == uint32_t(operand_shapes.at(i)))
+        << "The bound shapes do not match the graph at dim " << i;
+  }
+  std::vector<uint32_t> sample_shapes(3, 1);
+  std::copy(shapes.begin() + 1, shapes.end(), sample_shapes.end() - (shapes.size() - 1));
+  return sample_shapes;
+}
+
+// 通道是向量时两种布局的内存顺序相同
+static bool IsBindingInPlace(BufferLayout layout, const std::vector<uint32_t>& sample_shapes) {
+  return layout == BufferLayout::kColMajor || sample_shapes.at(1) == 1 ||
+         sample_shapes.at(2) == 1;
+}
+
+void RuntimeGraph::BindInput(const std::string& input_name, float* ptr,
+                             const std::vector<uint32_t>& shapes, BufferLayout layout) {
+  CHECK(this->graph_state_ == GraphState::Complete)
+      << "The graph need be build before binding an input";
+  const auto& input_op_iter = this->input_ops_.find(input_name);
+  CHECK(input_op_iter != this->input_ops_.end())
+      << "Can not find the input operator: " << input_name;
+  CHECK(ptr != nullptr) << "The memory bound to the input " << input_name << " is empty";
+  const std::shared_ptr<RuntimeOperator>& input_op = input_op_iter->second;
+  CHECK(!input_op->output_operands_seq.empty()) << "The input " << input_name << " is not used";
+
+  BufferBinding binding;
+  binding.ptr = ptr;
+  binding.layout = layout;
+  binding.sample_shapes =
+      BindingSampleShapes(shapes, input_op->output_operands_seq.front()->shapes);
+  const uint32_t batch_size = shapes.front();
+  const std::vector<uint32_t>& sample_shapes = binding.sample_shapes;
+  const size_t sample_size =
+      size_t(sample_shapes.at(0)) * sample_shapes.at(1) * sample_shapes.at(2);
+  const bool in_place = IsBindingInPlace(layout, sample_shapes);
+  for (uint32_t b = 0; b < batch_size; ++b) {
+    if (in_place) {
+      binding.tensors.push_back(std::make_shared<ftensor>(ptr + b * sample_size, sample_shapes));
+    } else {
+      binding.tensors.push_back(TensorCreate<float>(sample_shapes));
     }
   }
-  return false;
+  PropagateLayerOutputs(input_op, binding.tensors);
+
+  // 视图只需传递一次, 行优先的内存在每次Forward时转置
+  if (in_place) {
+    input_bindings_.erase(input_name);
+  } else {
+    input_bindings_[input_name] = std::move(binding);
+  }
 }
 
-bool RuntimeGraph::is_output_op(const std::string& op_name) const {
-  for (auto op : this->output_ops_) {
-    CHECK(op != nullptr);
-    if (op->name == op_name) {
-      return true;
+void RuntimeGraph::BindOutput(const std::string& output_name, float* ptr,
+                              const std::vector<uint32_t>& shapes, BufferLayout layout) {
+  CHECK(this->graph_state_ == GraphState::Complete)
+      << "The graph need be build before binding an output";
+  const auto& output_op_iter = this->output_ops_.find(output_name);
+  CHECK(output_op_iter != this->output_ops_.end())
+      << "Can not find the output operator: " << output_name;
+  const std::shared_ptr<RuntimeOperator>& output_op = output_op_iter->second;
+  CHECK_EQ(output_op->input_operands_seq.size(), 1)
+      << "Only outputs with a single input operand can be bound";
+  // operand以生成它的算子命名
+  const std::shared_ptr<RuntimeOperand>& output_operand = output_op->input_operands_seq.front();
+  const auto& producer_iter = operators_maps_.find(output_operand->name);
+  CHECK(producer_iter != operators_maps_.end())
+      << "Can not find the operator producing the output: " << output_name;
+  const std::shared_ptr<RuntimeOperator>& producer = producer_iter->second;
+  CHECK(!producer->is_graph_input && producer->output_operands != nullptr)
+      << "The output " << output_name << " is not produced by a layer";
+  std::vector<sftensor>& producer_datas = producer->output_operands->datas;
+
+  // 解除之前的绑定, 仍指向调用者内存的输出换回图自己的张量
+  const auto& binding_iter = output_bindings_.find(output_name);
+  if (binding_iter != output_bindings_.end()) {
+    const BufferBinding& old_binding = binding_iter->second;
+    for (uint32_t b = 0; b < producer_datas.size(); ++b) {
+      if (b < old_binding.tensors.size() && producer_datas.at(b) == old_binding.tensors.at(b)) {
+        producer_datas.at(b) = TensorCreate<float>(old_binding.sample_shapes);
+      }
+    }
+    output_bindings_.erase(binding_iter);
+  }
+  if (ptr == nullptr) {
+    return;
+  }
+  // 追加层的输出形状可能与图的输出不同, 不支持绑定
+  CHECK(output_layers_.find(output_name) == output_layers_.end())
+      << "Can not bind the output " << output_name << " which has an appended layer";
+
+  BufferBinding binding;
+  binding.ptr = ptr;
+  binding.layout = layout;
+  binding.sample_shapes = BindingSampleShapes(shapes, producer->output_operands->shapes);
+  const uint32_t batch_size = shapes.front();
+  CHECK_EQ(batch_size, producer_datas.size())
+      << "The bound batch size does not match the output " << output_name;
+  const std::vector<uint32_t>& sample_shapes = binding.sample_shapes;
+  const size_t sample_size =
+      size_t(sample_shapes.at(0)) * sample_shapes.at(1) * sample_shapes.at(2);
+  if (IsBindingInPlace(layout, sample_shapes)) {
+    // 生成输出的层直接写入调用者的内存
+    for (uint32_t b = 0; b < batch_size; ++b) {
+      sftensor view = std::make_shared<ftensor>(ptr + b * sample_size, sample_shapes);
+      producer_datas.at(b) = view;
+      binding.tensors.push_back(view);
+    }
+  }
+  output_bindings_[output_name] = std::move(binding);
+}
+
+void RuntimeGraph::CopyBoundInputs() {
+  for (const auto& [input_name, binding] : input_bindings_) {
+    const uint32_t channels = binding.sample_shapes.at(0);
+    const uint32_t rows = binding.sample_shapes.at(1);
+    const uint32_t cols = binding.sample_shapes.at(2);
+    const size_t planes = size_t(rows) * cols;
+    const uint32_t batch_size = binding.tensors.size();
+#pragma omp parallel for collapse(2) if (batch_size * channels > 1)
+    for (uint32_t b = 0; b < batch_size; ++b) {
+      for (uint32_t c = 0; c < channels; ++c) {
+        const float* src = binding.ptr + (size_t(b) * channels + c) * planes;
+        TransposePlane(src, rows, cols, binding.tensors.at(b)->matrix_raw_ptr(c));
+      }
     }
   }
-  return false;
+}
+
+void RuntimeGraph::CopyBoundOutputs() {
+  for (const auto& [output_name, binding] : output_bindings_) {
+    const std::vector<sftensor>& datas =
+        output_ops_.at(output_name)->input_operands_seq.front()->datas;
+    const uint32_t channels = binding.sample_shapes.at(0);
+    const uint32_t rows = binding.sample_shapes.at(1);
+    const uint32_t cols = binding.sample_shapes.at(2);
+    const size_t planes = size_t(rows) * cols;
+    const bool in_place = IsBindingInPlace(binding.layout, binding.sample_shapes);
+    for (uint32_t b = 0; b < datas.size(); ++b) {
+      const sftensor& data = datas.at(b);
+      CHECK(data != nullptr && data->shapes() == binding.sample_shapes)
+          << "The output " << output_name << " does not match the bound shapes";
+      float* dst = binding.ptr + size_t(b) * channels * planes;
+      if (in_place) {
+        // 层自行分配了输出张量时才需要拷贝
+        if (data->raw_ptr() != dst) {
+          std::copy(data->raw_ptr(), data->raw_ptr() + data->size(), dst);
+        }
+      } else {
+#pragma omp parallel for if (channels > 1)
+        for (uint32_t c = 0; c < channels; ++c) {
+          TransposePlane(data->matrix_raw_ptr(c), cols, rows, dst + c * planes);
+        }
+      }
+    }
+  }
+}
+
+bool RuntimeGraph::is_input_op(const std::string& op_name) const {
+  return this->input_ops_.find(op_name) != this->input_ops_.end();
+}
+
+bool RuntimeGraph::is_output_op(const std::string& op_name) const {
+  return this->output_ops_.find(op_name) != this->output_ops_.end();
 }
 
 }  // namespace kuiper_infer
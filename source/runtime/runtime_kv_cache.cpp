@@ -0,0 +1,139 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "runtime/runtime_kv_cache.hpp"
+#include <glog/logging.h>
+
+namespace kuiper_infer {
+KVCache::KVCache(uint32_t layer_num, uint32_t head_num, uint32_t head_dim, uint32_t block_size,
+                 uint32_t block_num)
+    : layer_num_(layer_num),
+      head_num_(head_num),
+      head_dim_(head_dim),
+      block_size_(block_size),
+      block_num_(block_num) {
+  CHECK(layer_num > 0 && head_num > 0 && head_dim > 0)
+      << "The kv cache needs at least one layer, head and head dimension";
+  CHECK(block_size > 0 && block_num > 0) << "The kv cache needs at least one block";
+  // 每个block依次存放所有层和所有头的key和value
+  pool_.resize(size_t(block_num) * layer_num * head_num * 2 * block_size * head_dim);
+  free_blocks_.reserve(block_num);
+  // 倒序入栈, 先分配编号小的block
+  for (uint32_t b = block_num; b > 0; --b) {
+    free_blocks_.push_back(b - 1);
+  }
+}
+
+int32_t KVCache::AddSequence() {
+  for (uint32_t i = 0; i < sequences_.size(); ++i) {
+    if (!sequences_.at(i).active) {
+      sequences_.at(i).active = true;
+      return int32_t(i);
+    }
+  }
+  Sequence sequence;
+  sequence.active = true;
+  sequences_.push_back(std::move(sequence));
+  return int32_t(sequences_.size() - 1);
+}
+
+void KVCache::FreeSequence(int32_t seq_id) {
+  Truncate(seq_id, 0);
+  sequences_.at(seq_id).active = false;
+}
+
+bool KVCache::Extend(int32_t seq_id, uint32_t tokens) {
+  CheckSequence(seq_id);
+  Sequence& seq = sequences_.at(seq_id);
+  const uint32_t length = seq.length + tokens;
+  const uint32_t need_blocks = (length + block_size_ - 1) / block_size_;
+  CHECK_GE(need_blocks, seq.blocks.size());
+  const uint32_t new_blocks = need_blocks - seq.blocks.size();
+  if (new_blocks > free_blocks_.size()) {
+    LOG(ERROR) << "The kv cache has " << free_blocks_.size() << " free blocks, " << new_blocks
+               << " blocks are needed";
+    return false;
+  }
+  for (uint32_t i = 0; i < new_blocks; ++i) {
+    seq.blocks.push_back(free_blocks_.back());
+    free_blocks_.pop_back();
+  }
+  seq.length = length;
+  return true;
+}
+
+void KVCache::Truncate(int32_t seq_id, uint32_t length) {
+  CheckSequence(seq_id);
+  Sequence& seq = sequences_.at(seq_id);
+  CHECK_LE(length, seq.length) << "The kv cache can not truncate a sequence to a larger length";
+  const uint32_t need_blocks = (length + block_size_ - 1) / block_size_;
+  while (seq.blocks.size() > need_blocks) {
+    free_blocks_.push_back(seq.blocks.back());
+    seq.blocks.pop_back();
+  }
+  seq.length = length;
+}
+
+uint32_t KVCache::length(int32_t seq_id) const {
+  CheckSequence(seq_id);
+  return sequences_.at(seq_id).length;
+}
+
+void KVCache::CheckSequence(int32_t seq_id) const {
+  CHECK(seq_id >= 0 && seq_id < int32_t(sequences_.size()) && sequences_.at(seq_id).active)
+      << "The sequence " << seq_id << " is not in the kv cache";
+}
+
+size_t KVCache::BlockOffset(uint32_t block, uint32_t layer, uint32_t head) const {
+  CHECK(layer < layer_num_ && head < head_num_);
+  return ((size_t(block) * layer_num_ + layer) * head_num_ + head) * 2 * block_size_ * head_dim_;
+}
+
+size_t KVCache::TokenOffset(int32_t seq_id, uint32_t layer, uint32_t head, uint32_t pos) const {
+  CheckSequence(seq_id);
+  const Sequence& seq = sequences_.at(seq_id);
+  CHECK_LT(pos, seq.length) << "The position is out of the sequence " << seq_id;
+  return BlockOffset(seq.blocks[pos / block_size_], layer, head) +
+         size_t(pos % block_size_) * head_dim_;
+}
+
+float* KVCache::key(int32_t seq_id, uint32_t layer, uint32_t head, uint32_t pos) {
+  return pool_.data() + TokenOffset(seq_id, layer, head, pos);
+}
+
+float* KVCache::value(int32_t seq_id, uint32_t layer, uint32_t head, uint32_t pos) {
+  return key(seq_id, layer, head, pos) + size_t(block_size_) * head_dim_;
+}
+
+const float* KVCache::key_block(int32_t seq_id, uint32_t layer, uint32_t head,
+                                uint32_t block) const {
+  CheckSequence(seq_id);
+  const Sequence& seq = sequences_.at(seq_id);
+  CHECK_LT(block, seq.blocks.size()) << "The block is out of the sequence " << seq_id;
+  return pool_.data() + BlockOffset(seq.blocks[block], layer, head);
+}
+
+const float* KVCache::value_block(int32_t seq_id, uint32_t layer, uint32_t head,
+                                  uint32_t block) const {
+  return key_block(seq_id, layer, head, block) + size_t(block_size_) * head_dim_;
+}
+
+}  // namespace kuiper_infer
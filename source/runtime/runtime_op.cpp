@@ -21,6 +21,8 @@
 
 // Created by fss on 23-2-27.
 #include "runtime/runtime_op.hpp"
+#include <algorithm>
+#include <unordered_set>
 #include "data/tensor_util.hpp"
 
 namespace kuiper_infer {
@@ -182,4 +184,134 @@ void RuntimeOperatorUtils<float>::InitOperatorOutput(
   }
 }
 
+static bool IsViewOperator(const std::shared_ptr<RuntimeOperator>& op) {
+  return op->type == "Tensor.view" || op->type == "torch.flatten";
+}
+
+void RuntimeOperatorUtils<float>::ExtendViewLifetimes(
+    const std::vector<std::shared_ptr<RuntimeOperator>>& operators) {
+  std::unordered_map<std::string, std::shared_ptr<RuntimeOperator>> operators_map;
+  for (const auto& op : operators) {
+    operators_map.insert({op->name, op});
+  }
+
+  // 逆序处理, 连续的view先延长后一个view的生命周期
+  for (auto op_iter = operators.rbegin(); op_iter != operators.rend(); ++op_iter) {
+    const auto& op = *op_iter;
+    if (!IsViewOperator(op)) {
+      continue;
+    }
+    for (const auto& input_operand : op->input_operands_seq) {
+      const auto& producer_iter = operators_map.find(input_operand->name);
+      if (producer_iter != operators_map.end()) {
+        const auto& producer = producer_iter->second;
+        producer->end_time = std::max(producer->end_time, op->end_time);
+      }
+    }
+  }
+}
+
+static bool IsChannelConcat(const std::shared_ptr<RuntimeOperator>& op) {
+  if (op->type != "torch.cat" || !op->has_parameter("dim")) {
+    return false;
+  }
+  auto dim_param = std::dynamic_pointer_cast<RuntimeParameterInt>(op->params.at("dim"));
+  if (dim_param == nullptr || (dim_param->value != 1 && dim_param->value != -3)) {
+    return false;
+  }
+  return op->output_operands != nullptr && op->output_operands->shapes.size() == 4 &&
+         !op->input_operands_seq.empty();
+}
+
+uint32_t RuntimeOperatorUtils<float>::PlanConcatOutputs(
+    const std::vector<std::shared_ptr<RuntimeOperator>>& operators) {
+  std::unordered_map<std::string, std::shared_ptr<RuntimeOperator>> operators_map;
+  for (const auto& op : operators) {
+    operators_map.insert({op->name, op});
+  }
+
+  uint32_t planned_num = 0;
+  // 已经被规划为另一个拼接输出切片的算子
+  std::unordered_set<const RuntimeOperator*> sliced_ops;
+  // 逆序处理, 嵌套的拼接先确定外层的输出位置
+  for (int32_t i = int32_t(operators.size()) - 1; i >= 0; --i) {
+    const auto& cat_op = operators.at(i);
+    if (!IsChannelConcat(cat_op)) {
+      continue;
+    }
+
+    const std::vector<int32_t>& cat_shapes = cat_op->output_operands->shapes;
+    const uint32_t batch = cat_shapes.at(0);
+    const uint32_t plane_size = cat_shapes.at(2) * cat_shapes.at(3);
+    std::vector<std::shared_ptr<RuntimeOperator>> producers;
+    std::unordered_set<std::string> producer_names;
+    for (const auto& input_operand : cat_op->input_operands_seq) {
+      std::shared_ptr<RuntimeOperator> producer;
+      const auto& producer_iter = operators_map.find(input_operand->name);
+      // 同一个输入出现多次时只能拷贝
+      if (producer_iter != operators_map.end() &&
+          producer_names.insert(input_operand->name).second) {
+        producer = producer_iter->second;
+      }
+      // 输出还被其他算子使用的节点不能写入拼接的输出, view的输出在执行时才确定
+      if (producer != nullptr &&
+          (producer->is_graph_input || IsViewOperator(producer) ||
+           producer->output_operands_seq.size() != 1 ||
+           producer->output_operands == nullptr ||
+           producer->output_operands->datas.size() != batch ||
+           producer->output_operands->shapes.size() != 4 ||
+           producer->output_operands->shapes.at(2) != cat_shapes.at(2) ||
+           producer->output_operands->shapes.at(3) != cat_shapes.at(3))) {
+        producer = nullptr;
+      }
+      producers.push_back(producer);
+    }
+    if (std::all_of(producers.begin(), producers.end(),
+                    [](const auto& producer) { return producer == nullptr; })) {
+      continue;
+    }
+
+    // 输入在拼接执行之前就写入输出, 因此输出不能与之前执行的算子共用内存
+    if (sliced_ops.find(cat_op.get()) == sliced_ops.end()) {
+      const float* cat_ptr = cat_op->output_operands->datas.front()->raw_ptr();
+      bool shared = false;
+      for (int32_t j = 0; j < i && !shared; ++j) {
+        const auto& prev_output = operators.at(j)->output_operands;
+        shared = prev_output != nullptr && !prev_output->datas.empty() &&
+                 prev_output->datas.front() != nullptr &&
+                 prev_output->datas.front()->raw_ptr() == cat_ptr;
+      }
+      if (shared) {
+        for (uint32_t b = 0; b < batch; ++b) {
+          cat_op->output_operands->datas.at(b) = CreateTensor(cat_shapes);
+        }
+      }
+    }
+
+    uint32_t channel_offset = 0;
+    for (uint32_t k = 0; k < producers.size(); ++k) {
+      const std::vector<int32_t>& input_shapes = cat_op->input_operands_seq.at(k)->shapes;
+      CHECK_EQ(input_shapes.size(), 4);
+      const uint32_t in_channels = input_shapes.at(1);
+      const auto& producer = producers.at(k);
+      if (producer != nullptr) {
+        std::vector<sftensor>& producer_datas = producer->output_operands->datas;
+        for (uint32_t b = 0; b < batch; ++b) {
+          const sftensor& cat_output = cat_op->output_operands->datas.at(b);
+          producer_datas.at(b) = std::make_shared<ftensor>(
+              cat_output->raw_ptr(size_t(channel_offset) * plane_size),
+              std::vector<uint32_t>{in_channels, uint32_t(cat_shapes.at(2)),
+                                    uint32_t(cat_shapes.at(3))});
+        }
+        sliced_ops.insert(producer.get());
+        planned_num += 1;
+      }
+      channel_offset += in_channels;
+    }
+    CHECK_EQ(channel_offset, cat_shapes.at(1))
+        << "The input channels of the concatenation " << cat_op->name << " do not match";
+  }
+  return planned_num;
+}
+
 }  // namespace kuiper_infer
@@ -0,0 +1,122 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "runtime/runtime_pipeline.hpp"
+#include <glog/logging.h>
+#include <stdexcept>
+#include <utility>
+#include "data/tensor_util.hpp"
+
+namespace kuiper_infer {
+
+RuntimePipeline::RuntimePipeline(std::shared_ptr<RuntimeGraph> graph, std::string input_name,
+                                 std::string output_name, size_t queue_capacity)
+    : graph_(std::move(graph)),
+      input_name_(std::move(input_name)),
+      output_name_(std::move(output_name)),
+      pre_process_queue_(queue_capacity),
+      compute_queue_(queue_capacity),
+      post_process_queue_(queue_capacity) {
+  CHECK(graph_ != nullptr) << "The graph of the pipeline is empty";
+  // 状态为0时执行图已经构建完成
+  CHECK_EQ(int32_t(graph_->graph_state()), 0)
+      << "The graph need be build before creating a pipeline";
+  CHECK(graph_->is_input_op(input_name_)) << "Can not find the input operator: " << input_name_;
+  CHECK(graph_->is_output_op(output_name_))
+      << "Can not find the output operator: " << output_name_;
+  pre_process_thread_ = std::thread(&RuntimePipeline::PreProcessLoop, this);
+  compute_thread_ = std::thread(&RuntimePipeline::ComputeLoop, this);
+  post_process_thread_ = std::thread(&RuntimePipeline::PostProcessLoop, this);
+}
+
+RuntimePipeline::~RuntimePipeline() {
+  // 每个阶段处理完队列中剩余的请求后关闭下一个队列
+  pre_process_queue_.Close();
+  pre_process_thread_.join();
+  compute_thread_.join();
+  post_process_thread_.join();
+}
+
+std::future<std::vector<sftensor>> RuntimePipeline::Submit(PreProcess pre_process,
+                                                           PostProcess post_process) {
+  CHECK(pre_process != nullptr) << "The pre process of a pipeline request is empty";
+  auto task = std::make_unique<Task>();
+  task->pre_process = std::move(pre_process);
+  task->post_process = std::move(post_process);
+  std::future<std::vector<sftensor>> result = task->promise.get_future();
+  if (!pre_process_queue_.Push(std::move(task))) {
+    task->promise.set_exception(
+        std::make_exception_ptr(std::runtime_error("The pipeline has been stopped")));
+  }
+  return result;
+}
+
+void RuntimePipeline::PreProcessLoop() {
+  std::unique_ptr<Task> task;
+  while (pre_process_queue_.Pop(task)) {
+    try {
+      task->tensors = task->pre_process();
+    } catch (...) {
+      task->promise.set_exception(std::current_exception());
+      continue;
+    }
+    compute_queue_.Push(std::move(task));
+  }
+  compute_queue_.Close();
+}
+
+void RuntimePipeline::ComputeLoop() {
+  std::unique_ptr<Task> task;
+  while (compute_queue_.Pop(task)) {
+    try {
+      graph_->set_inputs(input_name_, task->tensors);
+      graph_->Forward(false);
+      // 输出的内存在下一次Forward中会被复用, 交给后处理线程之前先拷贝
+      const std::vector<sftensor>& outputs = graph_->get_outputs(output_name_);
+      task->tensors.clear();
+      for (const sftensor& output : outputs) {
+        task->tensors.push_back(TensorClone(output));
+      }
+    } catch (...) {
+      task->promise.set_exception(std::current_exception());
+      continue;
+    }
+    post_process_queue_.Push(std::move(task));
+  }
+  post_process_queue_.Close();
+}
+
+void RuntimePipeline::PostProcessLoop() {
+  std::unique_ptr<Task> task;
+  while (post_process_queue_.Pop(task)) {
+    try {
+      if (task->post_process != nullptr) {
+        task->promise.set_value(task->post_process(task->tensors));
+      } else {
+        task->promise.set_value(std::move(task->tensors));
+      }
+    } catch (...) {
+      task->promise.set_exception(std::current_exception());
+    }
+  }
+}
+
+}  // namespace kuiper_infer
@@ -0,0 +1,154 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "runtime/runtime_stream.hpp"
+#include <glog/logging.h>
+#include <utility>
+#include "data/tensor_util.hpp"
+#include "utils/time/profiler.hpp"
+
+namespace kuiper_infer {
+
+RuntimeStreamSession::RuntimeStreamSession(std::shared_ptr<RuntimeGraph> graph,
+                                           std::string input_name, std::string output_name,
+                                           const std::vector<uint32_t>& shapes)
+    : graph_(std::move(graph)),
+      input_name_(std::move(input_name)),
+      output_name_(std::move(output_name)) {
+  CHECK(graph_ != nullptr) << "The graph of the stream session is empty";
+  // 状态为0时执行图已经构建完成
+  CHECK_EQ(int32_t(graph_->graph_state()), 0)
+      << "The graph need be build before creating a stream session";
+  CHECK(graph_->is_input_op(input_name_)) << "Can not find the input operator: " << input_name_;
+  CHECK(graph_->is_output_op(output_name_))
+      << "Can not find the output operator: " << output_name_;
+  CHECK(shapes.size() >= 2 && shapes.size() <= 4)
+      << "The input shapes should be the batch followed by at most three dimensions";
+  for (const auto& op : graph_->operators()) {
+    if (op->name != input_name_) {
+      continue;
+    }
+    CHECK(!op->output_operands_seq.empty()) << "The input " << input_name_ << " is not used";
+    const std::vector<int32_t>& operand_shapes = op->output_operands_seq.front()->shapes;
+    CHECK_EQ(shapes.size(), operand_shapes.size())
+        << "The input shapes do not match the graph input " << input_name_;
+    for (uint32_t i = 0; i < shapes.size(); ++i) {
+      // 图中未知的维度为-1
+      CHECK(operand_shapes.at(i) <= 0 || shapes.at(i) == uint32_t(operand_shapes.at(i)))
+          << "The input shapes do not match the graph input " << input_name_ << " at dim " << i;
+    }
+  }
+
+  const std::vector<uint32_t> sample_shapes(shapes.begin() + 1, shapes.end());
+  for (auto& input_buffer : input_buffers_) {
+    for (uint32_t b = 0; b < shapes.front(); ++b) {
+      input_buffer.push_back(TensorCreate<float>(sample_shapes));
+    }
+  }
+  worker_ = std::thread(&RuntimeStreamSession::WorkerLoop, this);
+}
+
+RuntimeStreamSession::~RuntimeStreamSession() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    frame_finished_.wait(lock, [this] { return !running_; });
+    stopped_ = true;
+  }
+  frame_submitted_.notify_one();
+  worker_.join();
+}
+
+const std::vector<sftensor>& RuntimeStreamSession::input() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return input_buffers_[write_index_];
+}
+
+void RuntimeStreamSession::Submit() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    frame_finished_.wait(lock, [this] { return !running_; });
+    // 写好的缓冲区交给工作线程, 调用者之后写入另一个
+    write_index_ ^= 1;
+    running_ = true;
+    submit_ns_ = utils::Profiler::NowNs();
+  }
+  frame_submitted_.notify_one();
+}
+
+const std::vector<sftensor>& RuntimeStreamSession::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  frame_finished_.wait(lock, [this] { return !running_; });
+  if (error_ != nullptr) {
+    std::exception_ptr error = error_;
+    error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+  return outputs_;
+}
+
+uint64_t RuntimeStreamSession::frame_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frame_count_;
+}
+
+const utils::LatencyHistogram& RuntimeStreamSession::latency() const { return latency_; }
+
+void RuntimeStreamSession::WorkerLoop() {
+  while (true) {
+    uint32_t run_index = 0;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      frame_submitted_.wait(lock, [this] { return running_ || stopped_; });
+      if (stopped_) {
+        return;
+      }
+      run_index = write_index_ ^ 1;
+    }
+
+    // 两个缓冲区的张量是固定的, set_inputs只传递指针
+    std::vector<sftensor> outputs;
+    std::exception_ptr error;
+    try {
+      graph_->set_inputs(input_name_, input_buffers_[run_index]);
+      graph_->Forward(false);
+      outputs = graph_->get_outputs(output_name_);
+    } catch (...) {
+      // 异常留给Wait重新抛出, 不能让它终止工作线程
+      error = std::current_exception();
+    }
+    const int64_t finish_ns = utils::Profiler::NowNs();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      outputs_ = std::move(outputs);
+      if (error != nullptr) {
+        error_ = error;
+      } else {
+        latency_.Record(finish_ns - submit_ns_);
+        frame_count_ += 1;
+      }
+      running_ = false;
+    }
+    frame_finished_.notify_all();
+  }
+}
+
+}  // namespace kuiper_infer
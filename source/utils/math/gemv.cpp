@@ -0,0 +1,105 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "utils/math/gemv.hpp"
+#include <glog/logging.h>
+#include "utils/math/simd_reduce.hpp"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+#define KUIPER_GEMV_SIMD
+#endif
+
+namespace kuiper_infer {
+namespace math {
+/// Output rows computed together, they share every load of the input vector
+constexpr uint32_t kGemvRowTile = 4;
+/// Distance of the software prefetch in floats, 8 cache lines ahead
+constexpr uint32_t kGemvPrefetchDistance = 128;
+
+/**
+ * 计算RT行权重与输入向量的点积
+ *
+ * 每行使用两个累加器交替累加, 隐藏FMA的延迟; 权重只读一次, 提前预取后面的缓存行.
+ */
+template <uint32_t RT>
+static inline void GemvTile(const float* weight, uint32_t depth, const float* input,
+                            float (&result)[RT]) {
+  uint32_t k = 0;
+#ifdef KUIPER_GEMV_SIMD
+  __m256 acc0[RT];
+  __m256 acc1[RT];
+  for (uint32_t r = 0; r < RT; ++r) {
+    acc0[r] = _mm256_setzero_ps();
+    acc1[r] = _mm256_setzero_ps();
+  }
+  for (; k + 16 <= depth; k += 16) {
+    const __m256 x0 = _mm256_loadu_ps(input + k);
+    const __m256 x1 = _mm256_loadu_ps(input + k + 8);
+    for (uint32_t r = 0; r < RT; ++r) {
+      const float* weight_row = weight + size_t(r) * depth + k;
+      _mm_prefetch(reinterpret_cast<const char*>(weight_row + kGemvPrefetchDistance),
+                   _MM_HINT_T0);
+      acc0[r] = _mm256_fmadd_ps(_mm256_loadu_ps(weight_row), x0, acc0[r]);
+      acc1[r] = _mm256_fmadd_ps(_mm256_loadu_ps(weight_row + 8), x1, acc1[r]);
+    }
+  }
+  for (uint32_t r = 0; r < RT; ++r) {
+    result[r] = HorizontalSum(_mm256_add_ps(acc0[r], acc1[r]));
+  }
+#else
+  for (uint32_t r = 0; r < RT; ++r) {
+    result[r] = 0.f;
+  }
+#endif
+  for (; k < depth; ++k) {
+    for (uint32_t r = 0; r < RT; ++r) {
+      result[r] += weight[size_t(r) * depth + k] * input[k];
+    }
+  }
+}
+
+void Gemv(const float* weight, uint32_t rows, uint32_t depth, const float* input,
+          const float* bias, float* output) {
+  CHECK(weight != nullptr && input != nullptr && output != nullptr);
+  const uint32_t tiles = rows / kGemvRowTile;
+  // 静态调度使每个线程读取一段连续的权重行
+  const bool parallel = uint64_t(rows) * depth > (1 << 15);
+#pragma omp parallel for schedule(static) if (parallel)
+  for (uint32_t t = 0; t < tiles; ++t) {
+    const uint32_t n = t * kGemvRowTile;
+    float result[kGemvRowTile];
+    GemvTile<kGemvRowTile>(weight + size_t(n) * depth, depth, input, result);
+    for (uint32_t r = 0; r < kGemvRowTile; ++r) {
+      output[n + r] = result[r] + (bias != nullptr ? bias[n + r] : 0.f);
+    }
+  }
+  for (uint32_t n = tiles * kGemvRowTile; n < rows; ++n) {
+    float result[1];
+    GemvTile<1>(weight + size_t(n) * depth, depth, input, result);
+    output[n] = result[0] + (bias != nullptr ? bias[n] : 0.f);
+  }
+}
+
+}  // namespace math
+}  // namespace kuiper_infer
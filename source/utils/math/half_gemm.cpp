@@ -0,0 +1,185 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "utils/math/half_gemm.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include "utils/math/simd_reduce.hpp"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__) && defined(__F16C__) && defined(__FMA__)
+#define KUIPER_HALF_SIMD
+#endif
+
+namespace kuiper_infer {
+namespace math {
+/// Rows of the activation matrix processed by one task
+constexpr uint32_t kHalfRowBlock = 64;
+/// Output channels processed by one task
+constexpr uint32_t kHalfChannelBlock = 16;
+
+void ConvertWeightToHalf(const float* weight, uint32_t rows, uint32_t depth, RuntimeDataType type,
+                         HalfWeight& converted) {
+  CHECK(weight != nullptr);
+  CHECK(rows > 0 && depth > 0) << "The weight to be converted is empty";
+  CHECK(IsHalfType(type)) << "Unsupported 16 bit weight type: " << int32_t(type);
+  converted.type = type;
+  converted.rows = rows;
+  converted.depth = depth;
+  converted.data.resize(size_t(rows) * depth);
+  const size_t size = converted.data.size();
+#pragma omp parallel for if (size > (1 << 16))
+  for (size_t i = 0; i < size; ++i) {
+    converted.data[i] = FloatToHalf(weight[i], type);
+  }
+}
+
+#ifdef KUIPER_HALF_SIMD
+template <RuntimeDataType type>
+static inline __m256 LoadHalf8(const uint16_t* ptr) {
+  const __m128i half8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+  if constexpr (type == RuntimeDataType::kTypeFloat16) {
+    return _mm256_cvtph_ps(half8);
+  } else {
+    // bfloat16就是float的高16位
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(half8), 16));
+  }
+}
+#endif
+
+template <RuntimeDataType type, uint32_t MR, uint32_t NR>
+static inline void HalfGemmTile(const float* input, uint32_t rows, uint32_t m,
+                                const HalfWeight& weight, uint32_t n, uint32_t weight_begin,
+                                const float* bias, float* output) {
+  const uint32_t depth = weight.depth;
+  const float* input_rows = input + size_t(m) * depth;
+  const uint16_t* weight_rows = weight.data.data() + size_t(n) * depth;
+  float acc[MR][NR];
+  uint32_t k = 0;
+#ifdef KUIPER_HALF_SIMD
+  __m256 acc8[MR][NR];
+  for (uint32_t i = 0; i < MR; ++i) {
+    for (uint32_t j = 0; j < NR; ++j) {
+      acc8[i][j] = _mm256_setzero_ps();
+    }
+  }
+  for (; k + 8 <= depth; k += 8) {
+    // 每组权重只转换一次, 供MR行激活复用
+    __m256 b[NR];
+    for (uint32_t j = 0; j < NR; ++j) {
+      b[j] = LoadHalf8<type>(weight_rows + j * depth + k);
+    }
+    for (uint32_t i = 0; i < MR; ++i) {
+      const __m256 a = _mm256_loadu_ps(input_rows + i * depth + k);
+      for (uint32_t j = 0; j < NR; ++j) {
+        acc8[i][j] = _mm256_fmadd_ps(a, b[j], acc8[i][j]);
+      }
+    }
+  }
+  for (uint32_t i = 0; i < MR; ++i) {
+    for (uint32_t j = 0; j < NR; ++j) {
+      acc[i][j] = HorizontalSum(acc8[i][j]);
+    }
+  }
+#else
+  for (uint32_t i = 0; i < MR; ++i) {
+    for (uint32_t j = 0; j < NR; ++j) {
+      acc[i][j] = 0.f;
+    }
+  }
+#endif
+  for (; k < depth; ++k) {
+    for (uint32_t j = 0; j < NR; ++j) {
+      const float b = HalfToFloat(weight_rows[j * depth + k], type);
+      for (uint32_t i = 0; i < MR; ++i) {
+        acc[i][j] += input_rows[i * depth + k] * b;
+      }
+    }
+  }
+
+  for (uint32_t j = 0; j < NR; ++j) {
+    const float bias_value = bias != nullptr ? bias[n + j] : 0.f;
+    float* output_channel = output + size_t(n + j - weight_begin) * rows + m;
+    for (uint32_t i = 0; i < MR; ++i) {
+      output_channel[i] = acc[i][j] + bias_value;
+    }
+  }
+}
+
+template <RuntimeDataType type>
+static void HalfGemmImpl(const float* input, uint32_t rows, const HalfWeight& weight,
+                         uint32_t weight_begin, uint32_t weight_end, const float* bias,
+                         float* output) {
+  const uint32_t channels = weight_end - weight_begin;
+  const uint32_t row_blocks = (rows + kHalfRowBlock - 1) / kHalfRowBlock;
+  const uint32_t channel_blocks = (channels + kHalfChannelBlock - 1) / kHalfChannelBlock;
+
+  const bool parallel = uint64_t(rows) * channels * weight.depth > (1 << 18);
+#pragma omp parallel for collapse(2) if (parallel)
+  for (uint32_t rb = 0; rb < row_blocks; ++rb) {
+    for (uint32_t cb = 0; cb < channel_blocks; ++cb) {
+      const uint32_t m_begin = rb * kHalfRowBlock;
+      const uint32_t m_end = std::min(m_begin + kHalfRowBlock, rows);
+      const uint32_t n_begin = weight_begin + cb * kHalfChannelBlock;
+      const uint32_t n_end = std::min(n_begin + kHalfChannelBlock, weight_end);
+
+      uint32_t n = n_begin;
+      for (; n + 4 <= n_end; n += 4) {
+        uint32_t m = m_begin;
+        for (; m + 2 <= m_end; m += 2) {
+          HalfGemmTile<type, 2, 4>(input, rows, m, weight, n, weight_begin, bias, output);
+        }
+        for (; m < m_end; ++m) {
+          HalfGemmTile<type, 1, 4>(input, rows, m, weight, n, weight_begin, bias, output);
+        }
+      }
+      for (; n < n_end; ++n) {
+        for (uint32_t m = m_begin; m < m_end; ++m) {
+          HalfGemmTile<type, 1, 1>(input, rows, m, weight, n, weight_begin, bias, output);
+        }
+      }
+    }
+  }
+}
+
+void HalfGemm(const float* input, uint32_t rows, const HalfWeight& weight, uint32_t weight_begin,
+              uint32_t weight_end, const float* bias, float* output) {
+  CHECK(input != nullptr && output != nullptr);
+  CHECK(!weight.empty()) << "The 16 bit float weight is empty";
+  CHECK(weight_begin < weight_end && weight_end <= weight.rows)
+      << "The output channel range is out of the 16 bit float weight";
+  CHECK_EQ(weight.data.size(), size_t(weight.rows) * weight.depth);
+
+  if (weight.type == RuntimeDataType::kTypeBFloat16) {
+    HalfGemmImpl<RuntimeDataType::kTypeBFloat16>(input, rows, weight, weight_begin, weight_end,
+                                                  bias, output);
+  } else {
+    CHECK(weight.type == RuntimeDataType::kTypeFloat16)
+        << "Unsupported 16 bit weight type: " << int32_t(weight.type);
+    HalfGemmImpl<RuntimeDataType::kTypeFloat16>(input, rows, weight, weight_begin, weight_end,
+                                                 bias, output);
+  }
+}
+
+}  // namespace math
+}  // namespace kuiper_infer
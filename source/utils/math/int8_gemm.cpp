@@ -0,0 +1,287 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "utils/math/int8_gemm.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "utils/math/simd_reduce.hpp"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#if defined(__AVXVNNI__) || (defined(__AVX512VNNI__) && defined(__AVX512VL__))
+#define KUIPER_INT8_VNNI
+#endif
+
+namespace kuiper_infer {
+namespace math {
+/// Rows of the activation matrix processed by one task
+constexpr uint32_t kInt8RowBlock = 64;
+/// Output channels processed by one task
+constexpr uint32_t kInt8ChannelBlock = 16;
+
+static inline int8_t QuantizeValue(float value, float inv_scale) {
+  const long quantized = std::lrint(value * inv_scale);
+  return static_cast<int8_t>(std::clamp(quantized, long(-kInt8Max), long(kInt8Max)));
+}
+
+void QuantizeWeightPerChannel(const float* weight, uint32_t rows, uint32_t depth,
+                              Int8Weight& quantized) {
+  CHECK(weight != nullptr);
+  CHECK(rows > 0 && depth > 0) << "The weight to be quantized is empty";
+  quantized.rows = rows;
+  quantized.depth = depth;
+  quantized.packed_depth = Int8PackedDepth(depth);
+  quantized.data.assign(size_t(rows) * quantized.packed_depth, 0);
+  quantized.scales.resize(rows);
+  quantized.row_sums.resize(rows);
+
+#pragma omp parallel for
+  for (uint32_t n = 0; n < rows; ++n) {
+    const float* weight_row = weight + size_t(n) * depth;
+    int8_t* quantized_row = quantized.data.data() + size_t(n) * quantized.packed_depth;
+    const float scale = Int8Scale(AbsMax(weight_row, depth));
+    const float inv_scale = 1.f / scale;
+    int32_t row_sum = 0;
+    for (uint32_t k = 0; k < depth; ++k) {
+      quantized_row[k] = QuantizeValue(weight_row[k], inv_scale);
+      row_sum += quantized_row[k];
+    }
+    quantized.scales.at(n) = scale;
+    quantized.row_sums.at(n) = row_sum;
+  }
+}
+
+float AbsMax(const float* data, size_t size) {
+  CHECK(data != nullptr || size == 0);
+  size_t index = 0;
+  float abs_max = 0.f;
+#ifdef __AVX2__
+  const __m256 sign_mask = _mm256_set1_ps(-0.f);
+  __m256 abs_max8 = _mm256_setzero_ps();
+  for (; index + 8 <= size; index += 8) {
+    abs_max8 = _mm256_max_ps(abs_max8, _mm256_andnot_ps(sign_mask, _mm256_loadu_ps(data + index)));
+  }
+  __m128 abs_max4 =
+      _mm_max_ps(_mm256_castps256_ps128(abs_max8), _mm256_extractf128_ps(abs_max8, 1));
+  abs_max4 = _mm_max_ps(abs_max4, _mm_movehl_ps(abs_max4, abs_max4));
+  abs_max4 = _mm_max_ss(abs_max4, _mm_shuffle_ps(abs_max4, abs_max4, 1));
+  abs_max = _mm_cvtss_f32(abs_max4);
+#endif
+  for (; index < size; ++index) {
+    abs_max = std::max(abs_max, std::fabs(data[index]));
+  }
+  return abs_max;
+}
+
+void QuantizeActivation(const float* src, uint32_t rows, uint32_t depth, size_t row_stride,
+                        size_t depth_stride, float scale, int8_t* dst) {
+  CHECK(src != nullptr && dst != nullptr);
+  CHECK_GT(scale, 0.f) << "The quantization scale should be greater than zero";
+  const uint32_t packed_depth = Int8PackedDepth(depth);
+  const float inv_scale = 1.f / scale;
+
+#pragma omp parallel for if (size_t(rows) * depth > (1 << 16))
+  for (uint32_t m = 0; m < rows; ++m) {
+    const float* src_row = src + m * row_stride;
+    int8_t* dst_row = dst + size_t(m) * packed_depth;
+    uint32_t k = 0;
+    if (depth_stride == 1) {
+#ifdef __AVX2__
+      const __m256 inv_scale8 = _mm256_set1_ps(inv_scale);
+      const __m256i min8 = _mm256_set1_epi8(-kInt8Max);
+      const __m256i lane_order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+      for (; k + 32 <= depth; k += 32) {
+        // cvtps按照默认的舍入模式(四舍六入五取偶)转换, 与lrint一致
+        const __m256i q0 =
+            _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(src_row + k), inv_scale8));
+        const __m256i q1 =
+            _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(src_row + k + 8), inv_scale8));
+        const __m256i q2 =
+            _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(src_row + k + 16), inv_scale8));
+        const __m256i q3 =
+            _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(src_row + k + 24), inv_scale8));
+        // packs按128位通道交错, 需要重新排列为原始的顺序
+        __m256i q = _mm256_packs_epi16(_mm256_packs_epi32(q0, q1), _mm256_packs_epi32(q2, q3));
+        q = _mm256_permutevar8x32_epi32(_mm256_max_epi8(q, min8), lane_order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_row + k), q);
+      }
+#endif
+    }
+    for (; k < depth; ++k) {
+      dst_row[k] = QuantizeValue(src_row[k * depth_stride], inv_scale);
+    }
+    if (packed_depth > depth) {
+      std::memset(dst_row + depth, 0, packed_depth - depth);
+    }
+  }
+}
+
+/**
+ * 计算MR行激活与NR行权重的点积, 结果为int32
+ *
+ * VNNI的vpdpbusd要求一侧为无符号数, 所以激活值加上128转为uint8,
+ * 多出的128 * sum(weight)在之后用row_sums扣除.
+ * 在只有AVX2时, vpmaddubsw的int16中间结果会饱和, 因此扩展为int16后用vpmaddwd累加.
+ */
+template <uint32_t MR, uint32_t NR>
+static inline void Int8DotTile(const int8_t* input, const int8_t* weight, uint32_t packed_depth,
+                               int32_t (&acc)[MR][NR]) {
+#if defined(KUIPER_INT8_VNNI)
+  __m256i acc8[MR][NR];
+  for (uint32_t i = 0; i < MR; ++i) {
+    for (uint32_t j = 0; j < NR; ++j) {
+      acc8[i][j] = _mm256_setzero_si256();
+    }
+  }
+  const __m256i offset = _mm256_set1_epi8(static_cast<char>(0x80));
+  for (uint32_t k = 0; k < packed_depth; k += 32) {
+    __m256i a[MR];
+    for (uint32_t i = 0; i < MR; ++i) {
+      a[i] = _mm256_xor_si256(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i * packed_depth + k)),
+          offset);
+    }
+    for (uint32_t j = 0; j < NR; ++j) {
+      const __m256i b =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weight + j * packed_depth + k));
+      for (uint32_t i = 0; i < MR; ++i) {
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+        acc8[i][j] = _mm256_dpbusd_epi32(acc8[i][j], a[i], b);
+#else
+        acc8[i][j] = _mm256_dpbusd_avx_epi32(acc8[i][j], a[i], b);
+#endif
+      }
+    }
+  }
+  for (uint32_t i = 0; i < MR; ++i) {
+    for (uint32_t j = 0; j < NR; ++j) {
+      acc[i][j] = HorizontalSum(acc8[i][j]);
+    }
+  }
+#elif defined(__AVX2__)
+  __m256i acc8[MR][NR];
+  for (uint32_t i = 0; i < MR; ++i) {
+    for (uint32_t j = 0; j < NR; ++j) {
+      acc8[i][j] = _mm256_setzero_si256();
+    }
+  }
+  for (uint32_t k = 0; k < packed_depth; k += 16) {
+    __m256i a[MR];
+    for (uint32_t i = 0; i < MR; ++i) {
+      a[i] = _mm256_cvtepi8_epi16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i * packed_depth + k)));
+    }
+    for (uint32_t j = 0; j < NR; ++j) {
+      const __m256i b = _mm256_cvtepi8_epi16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(weight + j * packed_depth + k)));
+      for (uint32_t i = 0; i < MR; ++i) {
+        acc8[i][j] = _mm256_add_epi32(acc8[i][j], _mm256_madd_epi16(a[i], b));
+      }
+    }
+  }
+  for (uint32_t i = 0; i < MR; ++i) {
+    for (uint32_t j = 0; j < NR; ++j) {
+      acc[i][j] = HorizontalSum(acc8[i][j]);
+    }
+  }
+#else
+  for (uint32_t i = 0; i < MR; ++i) {
+    for (uint32_t j = 0; j < NR; ++j) {
+      int32_t sum = 0;
+      for (uint32_t k = 0; k < packed_depth; ++k) {
+        sum += int32_t(input[i * packed_depth + k]) * int32_t(weight[j * packed_depth + k]);
+      }
+      acc[i][j] = sum;
+    }
+  }
+#endif
+}
+
+template <uint32_t MR, uint32_t NR>
+static inline void Int8GemmTile(const int8_t* input, uint32_t rows, uint32_t m,
+                                float input_scale, const Int8Weight& weight, uint32_t n,
+                                uint32_t weight_begin, const float* bias, float* output) {
+  const uint32_t packed_depth = weight.packed_depth;
+  int32_t acc[MR][NR];
+  Int8DotTile<MR, NR>(input + size_t(m) * packed_depth,
+                      weight.data.data() + size_t(n) * packed_depth, packed_depth, acc);
+  for (uint32_t j = 0; j < NR; ++j) {
+#if defined(KUIPER_INT8_VNNI)
+    const int32_t compensation = 128 * weight.row_sums[n + j];
+#else
+    const int32_t compensation = 0;
+#endif
+    // 反量化的尾处理: int32累加结果乘以激活和权重的scale并加上偏置
+    const float scale = input_scale * weight.scales[n + j];
+    const float bias_value = bias != nullptr ? bias[n + j] : 0.f;
+    float* output_channel = output + size_t(n + j - weight_begin) * rows + m;
+    for (uint32_t i = 0; i < MR; ++i) {
+      output_channel[i] = float(acc[i][j] - compensation) * scale + bias_value;
+    }
+  }
+}
+
+void Int8GemmDequantize(const int8_t* input, uint32_t rows, float input_scale,
+                        const Int8Weight& weight, uint32_t weight_begin, uint32_t weight_end,
+                        const float* bias, float* output) {
+  CHECK(input != nullptr && output != nullptr);
+  CHECK(!weight.empty()) << "The int8 weight is empty";
+  CHECK(weight_begin < weight_end && weight_end <= weight.rows)
+      << "The output channel range is out of the int8 weight";
+
+  const uint32_t channels = weight_end - weight_begin;
+  const uint32_t row_blocks = (rows + kInt8RowBlock - 1) / kInt8RowBlock;
+  const uint32_t channel_blocks = (channels + kInt8ChannelBlock - 1) / kInt8ChannelBlock;
+
+  // 每个任务计算kInt8RowBlock行激活与kInt8ChannelBlock个输出通道, 两者都能留在缓存中
+  const bool parallel = uint64_t(rows) * channels * weight.packed_depth > (1 << 18);
+#pragma omp parallel for collapse(2) if (parallel)
+  for (uint32_t rb = 0; rb < row_blocks; ++rb) {
+    for (uint32_t cb = 0; cb < channel_blocks; ++cb) {
+      const uint32_t m_begin = rb * kInt8RowBlock;
+      const uint32_t m_end = std::min(m_begin + kInt8RowBlock, rows);
+      const uint32_t n_begin = weight_begin + cb * kInt8ChannelBlock;
+      const uint32_t n_end = std::min(n_begin + kInt8ChannelBlock, weight_end);
+
+      uint32_t n = n_begin;
+      for (; n + 4 <= n_end; n += 4) {
+        uint32_t m = m_begin;
+        for (; m + 2 <= m_end; m += 2) {
+          Int8GemmTile<2, 4>(input, rows, m, input_scale, weight, n, weight_begin, bias, output);
+        }
+        for (; m < m_end; ++m) {
+          Int8GemmTile<1, 4>(input, rows, m, input_scale, weight, n, weight_begin, bias, output);
+        }
+      }
+      for (; n < n_end; ++n) {
+        for (uint32_t m = m_begin; m < m_end; ++m) {
+          Int8GemmTile<1, 1>(input, rows, m, input_scale, weight, n, weight_begin, bias, output);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace math
+}  // namespace kuiper_infer
@@ -0,0 +1,299 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "utils/math/weight_quant_gemm.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include "utils/math/simd_reduce.hpp"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+#define KUIPER_QUANT_SIMD
+#endif
+
+namespace kuiper_infer {
+namespace math {
+/// Rows of the activation matrix processed by one task
+constexpr uint32_t kQuantRowBlock = 16;
+/// Output channels processed by one task
+constexpr uint32_t kQuantChannelBlock = 16;
+
+static inline int32_t QuantMax(WeightFormat format) {
+  return format == WeightFormat::kInt4Grouped ? 15 : 255;
+}
+
+void QuantizeWeightGrouped(const float* weight, uint32_t rows, uint32_t depth,
+                           uint32_t group_size, WeightFormat format, GroupQuantWeight& quantized) {
+  CHECK(weight != nullptr);
+  CHECK(rows > 0 && depth > 0) << "The weight to be quantized is empty";
+  CHECK(format == WeightFormat::kInt8Grouped || format == WeightFormat::kInt4Grouped)
+      << "Unsupported grouped weight format: " << int32_t(format);
+  CHECK(group_size > 0 && group_size % kQuantGroupBlock == 0)
+      << "The group size should be a multiple of " << kQuantGroupBlock;
+  CHECK_EQ(depth % group_size, 0) << "The reduction length should be a multiple of the group size";
+
+  quantized.format = format;
+  quantized.rows = rows;
+  quantized.depth = depth;
+  quantized.group_size = group_size;
+  const uint32_t groups = quantized.groups();
+  const size_t row_bytes = quantized.row_bytes();
+  quantized.data.assign(rows * row_bytes, 0);
+  quantized.scales.resize(size_t(rows) * groups);
+  quantized.zeros.resize(size_t(rows) * groups);
+
+  const int32_t quant_max = QuantMax(format);
+#pragma omp parallel for
+  for (uint32_t n = 0; n < rows; ++n) {
+    uint8_t* row_data = quantized.data.data() + n * row_bytes;
+    for (uint32_t g = 0; g < groups; ++g) {
+      const float* group_weight = weight + size_t(n) * depth + g * group_size;
+      const auto [min_iter, max_iter] =
+          std::minmax_element(group_weight, group_weight + group_size);
+      // 范围包含0, 保证0权重量化后没有误差
+      const float min_value = std::min(*min_iter, 0.f);
+      const float max_value = std::max(*max_iter, 0.f);
+      float scale = (max_value - min_value) / float(quant_max);
+      if (scale <= 0.f) {
+        scale = 1.f;
+      }
+      const int32_t zero =
+          std::clamp(int32_t(std::lrint(-min_value / scale)), int32_t(0), quant_max);
+      quantized.scales.at(size_t(n) * groups + g) = scale;
+      quantized.zeros.at(size_t(n) * groups + g) = uint8_t(zero);
+
+      for (uint32_t i = 0; i < group_size; ++i) {
+        const int32_t code = std::clamp(int32_t(std::lrint(group_weight[i] / scale)) + zero,
+                                        int32_t(0), quant_max);
+        const uint32_t k = g * group_size + i;
+        if (format == WeightFormat::kInt8Grouped) {
+          row_data[k] = uint8_t(code);
+        } else {
+          // 每32个权重一块, 第i个字节的低4位和高4位分别存放第i个和第i + 16个权重
+          const uint32_t block = k / kQuantGroupBlock;
+          const uint32_t index = k % kQuantGroupBlock;
+          uint8_t& byte = row_data[block * (kQuantGroupBlock / 2) + index % 16];
+          byte |= index < 16 ? uint8_t(code) : uint8_t(code << 4);
+        }
+      }
+    }
+  }
+}
+
+static inline uint32_t WeightCode(const GroupQuantWeight& weight, const uint8_t* row_data,
+                                  uint32_t k) {
+  if (weight.format == WeightFormat::kInt8Grouped) {
+    return row_data[k];
+  }
+  const uint32_t index = k % kQuantGroupBlock;
+  const uint8_t byte = row_data[k / kQuantGroupBlock * (kQuantGroupBlock / 2) + index % 16];
+  return index < 16 ? (byte & 0xf) : (byte >> 4);
+}
+
+float DequantizeGroupedValue(const GroupQuantWeight& weight, uint32_t row, uint32_t k) {
+  CHECK(row < weight.rows && k < weight.depth);
+  const uint8_t* row_data = weight.data.data() + row * weight.row_bytes();
+  const size_t group_index = size_t(row) * weight.groups() + k / weight.group_size;
+  return (float(WeightCode(weight, row_data, k)) - float(weight.zeros.at(group_index))) *
+         weight.scales.at(group_index);
+}
+
+#ifdef KUIPER_QUANT_SIMD
+static inline __m256 WidenCodes(__m128i codes) {
+  return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(codes));
+}
+
+/**
+ * 将一块32个权重的编码转换为4组float
+ */
+template <WeightFormat format>
+static inline void LoadCodeBlock(const uint8_t* block, __m256 (&codes)[4]) {
+  if constexpr (format == WeightFormat::kInt4Grouped) {
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+    const __m128i low = _mm_and_si128(packed, mask);
+    const __m128i high = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+    codes[0] = WidenCodes(low);
+    codes[1] = WidenCodes(_mm_srli_si128(low, 8));
+    codes[2] = WidenCodes(high);
+    codes[3] = WidenCodes(_mm_srli_si128(high, 8));
+  } else {
+    for (uint32_t i = 0; i < 4; ++i) {
+      codes[i] = WidenCodes(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(block + i * 8)));
+    }
+  }
+}
+#endif
+
+/**
+ * 计算一行激活与NR个输出通道的点积
+ *
+ * 组内先累加x * q, 每组结束时乘一次scale; 零点的贡献zero * scale * sum(x)
+ * 使用预先计算的每组激活之和单独扣除, 内层循环只有编码的展开和乘加.
+ */
+template <WeightFormat format, uint32_t NR>
+static inline void GroupQuantTile(const float* input_row, const float* input_sums,
+                                  const GroupQuantWeight& weight, uint32_t n, float (&result)[NR]) {
+  const uint32_t groups = weight.groups();
+  const uint32_t group_size = weight.group_size;
+  const size_t row_bytes = weight.row_bytes();
+  constexpr uint32_t block_bytes =
+      format == WeightFormat::kInt4Grouped ? kQuantGroupBlock / 2 : kQuantGroupBlock;
+
+  const uint8_t* row_data[NR];
+  const float* row_scales[NR];
+  const uint8_t* row_zeros[NR];
+  float zero_acc[NR];
+  for (uint32_t j = 0; j < NR; ++j) {
+    row_data[j] = weight.data.data() + (n + j) * row_bytes;
+    row_scales[j] = weight.scales.data() + size_t(n + j) * groups;
+    row_zeros[j] = weight.zeros.data() + size_t(n + j) * groups;
+    zero_acc[j] = 0.f;
+  }
+
+#ifdef KUIPER_QUANT_SIMD
+  __m256 acc[NR];
+  for (uint32_t j = 0; j < NR; ++j) {
+    acc[j] = _mm256_setzero_ps();
+  }
+  for (uint32_t g = 0; g < groups; ++g) {
+    __m256 group_acc[NR];
+    for (uint32_t j = 0; j < NR; ++j) {
+      group_acc[j] = _mm256_setzero_ps();
+    }
+    for (uint32_t b = g * group_size; b < (g + 1) * group_size; b += kQuantGroupBlock) {
+      __m256 x[4];
+      for (uint32_t i = 0; i < 4; ++i) {
+        x[i] = _mm256_loadu_ps(input_row + b + i * 8);
+      }
+      const size_t block_offset = b / kQuantGroupBlock * block_bytes;
+      for (uint32_t j = 0; j < NR; ++j) {
+        __m256 codes[4];
+        LoadCodeBlock<format>(row_data[j] + block_offset, codes);
+        for (uint32_t i = 0; i < 4; ++i) {
+          group_acc[j] = _mm256_fmadd_ps(x[i], codes[i], group_acc[j]);
+        }
+      }
+    }
+    for (uint32_t j = 0; j < NR; ++j) {
+      const float scale = row_scales[j][g];
+      acc[j] = _mm256_fmadd_ps(group_acc[j], _mm256_set1_ps(scale), acc[j]);
+      zero_acc[j] += float(row_zeros[j][g]) * scale * input_sums[g];
+    }
+  }
+  for (uint32_t j = 0; j < NR; ++j) {
+    result[j] = HorizontalSum(acc[j]) - zero_acc[j];
+  }
+#else
+  for (uint32_t j = 0; j < NR; ++j) {
+    float acc = 0.f;
+    for (uint32_t g = 0; g < groups; ++g) {
+      float group_acc = 0.f;
+      for (uint32_t k = g * group_size; k < (g + 1) * group_size; ++k) {
+        group_acc += input_row[k] * float(WeightCode(weight, row_data[j], k));
+      }
+      const float scale = row_scales[j][g];
+      acc += group_acc * scale;
+      zero_acc[j] += float(row_zeros[j][g]) * scale * input_sums[g];
+    }
+    result[j] = acc - zero_acc[j];
+  }
+#endif
+}
+
+template <WeightFormat format>
+static void GroupQuantGemmImpl(const float* input, uint32_t rows, const GroupQuantWeight& weight,
+                               uint32_t weight_begin, uint32_t weight_end, float* output) {
+  const uint32_t depth = weight.depth;
+  const uint32_t groups = weight.groups();
+  const uint32_t group_size = weight.group_size;
+
+  // 每行激活的分组和, 所有输出通道共用
+  std::vector<float> input_sums(size_t(rows) * groups);
+  for (uint32_t m = 0; m < rows; ++m) {
+    for (uint32_t g = 0; g < groups; ++g) {
+      const float* group_input = input + size_t(m) * depth + g * group_size;
+      float sum = 0.f;
+      for (uint32_t i = 0; i < group_size; ++i) {
+        sum += group_input[i];
+      }
+      input_sums[size_t(m) * groups + g] = sum;
+    }
+  }
+
+  const uint32_t channels = weight_end - weight_begin;
+  const uint32_t row_blocks = (rows + kQuantRowBlock - 1) / kQuantRowBlock;
+  const uint32_t channel_blocks = (channels + kQuantChannelBlock - 1) / kQuantChannelBlock;
+  const bool parallel = uint64_t(rows) * channels * depth > (1 << 18);
+#pragma omp parallel for collapse(2) if (parallel)
+  for (uint32_t rb = 0; rb < row_blocks; ++rb) {
+    for (uint32_t cb = 0; cb < channel_blocks; ++cb) {
+      const uint32_t m_begin = rb * kQuantRowBlock;
+      const uint32_t m_end = std::min(m_begin + kQuantRowBlock, rows);
+      const uint32_t n_begin = weight_begin + cb * kQuantChannelBlock;
+      const uint32_t n_end = std::min(n_begin + kQuantChannelBlock, weight_end);
+      for (uint32_t m = m_begin; m < m_end; ++m) {
+        const float* input_row = input + size_t(m) * depth;
+        const float* row_sums = input_sums.data() + size_t(m) * groups;
+        uint32_t n = n_begin;
+        for (; n + 4 <= n_end; n += 4) {
+          float result[4];
+          GroupQuantTile<format, 4>(input_row, row_sums, weight, n, result);
+          for (uint32_t j = 0; j < 4; ++j) {
+            output[size_t(n + j - weight_begin) * rows + m] = result[j];
+          }
+        }
+        for (; n < n_end; ++n) {
+          float result[1];
+          GroupQuantTile<format, 1>(input_row, row_sums, weight, n, result);
+          output[size_t(n - weight_begin) * rows + m] = result[0];
+        }
+      }
+    }
+  }
+}
+
+void GroupQuantGemm(const float* input, uint32_t rows, const GroupQuantWeight& weight,
+                    uint32_t weight_begin, uint32_t weight_end, float* output) {
+  CHECK(input != nullptr && output != nullptr);
+  CHECK(!weight.empty()) << "The quantized weight is empty";
+  CHECK(weight_begin < weight_end && weight_end <= weight.rows)
+      << "The output channel range is out of the quantized weight";
+  CHECK(weight.group_size > 0 && weight.group_size % kQuantGroupBlock == 0 &&
+        weight.depth % weight.group_size == 0)
+      << "The group size of the quantized weight is wrong";
+
+  if (weight.format == WeightFormat::kInt4Grouped) {
+    GroupQuantGemmImpl<WeightFormat::kInt4Grouped>(input, rows, weight, weight_begin, weight_end,
+                                                   output);
+  } else {
+    CHECK(weight.format == WeightFormat::kInt8Grouped)
+        << "Unsupported grouped weight format: " << int32_t(weight.format);
+    GroupQuantGemmImpl<WeightFormat::kInt8Grouped>(input, rows, weight, weight_begin, weight_end,
+                                                   output);
+  }
+}
+
+}  // namespace math
+}  // namespace kuiper_infer
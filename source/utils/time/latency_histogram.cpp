@@ -0,0 +1,114 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "utils/time/latency_histogram.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+
+namespace kuiper_infer {
+namespace utils {
+
+LatencyHistogram::LatencyHistogram(double bucket_us, uint32_t bucket_num)
+    : bucket_us_(bucket_us), buckets_(bucket_num, 0) {
+  CHECK(bucket_us > 0. && bucket_num > 0) << "The latency histogram needs at least one bucket";
+}
+
+void LatencyHistogram::Record(int64_t duration_ns) {
+  duration_ns = std::max(duration_ns, int64_t(0));
+  const double bucket = std::floor(double(duration_ns) / 1e3 / bucket_us_);
+  const size_t index = std::min(size_t(bucket), buckets_.size() - 1);
+  std::lock_guard<std::mutex> lock(mutex_);
+  buckets_.at(index) += 1;
+  count_ += 1;
+  total_ns_ += duration_ns;
+  min_ns_ = std::min(min_ns_, duration_ns);
+  max_ns_ = std::max(max_ns_, duration_ns);
+}
+
+void LatencyHistogram::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::fill(buckets_.begin(), buckets_.end(), 0);
+  count_ = 0;
+  total_ns_ = 0;
+  min_ns_ = std::numeric_limits<int64_t>::max();
+  max_ns_ = 0;
+}
+
+uint64_t LatencyHistogram::count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return count_;
+}
+
+double LatencyHistogram::mean_us() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return count_ == 0 ? 0. : double(total_ns_) / 1e3 / double(count_);
+}
+
+double LatencyHistogram::min_us() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return count_ == 0 ? 0. : double(min_ns_) / 1e3;
+}
+
+double LatencyHistogram::max_us() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return double(max_ns_) / 1e3;
+}
+
+double LatencyHistogram::Percentile(double percent) const {
+  CHECK(percent > 0. && percent <= 100.) << "The percentile should be in (0, 100]";
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (count_ == 0) {
+    return 0.;
+  }
+  const uint64_t rank = uint64_t(std::ceil(percent / 100. * double(count_)));
+  uint64_t accumulated = 0;
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    accumulated += buckets_.at(i);
+    if (accumulated >= rank) {
+      // 最后一个桶没有上界, 使用记录到的最大值
+      if (i + 1 == buckets_.size()) {
+        return double(max_ns_) / 1e3;
+      }
+      return std::min(double(i + 1) * bucket_us_, double(max_ns_) / 1e3);
+    }
+  }
+  return double(max_ns_) / 1e3;
+}
+
+std::vector<uint64_t> LatencyHistogram::buckets() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return buckets_;
+}
+
+double LatencyHistogram::bucket_us() const { return bucket_us_; }
+
+void LatencyHistogram::PrintSummary(const std::string& name) const {
+  LOG(INFO) << name << " count: " << count() << "\tmean: " << mean_us() << "us\t"
+            << "p50: " << Percentile(50.) << "us\t"
+            << "p90: " << Percentile(90.) << "us\t"
+            << "p99: " << Percentile(99.) << "us\t"
+            << "min: " << min_us() << "us\t"
+            << "max: " << max_us() << "us";
+}
+
+}  // namespace utils
+}  // namespace kuiper_infer
@@ -0,0 +1,141 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "utils/time/perf_counter.hpp"
+#include <glog/logging.h>
+#include <cstring>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace kuiper_infer {
+namespace utils {
+#ifdef __linux__
+static int32_t OpenPerfEvent(uint32_t type, uint64_t config, int32_t group_fd) {
+  struct perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  // 组内的计数器跟随leader一起开启和关闭
+  attr.disabled = group_fd == -1 ? 1 : 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return static_cast<int32_t>(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+#endif
+
+PerfCounters::PerfCounters() {
+#ifdef __linux__
+  const uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  const uint32_t event_types[kPerfCounterNum] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                 PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                                 PERF_TYPE_HARDWARE};
+  const uint64_t event_configs[kPerfCounterNum] = {PERF_COUNT_HW_CPU_CYCLES,
+                                                   PERF_COUNT_HW_INSTRUCTIONS,
+                                                   PERF_COUNT_HW_CACHE_MISSES, l1d_read_miss,
+                                                   PERF_COUNT_HW_BRANCH_MISSES};
+  for (uint32_t i = 0; i < kPerfCounterNum; ++i) {
+    const int32_t fd = OpenPerfEvent(event_types[i], event_configs[i], leader_fd_);
+    if (fd < 0) {
+      continue;
+    }
+    if (leader_fd_ == -1) {
+      leader_fd_ = fd;
+    }
+    fds_[i] = fd;
+    group_index_[i] = static_cast<int32_t>(opened_num_);
+    opened_num_ += 1;
+  }
+  LOG_IF(WARNING, opened_num_ == 0)
+      << "Hardware performance counters are unavailable, fall back to time only profiling";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (int32_t& fd : fds_) {
+    if (fd >= 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+#endif
+  leader_fd_ = -1;
+}
+
+bool PerfCounters::available() const { return opened_num_ > 0; }
+
+void PerfCounters::Start() {
+#ifdef __linux__
+  if (leader_fd_ >= 0) {
+    ioctl(leader_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+#endif
+}
+
+void PerfCounters::Stop(PerfCounterValues& values) {
+  values.valid_mask = 0;
+#ifdef __linux__
+  if (leader_fd_ < 0) {
+    return;
+  }
+  ioctl(leader_fd_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+  // PERF_FORMAT_GROUP的读取格式为: 计数器数量 + 各计数器的值
+  uint64_t buffer[kPerfCounterNum + 1] = {0};
+  const ssize_t read_size = read(leader_fd_, buffer, sizeof(buffer));
+  if (read_size < static_cast<ssize_t>(sizeof(uint64_t)) || buffer[0] != opened_num_) {
+    return;
+  }
+  for (uint32_t i = 0; i < kPerfCounterNum; ++i) {
+    if (group_index_[i] >= 0) {
+      values.values[i] = buffer[group_index_[i] + 1];
+      values.valid_mask |= 1u << i;
+    }
+  }
+#endif
+}
+
+const char* PerfCounters::CounterName(PerfCounterType type) {
+  switch (type) {
+    case PerfCounterType::kCycles:
+      return "cycles";
+    case PerfCounterType::kInstructions:
+      return "instructions";
+    case PerfCounterType::kLLCMisses:
+      return "llc_misses";
+    case PerfCounterType::kL1DMisses:
+      return "l1d_misses";
+    case PerfCounterType::kBranchMisses:
+      return "branch_misses";
+  }
+  return "unknown";
+}
+
+}  // namespace utils
+}  // namespace kuiper_infer
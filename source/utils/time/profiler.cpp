@@ -0,0 +1,361 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "utils/time/profiler.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace kuiper_infer {
+namespace utils {
+static std::atomic<uint64_t> profiler_counter{0};
+
+static uint32_t RoundUpPowerOfTwo(uint32_t value) {
+  uint32_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+static double Percentile(const std::vector<int64_t>& sorted_durations, double percent) {
+  CHECK(!sorted_durations.empty());
+  const size_t index = static_cast<size_t>(
+      std::ceil(percent / 100. * static_cast<double>(sorted_durations.size())));
+  return static_cast<double>(sorted_durations.at(index == 0 ? 0 : index - 1)) / 1e3;
+}
+
+static std::string JsonEscape(const std::string& str) {
+  std::string escaped;
+  escaped.reserve(str.size());
+  for (const char c : str) {
+    switch (c) {
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\\':
+        escaped += "\\\\";
+        break;
+      case '\n':
+        escaped += "\\n";
+        break;
+      case '\t':
+        escaped += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          escaped += ' ';
+        } else {
+          escaped += c;
+        }
+    }
+  }
+  return escaped;
+}
+
+static std::string CountersLogging(const PerfCounterValues& counters, double ipc) {
+  if (!counters.is_valid(PerfCounterType::kInstructions)) {
+    return "";
+  }
+  // 以每千条指令的缺失次数(MPKI)展示各类缺失率
+  const double kilo_instructions =
+      std::max(static_cast<double>(counters.value(PerfCounterType::kInstructions)) / 1e3, 1e-9);
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(3);
+  if (counters.is_valid(PerfCounterType::kCycles)) {
+    ss << "\tIPC: " << ipc;
+  }
+  for (PerfCounterType type :
+       {PerfCounterType::kLLCMisses, PerfCounterType::kL1DMisses, PerfCounterType::kBranchMisses}) {
+    if (counters.is_valid(type)) {
+      ss << "\t" << PerfCounters::CounterName(type)
+         << " MPKI: " << static_cast<double>(counters.value(type)) / kilo_instructions;
+    }
+  }
+  return ss.str();
+}
+
+ProfileRingBuffer::ProfileRingBuffer(uint32_t capacity, uint32_t thread_index)
+    : events(capacity), thread_index(thread_index), thread_id(std::this_thread::get_id()) {}
+
+Profiler::Profiler(uint32_t capacity, bool hardware_counters)
+    : profiler_id_(++profiler_counter),
+      capacity_(RoundUpPowerOfTwo(std::max(capacity, 1u))),
+      hardware_counters_(hardware_counters) {}
+
+uint32_t Profiler::RegisterOp(const std::string& name, const std::string& type, uint64_t flops,
+                              uint64_t bytes) {
+  ops_.push_back({name, type, flops, bytes});
+  return static_cast<uint32_t>(ops_.size() - 1);
+}
+
+void Profiler::Clear() {
+  ops_.clear();
+  Reset();
+}
+
+void Profiler::Reset() {
+  std::lock_guard<std::mutex> lock(buffers_mutex_);
+  for (const auto& buffer : buffers_) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    buffer->head = 0;
+  }
+}
+
+ProfileRingBuffer* Profiler::LocalBuffer() {
+  thread_local uint64_t cached_profiler_id = 0;
+  thread_local ProfileRingBuffer* cached_buffer = nullptr;
+  if (cached_profiler_id == profiler_id_) {
+    return cached_buffer;
+  }
+
+  std::lock_guard<std::mutex> lock(buffers_mutex_);
+  const std::thread::id thread_id = std::this_thread::get_id();
+  ProfileRingBuffer* buffer = nullptr;
+  for (const auto& local_buffer : buffers_) {
+    if (local_buffer->thread_id == thread_id) {
+      buffer = local_buffer.get();
+      break;
+    }
+  }
+  if (!buffer) {
+    buffers_.push_back(
+        std::make_unique<ProfileRingBuffer>(capacity_, static_cast<uint32_t>(buffers_.size())));
+    buffer = buffers_.back().get();
+    if (hardware_counters_) {
+      // 计数器只统计打开它的线程，所以在每个线程首次记录时创建
+      buffer->perf_counters = std::make_unique<PerfCounters>();
+      if (buffer->perf_counters->available()) {
+        buffer->counter_values.resize(capacity_);
+      } else {
+        buffer->perf_counters.reset();
+      }
+    }
+  }
+  cached_profiler_id = profiler_id_;
+  cached_buffer = buffer;
+  return buffer;
+}
+
+void Profiler::Record(uint32_t op_id, int64_t start_ns, int64_t end_ns,
+                      const PerfCounterValues* counter_values) {
+  ProfileRingBuffer* buffer = LocalBuffer();
+  // 只有汇总或导出时才会与其他线程竞争
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  const uint64_t slot = buffer->head & (capacity_ - 1);
+  ProfileEvent& event = buffer->events[slot];
+  event.op_id = op_id;
+  event.start_ns = start_ns;
+  event.end_ns = end_ns;
+  if (!buffer->counter_values.empty()) {
+    buffer->counter_values[slot] = counter_values ? *counter_values : PerfCounterValues();
+  }
+  buffer->head += 1;
+}
+
+PerfCounters* Profiler::LocalPerfCounters() {
+  if (!hardware_counters_) {
+    return nullptr;
+  }
+  return LocalBuffer()->perf_counters.get();
+}
+
+bool Profiler::hardware_counters() const { return hardware_counters_; }
+
+uint64_t Profiler::event_count() const {
+  std::lock_guard<std::mutex> lock(buffers_mutex_);
+  uint64_t count = 0;
+  for (const auto& buffer : buffers_) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    count += std::min(buffer->head, static_cast<uint64_t>(capacity_));
+  }
+  return count;
+}
+
+uint32_t Profiler::op_count() const { return static_cast<uint32_t>(ops_.size()); }
+
+std::vector<ProfileEvent> Profiler::CollectEvents(
+    std::vector<uint32_t>* thread_indexes, std::vector<PerfCounterValues>* counter_values) const {
+  std::lock_guard<std::mutex> lock(buffers_mutex_);
+  std::vector<ProfileEvent> events;
+  for (const auto& buffer : buffers_) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    const uint64_t head = buffer->head;
+    const uint64_t count = std::min(head, static_cast<uint64_t>(capacity_));
+    for (uint64_t i = head - count; i < head; ++i) {
+      const ProfileEvent& event = buffer->events[i & (capacity_ - 1)];
+      if (event.op_id >= ops_.size()) {
+        continue;
+      }
+      events.push_back(event);
+      if (thread_indexes) {
+        thread_indexes->push_back(buffer->thread_index);
+      }
+      if (counter_values) {
+        counter_values->push_back(buffer->counter_values.empty()
+                                      ? PerfCounterValues()
+                                      : buffer->counter_values[i & (capacity_ - 1)]);
+      }
+    }
+  }
+  return events;
+}
+
+std::vector<ProfileStats> Profiler::Summary(bool by_type) const {
+  std::vector<PerfCounterValues> counter_values;
+  const std::vector<ProfileEvent>& events = CollectEvents(nullptr, &counter_values);
+
+  // 按照算子(或算子类型)归类每次执行的耗时和计算量
+  std::map<std::string, std::vector<int64_t>> durations;
+  std::map<std::string, ProfileStats> stats;
+  for (size_t i = 0; i < events.size(); ++i) {
+    const ProfileEvent& event = events.at(i);
+    const OpInfo& op = ops_.at(event.op_id);
+    const std::string& key = by_type ? op.type : op.name;
+    durations[key].push_back(event.end_ns - event.start_ns);
+
+    ProfileStats& stat = stats[key];
+    if (stat.name.empty()) {
+      stat.name = key;
+      stat.type = op.type;
+      stat.counters.valid_mask = counter_values.at(i).valid_mask;
+    }
+    stat.flops += op.flops;
+    stat.bytes += op.bytes;
+    // 只保留每次执行都测量到的计数器
+    stat.counters.valid_mask &= counter_values.at(i).valid_mask;
+    for (uint32_t j = 0; j < kPerfCounterNum; ++j) {
+      stat.counters.values[j] += counter_values.at(i).values[j];
+    }
+  }
+
+  std::vector<ProfileStats> summary;
+  for (auto& [key, stat] : stats) {
+    std::vector<int64_t>& op_durations = durations.at(key);
+    std::sort(op_durations.begin(), op_durations.end());
+
+    int64_t total_ns = 0;
+    for (int64_t duration : op_durations) {
+      total_ns += duration;
+    }
+    if (total_ns > 0) {
+      stat.gflops = static_cast<double>(stat.flops) / static_cast<double>(total_ns);
+    }
+    stat.count = op_durations.size();
+    stat.flops /= stat.count;
+    stat.bytes /= stat.count;
+    for (uint32_t j = 0; j < kPerfCounterNum; ++j) {
+      stat.counters.values[j] = stat.counters.is_valid(PerfCounterType(j))
+                                    ? stat.counters.values[j] / stat.count
+                                    : 0;
+    }
+    const uint64_t cycles = stat.counters.value(PerfCounterType::kCycles);
+    if (stat.counters.is_valid(PerfCounterType::kInstructions) && cycles > 0) {
+      stat.ipc = static_cast<double>(stat.counters.value(PerfCounterType::kInstructions)) /
+                 static_cast<double>(cycles);
+    }
+    stat.total_us = static_cast<double>(total_ns) / 1e3;
+    stat.mean_us = stat.total_us / static_cast<double>(stat.count);
+    stat.p50_us = Percentile(op_durations, 50.);
+    stat.p99_us = Percentile(op_durations, 99.);
+    summary.push_back(stat);
+  }
+
+  std::sort(summary.begin(), summary.end(),
+            [](const ProfileStats& stat1, const ProfileStats& stat2) {
+              return stat1.total_us > stat2.total_us;
+            });
+  return summary;
+}
+
+void Profiler::SummaryLogging() const {
+  double total_us = 0.;
+  for (const ProfileStats& stat : Summary(false)) {
+    total_us += stat.total_us;
+    LOG(INFO) << std::fixed << std::setprecision(3) << "Layer name: " << stat.name << "\t"
+              << "layer type: " << stat.type << "\t"
+              << "count: " << stat.count << "\t"
+              << "mean: " << stat.mean_us << "us\t"
+              << "p50: " << stat.p50_us << "us\t"
+              << "p99: " << stat.p99_us << "us\t"
+              << "GFLOP/s: " << stat.gflops << CountersLogging(stat.counters, stat.ipc);
+  }
+  for (const ProfileStats& stat : Summary(true)) {
+    LOG(INFO) << std::fixed << std::setprecision(3) << "Layer type: " << stat.name << "\t"
+              << "count: " << stat.count << "\t"
+              << "total: " << stat.total_us << "us\t"
+              << "GFLOP/s: " << stat.gflops << CountersLogging(stat.counters, stat.ipc);
+  }
+  LOG(INFO) << std::fixed << std::setprecision(3) << "Total time: " << total_us / 1e3 << "ms";
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path) const {
+  std::ofstream trace_file(path);
+  if (!trace_file.is_open()) {
+    LOG(ERROR) << "Can not open the trace file: " << path;
+    return false;
+  }
+
+  std::vector<uint32_t> thread_indexes;
+  std::vector<PerfCounterValues> counter_values;
+  const std::vector<ProfileEvent>& events = CollectEvents(&thread_indexes, &counter_values);
+  int64_t base_ns = 0;
+  if (!events.empty()) {
+    base_ns = std::min_element(events.begin(), events.end(),
+                               [](const ProfileEvent& event1, const ProfileEvent& event2) {
+                                 return event1.start_ns < event2.start_ns;
+                               })
+                  ->start_ns;
+  }
+
+  trace_file << std::fixed << std::setprecision(3);
+  trace_file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  for (size_t i = 0; i < events.size(); ++i) {
+    const ProfileEvent& event = events.at(i);
+    const OpInfo& op = ops_.at(event.op_id);
+    if (i != 0) {
+      trace_file << ",";
+    }
+    // Chrome trace的时间单位为微秒
+    trace_file << "\n{\"name\":\"" << JsonEscape(op.name) << "\",\"cat\":\"" << JsonEscape(op.type)
+               << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread_indexes.at(i)
+               << ",\"ts\":" << static_cast<double>(event.start_ns - base_ns) / 1e3
+               << ",\"dur\":" << static_cast<double>(event.end_ns - event.start_ns) / 1e3
+               << ",\"args\":{\"flops\":" << op.flops << ",\"bytes\":" << op.bytes;
+    for (uint32_t j = 0; j < kPerfCounterNum; ++j) {
+      if (counter_values.at(i).is_valid(PerfCounterType(j))) {
+        trace_file << ",\"" << PerfCounters::CounterName(PerfCounterType(j))
+                   << "\":" << counter_values.at(i).values[j];
+      }
+    }
+    trace_file << "}}";
+  }
+  trace_file << "\n]}\n";
+  return trace_file.good();
+}
+
+}  // namespace utils
+}  // namespace kuiper_infer
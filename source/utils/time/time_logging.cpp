@@ -67,7 +67,7 @@ LayerTimeLogging::~LayerTimeLogging() {
     std::lock_guard<std::mutex> lock_guard(layer_state->time_mutex_);
     const auto end_time = Time::now();
     const auto duration =
-        std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time_).count();
+        std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time_).count();
     layer_state->duration_time_ += duration;
   } else {
     LOG(ERROR) << "Can not find the layer: " << layer_name_ << " in the time logging.";
@@ -89,10 +89,10 @@ void LayerTimeLogging::SummaryLogging() {
     if (layer_time_state->duration_time_ != 0) {
       LOG(INFO) << "Layer name: " << layer_name << "\t"
                 << "layer type: " << layer_time_state->layer_type_ << "\t"
-                << "time cost: " << time_cost << "ms";
+                << "time cost: " << double(time_cost) / 1e3 << "ms";
     }
   }
-  LOG(INFO) << "Total time: " << total_time_costs << "ms";
+  LOG(INFO) << "Total time: " << double(total_time_costs) / 1e3 << "ms";
 }
 
 }  // namespace utils
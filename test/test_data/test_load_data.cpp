@@ -22,6 +22,8 @@
 // Created by fss on 22-11-21.
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
 #include "data/load_data.hpp"
 #include "tick.hpp"
 
@@ -185,3 +187,146 @@ TEST(test_load, load_large_data_int32) {
   }
   ASSERT_EQ(data_minus_one, 1024 * 1024);
 }
+
+namespace {
+std::string TempFilePath(const std::string& file_name) {
+  return (std::filesystem::temp_directory_path() / file_name).string();
+}
+
+void WriteFile(const std::string& file_path, const std::string& content) {
+  std::ofstream out(file_path, std::ios::binary);
+  out << content;
+}
+}  // namespace
+
+TEST(test_load, load_csv_irregular_lines) {
+  using namespace kuiper_infer;
+  // 缺失的值为0, 第一个空行之后的内容不读取
+  const std::string file_path = TempFilePath("kuiper_load_irregular.csv");
+  WriteFile(file_path, "1,2.5,-3\r\n4,, +6\n7,1e2\n\n9,9,9,9\n");
+  const arma::fmat& data = CSVDataLoader::LoadData<float>(file_path);
+  ASSERT_EQ(data.n_rows, 3);
+  ASSERT_EQ(data.n_cols, 3);
+  const std::vector<float> expected = {1.f, 2.5f, -3.f, 4.f, 0.f, 6.f, 7.f, 100.f, 0.f};
+  for (uint32_t i = 0; i < 3; ++i) {
+    for (uint32_t j = 0; j < 3; ++j) {
+      ASSERT_EQ(data.at(i, j), expected.at(i * 3 + j));
+    }
+  }
+  std::filesystem::remove(file_path);
+}
+
+TEST(test_load, load_csv_chunks) {
+  using namespace kuiper_infer;
+  // 文件大于一个块, 由多个线程解析
+  const uint32_t rows = 1200;
+  const uint32_t cols = 500;
+  std::string content;
+  for (uint32_t i = 0; i < rows; ++i) {
+    for (uint32_t j = 0; j < cols; ++j) {
+      content += std::to_string(int32_t(i + j) - 700);
+      content += j + 1 < cols ? ',' : '\n';
+    }
+  }
+  ASSERT_GT(content.size(), 2u << 20);
+  const std::string file_path = TempFilePath("kuiper_load_chunks.csv");
+  WriteFile(file_path, content);
+
+  const arma::Mat<int32_t>& data = CSVDataLoader::LoadData<int32_t>(file_path);
+  ASSERT_EQ(data.n_rows, rows);
+  ASSERT_EQ(data.n_cols, cols);
+  for (uint32_t i = 0; i < rows; ++i) {
+    for (uint32_t j = 0; j < cols; ++j) {
+      ASSERT_EQ(data.at(i, j), int32_t(i + j) - 700);
+    }
+  }
+
+  // 直接读入张量的通道
+  std::shared_ptr<Tensor<float>> tensor = std::make_shared<Tensor<float>>(2, rows, cols);
+  ASSERT_TRUE(CSVDataLoader::LoadData(file_path, tensor->slice(1)));
+  ASSERT_EQ(tensor->at(1, rows - 1, cols - 1), float(rows + cols - 2) - 700.f);
+  std::filesystem::remove(file_path);
+}
+
+TEST(test_load, load_csv_missing_file) {
+  using namespace kuiper_infer;
+  const arma::fmat& data = CSVDataLoader::LoadData<float>("./tmp/data_loader/not_exist.csv");
+  ASSERT_TRUE(data.empty());
+}
+
+TEST(test_load, npy_tensor) {
+  using namespace kuiper_infer;
+  const std::string file_path = TempFilePath("kuiper_tensor.npy");
+  const std::vector<std::vector<uint32_t>> shapes_list = {{3, 17, 29}, {17, 29}, {29}};
+  for (const auto& shapes : shapes_list) {
+    std::shared_ptr<Tensor<float>> tensor = std::make_shared<Tensor<float>>(shapes);
+    tensor->RandN();
+    ASSERT_TRUE(NpyDataLoader::SaveTensor(file_path, tensor));
+    std::shared_ptr<Tensor<float>> loaded = NpyDataLoader::LoadTensor<float>(file_path);
+    ASSERT_NE(loaded, nullptr);
+    ASSERT_EQ(loaded->raw_shapes(), shapes);
+    for (uint32_t i = 0; i < tensor->size(); ++i) {
+      ASSERT_EQ(loaded->index(i), tensor->index(i));
+    }
+  }
+
+  // 类型不匹配
+  ASSERT_EQ(NpyDataLoader::LoadTensor<int32_t>(file_path), nullptr);
+  std::filesystem::remove(file_path);
+}
+
+TEST(test_load, npy_matrix) {
+  using namespace kuiper_infer;
+  const std::string file_path = TempFilePath("kuiper_matrix.npy");
+  arma::Mat<uint8_t> data(13, 7);
+  for (uint32_t i = 0; i < data.n_elem; ++i) {
+    data.at(i) = uint8_t(i * 7);
+  }
+  // 矩阵按fortran顺序保存
+  ASSERT_TRUE(NpyDataLoader::SaveData(file_path, data));
+  const arma::Mat<uint8_t>& loaded = NpyDataLoader::LoadData<uint8_t>(file_path);
+  ASSERT_EQ(loaded.n_rows, 13);
+  ASSERT_EQ(loaded.n_cols, 7);
+  std::shared_ptr<Tensor<uint8_t>> tensor = NpyDataLoader::LoadTensor<uint8_t>(file_path);
+  ASSERT_NE(tensor, nullptr);
+  for (uint32_t i = 0; i < 13; ++i) {
+    for (uint32_t j = 0; j < 7; ++j) {
+      ASSERT_EQ(loaded.at(i, j), data.at(i, j));
+      ASSERT_EQ(tensor->at(0, i, j), data.at(i, j));
+    }
+  }
+  std::filesystem::remove(file_path);
+}
+
+TEST(test_load, npy_version2_header) {
+  using namespace kuiper_infer;
+  // numpy写出的2.0版本文件, header长度为4字节
+  std::string header = "{'descr': '<i4', 'fortran_order': False, 'shape': (1, 2, 3), }";
+  header.append(64 - (12 + header.size() + 1) % 64, ' ');
+  header += '\n';
+  std::string content = std::string("\x93NUMPY") + char(2) + char(0);
+  const uint32_t header_length = header.size();
+  for (uint32_t i = 0; i < 4; ++i) {
+    content += char(header_length >> (8 * i) & 0xff);
+  }
+  content += header;
+  for (int32_t value = 0; value < 6; ++value) {
+    content.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+  const std::string file_path = TempFilePath("kuiper_version2.npy");
+  WriteFile(file_path, content);
+
+  std::shared_ptr<Tensor<int32_t>> tensor = NpyDataLoader::LoadTensor<int32_t>(file_path);
+  ASSERT_NE(tensor, nullptr);
+  ASSERT_EQ(tensor->raw_shapes(), std::vector<uint32_t>({2, 3}));
+  const arma::Mat<int32_t>& data = NpyDataLoader::LoadData<int32_t>(file_path);
+  ASSERT_EQ(data.n_rows, 2);
+  ASSERT_EQ(data.n_cols, 3);
+  for (uint32_t i = 0; i < 2; ++i) {
+    for (uint32_t j = 0; j < 3; ++j) {
+      ASSERT_EQ(tensor->at(0, i, j), int32_t(i * 3 + j));
+      ASSERT_EQ(data.at(i, j), int32_t(i * 3 + j));
+    }
+  }
+  std::filesystem::remove(file_path);
+}
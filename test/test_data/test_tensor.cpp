@@ -875,6 +875,45 @@ TEST(test_tensor, reshape2) {
   }
 }
 
+TEST(test_tensor, view1) {
+  using namespace kuiper_infer;
+  // 通道为向量, 按行优先展开不改变内存顺序
+  sftensor data = TensorCreate<float>(6, 1, 4);
+  data->RandN();
+  ASSERT_TRUE(data->IsViewable({24}));
+  ASSERT_TRUE(data->IsViewable({2, 12, 1}));
+  ASSERT_FALSE(data->IsViewable({4, 6}));
+
+  sftensor view = data->View({24});
+  ASSERT_EQ(view->raw_ptr(), data->raw_ptr());
+  ASSERT_EQ(view->raw_shapes(), std::vector<uint32_t>{24});
+  sftensor copy = TensorClone(data);
+  copy->Reshape({24}, true);
+  for (uint32_t i = 0; i < 24; ++i) {
+    ASSERT_EQ(view->index(i), copy->index(i));
+  }
+}
+
+TEST(test_tensor, view2) {
+  using namespace kuiper_infer;
+  sftensor data = TensorCreate<float>(4, 3, 5);
+  data->RandN();
+  ASSERT_TRUE(data->IsViewable({4, 3, 5}));
+  ASSERT_FALSE(data->IsViewable({2, 6, 5}));
+  ASSERT_FALSE(data->IsViewable({60}));
+  ASSERT_FALSE(data->IsViewable({4, 3, 4}));
+
+  // 通道大小相同时可以引用, 否则按行优先拷贝
+  sftensor view = TensorReshape(data, {4, 3, 5});
+  ASSERT_EQ(view->raw_ptr(), data->raw_ptr());
+
+  sftensor reshaped = TensorReshape(data, {60});
+  ASSERT_NE(reshaped->raw_ptr(), data->raw_ptr());
+  sftensor copy = TensorClone(data);
+  copy->Reshape({60}, true);
+  ASSERT_TRUE(TensorIsSame(reshaped, copy, 0.f));
+}
+
 TEST(test_tensor, ones) {
   using namespace kuiper_infer;
   Tensor<float> tensor(3, 4, 5);
@@ -0,0 +1,165 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include "data/tensor_elementwise.hpp"
+
+namespace {
+using namespace kuiper_infer;
+
+float ReferenceBinary(BinaryType type, float a, float b) {
+  switch (type) {
+    case BinaryType::kAdd:
+      return a + b;
+    case BinaryType::kSub:
+      return a - b;
+    case BinaryType::kMul:
+      return a * b;
+    case BinaryType::kDiv:
+      return a / b;
+    case BinaryType::kMax:
+      return std::max(a, b);
+    default:
+      return std::min(a, b);
+  }
+}
+
+// 按广播规则逐元素计算结果
+void CheckBinary(BinaryType type, const sftensor& tensor1, const sftensor& tensor2,
+                 const sftensor& output) {
+  for (uint32_t c = 0; c < output->channels(); ++c) {
+    for (uint32_t r = 0; r < output->rows(); ++r) {
+      for (uint32_t col = 0; col < output->cols(); ++col) {
+        const float a = tensor1->at(c % tensor1->channels(), r % tensor1->rows(),
+                                    col % tensor1->cols());
+        const float b = tensor2->at(c % tensor2->channels(), r % tensor2->rows(),
+                                    col % tensor2->cols());
+        ASSERT_FLOAT_EQ(output->at(c, r, col), ReferenceBinary(type, a, b));
+      }
+    }
+  }
+}
+
+sftensor RandomTensor(const std::vector<uint32_t>& shapes) {
+  sftensor tensor = std::make_shared<ftensor>(shapes.at(0), shapes.at(1), shapes.at(2));
+  tensor->RandN();
+  // 避免除数接近0
+  for (uint32_t i = 0; i < tensor->size(); ++i) {
+    tensor->index(i) += tensor->index(i) >= 0.f ? 0.5f : -0.5f;
+  }
+  return tensor;
+}
+}  // namespace
+
+TEST(test_tensor_elementwise, broadcast_shapes) {
+  using namespace kuiper_infer;
+  ASSERT_EQ(TensorBroadcastShapes({3, 4, 5}, {3, 4, 5}), std::vector<uint32_t>({3, 4, 5}));
+  ASSERT_EQ(TensorBroadcastShapes({3, 4, 5}, {1, 1, 1}), std::vector<uint32_t>({3, 4, 5}));
+  ASSERT_EQ(TensorBroadcastShapes({1, 4, 1}, {3, 1, 5}), std::vector<uint32_t>({3, 4, 5}));
+  ASSERT_DEATH(TensorBroadcastShapes({3, 4, 5}, {2, 4, 5}), "");
+}
+
+TEST(test_tensor_elementwise, broadcast) {
+  using namespace kuiper_infer;
+  const std::vector<std::pair<std::vector<uint32_t>, std::vector<uint32_t>>> shapes_pairs = {
+      {{3, 37, 29}, {3, 37, 29}},  // 形状相同
+      {{3, 37, 29}, {1, 1, 1}},    // 标量
+      {{3, 37, 29}, {3, 1, 1}},    // 每个通道一个值
+      {{3, 37, 29}, {1, 37, 29}},  // 通道广播
+      {{3, 37, 29}, {3, 1, 29}},   // 行广播
+      {{3, 37, 29}, {1, 37, 1}},   // 列广播
+      {{1, 37, 1}, {3, 1, 29}},    // 两个操作数都被广播
+      {{1, 1, 1}, {2, 19, 3}},
+      {{1, 1, 67}, {1, 1, 1}},
+      {{4, 1, 1}, {4, 1, 1}},
+  };
+  const BinaryType types[] = {BinaryType::kAdd, BinaryType::kSub, BinaryType::kMul,
+                              BinaryType::kDiv, BinaryType::kMax, BinaryType::kMin};
+  for (const auto& [shapes1, shapes2] : shapes_pairs) {
+    const sftensor tensor1 = RandomTensor(shapes1);
+    const sftensor tensor2 = RandomTensor(shapes2);
+    for (BinaryType type : types) {
+      const sftensor output1 = TensorElementBinary(type, tensor1, tensor2);
+      ASSERT_EQ(output1->shapes(), TensorBroadcastShapes(shapes1, shapes2));
+      CheckBinary(type, tensor1, tensor2, output1);
+
+      const sftensor output2 = TensorElementBinary(type, tensor2, tensor1);
+      CheckBinary(type, tensor2, tensor1, output2);
+    }
+  }
+}
+
+TEST(test_tensor_elementwise, large) {
+  using namespace kuiper_infer;
+  // 超过一个任务块的大小, 按块并行计算
+  const sftensor tensor1 = RandomTensor({5, 150, 131});
+  const sftensor tensor2 = RandomTensor({5, 1, 1});
+  const sftensor tensor3 = RandomTensor({1, 150, 1});
+  CheckBinary(BinaryType::kMul, tensor1, tensor2,
+              TensorElementBinary(BinaryType::kMul, tensor1, tensor2));
+  CheckBinary(BinaryType::kSub, tensor1, tensor1,
+              TensorElementBinary(BinaryType::kSub, tensor1, tensor1));
+  CheckBinary(BinaryType::kAdd, tensor3, tensor1,
+              TensorElementBinary(BinaryType::kAdd, tensor3, tensor1));
+}
+
+TEST(test_tensor_elementwise, in_place) {
+  using namespace kuiper_infer;
+  const sftensor tensor1 = RandomTensor({3, 17, 11});
+  const sftensor tensor2 = RandomTensor({1, 17, 1});
+  const sftensor origin = std::make_shared<ftensor>(*tensor1);
+  TensorElementBinary(BinaryType::kDiv, tensor1, tensor2, tensor1);
+  CheckBinary(BinaryType::kDiv, origin, tensor2, tensor1);
+
+  const sftensor tensor3 = RandomTensor({3, 17, 11});
+  const sftensor origin3 = std::make_shared<ftensor>(*tensor3);
+  TensorElementBinary(BinaryType::kMax, tensor2, tensor3, tensor3);
+  CheckBinary(BinaryType::kMax, tensor2, origin3, tensor3);
+}
+
+TEST(test_tensor_elementwise, uint8) {
+  using namespace kuiper_infer;
+  const su1tensor tensor1 = std::make_shared<u1tensor>(2, 9, 5);
+  const su1tensor tensor2 = std::make_shared<u1tensor>(2, 1, 5);
+  for (uint32_t i = 0; i < tensor1->size(); ++i) {
+    tensor1->index(i) = uint8_t(i);
+  }
+  for (uint32_t i = 0; i < tensor2->size(); ++i) {
+    tensor2->index(i) = uint8_t(3 * i + 1);
+  }
+  const su1tensor output = TensorElementBinary(BinaryType::kMin, tensor1, tensor2);
+  for (uint32_t c = 0; c < 2; ++c) {
+    for (uint32_t r = 0; r < 9; ++r) {
+      for (uint32_t col = 0; col < 5; ++col) {
+        ASSERT_EQ(output->at(c, r, col), std::min(tensor1->at(c, r, col), tensor2->at(c, 0, col)));
+      }
+    }
+  }
+}
+
+TEST(test_tensor_elementwise, output_shape_mismatch) {
+  using namespace kuiper_infer;
+  const sftensor tensor1 = RandomTensor({3, 4, 5});
+  const sftensor tensor2 = RandomTensor({3, 1, 1});
+  ASSERT_DEATH(TensorElementBinary(BinaryType::kAdd, tensor1, tensor2, tensor2), "");
+}
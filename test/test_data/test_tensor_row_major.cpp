@@ -0,0 +1,182 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cstdint>
+#include "data/tensor_row_major.hpp"
+
+TEST(test_tensor_row_major, init) {
+  using namespace kuiper_infer;
+  RowMajorTensor<float> f1(3, 5, 7);
+  ASSERT_EQ(f1.channels(), 3);
+  ASSERT_EQ(f1.rows(), 5);
+  ASSERT_EQ(f1.cols(), 7);
+  ASSERT_EQ(f1.size(), 3 * 5 * 7);
+  ASSERT_FALSE(f1.is_view());
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(f1.raw_ptr()) % kTensorAlignment, 0);
+
+  RowMajorTensor<float> f2(std::vector<uint32_t>{24});
+  ASSERT_EQ(f2.raw_shapes(), std::vector<uint32_t>{24});
+  ASSERT_EQ(f2.shapes(), std::vector<uint32_t>({1, 1, 24}));
+
+  RowMajorTensor<uint8_t> f3(std::vector<uint32_t>{3, 31});
+  ASSERT_EQ(f3.raw_shapes(), std::vector<uint32_t>({3, 31}));
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(f3.raw_ptr()) % kTensorAlignment, 0);
+}
+
+TEST(test_tensor_row_major, at_index) {
+  using namespace kuiper_infer;
+  RowMajorTensor<int32_t> f1(2, 3, 4);
+  for (uint32_t i = 0; i < f1.size(); ++i) {
+    f1.index(i) = int32_t(i);
+  }
+  // 同一行的元素在内存中相邻
+  for (uint32_t c = 0; c < 2; ++c) {
+    for (uint32_t r = 0; r < 3; ++r) {
+      for (uint32_t col = 0; col < 4; ++col) {
+        ASSERT_EQ(f1.at(c, r, col), int32_t(c * 12 + r * 4 + col));
+      }
+    }
+  }
+  ASSERT_EQ(*f1.matrix_raw_ptr(1), 12);
+}
+
+TEST(test_tensor_row_major, fill_values) {
+  using namespace kuiper_infer;
+  RowMajorTensor<float> f1(2, 3, 5);
+  std::vector<float> values(f1.size());
+  for (uint32_t i = 0; i < values.size(); ++i) {
+    values.at(i) = float(i);
+  }
+  f1.Fill(values);
+  ASSERT_EQ(f1.values(), values);
+  ASSERT_EQ(f1.at(1, 2, 3), 28.f);
+
+  f1.Fill(2.f);
+  for (float value : f1.values()) {
+    ASSERT_EQ(value, 2.f);
+  }
+}
+
+TEST(test_tensor_row_major, to_tensor) {
+  using namespace kuiper_infer;
+  for (const auto& shapes : std::vector<std::vector<uint32_t>>{
+           {3, 17, 33}, {1, 40, 21}, {1, 1, 19}, {4, 1, 18}, {2, 35, 1}}) {
+    Tensor<float> tensor(shapes.at(0), shapes.at(1), shapes.at(2));
+    tensor.RandN();
+    RowMajorTensor<float> row_major(tensor);
+    ASSERT_EQ(row_major.raw_shapes(), tensor.raw_shapes());
+    ASSERT_EQ(row_major.values(), tensor.values(true));
+    for (uint32_t c = 0; c < tensor.channels(); ++c) {
+      for (uint32_t r = 0; r < tensor.rows(); ++r) {
+        for (uint32_t col = 0; col < tensor.cols(); ++col) {
+          ASSERT_EQ(row_major.at(c, r, col), tensor.at(c, r, col));
+        }
+      }
+    }
+
+    std::shared_ptr<Tensor<float>> converted = row_major.ToTensor();
+    ASSERT_EQ(converted->shapes(), tensor.shapes());
+    ASSERT_EQ(converted->raw_shapes(), tensor.raw_shapes());
+    ASSERT_EQ(converted->values(false), tensor.values(false));
+  }
+}
+
+TEST(test_tensor_row_major, fill_row_major) {
+  using namespace kuiper_infer;
+  Tensor<float> tensor(3, 19, 37);
+  std::vector<float> values(tensor.size());
+  for (uint32_t i = 0; i < values.size(); ++i) {
+    values.at(i) = float(i);
+  }
+  tensor.Fill(values, true);
+  RowMajorTensor<float> row_major(3, 19, 37);
+  row_major.Fill(values);
+  for (uint32_t c = 0; c < 3; ++c) {
+    for (uint32_t r = 0; r < 19; ++r) {
+      for (uint32_t col = 0; col < 37; ++col) {
+        ASSERT_EQ(tensor.at(c, r, col), row_major.at(c, r, col));
+      }
+    }
+  }
+  ASSERT_EQ(tensor.values(true), values);
+}
+
+TEST(test_tensor_row_major, reshape) {
+  using namespace kuiper_infer;
+  RowMajorTensor<float> f1(2, 3, 4);
+  for (uint32_t i = 0; i < f1.size(); ++i) {
+    f1.index(i) = float(i);
+  }
+  const float* data = f1.raw_ptr();
+  // 行优先的变形不移动数据
+  f1.Reshape({4, 6});
+  ASSERT_EQ(f1.raw_shapes(), std::vector<uint32_t>({4, 6}));
+  ASSERT_EQ(f1.shapes(), std::vector<uint32_t>({1, 4, 6}));
+  ASSERT_EQ(f1.raw_ptr(), data);
+  ASSERT_EQ(f1.at(0, 2, 5), 17.f);
+
+  f1.Reshape({24});
+  ASSERT_EQ(f1.at(0, 0, 23), 23.f);
+  ASSERT_DEATH(f1.Reshape({5, 5}), "");
+}
+
+TEST(test_tensor_row_major, view_and_copy) {
+  using namespace kuiper_infer;
+  std::vector<float> data(2 * 3 * 4);
+  for (uint32_t i = 0; i < data.size(); ++i) {
+    data.at(i) = float(i);
+  }
+  RowMajorTensor<float> view(data.data(), {2, 3, 4});
+  ASSERT_TRUE(view.is_view());
+  ASSERT_EQ(view.at(1, 2, 3), 23.f);
+  view.at(0, 1, 1) = -1.f;
+  ASSERT_EQ(data.at(5), -1.f);
+
+  // 拷贝得到拥有内存的张量
+  RowMajorTensor<float> copy(view);
+  ASSERT_FALSE(copy.is_view());
+  ASSERT_NE(copy.raw_ptr(), view.raw_ptr());
+  ASSERT_EQ(copy.values(), data);
+}
+
+TEST(test_tensor_row_major, cube_view) {
+  using namespace kuiper_infer;
+  RowMajorTensor<float> f1(2, 3, 4);
+  for (uint32_t i = 0; i < f1.size(); ++i) {
+    f1.index(i) = float(i);
+  }
+  arma::fcube cube = f1.cube();
+  ASSERT_EQ(cube.memptr(), f1.raw_ptr());
+  ASSERT_EQ(cube.n_rows, 4);
+  ASSERT_EQ(cube.n_cols, 3);
+  ASSERT_EQ(cube.n_slices, 2);
+  for (uint32_t c = 0; c < 2; ++c) {
+    for (uint32_t r = 0; r < 3; ++r) {
+      for (uint32_t col = 0; col < 4; ++col) {
+        ASSERT_EQ(cube.at(col, r, c), f1.at(c, r, col));
+      }
+    }
+  }
+  cube.slice(1).fill(0.f);
+  ASSERT_EQ(f1.at(1, 0, 0), 0.f);
+}
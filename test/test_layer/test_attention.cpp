@@ -0,0 +1,220 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "../../source/layer/details/attention.hpp"
+#include "runtime/runtime_kv_cache.hpp"
+
+TEST(test_kv_cache, block_allocation) {
+  using namespace kuiper_infer;
+  KVCache kv_cache(2, 3, 8, 4, 5);
+  ASSERT_EQ(kv_cache.bytes(), 2 * 3 * 2 * 4 * 8 * 5 * sizeof(float));
+  ASSERT_EQ(kv_cache.free_block_num(), 5);
+
+  const int32_t seq0 = kv_cache.AddSequence();
+  const int32_t seq1 = kv_cache.AddSequence();
+  ASSERT_NE(seq0, seq1);
+  ASSERT_TRUE(kv_cache.Extend(seq0, 5));
+  ASSERT_EQ(kv_cache.length(seq0), 5);
+  ASSERT_EQ(kv_cache.free_block_num(), 3);
+  ASSERT_TRUE(kv_cache.Extend(seq0, 3));
+  ASSERT_EQ(kv_cache.free_block_num(), 3);
+
+  ASSERT_TRUE(kv_cache.Extend(seq1, 12));
+  ASSERT_EQ(kv_cache.free_block_num(), 0);
+  ASSERT_FALSE(kv_cache.Extend(seq0, 1));
+  ASSERT_EQ(kv_cache.length(seq0), 8);
+
+  // 不同序列, 层, 头以及key和value的位置互不重叠
+  std::vector<const float*> slots;
+  for (int32_t seq : {seq0, seq1}) {
+    for (uint32_t layer = 0; layer < 2; ++layer) {
+      for (uint32_t head = 0; head < 3; ++head) {
+        for (uint32_t pos = 0; pos < kv_cache.length(seq); ++pos) {
+          slots.push_back(kv_cache.key(seq, layer, head, pos));
+          slots.push_back(kv_cache.value(seq, layer, head, pos));
+          ASSERT_EQ(kv_cache.key(seq, layer, head, pos),
+                    kv_cache.key_block(seq, layer, head, pos / 4) + (pos % 4) * 8);
+        }
+      }
+    }
+  }
+  std::sort(slots.begin(), slots.end());
+  for (uint32_t i = 1; i < slots.size(); ++i) {
+    ASSERT_GE(slots.at(i) - slots.at(i - 1), 8);
+  }
+
+  kv_cache.Truncate(seq1, 5);
+  ASSERT_EQ(kv_cache.free_block_num(), 1);
+  kv_cache.FreeSequence(seq0);
+  ASSERT_EQ(kv_cache.free_block_num(), 3);
+  ASSERT_EQ(kv_cache.AddSequence(), seq0);
+  ASSERT_EQ(kv_cache.length(seq0), 0);
+}
+
+namespace {
+// 不使用kv cache, 对全部token重新计算的因果注意力
+std::vector<float> ReferenceAttention(const std::vector<float>& query,
+                                      const std::vector<float>& key,
+                                      const std::vector<float>& value, uint32_t tokens,
+                                      uint32_t head_num, uint32_t kv_head_num, uint32_t head_dim,
+                                      float rope_theta) {
+  const uint32_t query_dim = head_num * head_dim;
+  const uint32_t kv_dim = kv_head_num * head_dim;
+  auto rotate = [&](std::vector<float> data, uint32_t dim) {
+    for (uint32_t t = 0; t < tokens; ++t) {
+      for (uint32_t h = 0; h < dim / head_dim; ++h) {
+        for (uint32_t p = 0; p < head_dim / 2; ++p) {
+          const double angle = t * std::pow(double(rope_theta), -2. * p / head_dim);
+          float* pair = data.data() + t * dim + h * head_dim + 2 * p;
+          const float x0 = pair[0];
+          const float x1 = pair[1];
+          pair[0] = float(x0 * std::cos(angle) - x1 * std::sin(angle));
+          pair[1] = float(x0 * std::sin(angle) + x1 * std::cos(angle));
+        }
+      }
+    }
+    return data;
+  };
+  const std::vector<float> rotated_query = rotate(query, query_dim);
+  const std::vector<float> rotated_key = rotate(key, kv_dim);
+
+  std::vector<float> output(tokens * query_dim);
+  for (uint32_t t = 0; t < tokens; ++t) {
+    for (uint32_t h = 0; h < head_num; ++h) {
+      const uint32_t kv_head = h / (head_num / kv_head_num);
+      std::vector<double> scores(t + 1);
+      for (uint32_t j = 0; j <= t; ++j) {
+        double score = 0.;
+        for (uint32_t d = 0; d < head_dim; ++d) {
+          score += double(rotated_query.at(t * query_dim + h * head_dim + d)) *
+                   rotated_key.at(j * kv_dim + kv_head * head_dim + d);
+        }
+        scores.at(j) = score / std::sqrt(double(head_dim));
+      }
+      const double max_score = *std::max_element(scores.begin(), scores.end());
+      double sum = 0.;
+      for (double& score : scores) {
+        score = std::exp(score - max_score);
+        sum += score;
+      }
+      for (uint32_t d = 0; d < head_dim; ++d) {
+        double result = 0.;
+        for (uint32_t j = 0; j <= t; ++j) {
+          result += scores.at(j) / sum * value.at(j * kv_dim + kv_head * head_dim + d);
+        }
+        output.at(t * query_dim + h * head_dim + d) = float(result);
+      }
+    }
+  }
+  return output;
+}
+
+kuiper_infer::sftensor MakeTokens(const std::vector<float>& data, uint32_t dim, uint32_t begin,
+                                  uint32_t end) {
+  auto tensor = std::make_shared<kuiper_infer::ftensor>(1, dim, end - begin);
+  std::copy(data.begin() + begin * dim, data.begin() + end * dim, tensor->raw_ptr());
+  return tensor;
+}
+}  // namespace
+
+TEST(test_attention, prefill_and_decode) {
+  using namespace kuiper_infer;
+  const uint32_t head_num = 4;
+  const uint32_t kv_head_num = 2;
+  const uint32_t head_dim = 20;
+  const uint32_t tokens = 11;
+  const uint32_t prefill = 6;
+  const uint32_t query_dim = head_num * head_dim;
+  const uint32_t kv_dim = kv_head_num * head_dim;
+
+  std::mt19937 mt(3);
+  std::normal_distribution<float> dist;
+  std::vector<std::vector<float>> queries(2), keys(2), values(2), expected(2);
+  for (uint32_t s = 0; s < 2; ++s) {
+    queries.at(s).resize(tokens * query_dim);
+    keys.at(s).resize(tokens * kv_dim);
+    values.at(s).resize(tokens * kv_dim);
+    for (float& v : queries.at(s)) v = dist(mt);
+    for (float& v : keys.at(s)) v = dist(mt);
+    for (float& v : values.at(s)) v = dist(mt);
+    expected.at(s) = ReferenceAttention(queries.at(s), keys.at(s), values.at(s), tokens, head_num,
+                                        kv_head_num, head_dim, 10000.f);
+  }
+
+  // 两个序列共用同一个block池, block的大小不整除序列长度
+  auto kv_cache = std::make_shared<KVCache>(2, kv_head_num, head_dim, 4, 8);
+  MultiHeadAttentionLayer attention_layer(head_num, kv_head_num, head_dim, 1, kv_cache);
+  const std::vector<int32_t> seq_ids = {kv_cache->AddSequence(), kv_cache->AddSequence()};
+  attention_layer.set_sequences(seq_ids);
+
+  for (uint32_t begin = 0; begin < tokens;) {
+    const uint32_t end = begin == 0 ? prefill : begin + 1;
+    std::vector<sftensor> inputs;
+    std::vector<sftensor> outputs(2);
+    for (uint32_t s = 0; s < 2; ++s) {
+      ASSERT_TRUE(kv_cache->Extend(seq_ids.at(s), end - begin));
+      inputs.push_back(MakeTokens(queries.at(s), query_dim, begin, end));
+      inputs.push_back(MakeTokens(keys.at(s), kv_dim, begin, end));
+      inputs.push_back(MakeTokens(values.at(s), kv_dim, begin, end));
+    }
+    ASSERT_EQ(attention_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+    for (uint32_t s = 0; s < 2; ++s) {
+      ASSERT_EQ(outputs.at(s)->size(), (end - begin) * query_dim);
+      for (uint32_t i = 0; i < outputs.at(s)->size(); ++i) {
+        ASSERT_NEAR(outputs.at(s)->index(i), expected.at(s).at(begin * query_dim + i), 1e-4f)
+            << "sequence: " << s << " token: " << begin + i / query_dim;
+      }
+    }
+    begin = end;
+  }
+  ASSERT_EQ(kv_cache->length(seq_ids.front()), tokens);
+  ASSERT_EQ(kv_cache->free_block_num(), 2);
+}
+
+TEST(test_attention, without_rope) {
+  using namespace kuiper_infer;
+  auto kv_cache = std::make_shared<KVCache>(1, 1, 8, 16, 1);
+  MultiHeadAttentionLayer attention_layer(1, 1, 8, 0, kv_cache, 0.f);
+  attention_layer.set_sequences({kv_cache->AddSequence()});
+
+  // 所有key相同时, 输出为value的平均值
+  std::vector<float> values;
+  for (uint32_t t = 0; t < 3; ++t) {
+    ASSERT_TRUE(kv_cache->Extend(0, 1));
+    sftensor query = std::make_shared<ftensor>(1, 8, 1);
+    query->RandN();
+    sftensor key = std::make_shared<ftensor>(1, 8, 1);
+    key->Fill(1.f);
+    sftensor value = std::make_shared<ftensor>(1, 8, 1);
+    value->Fill(float(t));
+    std::vector<sftensor> inputs = {query, key, value};
+    std::vector<sftensor> outputs(1);
+    ASSERT_EQ(attention_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+    for (uint32_t d = 0; d < 8; ++d) {
+      ASSERT_NEAR(outputs.front()->index(d), float(t) / 2.f, 1e-5f);
+    }
+  }
+}
@@ -0,0 +1,103 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include "../../source/layer/details/linear.hpp"
+#include "../../source/layer/details/matmul.hpp"
+#include "utils/math/gemv.hpp"
+
+TEST(test_gemv, kernel) {
+  using namespace kuiper_infer;
+  std::mt19937 mt(11);
+  std::normal_distribution<float> dist;
+  for (uint32_t rows : {1, 7, 37, 1024}) {
+    for (uint32_t depth : {3, 75, 4096}) {
+      std::vector<float> weight(rows * depth);
+      std::vector<float> input(depth);
+      std::vector<float> bias(rows);
+      for (float& value : weight) value = dist(mt);
+      for (float& value : input) value = dist(mt);
+      for (float& value : bias) value = dist(mt);
+
+      std::vector<float> output(rows);
+      math::Gemv(weight.data(), rows, depth, input.data(), bias.data(), output.data());
+      for (uint32_t n = 0; n < rows; ++n) {
+        double expected = bias.at(n);
+        for (uint32_t k = 0; k < depth; ++k) {
+          expected += double(weight.at(n * depth + k)) * input.at(k);
+        }
+        ASSERT_NEAR(output.at(n), expected, 1e-5 * depth)
+            << "rows: " << rows << " depth: " << depth;
+      }
+    }
+  }
+}
+
+TEST(test_gemv, linear_single_row) {
+  using namespace kuiper_infer;
+  const uint32_t in_features = 259;
+  const uint32_t out_features = 131;
+  sftensor weight = std::make_shared<ftensor>(1, in_features, out_features);
+  weight->RandN();
+  sftensor bias = std::make_shared<ftensor>(1, 1, out_features);
+  bias->RandN();
+  LinearLayer linear_layer(in_features, out_features, true);
+  linear_layer.set_weights(std::vector<sftensor>{weight});
+  linear_layer.set_bias(std::vector<sftensor>{bias});
+
+  sftensor input = std::make_shared<ftensor>(1, 1, in_features);
+  input->RandN();
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> outputs = {std::make_shared<ftensor>(1, 1, out_features)};
+  ASSERT_EQ(linear_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+
+  const arma::fmat weight_t(weight->raw_ptr(), in_features, out_features, false, true);
+  const arma::fmat input_row(input->raw_ptr(), 1, in_features, false, true);
+  const arma::fmat expected = input_row * weight_t + bias->slice(0);
+  for (uint32_t j = 0; j < out_features; ++j) {
+    ASSERT_NEAR(outputs.front()->index(j), expected.at(0, j), 1e-4f);
+  }
+}
+
+TEST(test_gemv, matmul_single_token) {
+  using namespace kuiper_infer;
+  const uint32_t weight_dim0 = 67;
+  const uint32_t weight_dim1 = 96;
+  sftensor weight = std::make_shared<ftensor>(1, weight_dim0, weight_dim1);
+  weight->RandN();
+  LLamaMatmulLayer matmul_layer(weight_dim0, weight_dim1);
+  matmul_layer.set_weights({weight});
+
+  sftensor input = std::make_shared<ftensor>(weight_dim1, 1);
+  input->RandN();
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> outputs = {std::make_shared<ftensor>(1, weight_dim0, 1)};
+  ASSERT_EQ(matmul_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+  for (uint32_t n = 0; n < weight_dim0; ++n) {
+    float expected = 0.f;
+    for (uint32_t k = 0; k < weight_dim1; ++k) {
+      expected += weight->index(n * weight_dim1 + k) * input->index(k);
+    }
+    ASSERT_NEAR(outputs.front()->index(n), expected, 1e-4f);
+  }
+}
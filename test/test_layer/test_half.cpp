@@ -0,0 +1,309 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include "../../source/layer/details/base_convolution.hpp"
+#include "../../source/layer/details/convolution.hpp"
+#include "../../source/layer/details/linear.hpp"
+#include "../../source/layer/details/matmul.hpp"
+#include "runtime/runtime_attr.hpp"
+#include "runtime/runtime_op.hpp"
+#include "utils/math/half_gemm.hpp"
+
+static std::vector<float> RoundToHalf(const std::vector<float>& values, RuntimeDataType type) {
+  std::vector<float> rounded;
+  for (float value : values) {
+    rounded.push_back(kuiper_infer::math::HalfToFloat(kuiper_infer::math::FloatToHalf(value, type),
+                                                      type));
+  }
+  return rounded;
+}
+
+TEST(test_half, conversion) {
+  using namespace kuiper_infer::math;
+  ASSERT_EQ(FloatToFloat16(1.f), 0x3c00);
+  ASSERT_EQ(FloatToFloat16(-2.f), 0xc000);
+  ASSERT_EQ(FloatToFloat16(65504.f), 0x7bff);
+  ASSERT_EQ(FloatToFloat16(1e6f), 0x7c00);
+  ASSERT_EQ(Float16ToFloat(0x0001), std::ldexp(1.f, -24));
+  ASSERT_EQ(Float16ToFloat(0x3555), 0.333251953125f);
+  ASSERT_TRUE(std::isnan(Float16ToFloat(FloatToFloat16(NAN))));
+
+  ASSERT_EQ(FloatToBFloat16(1.f), 0x3f80);
+  ASSERT_EQ(BFloat16ToFloat(0xc040), -3.f);
+  // 1 + 2^-8正好在两个bfloat16中间, 舍入到偶数
+  ASSERT_EQ(FloatToBFloat16(1.f + std::ldexp(1.f, -8)), 0x3f80);
+  ASSERT_EQ(FloatToBFloat16(1.f + 3 * std::ldexp(1.f, -8)), 0x3f82);
+
+  std::mt19937 mt(7);
+  std::normal_distribution<float> dist(0.f, 100.f);
+  for (uint32_t i = 0; i < 1000; ++i) {
+    const float value = dist(mt);
+    ASSERT_NEAR(Float16ToFloat(FloatToFloat16(value)), value, std::fabs(value) * 1e-3f);
+    ASSERT_NEAR(BFloat16ToFloat(FloatToBFloat16(value)), value, std::fabs(value) * 4e-3f);
+  }
+}
+
+TEST(test_half, attribute_get) {
+  using namespace kuiper_infer;
+  const std::vector<float> values = {1.f, -0.5f, 3.25f, 0.f};
+  for (RuntimeDataType type : {RuntimeDataType::kTypeFloat16, RuntimeDataType::kTypeBFloat16}) {
+    std::vector<char> data(values.size() * sizeof(uint16_t));
+    for (uint32_t i = 0; i < values.size(); ++i) {
+      const uint16_t half = math::FloatToHalf(values.at(i), type);
+      memcpy(data.data() + i * sizeof(uint16_t), &half, sizeof(uint16_t));
+    }
+    RuntimeAttribute attribute({4}, type, data);
+    ASSERT_EQ(attribute.get<uint16_t>(false).size(), values.size());
+    ASSERT_EQ(attribute.get<float>(), values);
+  }
+}
+
+TEST(test_half, gemm) {
+  using namespace kuiper_infer;
+  std::mt19937 mt(42);
+  std::normal_distribution<float> dist;
+  const uint32_t rows = 67;
+  const uint32_t channels = 37;
+  const uint32_t depth = 75;
+
+  std::vector<float> input(rows * depth);
+  std::vector<float> weight(channels * depth);
+  std::vector<float> bias(channels);
+  for (float& value : input) value = dist(mt);
+  for (float& value : weight) value = dist(mt);
+  for (float& value : bias) value = dist(mt);
+
+  for (RuntimeDataType type : {RuntimeDataType::kTypeFloat16, RuntimeDataType::kTypeBFloat16}) {
+    math::HalfWeight half_weight;
+    math::ConvertWeightToHalf(weight.data(), channels, depth, type, half_weight);
+    ASSERT_EQ(half_weight.bytes(), channels * depth * sizeof(uint16_t));
+    const std::vector<float>& rounded_weight = RoundToHalf(weight, type);
+
+    for (uint32_t gemm_rows : {rows, 1u}) {
+      const uint32_t begin = 3;
+      std::vector<float> output((channels - begin) * gemm_rows);
+      math::HalfGemm(input.data(), gemm_rows, half_weight, begin, channels, bias.data(),
+                     output.data());
+      for (uint32_t n = begin; n < channels; ++n) {
+        for (uint32_t m = 0; m < gemm_rows; ++m) {
+          float expected = bias.at(n);
+          for (uint32_t k = 0; k < depth; ++k) {
+            expected += input.at(m * depth + k) * rounded_weight.at(n * depth + k);
+          }
+          ASSERT_NEAR(output.at((n - begin) * gemm_rows + m), expected, 1e-3f);
+        }
+      }
+    }
+  }
+}
+
+TEST(test_half, linear) {
+  using namespace kuiper_infer;
+  const uint32_t in_features = 96;
+  const uint32_t out_features = 45;
+
+  for (uint32_t in_dims : {1, 7}) {
+    sftensor weight = std::make_shared<ftensor>(1, in_features, out_features);
+    weight->RandN();
+    sftensor bias = std::make_shared<ftensor>(1, 1, out_features);
+    bias->RandN();
+
+    math::HalfWeight half_weight;
+    math::ConvertWeightToHalf(weight->raw_ptr(), out_features, in_features,
+                              RuntimeDataType::kTypeFloat16, half_weight);
+    // 用舍入后的权重计算float结果作为参考
+    weight->Fill(RoundToHalf(weight->values(false), RuntimeDataType::kTypeFloat16), false);
+
+    LinearLayer float_layer(in_features, out_features, true);
+    float_layer.set_weights(std::vector<sftensor>{weight});
+    float_layer.set_bias(std::vector<sftensor>{bias});
+    LinearLayer half_layer(in_features, out_features, true);
+    half_layer.set_half_weights(half_weight);
+    half_layer.set_bias(std::vector<sftensor>{bias});
+    ASSERT_TRUE(half_layer.weights().front()->empty());
+
+    sftensor input = std::make_shared<ftensor>(1, in_dims, in_features);
+    input->RandN();
+    std::vector<sftensor> inputs = {input};
+    std::vector<sftensor> float_outputs = {std::make_shared<ftensor>(1, in_dims, out_features)};
+    std::vector<sftensor> half_outputs = {std::make_shared<ftensor>(1, in_dims, out_features)};
+    ASSERT_EQ(float_layer.Forward(inputs, float_outputs), StatusCode::kSuccess);
+    ASSERT_EQ(half_layer.Forward(inputs, half_outputs), StatusCode::kSuccess);
+    for (uint32_t i = 0; i < float_outputs.front()->size(); ++i) {
+      ASSERT_NEAR(half_outputs.front()->index(i), float_outputs.front()->index(i), 1e-3f);
+    }
+  }
+}
+
+TEST(test_half, conv) {
+  using namespace kuiper_infer;
+  const uint32_t in_channel = 16;
+  const uint32_t out_channel = 24;
+  for (uint32_t kernel_size : {1, 3}) {
+    for (uint32_t groups : {1, 2}) {
+      const uint32_t padding = kernel_size / 2;
+      const uint32_t depth = in_channel / groups * kernel_size * kernel_size;
+      std::vector<sftensor> weights;
+      std::vector<sftensor> bias;
+      std::vector<float> weight_values;
+      for (uint32_t k = 0; k < out_channel; ++k) {
+        sftensor weight = std::make_shared<ftensor>(in_channel / groups, kernel_size, kernel_size);
+        weight->RandN();
+        weight->Fill(RoundToHalf(weight->values(false), RuntimeDataType::kTypeBFloat16), false);
+        weights.push_back(weight);
+        const std::vector<float>& values = weight->values(false);
+        weight_values.insert(weight_values.end(), values.begin(), values.end());
+        sftensor bias_value = std::make_shared<ftensor>(1, 1, 1);
+        bias_value->RandN();
+        bias.push_back(bias_value);
+      }
+
+      ConvolutionLayer float_layer(out_channel, in_channel, kernel_size, kernel_size, padding,
+                                   padding, 1, 1, groups, true);
+      float_layer.set_weights(weights);
+      float_layer.set_bias(bias);
+      ConvolutionLayer half_layer(out_channel, in_channel, kernel_size, kernel_size, padding,
+                                  padding, 1, 1, groups, true);
+      half_layer.set_weights(weights);
+      half_layer.set_bias(bias);
+      math::HalfWeight half_weight;
+      math::ConvertWeightToHalf(weight_values.data(), out_channel, depth,
+                                RuntimeDataType::kTypeBFloat16, half_weight);
+      half_layer.set_half_weights(half_weight);
+      ASSERT_TRUE(half_layer.weights().front()->empty());
+
+      sftensor input = std::make_shared<ftensor>(in_channel, 19, 23);
+      input->RandN();
+      std::vector<sftensor> inputs = {input};
+      std::vector<sftensor> float_outputs(1);
+      std::vector<sftensor> half_outputs(1);
+      ASSERT_EQ(float_layer.Forward(inputs, float_outputs), StatusCode::kSuccess);
+      ASSERT_EQ(half_layer.Forward(inputs, half_outputs), StatusCode::kSuccess);
+      ASSERT_EQ(half_outputs.front()->shapes(), float_outputs.front()->shapes());
+      for (uint32_t i = 0; i < float_outputs.front()->size(); ++i) {
+        ASSERT_NEAR(half_outputs.front()->index(i), float_outputs.front()->index(i), 1e-3f)
+            << "kernel: " << kernel_size << " groups: " << groups;
+      }
+    }
+  }
+}
+
+TEST(test_half, conv_create_instance) {
+  using namespace kuiper_infer;
+  const int32_t in_channel = 8;
+  const int32_t out_channel = 4;
+  const int32_t kernel_size = 3;
+  // pnnx的卷积核按out_channel, in_channel, kernel_h, kernel_w行优先存放
+  std::mt19937 mt(11);
+  std::normal_distribution<float> dist;
+  std::vector<float> weight_values(out_channel * in_channel * kernel_size * kernel_size);
+  for (float& value : weight_values) value = dist(mt);
+  weight_values = RoundToHalf(weight_values, RuntimeDataType::kTypeFloat16);
+  std::vector<float> bias_values(out_channel);
+  for (float& value : bias_values) value = dist(mt);
+
+  auto create_conv = [&](RuntimeDataType type) {
+    std::shared_ptr<RuntimeOperator> op = std::make_shared<RuntimeOperator>();
+    op->type = "nn.Conv2d";
+    op->params["dilation"] = std::make_shared<RuntimeParameterIntArray>(std::vector<int32_t>{1, 1});
+    op->params["in_channels"] = std::make_shared<RuntimeParameterInt>(in_channel);
+    op->params["out_channels"] = std::make_shared<RuntimeParameterInt>(out_channel);
+    op->params["padding"] = std::make_shared<RuntimeParameterIntArray>(std::vector<int32_t>{1, 1});
+    op->params["bias"] = std::make_shared<RuntimeParameterBool>(true);
+    op->params["stride"] = std::make_shared<RuntimeParameterIntArray>(std::vector<int32_t>{1, 1});
+    op->params["kernel_size"] =
+        std::make_shared<RuntimeParameterIntArray>(std::vector<int32_t>{kernel_size, kernel_size});
+    op->params["padding_mode"] = std::make_shared<RuntimeParameterString>("zeros");
+    op->params["groups"] = std::make_shared<RuntimeParameterInt>(1);
+
+    std::vector<char> weight_data;
+    if (type == RuntimeDataType::kTypeFloat32) {
+      const char* ptr = reinterpret_cast<const char*>(weight_values.data());
+      weight_data.assign(ptr, ptr + weight_values.size() * sizeof(float));
+    } else {
+      std::vector<uint16_t> half_values;
+      for (float value : weight_values) {
+        half_values.push_back(math::FloatToHalf(value, type));
+      }
+      const char* ptr = reinterpret_cast<const char*>(half_values.data());
+      weight_data.assign(ptr, ptr + half_values.size() * sizeof(uint16_t));
+    }
+    op->attribute["weight"] = std::make_shared<RuntimeAttribute>(
+        std::vector<int32_t>{out_channel, in_channel, kernel_size, kernel_size}, type,
+        weight_data);
+    const char* bias_ptr = reinterpret_cast<const char*>(bias_values.data());
+    op->attribute["bias"] = std::make_shared<RuntimeAttribute>(
+        std::vector<int32_t>{out_channel}, RuntimeDataType::kTypeFloat32,
+        std::vector<char>(bias_ptr, bias_ptr + bias_values.size() * sizeof(float)));
+
+    std::shared_ptr<Layer<float>> conv_layer;
+    CHECK(BaseConvolutionLayer::CreateInstance(op, conv_layer) == StatusCode::kSuccess);
+    return conv_layer;
+  };
+
+  // 从模型加载的16位卷积核与float卷积核的平面布局一致
+  std::shared_ptr<Layer<float>> float_layer = create_conv(RuntimeDataType::kTypeFloat32);
+  std::shared_ptr<Layer<float>> half_layer = create_conv(RuntimeDataType::kTypeFloat16);
+  sftensor input = std::make_shared<ftensor>(in_channel, 11, 13);
+  input->RandN();
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> float_outputs(1);
+  std::vector<sftensor> half_outputs(1);
+  ASSERT_EQ(float_layer->Forward(inputs, float_outputs), StatusCode::kSuccess);
+  ASSERT_EQ(half_layer->Forward(inputs, half_outputs), StatusCode::kSuccess);
+  ASSERT_EQ(half_outputs.front()->shapes(), float_outputs.front()->shapes());
+  for (uint32_t i = 0; i < float_outputs.front()->size(); ++i) {
+    ASSERT_NEAR(half_outputs.front()->index(i), float_outputs.front()->index(i), 1e-3f);
+  }
+}
+
+TEST(test_half, matmul) {
+  using namespace kuiper_infer;
+  const uint32_t weight_dim0 = 33;
+  const uint32_t weight_dim1 = 64;
+  for (uint32_t tokens : {1, 5}) {
+    sftensor weight = std::make_shared<ftensor>(1, weight_dim0, weight_dim1);
+    weight->RandN();
+    math::HalfWeight half_weight;
+    math::ConvertWeightToHalf(weight->raw_ptr(), weight_dim0, weight_dim1,
+                              RuntimeDataType::kTypeFloat16, half_weight);
+    weight->Fill(RoundToHalf(weight->values(false), RuntimeDataType::kTypeFloat16), false);
+
+    LLamaMatmulLayer float_layer(weight_dim0, weight_dim1);
+    float_layer.set_weights({weight});
+    LLamaMatmulLayer half_layer(weight_dim0, weight_dim1);
+    half_layer.set_half_weights(half_weight);
+
+    sftensor input = std::make_shared<ftensor>(weight_dim1, tokens);
+    input->RandN();
+    std::vector<sftensor> inputs = {input};
+    std::vector<sftensor> float_outputs = {std::make_shared<ftensor>(1, weight_dim0, tokens)};
+    std::vector<sftensor> half_outputs = {std::make_shared<ftensor>(1, weight_dim0, tokens)};
+    ASSERT_EQ(float_layer.Forward(inputs, float_outputs), StatusCode::kSuccess);
+    ASSERT_EQ(half_layer.Forward(inputs, half_outputs), StatusCode::kSuccess);
+    for (uint32_t i = 0; i < float_outputs.front()->size(); ++i) {
+      ASSERT_NEAR(half_outputs.front()->index(i), float_outputs.front()->index(i), 1e-3f);
+    }
+  }
+}
@@ -0,0 +1,154 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include "../../source/layer/details/image_pre_process.hpp"
+
+namespace {
+std::vector<uint8_t> MakeImage(uint32_t rows, uint32_t cols, size_t step) {
+  std::vector<uint8_t> image(step * rows);
+  for (uint32_t i = 0; i < image.size(); ++i) {
+    image.at(i) = uint8_t((i * 37 + i / 7) % 256);
+  }
+  return image;
+}
+
+// 逐个像素的双线性插值, 与cv::resize的INTER_LINEAR相同
+float ReferencePixel(const std::vector<uint8_t>& image, uint32_t rows, uint32_t cols, size_t step,
+                     uint32_t resized_rows, uint32_t resized_cols, uint32_t y, uint32_t x,
+                     uint32_t channel) {
+  auto source = [](uint32_t d, uint32_t src_size, uint32_t dst_size, uint32_t& i0, uint32_t& i1,
+                   double& weight) {
+    double position = (d + 0.5) * double(src_size) / double(dst_size) - 0.5;
+    position = std::clamp(position, 0., double(src_size - 1));
+    i0 = uint32_t(std::floor(position));
+    i1 = std::min(i0 + 1, src_size - 1);
+    weight = position - i0;
+  };
+  uint32_t y0, y1, x0, x1;
+  double wy, wx;
+  source(y, rows, resized_rows, y0, y1, wy);
+  source(x, cols, resized_cols, x0, x1, wx);
+  auto pixel = [&](uint32_t r, uint32_t c) { return double(image.at(r * step + c * 3 + channel)); };
+  const double top = pixel(y0, x0) * (1 - wx) + pixel(y0, x1) * wx;
+  const double bottom = pixel(y1, x0) * (1 - wx) + pixel(y1, x1) * wx;
+  return float(top * (1 - wy) + bottom * wy);
+}
+}  // namespace
+
+TEST(test_image_pre_process, identity) {
+  using namespace kuiper_infer;
+  const uint32_t rows = 24;
+  const uint32_t cols = 40;
+  std::vector<uint8_t> image = MakeImage(rows, cols, cols * 3);
+  ImagePreProcess pre_process(rows, cols);
+  std::vector<sftensor> outputs(1);
+  ASSERT_EQ(pre_process.Forward({ImageBuffer{image.data(), rows, cols, cols * 3}}, outputs),
+            StatusCode::kSuccess);
+  const sftensor& output = outputs.front();
+  ASSERT_EQ(output->shapes(), std::vector<uint32_t>({3, rows, cols}));
+  // 输出为RGB, 输入为BGR
+  for (uint32_t c = 0; c < 3; ++c) {
+    for (uint32_t y = 0; y < rows; ++y) {
+      for (uint32_t x = 0; x < cols; ++x) {
+        ASSERT_NEAR(output->at(c, y, x), image.at((y * cols + x) * 3 + 2 - c) / 255.f, 1e-6f);
+      }
+    }
+  }
+}
+
+TEST(test_image_pre_process, letterbox_normalize) {
+  using namespace kuiper_infer;
+  const std::vector<float> mean = {0.485f, 0.456f, 0.406f};
+  const std::vector<float> std = {0.229f, 0.224f, 0.225f};
+  const uint32_t output_rows = 64;
+  const uint32_t output_cols = 48;
+  // 放大和缩小, 行有填充字节
+  for (const auto& [rows, cols] : std::vector<std::pair<uint32_t, uint32_t>>{
+           {37, 53}, {150, 31}, {21, 2}, {5, 1}}) {
+    const size_t step = cols * 3 + 5;
+    std::vector<uint8_t> image = MakeImage(rows, cols, step);
+    ImagePreProcess pre_process(output_rows, output_cols, false, 1.f / 255.f, mean, std, 114,
+                                true);
+    sftensor output = std::make_shared<ftensor>(3, output_rows, output_cols);
+    const float* output_ptr = output->raw_ptr();
+    std::vector<sftensor> outputs = {output};
+    ASSERT_EQ(pre_process.Forward({ImageBuffer{image.data(), rows, cols, step}}, outputs),
+              StatusCode::kSuccess);
+    ASSERT_EQ(outputs.front()->raw_ptr(), output_ptr);
+
+    const float ratio = std::min(float(output_rows) / rows, float(output_cols) / cols);
+    const uint32_t resized_rows = uint32_t(std::round(rows * ratio));
+    const uint32_t resized_cols = uint32_t(std::round(cols * ratio));
+    const uint32_t top = uint32_t(std::round((output_rows - resized_rows) / 2.f - 0.1f));
+    const uint32_t left = uint32_t(std::round((output_cols - resized_cols) / 2.f - 0.1f));
+    for (uint32_t c = 0; c < 3; ++c) {
+      for (uint32_t y = 0; y < output_rows; ++y) {
+        for (uint32_t x = 0; x < output_cols; ++x) {
+          float value = 114.f;
+          if (y >= top && y < top + resized_rows && x >= left && x < left + resized_cols) {
+            value = ReferencePixel(image, rows, cols, step, resized_rows, resized_cols, y - top,
+                                   x - left, c);
+          }
+          const float expected = (value / 255.f - mean.at(c)) / std.at(c);
+          ASSERT_NEAR(output->at(c, y, x), expected, 1e-4f);
+        }
+      }
+    }
+  }
+}
+
+TEST(test_image_pre_process, no_scale_up) {
+  using namespace kuiper_infer;
+  const uint32_t rows = 10;
+  const uint32_t cols = 20;
+  std::vector<uint8_t> image(rows * cols * 3, 200);
+  ImagePreProcess pre_process(32, 32);
+  std::vector<sftensor> outputs(2);
+  const ImageBuffer buffer{image.data(), rows, cols, cols * 3};
+  ASSERT_EQ(pre_process.Forward({buffer, buffer}, outputs), StatusCode::kSuccess);
+  // 小图不放大, 居中后四周填充
+  for (const sftensor& output : outputs) {
+    for (uint32_t c = 0; c < 3; ++c) {
+      for (uint32_t y = 0; y < 32; ++y) {
+        for (uint32_t x = 0; x < 32; ++x) {
+          const bool inside = y >= 11 && y < 21 && x >= 6 && x < 26;
+          ASSERT_NEAR(output->at(c, y, x), (inside ? 200.f : 114.f) / 255.f, 1e-6f);
+        }
+      }
+    }
+  }
+}
+
+TEST(test_image_pre_process, dim_mismatch) {
+  using namespace kuiper_infer;
+  std::vector<uint8_t> image(4 * 4 * 3);
+  ImagePreProcess pre_process(8, 8);
+  const ImageBuffer buffer{image.data(), 4, 4, 12};
+  std::vector<sftensor> outputs = {std::make_shared<ftensor>(3, 8, 7)};
+  ASSERT_EQ(pre_process.Forward({buffer}, outputs), StatusCode::kInferDimMismatch);
+  std::vector<sftensor> empty_outputs;
+  ASSERT_EQ(pre_process.Forward({buffer}, empty_outputs), StatusCode::kInferDimMismatch);
+  ASSERT_EQ(pre_process.Forward({}, empty_outputs), StatusCode::kInferInputsEmpty);
+}
@@ -0,0 +1,180 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include "../../source/layer/details/convolution.hpp"
+#include "../../source/layer/details/linear.hpp"
+#include "utils/math/int8_gemm.hpp"
+
+static float MaxAbsDiff(const kuiper_infer::sftensor& a, const kuiper_infer::sftensor& b) {
+  CHECK_EQ(a->size(), b->size());
+  float diff = 0.f;
+  for (uint32_t i = 0; i < a->size(); ++i) {
+    diff = std::max(diff, std::fabs(a->index(i) - b->index(i)));
+  }
+  return diff;
+}
+
+TEST(test_int8, gemm_exact) {
+  using namespace kuiper_infer;
+  std::mt19937 mt(42);
+  std::normal_distribution<float> dist;
+  const uint32_t rows = 67;
+  const uint32_t channels = 37;
+  const uint32_t depth = 75;
+
+  std::vector<float> input(rows * depth);
+  std::vector<float> weight(channels * depth);
+  std::vector<float> bias(channels);
+  for (float& value : input) value = dist(mt);
+  for (float& value : weight) value = dist(mt);
+  for (float& value : bias) value = dist(mt);
+
+  math::Int8Weight int8_weight;
+  math::QuantizeWeightPerChannel(weight.data(), channels, depth, int8_weight);
+  ASSERT_EQ(int8_weight.packed_depth % math::kInt8DepthAlign, 0);
+
+  const float input_scale = math::Int8Scale(math::AbsMax(input.data(), input.size()));
+  std::vector<int8_t> packed_input(rows * int8_weight.packed_depth);
+  math::QuantizeActivation(input.data(), rows, depth, depth, 1, input_scale, packed_input.data());
+
+  // 转置存放的输入量化后应当得到相同的结果
+  std::vector<float> input_t(rows * depth);
+  for (uint32_t m = 0; m < rows; ++m) {
+    for (uint32_t k = 0; k < depth; ++k) {
+      input_t.at(k * rows + m) = input.at(m * depth + k);
+    }
+  }
+  std::vector<int8_t> packed_input_t(rows * int8_weight.packed_depth);
+  math::QuantizeActivation(input_t.data(), rows, depth, 1, rows, input_scale,
+                           packed_input_t.data());
+  ASSERT_EQ(packed_input, packed_input_t);
+
+  const uint32_t begin = 3;
+  std::vector<float> output((channels - begin) * rows);
+  math::Int8GemmDequantize(packed_input.data(), rows, input_scale, int8_weight, begin, channels,
+                           bias.data(), output.data());
+  for (uint32_t n = begin; n < channels; ++n) {
+    for (uint32_t m = 0; m < rows; ++m) {
+      int32_t acc = 0;
+      for (uint32_t k = 0; k < depth; ++k) {
+        acc += int32_t(packed_input.at(m * int8_weight.packed_depth + k)) *
+               int32_t(int8_weight.data.at(n * int8_weight.packed_depth + k));
+      }
+      const float expected = float(acc) * input_scale * int8_weight.scales.at(n) + bias.at(n);
+      ASSERT_NEAR(output.at((n - begin) * rows + m), expected, 1e-4f);
+    }
+  }
+}
+
+TEST(test_int8, conv) {
+  using namespace kuiper_infer;
+  const uint32_t in_channel = 32;
+  const uint32_t out_channel = 24;
+  for (uint32_t kernel_size : {1, 3}) {
+    for (uint32_t groups : {1, 2}) {
+      const uint32_t padding = kernel_size / 2;
+      ConvolutionLayer conv_layer(out_channel, in_channel, kernel_size, kernel_size, padding,
+                                  padding, 1, 1, groups, true);
+      std::vector<sftensor> weights;
+      std::vector<sftensor> bias;
+      for (uint32_t k = 0; k < out_channel; ++k) {
+        sftensor weight =
+            std::make_shared<ftensor>(in_channel / groups, kernel_size, kernel_size);
+        weight->RandN();
+        weights.push_back(weight);
+        sftensor bias_value = std::make_shared<ftensor>(1, 1, 1);
+        bias_value->RandN();
+        bias.push_back(bias_value);
+      }
+      conv_layer.set_weights(weights);
+      conv_layer.set_bias(bias);
+
+      sftensor input = std::make_shared<ftensor>(in_channel, 19, 23);
+      input->RandN();
+      std::vector<sftensor> inputs = {input};
+      std::vector<sftensor> float_outputs(1);
+      ASSERT_EQ(conv_layer.Forward(inputs, float_outputs), StatusCode::kSuccess);
+
+      const std::vector<std::vector<int32_t>> input_shapes = {{1, int32_t(in_channel), 19, 23}};
+      const uint64_t float_bytes = conv_layer.EstimateBytes(input_shapes);
+      ASSERT_TRUE(conv_layer.QuantizeInt8(0.f));
+      // 量化后float卷积核已经释放
+      for (const sftensor& weight : conv_layer.weights()) {
+        ASSERT_TRUE(weight->empty());
+      }
+      ASSERT_LT(conv_layer.EstimateBytes(input_shapes), float_bytes);
+      std::vector<sftensor> int8_outputs(1);
+      ASSERT_EQ(conv_layer.Forward(inputs, int8_outputs), StatusCode::kSuccess);
+      ASSERT_EQ(int8_outputs.front()->shapes(), float_outputs.front()->shapes());
+
+      const float max_value = float_outputs.front()->data().max();
+      ASSERT_LT(MaxAbsDiff(int8_outputs.front(), float_outputs.front()), 0.05f * max_value)
+          << "kernel: " << kernel_size << " groups: " << groups;
+    }
+  }
+}
+
+TEST(test_int8, conv_depthwise_stays_float) {
+  using namespace kuiper_infer;
+  ConvolutionLayer conv_layer(8, 8, 3, 3, 1, 1, 1, 1, 8, false);
+  std::vector<float> weights(8 * 9, 1.f);
+  conv_layer.set_weights(weights);
+  ASSERT_FALSE(conv_layer.QuantizeInt8(0.f));
+}
+
+TEST(test_int8, linear) {
+  using namespace kuiper_infer;
+  const uint32_t in_features = 96;
+  const uint32_t out_features = 45;
+  const uint32_t in_dims = 7;
+
+  LinearLayer linear_layer(in_features, out_features, true);
+  sftensor weight = std::make_shared<ftensor>(1, in_features, out_features);
+  weight->RandN();
+  sftensor bias = std::make_shared<ftensor>(1, 1, out_features);
+  bias->RandN();
+  linear_layer.set_weights(std::vector<sftensor>{weight});
+  linear_layer.set_bias(std::vector<sftensor>{bias});
+
+  sftensor input = std::make_shared<ftensor>(1, in_dims, in_features);
+  input->RandN();
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> float_outputs = {std::make_shared<ftensor>(1, in_dims, out_features)};
+  ASSERT_EQ(linear_layer.Forward(inputs, float_outputs), StatusCode::kSuccess);
+
+  // 使用标定的scale量化输入
+  const float input_scale = math::Int8Scale(math::AbsMax(input->raw_ptr(), input->size()));
+  const std::vector<std::vector<int32_t>> input_shapes = {
+      {1, int32_t(in_dims), int32_t(in_features)}};
+  const uint64_t float_bytes = linear_layer.EstimateBytes(input_shapes);
+  ASSERT_TRUE(linear_layer.QuantizeInt8(input_scale));
+  // 量化后float权重已经释放
+  ASSERT_TRUE(linear_layer.weights().front()->empty());
+  ASSERT_LT(linear_layer.EstimateBytes(input_shapes), float_bytes);
+  std::vector<sftensor> int8_outputs = {std::make_shared<ftensor>(1, in_dims, out_features)};
+  ASSERT_EQ(linear_layer.Forward(inputs, int8_outputs), StatusCode::kSuccess);
+
+  const float max_value = float_outputs.front()->data().max();
+  ASSERT_LT(MaxAbsDiff(int8_outputs.front(), float_outputs.front()), 0.05f * max_value);
+}
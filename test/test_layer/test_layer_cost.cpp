@@ -0,0 +1,93 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include "../../source/layer/details/convolution.hpp"
+#include "../../source/layer/details/linear.hpp"
+#include "../../source/layer/details/maxpooling.hpp"
+#include "../../source/layer/details/softmax.hpp"
+#include "runtime/runtime_ir.hpp"
+
+TEST(test_layer_cost, conv) {
+  using namespace kuiper_infer;
+  ConvolutionLayer conv_layer(16, 8, 3, 3, 1, 1, 1, 1, 1, true);
+  const std::vector<std::vector<int32_t>> input_shapes = {{2, 8, 32, 32}};
+  // 2 * (batch * out_h * out_w * out_c * in_c * k_h * k_w) + bias
+  ASSERT_EQ(conv_layer.EstimateFlops(input_shapes),
+            2 * 2 * 32 * 32 * 16 * 8 * 9 + 2 * 16 * 32 * 32);
+  // input + output + weight + bias
+  ASSERT_EQ(conv_layer.EstimateBytes(input_shapes),
+            (2 * 8 * 32 * 32 + 2 * 16 * 32 * 32 + 16 * 8 * 9 + 16) * sizeof(float));
+}
+
+TEST(test_layer_cost, conv_group_dilation) {
+  using namespace kuiper_infer;
+  ConvolutionLayer conv_layer(16, 16, 3, 3, 0, 0, 1, 1, 4, false, 0, 0, 2, 2);
+  const std::vector<std::vector<int32_t>> input_shapes = {{1, 16, 10, 10}};
+  // 膨胀后的卷积核大小为5, 输出大小为6x6, 每组的输入通道数为4
+  ASSERT_EQ(conv_layer.EstimateFlops(input_shapes), 2 * 6 * 6 * 16 * 4 * 9);
+}
+
+TEST(test_layer_cost, linear) {
+  using namespace kuiper_infer;
+  LinearLayer linear_layer(64, 32, true);
+  const std::vector<std::vector<int32_t>> input_shapes = {{4, 64}};
+  ASSERT_EQ(linear_layer.EstimateFlops(input_shapes), 2 * 4 * 64 * 32 + 4 * 32);
+  ASSERT_EQ(linear_layer.EstimateBytes(input_shapes),
+            (4 * 64 + 4 * 32 + 64 * 32 + 32) * sizeof(float));
+}
+
+TEST(test_layer_cost, maxpooling_softmax) {
+  using namespace kuiper_infer;
+  MaxPoolingLayer max_layer(0, 0, 2, 2, 2, 2);
+  const std::vector<std::vector<int32_t>> pooling_shapes = {{1, 3, 8, 8}};
+  ASSERT_EQ(max_layer.EstimateFlops(pooling_shapes), 3 * 4 * 4 * 4);
+  ASSERT_EQ(max_layer.EstimateBytes(pooling_shapes), (3 * 8 * 8 + 3 * 4 * 4) * sizeof(float));
+
+  SoftmaxLayer softmax_layer(-1);
+  const std::vector<std::vector<int32_t>> softmax_shapes = {{1, 10}};
+  ASSERT_EQ(softmax_layer.EstimateFlops(softmax_shapes), 5 * 10);
+  ASSERT_EQ(softmax_layer.EstimateBytes(softmax_shapes), 2 * 10 * sizeof(float));
+}
+
+TEST(test_layer_cost, graph_report) {
+  using namespace kuiper_infer;
+  RuntimeGraph graph("tmp/resnet/demo/resnet18_batch1.param",
+                     "tmp/resnet/demo/resnet18_batch1.pnnx.bin");
+  graph.Build();
+  const auto& op_costs = graph.operator_costs();
+  ASSERT_FALSE(op_costs.empty());
+
+  uint64_t conv_flops = 0;
+  for (const auto& op_cost : op_costs) {
+    if (op_cost.type == "nn.Conv2d") {
+      ASSERT_GT(op_cost.flops, 0);
+      ASSERT_GT(op_cost.bytes, 0);
+      conv_flops += op_cost.flops;
+    }
+  }
+  // resnet18在224x224输入下约有1.8G次乘加
+  ASSERT_GT(conv_flops, uint64_t(3.4e9));
+  ASSERT_LT(conv_flops, uint64_t(3.8e9));
+  ASSERT_GE(graph.total_flops(), conv_flops);
+  graph.CostSummaryLogging();
+}
@@ -0,0 +1,112 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include "../../source/layer/details/rms_norm.hpp"
+
+namespace {
+void ReferenceRMSNorm(const float* input, const float* weight, uint32_t hidden, float* output) {
+  double square_sum = 0.;
+  for (uint32_t j = 0; j < hidden; ++j) {
+    square_sum += double(input[j]) * input[j];
+  }
+  const double norm_value = 1. / std::sqrt(square_sum / hidden + 1e-5);
+  for (uint32_t j = 0; j < hidden; ++j) {
+    output[j] = float(input[j] * norm_value * weight[j]);
+  }
+}
+}  // namespace
+
+TEST(test_rms_norm, per_row) {
+  using namespace kuiper_infer;
+  for (uint32_t hidden : {5, 37, 256}) {
+    sftensor weight = std::make_shared<ftensor>(hidden);
+    weight->RandN();
+    RMSNormLayer rms_norm;
+    rms_norm.set_weights(std::vector<sftensor>{weight});
+
+    // 每个token一行, 每行单独归一化
+    std::vector<sftensor> inputs;
+    std::vector<sftensor> outputs(3);
+    for (uint32_t i = 0; i < 3; ++i) {
+      sftensor input = std::make_shared<ftensor>(1, hidden, i + 1);
+      input->RandN();
+      inputs.push_back(input);
+    }
+    ASSERT_EQ(rms_norm.Forward(inputs, outputs), StatusCode::kSuccess);
+    for (uint32_t i = 0; i < 3; ++i) {
+      std::vector<float> expected(inputs.at(i)->size());
+      for (uint32_t row = 0; row <= i; ++row) {
+        ReferenceRMSNorm(inputs.at(i)->raw_ptr() + row * hidden, weight->raw_ptr(), hidden,
+                         expected.data() + row * hidden);
+      }
+      for (uint32_t j = 0; j < expected.size(); ++j) {
+        ASSERT_NEAR(outputs.at(i)->index(j), expected.at(j), 1e-5f);
+      }
+    }
+  }
+}
+
+TEST(test_rms_norm, residual) {
+  using namespace kuiper_infer;
+  const uint32_t hidden = 69;
+  const uint32_t tokens = 4;
+  sftensor weight = std::make_shared<ftensor>(hidden);
+  weight->RandN();
+  RMSNormLayer rms_norm;
+  rms_norm.set_weights(std::vector<sftensor>{weight});
+
+  sftensor input = std::make_shared<ftensor>(1, hidden, tokens);
+  input->RandN();
+  sftensor residual = std::make_shared<ftensor>(1, hidden, tokens);
+  residual->RandN();
+  std::vector<float> sum(input->size());
+  for (uint32_t j = 0; j < sum.size(); ++j) {
+    sum.at(j) = input->index(j) + residual->index(j);
+  }
+
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> residuals = {residual};
+  std::vector<sftensor> outputs(1);
+  ASSERT_EQ(rms_norm.ForwardResidual(inputs, residuals, outputs), StatusCode::kSuccess);
+  std::vector<float> expected(sum.size());
+  for (uint32_t row = 0; row < tokens; ++row) {
+    ReferenceRMSNorm(sum.data() + row * hidden, weight->raw_ptr(), hidden,
+                     expected.data() + row * hidden);
+  }
+  for (uint32_t j = 0; j < sum.size(); ++j) {
+    ASSERT_FLOAT_EQ(residual->index(j), sum.at(j));
+    ASSERT_NEAR(outputs.front()->index(j), expected.at(j), 1e-5f);
+  }
+}
+
+TEST(test_rms_norm, weight_size_mismatch) {
+  using namespace kuiper_infer;
+  sftensor weight = std::make_shared<ftensor>(8);
+  weight->Fill(1.f);
+  RMSNormLayer rms_norm;
+  rms_norm.set_weights(std::vector<sftensor>{weight});
+  std::vector<sftensor> inputs = {std::make_shared<ftensor>(12)};
+  std::vector<sftensor> outputs(1);
+  ASSERT_DEATH(rms_norm.Forward(inputs, outputs), "");
+}
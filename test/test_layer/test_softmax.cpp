@@ -349,4 +349,39 @@ TEST(test_layer, forward_softmax_dim1_1_m) {
       }
     }
   }
-}
\ No newline at end of file
+}
+
+TEST(test_layer, forward_softmax_large_axes) {
+  using namespace kuiper_infer;
+  const uint32_t channels = 5;
+  const uint32_t rows = 37;
+  const uint32_t cols = 300;
+  for (int32_t dim = 0; dim < 3; ++dim) {
+    sftensor input = std::make_shared<ftensor>(channels, rows, cols);
+    input->RandN(0.f, 4.f);
+    std::vector<sftensor> inputs = {input};
+    std::vector<sftensor> outputs(1);
+    SoftmaxLayer softmax_layer(dim);
+    ASSERT_EQ(softmax_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+
+    // 沿dim轴逐个位置计算的softmax
+    const uint32_t sizes[3] = {channels, rows, cols};
+    for (uint32_t c = 0; c < channels; ++c) {
+      for (uint32_t r = 0; r < rows; ++r) {
+        for (uint32_t l = 0; l < cols; ++l) {
+          uint32_t index[3] = {c, r, l};
+          double max_value = -1e30;
+          for (index[dim] = 0; index[dim] < sizes[dim]; ++index[dim]) {
+            max_value = std::max(max_value, double(input->at(index[0], index[1], index[2])));
+          }
+          double sum_value = 0.;
+          for (index[dim] = 0; index[dim] < sizes[dim]; ++index[dim]) {
+            sum_value += std::exp(input->at(index[0], index[1], index[2]) - max_value);
+          }
+          const double expected = std::exp(input->at(c, r, l) - max_value) / sum_value;
+          ASSERT_NEAR(outputs.front()->at(c, r, l), expected, 1e-6) << "dim: " << dim;
+        }
+      }
+    }
+  }
+}
@@ -410,4 +410,29 @@ TEST(test_layer, forward_view14) {
       }
     }
   }
-}
\ No newline at end of file
+}
+
+TEST(test_layer, forward_view_alias) {
+  using namespace kuiper_infer;
+  // 每个通道都是向量, 输出直接引用输入的数据
+  ViewLayer view_layer({2, 4, 12, -1});
+  std::vector<std::shared_ptr<Tensor<float>>> inputs;
+  for (int i = 0; i < 2; ++i) {
+    std::shared_ptr<Tensor<float>> input = std::make_shared<Tensor<float>>(8, 1, 6);
+    input->RandN();
+    inputs.push_back(input);
+  }
+
+  std::vector<std::shared_ptr<Tensor<float>>> outputs(2);
+  ASSERT_EQ(view_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(outputs.at(i)->raw_ptr(), inputs.at(i)->raw_ptr());
+    ASSERT_EQ(outputs.at(i)->raw_shapes(), std::vector<uint32_t>({4, 12, 1}));
+    for (uint32_t c = 0; c < 4; ++c) {
+      for (uint32_t r = 0; r < 12; ++r) {
+        const uint32_t index = c * 12 + r;
+        ASSERT_EQ(outputs.at(i)->at(c, r, 0), inputs.at(i)->at(index / 6, 0, index % 6));
+      }
+    }
+  }
+}
@@ -0,0 +1,132 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include "../../source/layer/details/matmul.hpp"
+#include "utils/math/weight_quant_gemm.hpp"
+
+TEST(test_weight_quant, quantize_error) {
+  using namespace kuiper_infer::math;
+  std::mt19937 mt(3);
+  std::normal_distribution<float> dist;
+  const uint32_t rows = 5;
+  const uint32_t depth = 256;
+  std::vector<float> weight(rows * depth);
+  for (float& value : weight) value = dist(mt);
+  weight.at(7) = 0.f;
+
+  for (WeightFormat format : {WeightFormat::kInt8Grouped, WeightFormat::kInt4Grouped}) {
+    for (uint32_t group_size : {32, 64, 128}) {
+      GroupQuantWeight quantized;
+      QuantizeWeightGrouped(weight.data(), rows, depth, group_size, format, quantized);
+      ASSERT_EQ(quantized.groups(), depth / group_size);
+      ASSERT_EQ(quantized.data.size(),
+                format == WeightFormat::kInt4Grouped ? rows * depth / 2 : rows * depth);
+      for (uint32_t n = 0; n < rows; ++n) {
+        for (uint32_t k = 0; k < depth; ++k) {
+          const float scale = quantized.scales.at(n * quantized.groups() + k / group_size);
+          ASSERT_LE(std::fabs(DequantizeGroupedValue(quantized, n, k) - weight.at(n * depth + k)),
+                    scale * 0.5f + 1e-6f);
+        }
+      }
+      // 零点使0可以被精确表示
+      ASSERT_EQ(DequantizeGroupedValue(quantized, 0, 7), 0.f);
+    }
+  }
+}
+
+TEST(test_weight_quant, gemm) {
+  using namespace kuiper_infer::math;
+  std::mt19937 mt(42);
+  std::normal_distribution<float> dist;
+  const uint32_t channels = 37;
+  const uint32_t depth = 384;
+
+  std::vector<float> input(3 * depth);
+  std::vector<float> weight(channels * depth);
+  for (float& value : input) value = dist(mt);
+  for (float& value : weight) value = dist(mt);
+
+  for (WeightFormat format : {WeightFormat::kInt8Grouped, WeightFormat::kInt4Grouped}) {
+    for (uint32_t group_size : {32, 64, 128}) {
+      GroupQuantWeight quantized;
+      QuantizeWeightGrouped(weight.data(), channels, depth, group_size, format, quantized);
+      for (uint32_t rows : {1, 3}) {
+        const uint32_t begin = 2;
+        std::vector<float> output((channels - begin) * rows);
+        GroupQuantGemm(input.data(), rows, quantized, begin, channels, output.data());
+        for (uint32_t n = begin; n < channels; ++n) {
+          for (uint32_t m = 0; m < rows; ++m) {
+            float expected = 0.f;
+            for (uint32_t k = 0; k < depth; ++k) {
+              expected += input.at(m * depth + k) * DequantizeGroupedValue(quantized, n, k);
+            }
+            ASSERT_NEAR(output.at((n - begin) * rows + m), expected, 2e-3f)
+                << "format: " << int32_t(format) << " group: " << group_size;
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(test_weight_quant, matmul_layer) {
+  using namespace kuiper_infer;
+  const uint32_t weight_dim0 = 45;
+  const uint32_t weight_dim1 = 128;
+  for (uint32_t tokens : {1, 4}) {
+    sftensor weight = std::make_shared<ftensor>(1, weight_dim0, weight_dim1);
+    weight->RandN();
+    math::GroupQuantWeight quantized;
+    math::QuantizeWeightGrouped(weight->raw_ptr(), weight_dim0, weight_dim1, 64,
+                                math::WeightFormat::kInt4Grouped, quantized);
+
+    // 以反量化的权重计算float结果作为参考
+    sftensor dequantized = std::make_shared<ftensor>(1, weight_dim0, weight_dim1);
+    for (uint32_t n = 0; n < weight_dim0; ++n) {
+      for (uint32_t k = 0; k < weight_dim1; ++k) {
+        dequantized->index(n * weight_dim1 + k) = math::DequantizeGroupedValue(quantized, n, k);
+      }
+    }
+    LLamaMatmulLayer float_layer(weight_dim0, weight_dim1);
+    float_layer.set_weights({dequantized});
+
+    LLamaMatmulLayer quant_layer(weight_dim0, weight_dim1);
+    quant_layer.set_weights({weight});
+    ASSERT_FALSE(quant_layer.ConvertWeights(math::WeightFormat::kInt4Grouped, 96));
+    ASSERT_TRUE(quant_layer.ConvertWeights(math::WeightFormat::kInt4Grouped, 64));
+    ASSERT_EQ(quant_layer.weight_format(), math::WeightFormat::kInt4Grouped);
+    ASSERT_EQ(quant_layer.weights().front(), nullptr);
+
+    sftensor input = std::make_shared<ftensor>(weight_dim1, tokens);
+    input->RandN();
+    std::vector<sftensor> inputs = {input};
+    std::vector<sftensor> float_outputs = {std::make_shared<ftensor>(1, weight_dim0, tokens)};
+    std::vector<sftensor> quant_outputs = {std::make_shared<ftensor>(1, weight_dim0, tokens)};
+    ASSERT_EQ(float_layer.Forward(inputs, float_outputs), StatusCode::kSuccess);
+    ASSERT_EQ(quant_layer.Forward(inputs, quant_outputs), StatusCode::kSuccess);
+    for (uint32_t i = 0; i < float_outputs.front()->size(); ++i) {
+      ASSERT_NEAR(quant_outputs.front()->index(i), float_outputs.front()->index(i), 1e-3f);
+    }
+  }
+}
@@ -0,0 +1,107 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include "../../source/layer/details/yolo_detect.hpp"
+
+TEST(test_yolo_detect, fused_decode) {
+  using namespace kuiper_infer;
+  const uint32_t stages = 3;
+  const uint32_t num_anchors = 3;
+  const uint32_t num_classes = 3;
+  const uint32_t classes_info = num_classes + 5;
+  const uint32_t in_channels = 4;
+  const uint32_t batch_size = 2;
+  // 高和宽不相等, 检查卷积输出到输出行的转置
+  const uint32_t heights[stages] = {5, 3, 2};
+  const uint32_t widths[stages] = {11, 6, 3};
+  const std::vector<float> strides = {8.f, 16.f, 32.f};
+
+  std::vector<arma::fmat> grids;
+  std::vector<arma::fmat> anchor_grids;
+  std::vector<std::shared_ptr<ConvolutionLayer>> conv_layers;
+  for (uint32_t stage = 0; stage < stages; ++stage) {
+    const uint32_t stage_rows = num_anchors * heights[stage] * widths[stage];
+    grids.push_back(arma::randn<arma::fmat>(stage_rows, 2));
+    anchor_grids.push_back(arma::randu<arma::fmat>(stage_rows, 2) * 50.f);
+    auto conv_layer = std::make_shared<ConvolutionLayer>(num_anchors * classes_info, in_channels,
+                                                         1, 1, 0, 0, 1, 1, 1);
+    std::vector<float> weights(num_anchors * classes_info * in_channels);
+    std::vector<float> bias(num_anchors * classes_info);
+    for (uint32_t i = 0; i < weights.size(); ++i) {
+      weights.at(i) = std::sin(float(i + stage));
+    }
+    for (uint32_t i = 0; i < bias.size(); ++i) {
+      bias.at(i) = std::cos(float(i));
+    }
+    conv_layer->set_weights(weights);
+    conv_layer->set_bias(bias);
+    conv_layers.push_back(conv_layer);
+  }
+
+  std::vector<sftensor> inputs;
+  for (uint32_t stage = 0; stage < stages; ++stage) {
+    for (uint32_t b = 0; b < batch_size; ++b) {
+      sftensor input = std::make_shared<ftensor>(in_channels, heights[stage], widths[stage]);
+      input->RandN();
+      inputs.push_back(input);
+    }
+  }
+
+  YoloDetectLayer yolo_detect_layer(stages, num_classes, num_anchors, strides, grids,
+                                    anchor_grids, conv_layers);
+  std::vector<sftensor> outputs(batch_size);
+  ASSERT_EQ(yolo_detect_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+
+  for (uint32_t b = 0; b < batch_size; ++b) {
+    uint32_t row = 0;
+    for (uint32_t stage = 0; stage < stages; ++stage) {
+      std::vector<sftensor> conv_inputs = {inputs.at(stage * batch_size + b)};
+      std::vector<sftensor> conv_outputs(1);
+      ASSERT_EQ(conv_layers.at(stage)->Forward(conv_inputs, conv_outputs), StatusCode::kSuccess);
+      const sftensor& conv_output = conv_outputs.front();
+      const uint32_t area = heights[stage] * widths[stage];
+      for (uint32_t anchor = 0; anchor < num_anchors; ++anchor) {
+        for (uint32_t y = 0; y < heights[stage]; ++y) {
+          for (uint32_t x = 0; x < widths[stage]; ++x) {
+            const uint32_t grid_row = anchor * area + y * widths[stage] + x;
+            for (uint32_t attr = 0; attr < classes_info; ++attr) {
+              const float value = conv_output->at(anchor * classes_info + attr, y, x);
+              float expected = 1.f / (1.f + std::exp(-value));
+              if (attr < 2) {
+                expected = (expected * 2.f + grids.at(stage)(grid_row, attr)) * strides.at(stage);
+              } else if (attr < 4) {
+                expected = std::pow(expected * 2.f, 2.f) *
+                           anchor_grids.at(stage)(grid_row, attr - 2);
+              }
+              ASSERT_NEAR(outputs.at(b)->at(0, row, attr), expected,
+                          1e-4f * (1.f + std::abs(expected)));
+            }
+            row += 1;
+          }
+        }
+      }
+    }
+    ASSERT_EQ(outputs.at(b)->rows(), row);
+  }
+}
@@ -0,0 +1,127 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include "../../source/layer/details/yolo_post_process.hpp"
+
+namespace {
+struct Box {
+  float cx;
+  float cy;
+  float w;
+  float h;
+  float objectness;
+  uint32_t class_id;
+  float class_score;
+};
+
+// 构造YoloDetectLayer形式的输出, 每行为(cx, cy, w, h, objectness, class scores...)
+kuiper_infer::sftensor MakeYoloOutput(const std::vector<Box>& boxes, uint32_t num_classes) {
+  auto output = std::make_shared<kuiper_infer::ftensor>(1, boxes.size(), num_classes + 5);
+  output->Fill(0.f);
+  for (uint32_t r = 0; r < boxes.size(); ++r) {
+    const Box& box = boxes.at(r);
+    output->at(0, r, 0) = box.cx;
+    output->at(0, r, 1) = box.cy;
+    output->at(0, r, 2) = box.w;
+    output->at(0, r, 3) = box.h;
+    output->at(0, r, 4) = box.objectness;
+    for (uint32_t c = 0; c < num_classes; ++c) {
+      output->at(0, r, 5 + c) = c == box.class_id ? box.class_score : box.class_score / 4.f;
+    }
+  }
+  return output;
+}
+}  // namespace
+
+TEST(test_yolo_post_process, filter_and_suppress) {
+  using namespace kuiper_infer;
+  // 行数超过8, 覆盖向量化和剩余部分的置信度过滤
+  std::vector<Box> boxes;
+  for (uint32_t i = 0; i < 11; ++i) {
+    boxes.push_back({500.f, 500.f, 10.f, 10.f, 0.1f, 0, 0.9f});
+  }
+  boxes.at(1) = {100.f, 100.f, 40.f, 40.f, 0.9f, 1, 0.9f};   // score 0.81
+  boxes.at(3) = {102.f, 101.f, 40.f, 40.f, 0.9f, 1, 0.8f};   // 与1重叠, 被抑制
+  boxes.at(5) = {102.f, 101.f, 40.f, 40.f, 0.9f, 2, 0.7f};   // 与1重叠但类别不同
+  boxes.at(9) = {300.f, 200.f, 20.f, 60.f, 0.8f, 0, 0.5f};   // score 0.4
+  boxes.at(10) = {10.f, 10.f, 8.f, 8.f, 0.5f, 0, 0.4f};      // score 0.2, 低于阈值
+
+  std::vector<sftensor> inputs = {MakeYoloOutput(boxes, 3)};
+  std::vector<sftensor> outputs(1);
+  YoloPostProcessLayer post_process(0.25f, 0.45f);
+  ASSERT_EQ(post_process.Forward(inputs, outputs), StatusCode::kSuccess);
+
+  const sftensor& output = outputs.front();
+  ASSERT_EQ(output->rows(), 3);
+  ASSERT_EQ(output->cols(), 6);
+  const float expected[3][6] = {{80.f, 80.f, 120.f, 120.f, 0.81f, 1.f},
+                                {82.f, 81.f, 122.f, 121.f, 0.63f, 2.f},
+                                {290.f, 170.f, 310.f, 230.f, 0.4f, 0.f}};
+  for (uint32_t d = 0; d < 3; ++d) {
+    for (uint32_t k = 0; k < 6; ++k) {
+      ASSERT_NEAR(output->at(0, d, k), expected[d][k], 1e-5f);
+    }
+  }
+
+  // 不区分类别时, 类别2的框也被抑制
+  YoloPostProcessLayer agnostic_post_process(0.25f, 0.45f, 1024, 300, true);
+  ASSERT_EQ(agnostic_post_process.Forward(inputs, outputs), StatusCode::kSuccess);
+  ASSERT_EQ(outputs.front()->rows(), 2);
+  ASSERT_FLOAT_EQ(outputs.front()->at(0, 1, 5), 0.f);
+}
+
+TEST(test_yolo_post_process, top_k_and_max_detections) {
+  using namespace kuiper_infer;
+  // 互不重叠的框, 分数依次递减
+  std::vector<Box> boxes;
+  for (uint32_t i = 0; i < 40; ++i) {
+    boxes.push_back({20.f * i, 0.f, 10.f, 10.f, 1.f, i % 2, 1.f - 0.01f * i});
+  }
+  std::vector<sftensor> inputs = {MakeYoloOutput(boxes, 2), MakeYoloOutput(boxes, 2)};
+  std::vector<sftensor> outputs(2);
+
+  YoloPostProcessLayer top_k_post_process(0.25f, 0.45f, 16, 300);
+  ASSERT_EQ(top_k_post_process.Forward(inputs, outputs), StatusCode::kSuccess);
+  for (const sftensor& output : outputs) {
+    ASSERT_EQ(output->rows(), 16);
+    for (uint32_t d = 0; d < 16; ++d) {
+      ASSERT_NEAR(output->at(0, d, 4), 1.f - 0.01f * d, 1e-5f);
+    }
+  }
+
+  YoloPostProcessLayer max_det_post_process(0.25f, 0.45f, 1024, 10);
+  ASSERT_EQ(max_det_post_process.Forward(inputs, outputs), StatusCode::kSuccess);
+  ASSERT_EQ(outputs.front()->rows(), 10);
+  ASSERT_EQ(outputs.back()->rows(), 10);
+}
+
+TEST(test_yolo_post_process, empty_result) {
+  using namespace kuiper_infer;
+  std::vector<Box> boxes(20, {50.f, 50.f, 10.f, 10.f, 0.2f, 0, 1.f});
+  std::vector<sftensor> inputs = {MakeYoloOutput(boxes, 4)};
+  std::vector<sftensor> outputs(1);
+  YoloPostProcessLayer post_process;
+  ASSERT_EQ(post_process.Forward(inputs, outputs), StatusCode::kSuccess);
+  ASSERT_EQ(outputs.front()->rows(), 0);
+  ASSERT_EQ(outputs.front()->cols(), 6);
+}
@@ -22,6 +22,7 @@
 // Created by fss on 22-11-22.
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include "../../source/layer/details/softmax.hpp"
 #include "data/load_data.hpp"
 #include "runtime/runtime_ir.hpp"
 
@@ -131,3 +132,51 @@ TEST(test_net, forward_mobilenet2) {
     }
   }
 }
+
+TEST(test_net, bind_resnet18) {
+  using namespace kuiper_infer;
+  RuntimeGraph graph("tmp/resnet/resnet18_batch1.param", "tmp/resnet/resnet18_batch1.pnnx.bin");
+  graph.Build();
+
+  sftensor input = std::make_shared<ftensor>(3, 224, 224);
+  input->RandN();
+  graph.set_inputs("pnnx_input_0", {input});
+  graph.Forward(false);
+  const std::vector<float> expected = graph.get_outputs("pnnx_output_0").front()->values();
+
+  // 行优先的输入在Forward时转置, 输出由最后一层直接写入
+  std::vector<float> row_major_input = input->values(true);
+  std::vector<float> output(1000);
+  graph.BindInput("pnnx_input_0", row_major_input.data(), {1, 3, 224, 224},
+                  BufferLayout::kRowMajor);
+  graph.BindOutput("pnnx_output_0", output.data(), {1, 1000});
+  graph.Forward(false);
+  ASSERT_EQ(graph.get_outputs("pnnx_output_0").front()->raw_ptr(), output.data());
+  for (uint32_t i = 0; i < output.size(); ++i) {
+    ASSERT_NEAR(output.at(i), expected.at(i), 1e-5f);
+  }
+
+  // 列优先的输入不经过拷贝
+  std::vector<float> col_major_input = input->values(false);
+  std::fill(output.begin(), output.end(), 0.f);
+  graph.BindInput("pnnx_input_0", col_major_input.data(), {1, 3, 224, 224},
+                  BufferLayout::kColMajor);
+  graph.Forward(false);
+  for (uint32_t i = 0; i < output.size(); ++i) {
+    ASSERT_NEAR(output.at(i), expected.at(i), 1e-5f);
+  }
+
+  graph.BindOutput("pnnx_output_0", nullptr, {});
+  graph.Forward(false);
+  ASSERT_NE(graph.get_outputs("pnnx_output_0").front()->raw_ptr(), output.data());
+  ASSERT_DEATH(graph.BindInput("pnnx_input_0", col_major_input.data(), {1, 3, 224, 223},
+                               BufferLayout::kColMajor),
+               "");
+
+  // 绑定的输出不能再追加层, 追加了层的输出也不能绑定
+  graph.BindOutput("pnnx_output_0", output.data(), {1, 1000});
+  ASSERT_DEATH(graph.AppendOutputLayer("pnnx_output_0", std::make_shared<SoftmaxLayer>()), "");
+  graph.BindOutput("pnnx_output_0", nullptr, {});
+  graph.AppendOutputLayer("pnnx_output_0", std::make_shared<SoftmaxLayer>());
+  ASSERT_DEATH(graph.BindOutput("pnnx_output_0", output.data(), {1, 1000}), "");
+}
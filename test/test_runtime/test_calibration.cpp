@@ -0,0 +1,170 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include "runtime/runtime_calibration.hpp"
+#include "runtime/runtime_ir.hpp"
+#include "utils/math/int8_gemm.hpp"
+
+TEST(test_calibration, minmax_and_growth) {
+  using namespace kuiper_infer;
+  ActivationHistogram histogram(2048);
+  sftensor small = std::make_shared<ftensor>(1, 4, 4);
+  small->Fill(0.5f);
+  small->index(0) = -1.f;
+  histogram.Collect({small}, 1);
+  const float first_width = histogram.bin_width();
+  ASSERT_GT(first_width, 0.f);
+
+  // 更大的值到来时, 直方图的范围应当扩大而已有的计数保持不变
+  sftensor large = std::make_shared<ftensor>(1, 4, 4);
+  large->Fill(-2.f);
+  large->index(3) = 6.f;
+  histogram.Collect({large, small}, 1);
+  ASSERT_GE(histogram.bin_width() * histogram.bins().size(), 6.f);
+  ASSERT_GT(histogram.bin_width(), first_width);
+
+  uint64_t total = 0;
+  for (uint64_t bin : histogram.bins()) {
+    total += bin;
+  }
+  ASSERT_EQ(total, 32);
+  ASSERT_EQ(histogram.count(), 32);
+  ASSERT_EQ(histogram.min_value(), -2.f);
+  ASSERT_EQ(histogram.max_value(), 6.f);
+  ASSERT_FLOAT_EQ(histogram.Scale(CalibrationMethod::kMinMax), 6.f / math::kInt8Max);
+}
+
+TEST(test_calibration, entropy_clips_outliers) {
+  using namespace kuiper_infer;
+  ActivationHistogram histogram;
+  for (uint32_t i = 0; i < 8; ++i) {
+    sftensor tensor = std::make_shared<ftensor>(8, 32, 32);
+    tensor->RandN();
+    histogram.Collect({tensor}, 1);
+  }
+  sftensor outlier = std::make_shared<ftensor>(1, 1, 1);
+  outlier->Fill(100.f);
+  histogram.Collect({outlier}, 1);
+
+  const float minmax_scale = histogram.Scale(CalibrationMethod::kMinMax);
+  const float entropy_scale = histogram.Scale(CalibrationMethod::kEntropy);
+  ASSERT_FLOAT_EQ(minmax_scale, 100.f / math::kInt8Max);
+  // 正态分布的阈值应当远小于离群点, 但不会截断大部分数据
+  ASSERT_LT(entropy_scale * math::kInt8Max, 10.f);
+  ASSERT_GT(entropy_scale * math::kInt8Max, 2.f);
+}
+
+TEST(test_calibration, table_round_trip) {
+  using namespace kuiper_infer;
+  Int8Calibrator calibrator;
+  sftensor tensor = std::make_shared<ftensor>(2, 8, 8);
+  tensor->RandN();
+  calibrator.Collect("conv1", {tensor});
+  tensor->RandN();
+  calibrator.Collect("linear", {tensor});
+
+  const std::string table_path = "calibration_table_test.txt";
+  ASSERT_TRUE(calibrator.WriteTable(table_path, CalibrationMethod::kMinMax));
+  std::map<std::string, float> scales;
+  ASSERT_TRUE(Int8Calibrator::ReadTable(table_path, scales));
+  const auto& expected_scales = calibrator.ComputeScales(CalibrationMethod::kMinMax);
+  ASSERT_EQ(scales.size(), 2);
+  for (const auto& [name, scale] : expected_scales) {
+    ASSERT_FLOAT_EQ(scales.at(name), scale);
+  }
+  std::remove(table_path.c_str());
+}
+
+TEST(test_calibration, load_sample) {
+  using namespace kuiper_infer;
+  const std::string raw_path = "calibration_sample_test.bin";
+  std::vector<float> values(2 * 3 * 4);
+  for (uint32_t i = 0; i < values.size(); ++i) {
+    values.at(i) = float(i);
+  }
+  std::ofstream(raw_path, std::ios::binary)
+      .write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+
+  sftensor sample = Int8Calibrator::LoadSample(raw_path, {2, 3, 4});
+  ASSERT_NE(sample, nullptr);
+  ASSERT_EQ(sample->at(1, 2, 3), 23.f);
+  ASSERT_EQ(sample->at(0, 1, 0), 4.f);
+  ASSERT_EQ(Int8Calibrator::LoadSample(raw_path, {2, 3, 5}), nullptr);
+  std::remove(raw_path.c_str());
+}
+
+TEST(test_calibration, graph_calibrate_and_quantize) {
+  using namespace kuiper_infer;
+  RuntimeGraph graph("tmp/resnet/demo/resnet18_batch1.param",
+                     "tmp/resnet/demo/resnet18_batch1.pnnx.bin");
+  graph.Build();
+
+  const std::string sample_dir = "calibration_samples_test";
+  std::filesystem::create_directories(sample_dir);
+  for (uint32_t i = 0; i < 3; ++i) {
+    sftensor sample = std::make_shared<ftensor>(3, 224, 224);
+    sample->RandN();
+    std::vector<float> values = sample->values(true);
+    std::ofstream(sample_dir + "/" + std::to_string(i) + ".bin", std::ios::binary)
+        .write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+  }
+
+  const std::string table_path = "calibration_resnet_test.txt";
+  // 调用前没有开启标定, 标定结束后关闭
+  ASSERT_TRUE(graph.Calibrate("pnnx_input_0", sample_dir, table_path));
+  ASSERT_EQ(graph.calibrator(), nullptr);
+
+  // 调用前已经开启标定, 标定结束后保持开启
+  graph.EnableCalibration();
+  ASSERT_TRUE(graph.Calibrate("pnnx_input_0", sample_dir, table_path));
+  ASSERT_NE(graph.calibrator(), nullptr);
+  ASSERT_EQ(graph.calibrator()->histograms().at("pnnx_input_0").count(), 3 * 3 * 224 * 224);
+  graph.DisableCalibration();
+
+  // 样本读取失败时同样关闭标定
+  const std::string bad_sample_path = sample_dir + "/3.bin";
+  std::ofstream(bad_sample_path, std::ios::binary).write("bad", 3);
+  ASSERT_FALSE(graph.Calibrate("pnnx_input_0", sample_dir, "calibration_bad_test.txt"));
+  ASSERT_EQ(graph.calibrator(), nullptr);
+  std::remove(bad_sample_path.c_str());
+
+  std::map<std::string, float> scales;
+  ASSERT_TRUE(Int8Calibrator::ReadTable(table_path, scales));
+  ASSERT_GT(scales.size(), 1);
+  ASSERT_GT(graph.QuantizeInt8(table_path), 0);
+
+  sftensor input = std::make_shared<ftensor>(3, 224, 224);
+  input->RandN();
+  graph.set_inputs("pnnx_input_0", {input});
+  graph.Forward();
+  const auto& outputs = graph.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs.size(), 1);
+  for (uint32_t i = 0; i < outputs.front()->size(); ++i) {
+    ASSERT_TRUE(std::isfinite(outputs.front()->index(i)));
+  }
+
+  std::filesystem::remove_all(sample_dir);
+  std::remove(table_path.c_str());
+}
@@ -0,0 +1,126 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include "runtime/runtime_pipeline.hpp"
+
+TEST(test_pipeline, bounded_queue) {
+  using namespace kuiper_infer;
+  BoundedQueue<int32_t> queue(2);
+  ASSERT_TRUE(queue.Push(1));
+  ASSERT_TRUE(queue.Push(2));
+  ASSERT_EQ(queue.size(), 2);
+
+  // 队列已满, 直到有元素被取出之前Push都会等待
+  std::atomic<bool> pushed = false;
+  std::thread producer([&] {
+    queue.Push(3);
+    pushed = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(pushed);
+
+  int32_t item = 0;
+  ASSERT_TRUE(queue.Pop(item));
+  ASSERT_EQ(item, 1);
+  producer.join();
+  ASSERT_TRUE(pushed);
+
+  queue.Close();
+  ASSERT_FALSE(queue.Push(4));
+  ASSERT_TRUE(queue.Pop(item));
+  ASSERT_EQ(item, 2);
+  ASSERT_TRUE(queue.Pop(item));
+  ASSERT_EQ(item, 3);
+  ASSERT_FALSE(queue.Pop(item));
+}
+
+TEST(test_pipeline, bounded_queue_close_wakes_consumer) {
+  using namespace kuiper_infer;
+  BoundedQueue<int32_t> queue(1);
+  std::thread consumer([&] {
+    int32_t item = 0;
+    ASSERT_FALSE(queue.Pop(item));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  queue.Close();
+  consumer.join();
+}
+
+TEST(test_pipeline, forward_resnet18) {
+  using namespace kuiper_infer;
+  auto graph = std::make_shared<RuntimeGraph>("tmp/resnet/resnet18_batch1.param",
+                                              "tmp/resnet/resnet18_batch1.pnnx.bin");
+  graph->Build();
+
+  const uint32_t request_num = 6;
+  std::vector<sftensor> inputs;
+  std::vector<std::vector<float>> expected;
+  for (uint32_t i = 0; i < request_num; ++i) {
+    sftensor input = std::make_shared<ftensor>(3, 224, 224);
+    input->RandN();
+    inputs.push_back(input);
+    graph->set_inputs("pnnx_input_0", {input});
+    graph->Forward(false);
+    expected.push_back(graph->get_outputs("pnnx_output_0").front()->values());
+  }
+
+  std::vector<std::future<std::vector<sftensor>>> results;
+  std::atomic<uint32_t> post_processed = 0;
+  {
+    RuntimePipeline pipeline(graph, "pnnx_input_0", "pnnx_output_0", 2);
+    for (uint32_t i = 0; i < request_num; ++i) {
+      results.push_back(pipeline.Submit(
+          [&inputs, i]() { return std::vector<sftensor>{inputs.at(i)}; },
+          [&post_processed](std::vector<sftensor>& outputs) {
+            post_processed += 1;
+            return outputs;
+          }));
+    }
+    // 失败的请求不影响之后的请求
+    results.push_back(pipeline.Submit(
+        []() -> std::vector<sftensor> { throw std::runtime_error("pre process failed"); }));
+    // 输入的数量和图的batch不一致, 执行图时抛出的异常保存在结果中
+    results.push_back(pipeline.Submit([]() { return std::vector<sftensor>{}; }));
+    results.push_back(pipeline.Submit([&inputs]() { return std::vector<sftensor>{inputs.at(0)}; }));
+  }
+
+  ASSERT_EQ(post_processed, request_num);
+  for (uint32_t i = 0; i < request_num; ++i) {
+    const std::vector<sftensor>& outputs = results.at(i).get();
+    ASSERT_EQ(outputs.size(), 1);
+    const std::vector<float>& values = outputs.front()->values();
+    ASSERT_EQ(values.size(), expected.at(i).size());
+    for (uint32_t j = 0; j < values.size(); ++j) {
+      ASSERT_NEAR(values.at(j), expected.at(i).at(j), 1e-5f);
+    }
+  }
+  ASSERT_THROW(results.at(request_num).get(), std::runtime_error);
+  ASSERT_THROW(results.at(request_num + 1).get(), std::out_of_range);
+  const std::vector<float>& values = results.at(request_num + 2).get().front()->values();
+  for (uint32_t j = 0; j < values.size(); ++j) {
+    ASSERT_NEAR(values.at(j), expected.at(0).at(j), 1e-5f);
+  }
+}
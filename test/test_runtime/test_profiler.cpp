@@ -0,0 +1,206 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "runtime/runtime_ir.hpp"
+#include "utils/time/profiler.hpp"
+
+TEST(test_profiler, summary) {
+  using namespace kuiper_infer::utils;
+  Profiler profiler;
+  const uint32_t conv_id = profiler.RegisterOp("conv1", "nn.Conv2d", 2000, 100);
+  const uint32_t relu_id = profiler.RegisterOp("relu1", "nn.ReLU", 0, 0);
+  for (int64_t i = 1; i <= 100; ++i) {
+    profiler.Record(conv_id, 0, i * 1000);
+    profiler.Record(relu_id, 0, 10);
+  }
+  ASSERT_EQ(profiler.event_count(), 200);
+
+  const auto& summary = profiler.Summary();
+  ASSERT_EQ(summary.size(), 2);
+  const ProfileStats& conv_stat = summary.front();
+  ASSERT_EQ(conv_stat.name, "conv1");
+  ASSERT_EQ(conv_stat.type, "nn.Conv2d");
+  ASSERT_EQ(conv_stat.count, 100);
+  ASSERT_EQ(conv_stat.flops, 2000);
+  ASSERT_EQ(conv_stat.bytes, 100);
+  ASSERT_FLOAT_EQ(conv_stat.mean_us, 50.5);
+  ASSERT_FLOAT_EQ(conv_stat.p50_us, 50.);
+  ASSERT_FLOAT_EQ(conv_stat.p99_us, 99.);
+  ASSERT_FLOAT_EQ(conv_stat.gflops, 2000. / 50500.);
+
+  const auto& type_summary = profiler.Summary(true);
+  ASSERT_EQ(type_summary.size(), 2);
+  ASSERT_EQ(type_summary.back().name, "nn.ReLU");
+  ASSERT_FLOAT_EQ(type_summary.back().mean_us, 0.01);
+}
+
+TEST(test_profiler, ring_buffer_overwrite) {
+  using namespace kuiper_infer::utils;
+  Profiler profiler(6);
+  const uint32_t op_id = profiler.RegisterOp("op", "type");
+  for (int64_t i = 0; i < 20; ++i) {
+    profiler.Record(op_id, 0, i * 1000);
+  }
+  // 容量向上取整为8，仅保留最近的8次记录
+  ASSERT_EQ(profiler.event_count(), 8);
+  const auto& summary = profiler.Summary();
+  ASSERT_EQ(summary.size(), 1);
+  ASSERT_EQ(summary.front().count, 8);
+  ASSERT_FLOAT_EQ(summary.front().mean_us, 15.5);
+
+  profiler.Reset();
+  ASSERT_EQ(profiler.event_count(), 0);
+  ASSERT_EQ(profiler.op_count(), 1);
+}
+
+TEST(test_profiler, multi_thread) {
+  using namespace kuiper_infer::utils;
+  Profiler profiler;
+  const uint32_t op_id = profiler.RegisterOp("op", "type");
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&profiler, op_id]() {
+      for (int i = 0; i < 100; ++i) {
+        ProfileScope scope(&profiler, op_id);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(profiler.event_count(), 400);
+  ASSERT_EQ(profiler.Summary().front().count, 400);
+}
+
+TEST(test_profiler, summary_while_recording) {
+  using namespace kuiper_infer::utils;
+  Profiler profiler(64);
+  const uint32_t op_id = profiler.RegisterOp("op", "type");
+  std::thread recorder([&profiler, op_id]() {
+    for (int64_t i = 0; i < 100000; ++i) {
+      profiler.Record(op_id, i, i + 1000);
+    }
+  });
+  // 记录的同时汇总和清空, 每次汇总看到的都是完整的事件
+  for (int i = 0; i < 100; ++i) {
+    for (const ProfileStats& stats : profiler.Summary()) {
+      ASSERT_LE(stats.count, 64);
+      ASSERT_DOUBLE_EQ(stats.mean_us, 1.);
+    }
+    profiler.Reset();
+  }
+  recorder.join();
+  ASSERT_LE(profiler.event_count(), 64);
+}
+
+TEST(test_profiler, chrome_trace) {
+  using namespace kuiper_infer::utils;
+  Profiler profiler;
+  const uint32_t op_id = profiler.RegisterOp("conv\"1", "nn.Conv2d", 10, 20);
+  profiler.Record(op_id, 1000, 3500);
+  profiler.Record(op_id, 4000, 5000);
+
+  const std::string trace_path = "./profiler_trace.json";
+  ASSERT_TRUE(profiler.ExportChromeTrace(trace_path));
+  std::ifstream trace_file(trace_path);
+  std::stringstream trace;
+  trace << trace_file.rdbuf();
+  const std::string& content = trace.str();
+  ASSERT_NE(content.find("\"traceEvents\""), std::string::npos);
+  ASSERT_NE(content.find("\"name\":\"conv\\\"1\""), std::string::npos);
+  ASSERT_NE(content.find("\"ts\":0.000,\"dur\":2.500"), std::string::npos);
+  ASSERT_NE(content.find("\"ts\":3.000,\"dur\":1.000"), std::string::npos);
+  std::remove(trace_path.data());
+}
+
+TEST(test_profiler, graph_forward) {
+  using namespace kuiper_infer;
+  RuntimeGraph graph("tmp/resnet/demo/resnet18_batch1.param",
+                     "tmp/resnet/demo/resnet18_batch1.pnnx.bin");
+  graph.EnableProfiler();
+  graph.Build();
+  ASSERT_NE(graph.profiler(), nullptr);
+
+  sftensor input = std::make_shared<ftensor>(3, 224, 224);
+  input->Fill(1.f);
+  graph.set_inputs("pnnx_input_0", {input});
+  graph.Forward();
+  graph.Forward();
+
+  const auto& summary = graph.profiler()->Summary();
+  ASSERT_FALSE(summary.empty());
+  for (const auto& stat : summary) {
+    ASSERT_EQ(stat.count, 2);
+  }
+  graph.DisableProfiler();
+  ASSERT_EQ(graph.profiler(), nullptr);
+}
+
+TEST(test_profiler, perf_counters) {
+  using namespace kuiper_infer::utils;
+  PerfCounters counters;
+  PerfCounterValues values;
+  counters.Start();
+  volatile float sum = 0.f;
+  for (int i = 0; i < 100000; ++i) {
+    sum = sum + float(i);
+  }
+  counters.Stop(values);
+  if (!counters.available()) {
+    // 容器等环境下无法打开计数器，此时应退化为只统计时间
+    ASSERT_EQ(values.valid_mask, 0);
+    return;
+  }
+  ASSERT_NE(values.valid_mask, 0);
+  if (values.is_valid(PerfCounterType::kInstructions)) {
+    ASSERT_GT(values.value(PerfCounterType::kInstructions), 100000);
+  }
+}
+
+TEST(test_profiler, summary_with_counters) {
+  using namespace kuiper_infer::utils;
+  Profiler profiler(1024, true);
+  ASSERT_TRUE(profiler.hardware_counters());
+  const uint32_t op_id = profiler.RegisterOp("op", "type");
+  for (int i = 0; i < 10; ++i) {
+    ProfileScope scope(&profiler, op_id);
+    volatile float sum = 0.f;
+    for (int j = 0; j < 10000; ++j) {
+      sum = sum + float(j);
+    }
+  }
+  const auto& summary = profiler.Summary();
+  ASSERT_EQ(summary.size(), 1);
+  ASSERT_EQ(summary.front().count, 10);
+  if (profiler.LocalPerfCounters() == nullptr) {
+    ASSERT_EQ(summary.front().counters.valid_mask, 0);
+    ASSERT_EQ(summary.front().ipc, 0.);
+  } else if (summary.front().counters.is_valid(PerfCounterType::kInstructions) &&
+             summary.front().counters.is_valid(PerfCounterType::kCycles)) {
+    ASSERT_GT(summary.front().ipc, 0.);
+  }
+  profiler.SummaryLogging();
+}
@@ -21,6 +21,7 @@
 
 // Created by fss on 23-1-29.
 #include <gtest/gtest.h>
+#include "../../source/layer/details/cat.hpp"
 #include "data/load_data.hpp"
 #include "runtime/runtime_ir.hpp"
 
@@ -605,3 +606,107 @@ TEST(test_runtime, op_is_output) {
   ASSERT_EQ(graph.is_output_op("pnnx_output_0"), true);
   ASSERT_EQ(graph.is_output_op("random_str"), false);
 }
+
+namespace {
+std::shared_ptr<kuiper_infer::RuntimeOperator> MakePlanOperator(const std::string& name,
+                                                               const std::string& type,
+                                                               std::vector<int32_t> shapes) {
+  using namespace kuiper_infer;
+  auto op = std::make_shared<RuntimeOperator>();
+  op->name = name;
+  op->type = type;
+  std::vector<sftensor> datas;
+  for (int32_t b = 0; b < shapes.at(0); ++b) {
+    datas.push_back(std::make_shared<ftensor>(shapes.at(1), shapes.at(2), shapes.at(3)));
+  }
+  op->output_operands = std::make_shared<RuntimeOperand>(name + "_output", shapes, datas,
+                                                         RuntimeDataType::kTypeFloat32);
+  return op;
+}
+
+void ConnectPlanOperators(const std::shared_ptr<kuiper_infer::RuntimeOperator>& producer,
+                          const std::shared_ptr<kuiper_infer::RuntimeOperator>& consumer) {
+  using namespace kuiper_infer;
+  auto operand = std::make_shared<RuntimeOperand>(
+      producer->name, producer->output_operands->shapes,
+      uint32_t(producer->output_operands->shapes.at(0)), RuntimeDataType::kTypeFloat32);
+  consumer->input_operands.insert({producer->name, operand});
+  consumer->input_operands_seq.push_back(operand);
+  producer->output_operands_seq.push_back(operand);
+}
+}  // namespace
+
+TEST(test_runtime, plan_concat_outputs) {
+  using namespace kuiper_infer;
+  const int32_t batch = 2;
+  auto conv_a = MakePlanOperator("conv_a", "nn.Conv2d", {batch, 3, 4, 5});
+  auto conv_b = MakePlanOperator("conv_b", "nn.Conv2d", {batch, 2, 4, 5});
+  auto relu_b = MakePlanOperator("relu_b", "nn.ReLU", {batch, 2, 4, 5});
+  auto cat = MakePlanOperator("cat", "torch.cat", {batch, 5, 4, 5});
+  cat->params.insert({"dim", std::make_shared<RuntimeParameterInt>(1)});
+  // conv_b的输出同时被relu_b使用, 只能拷贝
+  ConnectPlanOperators(conv_a, cat);
+  ConnectPlanOperators(conv_b, cat);
+  ConnectPlanOperators(conv_b, relu_b);
+  // 拼接的输出与之前执行的conv_b共用内存
+  for (int32_t b = 0; b < batch; ++b) {
+    const sftensor& conv_b_output = conv_b->output_operands->datas.at(b);
+    cat->output_operands->datas.at(b) = std::make_shared<ftensor>(
+        conv_b_output->raw_ptr(), std::vector<uint32_t>{5, 4, 5});
+  }
+
+  std::vector<std::shared_ptr<RuntimeOperator>> operators = {conv_a, conv_b, relu_b, cat};
+  ASSERT_EQ(RuntimeOperatorUtils<float>::PlanConcatOutputs(operators), 1);
+
+  std::vector<sftensor> inputs;
+  for (const auto& producer : {conv_a, conv_b}) {
+    for (int32_t b = 0; b < batch; ++b) {
+      const sftensor& output = producer->output_operands->datas.at(b);
+      output->RandN();
+      inputs.push_back(output);
+    }
+  }
+  for (int32_t b = 0; b < batch; ++b) {
+    const sftensor& cat_output = cat->output_operands->datas.at(b);
+    ASSERT_NE(cat_output->raw_ptr(), conv_b->output_operands->datas.at(b)->raw_ptr());
+    ASSERT_EQ(conv_a->output_operands->datas.at(b)->raw_ptr(), cat_output->raw_ptr());
+    ASSERT_EQ(conv_a->output_operands->datas.at(b)->shapes(), std::vector<uint32_t>({3, 4, 5}));
+  }
+
+  CatLayer cat_layer(1);
+  std::vector<sftensor> outputs = cat->output_operands->datas;
+  ASSERT_EQ(cat_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+  for (int32_t b = 0; b < batch; ++b) {
+    const sftensor& cat_output = outputs.at(b);
+    ASSERT_EQ(cat_output, cat->output_operands->datas.at(b));
+    for (uint32_t c = 0; c < 5; ++c) {
+      const sftensor& input = c < 3 ? inputs.at(b) : inputs.at(batch + b);
+      const uint32_t in_channel = c < 3 ? c : c - 3;
+      ASSERT_TRUE(arma::approx_equal(cat_output->slice(c), input->slice(in_channel), "absdiff",
+                                     1e-6f));
+    }
+  }
+}
+
+TEST(test_runtime, extend_view_lifetimes) {
+  using namespace kuiper_infer;
+  auto conv = MakePlanOperator("conv", "nn.Conv2d", {1, 8, 1, 1});
+  auto view = MakePlanOperator("view", "Tensor.view", {1, 8, 1, 1});
+  auto flatten = MakePlanOperator("flatten", "torch.flatten", {1, 8, 1, 1});
+  auto linear = MakePlanOperator("linear", "nn.Linear", {1, 8, 1, 1});
+  ConnectPlanOperators(conv, view);
+  ConnectPlanOperators(view, flatten);
+  ConnectPlanOperators(flatten, linear);
+  std::vector<std::shared_ptr<RuntimeOperator>> operators = {conv, view, flatten, linear};
+  for (int32_t i = 0; i < 4; ++i) {
+    operators.at(i)->start_time = i + 1;
+    operators.at(i)->end_time = i + 2;
+  }
+
+  // 连续的view引用conv的输出, conv的输出要保留到linear执行
+  RuntimeOperatorUtils<float>::ExtendViewLifetimes(operators);
+  ASSERT_EQ(conv->end_time, 4);
+  ASSERT_EQ(view->end_time, 4);
+  ASSERT_EQ(flatten->end_time, 4);
+  ASSERT_EQ(linear->end_time, 5);
+}
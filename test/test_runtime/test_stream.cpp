@@ -0,0 +1,109 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include "runtime/runtime_stream.hpp"
+#include "utils/time/latency_histogram.hpp"
+
+TEST(test_stream, latency_histogram) {
+  using namespace kuiper_infer;
+  utils::LatencyHistogram histogram(100., 10);
+  ASSERT_EQ(histogram.count(), 0);
+  ASSERT_EQ(histogram.Percentile(50.), 0.);
+
+  // 1us到100us各一次, 以及一次超出最后一个桶
+  for (int64_t us = 1; us <= 100; ++us) {
+    histogram.Record(us * 1000 * 9);
+  }
+  histogram.Record(5000 * 1000);
+  ASSERT_EQ(histogram.count(), 101);
+  ASSERT_DOUBLE_EQ(histogram.min_us(), 9.);
+  ASSERT_DOUBLE_EQ(histogram.max_us(), 5000.);
+
+  const std::vector<uint64_t>& buckets = histogram.buckets();
+  ASSERT_EQ(buckets.size(), 10);
+  ASSERT_EQ(buckets.at(0), 11);
+  ASSERT_EQ(buckets.at(8), 11);
+  // 900us落入最后一个桶
+  ASSERT_EQ(buckets.at(9), 2);
+  ASSERT_DOUBLE_EQ(histogram.Percentile(10.), 100.);
+  ASSERT_DOUBLE_EQ(histogram.Percentile(50.), 500.);
+  ASSERT_DOUBLE_EQ(histogram.Percentile(100.), 5000.);
+
+  histogram.Reset();
+  ASSERT_EQ(histogram.count(), 0);
+  ASSERT_EQ(histogram.max_us(), 0.);
+}
+
+TEST(test_stream, forward_resnet18) {
+  using namespace kuiper_infer;
+  auto graph = std::make_shared<RuntimeGraph>("tmp/resnet/resnet18_batch1.param",
+                                              "tmp/resnet/resnet18_batch1.pnnx.bin");
+  graph->Build();
+
+  const uint32_t frame_num = 5;
+  std::vector<sftensor> frames;
+  std::vector<std::vector<float>> expected;
+  for (uint32_t i = 0; i < frame_num; ++i) {
+    sftensor frame = std::make_shared<ftensor>(3, 224, 224);
+    frame->RandN();
+    frames.push_back(frame);
+    graph->set_inputs("pnnx_input_0", {frame});
+    graph->Forward(false);
+    expected.push_back(graph->get_outputs("pnnx_output_0").front()->values());
+  }
+
+  RuntimeStreamSession session(graph, "pnnx_input_0", "pnnx_output_0", {1, 3, 224, 224});
+  auto write_frame = [&](uint32_t i) {
+    const sftensor& input = session.input().front();
+    std::copy(frames.at(i)->raw_ptr(), frames.at(i)->raw_ptr() + frames.at(i)->size(),
+              input->raw_ptr());
+  };
+
+  write_frame(0);
+  const float* first_buffer = session.input().front()->raw_ptr();
+  for (uint32_t i = 0; i < frame_num; ++i) {
+    session.Submit();
+    // 当前帧运行时写入下一帧
+    if (i + 1 < frame_num) {
+      write_frame(i + 1);
+    }
+    const std::vector<sftensor>& outputs = session.Wait();
+    ASSERT_EQ(outputs.size(), 1);
+    const std::vector<float>& values = outputs.front()->values();
+    for (uint32_t j = 0; j < values.size(); ++j) {
+      ASSERT_NEAR(values.at(j), expected.at(i).at(j), 1e-5f);
+    }
+  }
+  // 两个缓冲区交替使用
+  ASSERT_NE(session.input().front()->raw_ptr(), first_buffer);
+  ASSERT_EQ(session.frame_count(), frame_num);
+  ASSERT_EQ(session.latency().count(), frame_num);
+  ASSERT_GT(session.latency().Percentile(99.), 0.);
+
+  // 与图的输入不一致的形状在构造时就被拒绝
+  ASSERT_DEATH(RuntimeStreamSession(graph, "pnnx_input_0", "pnnx_output_0", {2, 3, 224, 224}),
+               "");
+  ASSERT_DEATH(RuntimeStreamSession(graph, "pnnx_input_0", "pnnx_output_0", {1, 3, 224, 223}),
+               "");
+}